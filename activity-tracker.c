@@ -1,8 +1,9 @@
 /*
  * activity-tracker - Track active window time on GNOME/Wayland
  *
- * Polls the active window title via the Window Calls GNOME Shell
- * extension's D-Bus interface, monitors screen lock via
+ * Follows the active window via FocusChanged signals from the companion
+ * shell extension (falling back to polling the Window Calls GNOME Shell
+ * extension's D-Bus interface), monitors screen lock via
  * org.gnome.ScreenSaver, and outputs CSV-formatted tracking data
  * to daily files under ~/.local/share/activity-tracker/.
  */
@@ -15,109 +16,337 @@
 #include <errno.h>
 #include <limits.h>
 #include <sys/file.h>
+#include <unistd.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <locale.h>
 
 #include "tracker-core.h"
 #include "discord-ipc.h"
+#include "session-events.h"
+#include "csv-writer.h"
+#include "binary-log.h"
+#include "day-archive.h"
+#include "range-stats.h"
+#include "live-stats.h"
+#include "status-page.h"
+#include "event-stream.h"
 
 #define POLL_INTERVAL_MS 1000
+#define SAFETY_POLL_INTERVAL_MS (30 * 1000) /* when focus events are pushed */
 #define IDLE_THRESHOLD_MS (5 * 60 * 1000)  /* 5 minutes */
 
 static DiscordIpcState discord_state;
+static FocusEvents focus_events;
+static IdleWatch idle_watch;        /* GetIdletime is polled without it */
+static gboolean focus_push_active;  /* companion extension is answering */
+static guint poll_source_id;
+static guint idle_poll_source_id;   /* GetIdletime between safety polls */
+static gboolean lock_state_known;   /* ActiveChanged seen or GetActive answered */
+
+static gboolean on_poll_timeout(gpointer user_data);
+static gboolean on_idle_poll_timeout(gpointer user_data);
+
+/* ── Asynchronous poll cycle ─────────────────────────── */
+
+/* GetIdletime and the window query are issued together; the tracking
+ * decision is made once both have answered.  GetIdletime is left out
+ * while Mutter's idle watches report the changes. */
+typedef struct {
+    AppState *state;
+    gint pending;             /* replies still outstanding */
+    gboolean poll_idle;       /* GetIdletime was asked */
+    guint64 idle_ms;
+    FocusedWindowInfo info;
+    const FocusedWindowInfo *focused;  /* &info, or the List() cache below */
+    gint64 started;           /* monotonic time the calls were issued */
+} PollRequest;
+
+static PollRequest *current_poll;  /* NULL when no poll is in flight */
+
+/* Last List() reply, identified by hash and length.  An identical reply
+ * reuses the parsed window instead of scanning the JSON again. */
+static struct {
+    guint64 hash;
+    gsize len;
+    FocusedWindowInfo info;
+} list_cache;
+
+/* Main loop health, printed on exit with --loop-stats */
+#define LOOP_PROBE_INTERVAL_MS 100
+
+static gboolean loop_stats_enabled;
+static gint64 loop_probe_expected;
+static LatencyHistogram loop_lag;
+static LatencyHistogram dbus_latency;
+static guint64 polls_started;
+static guint64 polls_skipped;
+static guint64 stale_replies;
+static guint64 list_replies;
+static guint64 list_unchanged;
+
+/* Output format and durability, set from the command line */
+static OutputFormat output_format = OUTPUT_CSV;
+static gboolean compress_closed = TRUE;
+static gboolean stats_cache = TRUE;
+static DurabilityMode durability_mode = DURABILITY_STRICT;
+static int sync_interval = 30;
+static int sync_records = 100;
+
+static CsvWriter *csv_writer;
+static LiveStats live_stats;  /* today's totals, served on the session bus */
+static StatusPageWriter *status_page; /* the interval in progress, for --now */
+static EventStream event_stream;      /* interval events for subscribers */
+
+/* In push mode idle time is still asked for every second, unless the
+ * idle watches report it */
+static void update_idle_poll(AppState *state)
+{
+    gboolean wanted = focus_push_active && !idle_watch_active(&idle_watch);
+
+    if (wanted && !idle_poll_source_id) {
+        idle_poll_source_id = g_timeout_add(POLL_INTERVAL_MS,
+                                            on_idle_poll_timeout, state);
+    } else if (!wanted && idle_poll_source_id) {
+        g_source_remove(idle_poll_source_id);
+        idle_poll_source_id = 0;
+    }
+}
 
-static FocusedWindowInfo query_active_window(AppState *state)
+static void on_idle_watch_active_changed(gboolean active G_GNUC_UNUSED,
+                                         gpointer user_data)
 {
-    FocusedWindowInfo info = {NULL, NULL, NULL, 0};
+    update_idle_poll(user_data);
+}
 
-    if (!state->shell_proxy)
-        return info;
+/* Switch between 1 s polling and the slow safety-net poll used while the
+ * companion extension pushes FocusChanged signals. */
+static void set_push_mode(AppState *state, gboolean enabled)
+{
+    if (focus_push_active == enabled && poll_source_id)
+        return;
 
-    GError *error = NULL;
-    GVariant *result = g_dbus_proxy_call_sync(
-        state->shell_proxy,
-        "List",
-        NULL,
-        G_DBUS_CALL_FLAGS_NONE,
-        500, /* timeout ms */
-        NULL,
-        &error);
+    focus_push_active = enabled;
+    if (poll_source_id)
+        g_source_remove(poll_source_id);
+    poll_source_id = g_timeout_add(enabled ? SAFETY_POLL_INTERVAL_MS
+                                           : POLL_INTERVAL_MS,
+                                   on_poll_timeout, state);
+    update_idle_poll(state);
+    g_printerr(enabled ? "[focus] Focus events active, polling every %ds\n"
+                       : "[focus] Focus events unavailable, polling every %ds\n",
+               (enabled ? SAFETY_POLL_INTERVAL_MS : POLL_INTERVAL_MS) / 1000);
+}
 
-    if (error) {
-        g_error_free(error);
-        return info;
+/* Start a new interval when the focused window's title or its rich
+ * presence differs from the one being tracked. */
+static void track_focused_window(AppState *state, const FocusedWindowInfo *info)
+{
+    if (!info->title)
+        return;
+
+    /* Look up rich presence data for this window's PID */
+    const gchar *rp_state = NULL;
+    const gchar *rp_details = NULL;
+    if (info->pid > 0 && discord_state.active) {
+        const RichPresenceEntry *rp = discord_ipc_lookup_pid(&discord_state, info->pid);
+        if (rp) {
+            rp_state = rp->state;
+            rp_details = rp->details;
+        }
     }
 
-    const gchar *json_str = NULL;
-    if (!g_variant_is_of_type(result, G_VARIANT_TYPE("(s)"))) {
-        g_variant_unref(result);
-        return info;
+    gboolean title_changed = !state->current_title ||
+                              g_strcmp0(state->current_title, info->title) != 0;
+    gboolean rp_changed = g_strcmp0(state->current_rp_state ? state->current_rp_state : "",
+                                    rp_state ? rp_state : "") != 0 ||
+                           g_strcmp0(state->current_rp_details ? state->current_rp_details : "",
+                                    rp_details ? rp_details : "") != 0;
+
+    if (title_changed || rp_changed) {
+        emit_csv_line(state);
+        start_tracking(state, info->title, info->wm_class, info->wm_class_instance,
+                       rp_state, rp_details, info->pid, FALSE);
     }
-    g_variant_get(result, "(&s)", &json_str);
+}
 
-    info = parse_focused_window(json_str);
+static void apply_poll_result(PollRequest *req)
+{
+    AppState *state = req->state;
 
-    g_variant_unref(result);
-    return info;
+    if (state->is_locked)
+        return;
+
+    if (!req->poll_idle)
+        goto track;
+
+    if (req->idle_ms >= IDLE_THRESHOLD_MS && !state->is_idle) {
+        emit_csv_line(state);
+        state->is_idle = TRUE;
+        start_tracking(state, "", "", "", NULL, NULL, 0, FALSE);
+        return;
+    }
+
+    if (req->idle_ms < IDLE_THRESHOLD_MS && state->is_idle) {
+        emit_csv_line(state);
+        state->is_idle = FALSE;
+        start_tracking(state, req->focused->title ? req->focused->title : "",
+                       req->focused->wm_class, req->focused->wm_class_instance,
+                       NULL, NULL, req->focused->pid, FALSE);
+        return;
+    }
+
+track:
+    if (state->is_idle)
+        return;
+
+    track_focused_window(state, req->focused);
+}
+
+/* Called once per reply.  The last one applies the result, unless a lock
+ * change or a pushed focus event superseded the request meanwhile. */
+static void poll_reply_done(PollRequest *req)
+{
+    if (--req->pending > 0)
+        return;
+
+    if (req == current_poll) {
+        current_poll = NULL;
+        apply_poll_result(req);
+    } else {
+        stale_replies++;
+    }
+    free_focused_window_info(&req->info);
+    g_free(req);
 }
 
-static gboolean query_screensaver_active(AppState *state)
+/* Drop the answer of an in-flight poll; newer information has already
+ * decided the tracking state. */
+static void invalidate_poll(void)
 {
+    current_poll = NULL;
+}
+
+static void on_idle_reply(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+    PollRequest *req = user_data;
     GError *error = NULL;
-    GVariant *result = g_dbus_connection_call_sync(
-        state->connection,
-        "org.gnome.ScreenSaver",
-        "/org/gnome/ScreenSaver",
-        "org.gnome.ScreenSaver",
-        "GetActive",
-        NULL,
-        G_VARIANT_TYPE("(b)"),
-        G_DBUS_CALL_FLAGS_NONE,
-        500,
-        NULL,
-        &error);
+    GVariant *result = g_dbus_proxy_call_finish(G_DBUS_PROXY(source), res, &error);
+    latency_histogram_add(&dbus_latency, g_get_monotonic_time() - req->started);
 
     if (error) {
         g_error_free(error);
-        return FALSE;  /* assume unlocked on failure */
+    } else {
+        if (g_variant_is_of_type(result, G_VARIANT_TYPE("(t)")))
+            g_variant_get(result, "(t)", &req->idle_ms);
+        g_variant_unref(result);
     }
+    poll_reply_done(req);
+}
 
-    gboolean active = FALSE;
-    if (!g_variant_is_of_type(result, G_VARIANT_TYPE("(b)"))) {
+static void on_list_reply(GObject *source, GAsyncResult *res, gpointer user_data)
+{
+    PollRequest *req = user_data;
+    GError *error = NULL;
+    GVariant *result = g_dbus_proxy_call_finish(G_DBUS_PROXY(source), res, &error);
+    latency_histogram_add(&dbus_latency, g_get_monotonic_time() - req->started);
+
+    if (error) {
+        g_error_free(error);
+    } else {
+        if (g_variant_is_of_type(result, G_VARIANT_TYPE("(s)"))) {
+            const gchar *json_str = NULL;
+            g_variant_get(result, "(&s)", &json_str);
+            gsize len = strlen(json_str);
+            guint64 hash = reply_hash(json_str, len);
+
+            list_replies++;
+            if (len == list_cache.len && hash == list_cache.hash) {
+                list_unchanged++;
+            } else {
+                free_focused_window_info(&list_cache.info);
+                list_cache.info = parse_focused_window(json_str);
+                list_cache.hash = hash;
+                list_cache.len = len;
+            }
+            req->focused = &list_cache.info;
+        }
         g_variant_unref(result);
-        return FALSE;
     }
-    g_variant_get(result, "(b)", &active);
-    g_variant_unref(result);
-    return active;
+    poll_reply_done(req);
 }
 
-static guint64 query_idle_time(AppState *state)
+static void query_window_list(PollRequest *req)
 {
-    if (!state->idle_proxy)
-        return 0;
+    if (!req->state->shell_proxy) {
+        poll_reply_done(req);
+        return;
+    }
+    g_dbus_proxy_call(req->state->shell_proxy,
+                      "List",
+                      NULL,
+                      G_DBUS_CALL_FLAGS_NONE,
+                      500, /* timeout ms */
+                      NULL,
+                      on_list_reply,
+                      req);
+}
 
+static void on_get_focused_reply(GObject *source G_GNUC_UNUSED,
+                                 GAsyncResult *res, gpointer user_data)
+{
+    PollRequest *req = user_data;
     GError *error = NULL;
-    GVariant *result = g_dbus_proxy_call_sync(
-        state->idle_proxy,
-        "GetIdletime",
-        NULL,
-        G_DBUS_CALL_FLAGS_NONE,
-        500,
-        NULL,
-        &error);
+    gboolean ok = focus_events_query_finish(&focus_events, res,
+                                            &req->info, &error);
+    latency_histogram_add(&dbus_latency, g_get_monotonic_time() - req->started);
 
-    if (error) {
+    if (!ok) {
         g_error_free(error);
-        return 0;
+        /* Extension disabled or shell restarted — poll until it is back */
+        set_push_mode(req->state, FALSE);
+        query_window_list(req);
+        return;
     }
+    poll_reply_done(req);
+}
 
-    guint64 idle_ms = 0;
-    if (g_variant_is_of_type(result, G_VARIANT_TYPE("(t)")))
-        g_variant_get(result, "(t)", &idle_ms);
-    g_variant_unref(result);
-    return idle_ms;
+/* Issue GetIdletime, unless the idle watches make it unnecessary, and the
+ * focused-window query concurrently, unless the previous poll is still
+ * waiting for gnome-shell. */
+static void start_poll(AppState *state)
+{
+    if (current_poll) {
+        polls_skipped++;
+        return;
+    }
+
+    PollRequest *req = g_new0(PollRequest, 1);
+    req->state = state;
+    req->pending = 2;
+    req->focused = &req->info;
+    req->started = g_get_monotonic_time();
+    current_poll = req;
+    polls_started++;
+
+    req->poll_idle = state->idle_proxy && !idle_watch_active(&idle_watch);
+    if (req->poll_idle)
+        g_dbus_proxy_call(state->idle_proxy,
+                          "GetIdletime",
+                          NULL,
+                          G_DBUS_CALL_FLAGS_NONE,
+                          500,
+                          NULL,
+                          on_idle_reply,
+                          req);
+    else
+        poll_reply_done(req);
+
+    if (focus_push_active)
+        focus_events_query_async(&focus_events, NULL,
+                                 on_get_focused_reply, req);
+    else
+        query_window_list(req);
 }
 
 static gboolean on_poll_timeout(gpointer user_data)
@@ -127,61 +356,142 @@ static gboolean on_poll_timeout(gpointer user_data)
     if (state->is_locked)
         return G_SOURCE_CONTINUE;
 
-    guint64 idle_ms = query_idle_time(state);
+    start_poll(state);
+    return G_SOURCE_CONTINUE;
+}
 
-    if (idle_ms >= IDLE_THRESHOLD_MS && !state->is_idle) {
-        emit_csv_line(state);
-        state->is_idle = TRUE;
-        start_tracking(state, "", "", "", NULL, NULL, 0, FALSE);
-        return G_SOURCE_CONTINUE;
-    }
+/* Between safety polls only idle time is asked for.  A crossing of the
+ * threshold either way starts a full poll, which records it together
+ * with the focused window. */
+static void on_idle_poll_reply(GObject *source, GAsyncResult *res,
+                               gpointer user_data)
+{
+    AppState *state = user_data;
+    GError *error = NULL;
+    GVariant *result = g_dbus_proxy_call_finish(G_DBUS_PROXY(source), res, &error);
+    guint64 idle_ms;
 
-    if (idle_ms < IDLE_THRESHOLD_MS && state->is_idle) {
-        emit_csv_line(state);
-        state->is_idle = FALSE;
-        FocusedWindowInfo info = query_active_window(state);
-        start_tracking(state, info.title ? info.title : "",
-                       info.wm_class, info.wm_class_instance,
-                       NULL, NULL, info.pid, FALSE);
-        free_focused_window_info(&info);
-        return G_SOURCE_CONTINUE;
+    if (error) {
+        g_error_free(error);
+        return;
+    }
+    if (!g_variant_is_of_type(result, G_VARIANT_TYPE("(t)"))) {
+        g_variant_unref(result);
+        return;
     }
+    g_variant_get(result, "(t)", &idle_ms);
+    g_variant_unref(result);
 
-    if (state->is_idle)
-        return G_SOURCE_CONTINUE;
+    if (state->is_locked || !focus_push_active ||
+        idle_watch_active(&idle_watch))
+        return;
+    if ((idle_ms >= IDLE_THRESHOLD_MS) != state->is_idle)
+        start_poll(state);
+}
 
-    FocusedWindowInfo info = query_active_window(state);
-    if (!info.title) {
-        free_focused_window_info(&info);
+static gboolean on_idle_poll_timeout(gpointer user_data)
+{
+    AppState *state = user_data;
+
+    /* A poll in flight asks GetIdletime itself */
+    if (state->is_locked || !state->idle_proxy || current_poll)
         return G_SOURCE_CONTINUE;
-    }
 
-    /* Look up rich presence data for this window's PID */
-    const gchar *rp_state = NULL;
-    const gchar *rp_details = NULL;
-    if (info.pid > 0 && discord_state.active) {
-        const RichPresenceEntry *rp = discord_ipc_lookup_pid(&discord_state, info.pid);
-        if (rp) {
-            rp_state = rp->state;
-            rp_details = rp->details;
-        }
-    }
+    g_dbus_proxy_call(state->idle_proxy,
+                      "GetIdletime",
+                      NULL,
+                      G_DBUS_CALL_FLAGS_NONE,
+                      500,
+                      NULL,
+                      on_idle_poll_reply,
+                      state);
+    return G_SOURCE_CONTINUE;
+}
 
-    gboolean title_changed = !state->current_title ||
-                              g_strcmp0(state->current_title, info.title) != 0;
-    gboolean rp_changed = g_strcmp0(state->current_rp_state ? state->current_rp_state : "",
-                                    rp_state ? rp_state : "") != 0 ||
-                           g_strcmp0(state->current_rp_details ? state->current_rp_details : "",
-                                    rp_details ? rp_details : "") != 0;
+static void on_focus_changed(FocusedWindowInfo *info, gpointer user_data)
+{
+    AppState *state = user_data;
 
-    if (title_changed || rp_changed) {
-        emit_csv_line(state);
-        start_tracking(state, info.title, info.wm_class, info.wm_class_instance,
-                       rp_state, rp_details, info.pid, FALSE);
+    /* First signal after a fallback period: the extension is back */
+    if (!focus_push_active)
+        set_push_mode(state, TRUE);
+
+    if (state->is_locked)
+        return;
+
+    /* The slow poll may not have noticed the user returning yet; the
+     * user-active watch, where there is one, reports it by itself */
+    if (state->is_idle) {
+        if (!idle_watch_active(&idle_watch))
+            start_poll(state);
+        return;
     }
 
+    /* This event is newer than whatever an in-flight poll will report */
+    invalidate_poll();
+    track_focused_window(state, info);
+}
+
+/* Mutter's watches fire the moment the threshold is crossed or input
+ * arrives, so the idle interval starts at its true time. */
+static void on_idle_changed(gboolean idle, gpointer user_data)
+{
+    AppState *state = user_data;
+
+    if (state->is_locked || state->is_idle == idle)
+        return;
+
+    invalidate_poll();
+    emit_csv_line(state);
+    state->is_idle = idle;
+    start_tracking(state, "", "", "", NULL, NULL, 0, FALSE);
+    /* Back from idle: resume tracking once the focused window is known */
+    if (!idle)
+        start_poll(state);
+}
+
+/* A game or editor in the focused window changed its rich presence: the
+ * interval ends when the frame arrived, not at the next poll, so every
+ * change is seen even when several come within a second.  With the proxy
+ * on its own thread a poll may already have looked up a newer presence
+ * than this notice carries; the notice is then dropped. */
+static void on_presence_changed(const RichPresenceEntry *entry,
+                                gpointer user_data)
+{
+    track_presence_change(user_data, entry->pid, entry->state,
+                          entry->details, entry->last_updated);
+}
+
+static void on_focus_probe_reply(GObject *source G_GNUC_UNUSED,
+                                 GAsyncResult *res, gpointer user_data)
+{
+    AppState *state = user_data;
+    FocusedWindowInfo info;
+    GError *error = NULL;
+
+    if (focus_events_query_finish(&focus_events, res, &info, &error))
+        set_push_mode(state, TRUE);
+    else
+        g_error_free(error);
     free_focused_window_info(&info);
-    return G_SOURCE_CONTINUE;
+}
+
+/* ── Screen lock ─────────────────────────────────────── */
+
+static void apply_lock_state(AppState *state, gboolean locked)
+{
+    invalidate_poll();
+    /* Lock takes precedence over idle; unlock means the user interacted */
+    state->is_idle = FALSE;
+    emit_csv_line(state);
+
+    if (locked) {
+        start_tracking(state, "", "", "", NULL, NULL, 0, TRUE);
+    } else {
+        /* Resume tracking once the focused window is known */
+        start_tracking(state, "", "", "", NULL, NULL, 0, FALSE);
+        start_poll(state);
+    }
 }
 
 static void on_screensaver_signal(GDBusConnection *connection G_GNUC_UNUSED,
@@ -198,27 +508,82 @@ static void on_screensaver_signal(GDBusConnection *connection G_GNUC_UNUSED,
         return;
     g_variant_get(parameters, "(b)", &active);
 
-    if (active) {
-        /* Screen locked — lock takes precedence over idle */
-        state->is_idle = FALSE;
-        emit_csv_line(state);
-        start_tracking(state, "", "", "", NULL, NULL, 0, TRUE);
+    lock_state_known = TRUE;
+    apply_lock_state(state, active);
+}
+
+static void on_screensaver_reply(GObject *source, GAsyncResult *res,
+                                 gpointer user_data)
+{
+    AppState *state = user_data;
+    GError *error = NULL;
+    GVariant *result = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                     res, &error);
+    gboolean active = FALSE;  /* assume unlocked on failure */
+
+    if (error) {
+        g_error_free(error);
     } else {
-        /* Screen unlocked — user just interacted */
-        state->is_idle = FALSE;
-        emit_csv_line(state);
-        /* Query current window to resume tracking */
-        FocusedWindowInfo info = query_active_window(state);
-        start_tracking(state, info.title ? info.title : "",
-                       info.wm_class, info.wm_class_instance,
-                       NULL, NULL, info.pid, FALSE);
-        free_focused_window_info(&info);
+        g_variant_get(result, "(b)", &active);
+        g_variant_unref(result);
     }
+
+    /* An ActiveChanged signal that arrived first is more recent */
+    if (lock_state_known)
+        return;
+    lock_state_known = TRUE;
+
+    if (active)
+        apply_lock_state(state, TRUE);
+}
+
+/* ── Loop health ─────────────────────────────────────── */
+
+static gboolean on_loop_probe(gpointer user_data G_GNUC_UNUSED)
+{
+    gint64 now = g_get_monotonic_time();
+    latency_histogram_add(&loop_lag, now - loop_probe_expected);
+    loop_probe_expected = now + LOOP_PROBE_INTERVAL_MS * 1000;
+    return G_SOURCE_CONTINUE;
+}
+
+static void print_loop_stats(void)
+{
+    print_latency_histogram(stderr, "Main loop dispatch lag", &loop_lag);
+    print_latency_histogram(stderr, "D-Bus reply latency", &dbus_latency);
+    fprintf(stderr, "Polls: %" G_GUINT64_FORMAT " started, %" G_GUINT64_FORMAT
+            " skipped while in flight, %" G_GUINT64_FORMAT " stale replies dropped\n",
+            polls_started, polls_skipped, stale_replies);
+    fprintf(stderr, "Window list: %" G_GUINT64_FORMAT " replies, %" G_GUINT64_FORMAT
+            " unchanged (%.1f%%)\n", list_replies, list_unchanged,
+            list_replies ? 100.0 * list_unchanged / list_replies : 0.0);
+
+    CsvWriterStats ws;
+    csv_writer_get_stats(csv_writer, &ws);
+    fprintf(stderr, "CSV writer: %" G_GUINT64_FORMAT " records queued, %" G_GUINT64_FORMAT
+            " written, %" G_GUINT64_FORMAT " overflowed, max ring depth %u\n",
+            ws.pushed, ws.written, ws.overflowed, ws.max_depth);
+
+    DiscordPresenceStats ps;
+    discord_ipc_get_presence_stats(&discord_state, &ps);
+    fprintf(stderr, "Rich presence: %u entries, evicted %" G_GUINT64_FORMAT
+            " on disconnect, %" G_GUINT64_FORMAT " on exit, %" G_GUINT64_FORMAT
+            " expired, %" G_GUINT64_FORMAT " over the limit\n",
+            ps.size, ps.evicted_closed, ps.evicted_exited, ps.evicted_expired,
+            ps.evicted_lru);
+
+    const DiscordProxyStats *xs = &discord_state.proxy_stats;
+    fprintf(stderr, "Discord proxy: %" G_GUINT64_FORMAT " bytes to Discord, %"
+            G_GUINT64_FORMAT " to clients (%" G_GUINT64_FORMAT " spliced), %"
+            G_GUINT64_FORMAT " reads held back, max %" G_GSIZE_FORMAT
+            " bytes buffered\n", xs->to_upstream, xs->to_client, xs->spliced,
+            xs->read_pauses, xs->max_buffered);
 }
 
 static gboolean on_signal(gpointer user_data)
 {
     AppState *state = user_data;
+    /* Queued for the writer thread, which is drained before exit */
     emit_csv_line(state);
     g_main_loop_quit(state->loop);
     return G_SOURCE_REMOVE;
@@ -255,21 +620,52 @@ static int try_acquire_lock(void)
 
 /* ── Stats mode ──────────────────────────────────────── */
 
-static int run_stats_mode(int year, int month, int day,
+static gchar *build_stats_cache_dir(void)
+{
+    return stats_cache
+        ? g_build_filename(g_get_user_cache_dir(), "activity-tracker", NULL)
+        : NULL;
+}
+
+/* The day's statistics from a running tracker, including the interval in
+ * progress; NULL when none is running or it does not count that day */
+static DayStats *query_running_tracker(int year, int month, int day)
+{
+    GDBusConnection *connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, NULL);
+    if (!connection)
+        return NULL;
+
+    DayStats *stats = NULL;
+    GError *error = NULL;
+    if (!live_stats_query(connection, year, month, day, &stats, &error)) {
+        /* No tracker on the bus is the usual case, not worth a message */
+        if (!g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_SERVICE_UNKNOWN) &&
+            !g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_NAME_HAS_NO_OWNER))
+            g_printerr("Running tracker did not answer, reading day files: %s\n",
+                       error->message);
+        g_error_free(error);
+    }
+    g_object_unref(connection);
+    return stats;
+}
+
+static int run_stats_mode(int year, int month, int day, guint jobs,
                           const StatsOptions *opts)
 {
-    gchar *csv_path = build_csv_path(NULL, year, month, day);
+    gboolean found = TRUE;
+    DayStats *stats = query_running_tracker(year, month, day);
+    if (!stats) {
+        gchar *cache_dir = build_stats_cache_dir();
+        stats = load_day_stats(NULL, year, month, day, jobs, cache_dir, &found);
+        g_free(cache_dir);
+    }
 
-    if (!g_file_test(csv_path, G_FILE_TEST_EXISTS)) {
+    if (!found) {
         g_printerr("No activity data for %04d-%02d-%02d.\n",
                     year, month, day);
-        g_free(csv_path);
         return 1;
     }
 
-    DayStats *stats = compute_day_stats(csv_path);
-    g_free(csv_path);
-
     if (!stats) {
         g_printerr("Failed to parse activity data.\n");
         return 1;
@@ -293,8 +689,178 @@ static int run_stats_mode(int year, int month, int day,
     return 0;
 }
 
+/* What the running tracker is tracking, from its status page */
+static int run_now_mode(void)
+{
+    gchar *path = status_page_default_path();
+    GError *error = NULL;
+    StatusPageReader *reader = status_page_reader_open(path, &error);
+    g_free(path);
+    if (!reader) {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+            g_printerr("Not tracking.\n");
+        else
+            g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    StatusSnapshot snap;
+    gboolean ok = status_page_read(reader, &snap);
+    status_page_reader_close(reader);
+    if (!ok || snap.state == STATUS_PAGE_STOPPED) {
+        g_printerr("Not tracking.\n");
+        return 1;
+    }
+
+    gint64 elapsed = (g_get_monotonic_time() - snap.start_monotonic) / G_USEC_PER_SEC;
+    gchar *duration = format_duration((long)MAX(elapsed, 0));
+    if (snap.state == STATUS_PAGE_LOCKED) {
+        printf("Locked (%s)\n", duration);
+    } else if (snap.state == STATUS_PAGE_IDLE) {
+        printf("Idle (%s)\n", duration);
+    } else {
+        /* Named as in the report: rich presence first, else the title */
+        gchar *what;
+        if (snap.rp_state[0] && snap.rp_details[0])
+            what = g_strdup_printf("%s | %s", snap.rp_state, snap.rp_details);
+        else
+            what = g_strdup(snap.rp_state[0] ? snap.rp_state :
+                            snap.rp_details[0] ? snap.rp_details : snap.title);
+        const gchar *app = snap.wm_class[0] ? snap.wm_class : "Unknown";
+        if (what[0])
+            printf("%s: %s (%s)\n", app, what, duration);
+        else
+            printf("%s (%s)\n", app, duration);
+        g_free(what);
+    }
+    g_free(duration);
+    return 0;
+}
+
+/* Finished intervals from the running tracker as day-file CSV lines, as
+ * they end, until it exits */
+static int run_follow_mode(void)
+{
+    gchar *path = event_stream_default_path();
+    GError *error = NULL;
+    int fd = event_stream_connect(path, &error);
+    g_free(path);
+    if (fd < 0) {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND) ||
+            g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CONNECTION_REFUSED))
+            g_printerr("Not tracking.\n");
+        else
+            g_printerr("%s\n", error->message);
+        g_error_free(error);
+        return 1;
+    }
+
+    fputs(CSV_HEADER, stdout);
+    fflush(stdout);
+
+    GByteArray *buf = g_byte_array_new();
+    GString *line = g_string_new(NULL);
+    guint8 chunk[64 * 1024];
+    int ret = 0;
+    for (;;) {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        g_byte_array_append(buf, chunk, n);
+
+        gsize offset = 0, consumed;
+        EventRecord ev;
+        int rc;
+        while ((rc = event_record_parse(buf->data + offset, buf->len - offset,
+                                        &ev, &consumed)) == 1) {
+            offset += consumed;
+            if (ev.kind == EVENT_FINISHED) {
+                CsvRecord rec = {(time_t)ev.wall, (long)ev.count,
+                                 event_status_name(ev.status), ev.title,
+                                 ev.wm_class, ev.wm_class_instance,
+                                 ev.rp_state, ev.rp_details};
+                g_string_truncate(line, 0);
+                serialize_csv_record(line, &rec, NULL);
+                fwrite(line->str, 1, line->len, stdout);
+                fflush(stdout);
+            } else if (ev.kind == EVENT_LOST) {
+                g_printerr("Fell behind the tracker, %u events missed\n",
+                           ev.count);
+            }
+            event_record_clear(&ev);
+        }
+        g_byte_array_remove_range(buf, 0, offset);
+        if (rc < 0) {
+            g_printerr("Unexpected data from the tracker\n");
+            ret = 1;
+            break;
+        }
+    }
+
+    g_string_free(line, TRUE);
+    g_byte_array_free(buf, TRUE);
+    close(fd);
+    return ret;
+}
+
+static int run_range_mode(const GDate *first, const GDate *last, guint jobs,
+                          const StatsOptions *opts)
+{
+    RangeStatsInfo info;
+    DayStats *stats = compute_range_stats(NULL, first, last, jobs, &info);
+    gchar from[16], to[16];
+    g_date_strftime(from, sizeof(from), "%Y-%m-%d", first);
+    g_date_strftime(to, sizeof(to), "%Y-%m-%d", last);
+
+    if (info.days_found == 0) {
+        free_day_stats(stats);
+        g_printerr("No activity data from %s to %s.\n", from, to);
+        return 1;
+    }
+    if (info.days_failed > 0)
+        g_printerr("Skipped %d unreadable day%s between %s and %s.\n",
+                   info.days_failed, info.days_failed == 1 ? "" : "s",
+                   from, to);
+
+    if (opts->grep_pattern) {
+        GError *error = NULL;
+        DayStats *filtered = filter_stats_by_grep(stats, opts->grep_pattern,
+                                                   &error);
+        free_day_stats(stats);
+        if (!filtered) {
+            g_printerr("Invalid grep pattern: %s\n", error->message);
+            g_error_free(error);
+            return 1;
+        }
+        stats = filtered;
+    }
+
+    print_range_report(stdout, stats, first, last, &info, opts);
+    free_day_stats(stats);
+    return 0;
+}
+
 /* ── Tracker mode (original main body) ───────────────── */
 
+/* Every finished interval is counted for GetDayStats, then queued for the
+ * writer thread */
+static void on_record(const CsvRecord *rec, gpointer user_data)
+{
+    live_stats_add_record(&live_stats, rec);
+    event_stream_publish_record(&event_stream, rec);
+    csv_writer_sink(rec, user_data);
+}
+
+static void on_tracking_changed(gpointer user_data)
+{
+    if (status_page)
+        status_page_publish_state(status_page, user_data);
+    event_stream_publish_start(&event_stream);
+}
+
 static int run_tracker_mode(int lock_fd)
 {
     AppState state = {0};
@@ -302,6 +868,11 @@ static int run_tracker_mode(int lock_fd)
     int ret = 1;
 
     state.loop = g_main_loop_new(NULL, FALSE);
+    state.output_format = output_format;
+    state.compress_closed = compress_closed;
+    state.durability = durability_mode;
+    state.sync_interval = sync_interval;
+    state.sync_records = sync_records;
 
     /* Connect to session bus */
     state.connection = g_bus_get_sync(G_BUS_TYPE_SESSION, NULL, &error);
@@ -343,6 +914,12 @@ static int run_tracker_mode(int lock_fd)
         g_clear_error(&error);
     }
 
+    /* Idle changes are pushed by watches once the monitor adds them;
+     * until then, and if it cannot, the poll asks GetIdletime. */
+    idle_watch_start(&idle_watch, state.connection, IDLE_THRESHOLD_MS,
+                     on_idle_changed, &state);
+    idle_watch.active_changed = on_idle_watch_active_changed;
+
     /* Subscribe to screen lock signals */
     state.screensaver_signal_id = g_dbus_connection_signal_subscribe(
         state.connection,
@@ -356,33 +933,84 @@ static int run_tracker_mode(int lock_fd)
         &state,
         NULL);
 
-    /* Set up Discord IPC proxy (optional — graceful degradation) */
-    if (!discord_ipc_setup(&discord_state))
-        g_printerr("Discord IPC proxy not available, rich presence disabled\n");
+    /* Subscribe to focus events from the companion extension; push mode
+     * starts once it answers GetFocused or emits its first signal. */
+    focus_events_subscribe(&focus_events, state.connection,
+                           on_focus_changed, &state);
+    focus_events_query_async(&focus_events, NULL, on_focus_probe_reply, &state);
 
-    /* Open initial output file */
-    if (!ensure_output_file(&state, time(NULL))) {
+    /* Set up Discord IPC proxy (optional — graceful degradation).  It runs
+     * on a thread of its own so games are answered while this loop waits
+     * on D-Bus or the disk. */
+    if (!discord_ipc_setup_full(&discord_state, TRUE))
+        g_printerr("Discord IPC proxy not available, rich presence disabled\n");
+    discord_state.presence_changed = on_presence_changed;
+    discord_state.presence_changed_data = &state;
+    discord_ipc_start(&discord_state);
+
+    /* Open initial output file; from here on all file I/O, including
+     * interval fsyncs, happens on the writer thread */
+    csv_writer = csv_writer_new(&state, time(NULL), CSV_WRITER_DEFAULT_CAPACITY);
+    if (!csv_writer) {
         g_printerr("Failed to open output file\n");
         goto cleanup;
     }
-
-    /* Initialize tracking with current state */
-    gboolean initially_locked = query_screensaver_active(&state);
-    if (initially_locked) {
-        start_tracking(&state, "", "", "", NULL, NULL, 0, TRUE);
-    } else if (query_idle_time(&state) >= IDLE_THRESHOLD_MS) {
-        state.is_idle = TRUE;
-        start_tracking(&state, "", "", "", NULL, NULL, 0, FALSE);
-    } else {
-        FocusedWindowInfo info = query_active_window(&state);
-        start_tracking(&state, info.title ? info.title : "",
-                       info.wm_class, info.wm_class_instance,
-                       NULL, NULL, info.pid, FALSE);
-        free_focused_window_info(&info);
+    state.record_sink = on_record;
+    state.record_sink_data = csv_writer;
+    csv_writer_start(csv_writer);
+
+    /* Today so far, read once the writer has cut off any torn record */
+    gchar *cache_dir = build_stats_cache_dir();
+    live_stats_init(&live_stats, &state, time(NULL), 0, cache_dir);
+    g_free(cache_dir);
+    if (!live_stats_export(&live_stats, state.connection, &error)) {
+        g_printerr("Live statistics not available on the session bus: %s\n",
+                   error->message);
+        g_clear_error(&error);
     }
 
-    /* Set up polling timer */
-    g_timeout_add(POLL_INTERVAL_MS, on_poll_timeout, &state);
+    /* Every new interval is published for --now and panel widgets, and
+     * sent to subscribers together with every finished one */
+    gchar *status_path = status_page_default_path();
+    status_page = status_page_writer_open(status_path, &error);
+    g_free(status_path);
+    if (!status_page) {
+        g_printerr("Status page not available: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    gchar *events_path = event_stream_default_path();
+    if (!event_stream_setup(&event_stream, events_path, &state, &error)) {
+        g_printerr("Event stream not available: %s\n", error->message);
+        g_clear_error(&error);
+    }
+    g_free(events_path);
+    state.tracking_changed = on_tracking_changed;
+    state.tracking_changed_data = &state;
+
+    /* Initialize tracking: the first poll picks up the focused window and
+     * idle state, GetActive switches to a locked interval if needed. */
+    g_dbus_connection_call(state.connection,
+                           "org.gnome.ScreenSaver",
+                           "/org/gnome/ScreenSaver",
+                           "org.gnome.ScreenSaver",
+                           "GetActive",
+                           NULL,
+                           G_VARIANT_TYPE("(b)"),
+                           G_DBUS_CALL_FLAGS_NONE,
+                           500,
+                           NULL,
+                           on_screensaver_reply,
+                           &state);
+    start_tracking(&state, "", "", "", NULL, NULL, 0, FALSE);
+    start_poll(&state);
+
+    /* Set up polling timer (slowed down once focus events arrive) */
+    poll_source_id = g_timeout_add(POLL_INTERVAL_MS, on_poll_timeout, &state);
+
+    if (loop_stats_enabled) {
+        loop_probe_expected = g_get_monotonic_time() + LOOP_PROBE_INTERVAL_MS * 1000;
+        g_timeout_add(LOOP_PROBE_INTERVAL_MS, on_loop_probe, NULL);
+    }
 
     /* Handle SIGINT and SIGTERM for clean shutdown */
     g_unix_signal_add(SIGINT, on_signal, &state);
@@ -390,9 +1018,30 @@ static int run_tracker_mode(int lock_fd)
 
     g_main_loop_run(state.loop);
     ret = 0;
+    discord_ipc_stop(&discord_state);
+
+    if (loop_stats_enabled)
+        print_loop_stats();
 
 cleanup:
+    if (poll_source_id)
+        g_source_remove(poll_source_id);
+    poll_source_id = 0;
+    if (idle_poll_source_id)
+        g_source_remove(idle_poll_source_id);
+    idle_poll_source_id = 0;
+    focus_events_unsubscribe(&focus_events);
+    idle_watch_stop(&idle_watch);
+    free_focused_window_info(&list_cache.info);
     discord_ipc_cleanup(&discord_state);
+    live_stats_clear(&live_stats);
+    state.tracking_changed = NULL;
+    status_page_writer_close(status_page);
+    status_page = NULL;
+    event_stream_cleanup(&event_stream);
+    /* Writes out every interval still queued, including the final one */
+    csv_writer_free(csv_writer);
+    csv_writer = NULL;
     close_output_file(&state);
     if (state.screensaver_signal_id)
         g_dbus_connection_signal_unsubscribe(state.connection,
@@ -425,11 +1074,33 @@ static void print_usage(const char *prog)
         "\n"
         "Options:\n"
         "  -s, --stats              Show activity report and exit\n"
+        "      --now                Show what the running tracker is tracking and\n"
+        "                           for how long\n"
+        "      --follow             Print each interval the running tracker finishes,\n"
+        "                           as a CSV line, until it exits\n"
         "  -d, --date YYYY-MM-DD    Report for a specific date (default: today)\n"
+        "      --from YYYY-MM-DD    Report for a range of days, up to --to or today\n"
+        "      --to YYYY-MM-DD      Last day of the --from range\n"
+        "      --week               Report for the week (Monday to Sunday) of --date\n"
+        "      --month              Report for the month of --date\n"
+        "      --year               Report for the year of --date\n"
+        "  -j, --jobs N             Threads reading day files\n"
+        "                           (default: one per processor)\n"
         "  -n, --top-apps N         Number of applications to show (default: 20)\n"
         "  -t, --top-titles N       Window titles per application (default: 5)\n"
         "  -g, --grep PATTERN       Filter by regex on app names and titles\n"
         "  -c, --cols N             Output width in columns (default: 80)\n"
+        "      --sync MODE          When to fsync the CSV: strict (every record,\n"
+        "                           default), interval or rotation\n"
+        "      --sync-interval SECS Interval mode: fsync at least every SECS s (default: 30)\n"
+        "      --sync-records N     Interval mode: fsync after N records (default: 100)\n"
+        "      --loop-stats         Print main loop latency histogram on exit\n"
+        "      --format FORMAT      Daily file format: csv (default) or binary\n"
+        "      --export-csv FILE    Print a binary activity log as CSV and exit\n"
+        "      --no-compress        Keep finished CSV days uncompressed instead of\n"
+        "                           gzipping them after midnight\n"
+        "      --no-cache           Parse the whole day file for a report instead of\n"
+        "                           only what was appended since the last one\n"
         "  -h, --help               Show this help message\n",
         prog);
 }
@@ -446,30 +1117,69 @@ static gboolean parse_date(const char *str, int *year, int *month, int *day)
     return TRUE;
 }
 
+static gboolean parse_gdate(const char *str, GDate *date)
+{
+    int year, month, day;
+    if (!parse_date(str, &year, &month, &day) ||
+        !g_date_valid_dmy(day, month, year))
+        return FALSE;
+    g_date_clear(date, 1);
+    g_date_set_dmy(date, day, month, year);
+    return TRUE;
+}
+
 int main(int argc, char *argv[])
 {
     setlocale(LC_CTYPE, "");
     gboolean explicit_stats = FALSE;
+    gboolean now_mode = FALSE;
+    gboolean follow_mode = FALSE;
     const char *date_str = NULL;
+    const char *export_path = NULL;
+    const char *from_str = NULL, *to_str = NULL;
+    int period = -1;
+    guint jobs = 0;
     StatsOptions opts = { .top_apps = 20, .top_titles = 5, .grep_pattern = NULL, .cols = 80 };
 
     static struct option long_options[] = {
         {"stats",      no_argument,       NULL, 's'},
+        {"now",        no_argument,       NULL, 'N'},
+        {"follow",     no_argument,       NULL, 'O'},
         {"date",       required_argument, NULL, 'd'},
         {"top-apps",   required_argument, NULL, 'n'},
         {"top-titles", required_argument, NULL, 't'},
         {"grep",       required_argument, NULL, 'g'},
         {"cols",       required_argument, NULL, 'c'},
+        {"sync",       required_argument, NULL, 'S'},
+        {"sync-interval", required_argument, NULL, 'I'},
+        {"sync-records", required_argument, NULL, 'R'},
+        {"loop-stats", no_argument,       NULL, 'L'},
+        {"format",     required_argument, NULL, 'F'},
+        {"export-csv", required_argument, NULL, 'E'},
+        {"no-compress", no_argument,      NULL, 'Z'},
+        {"no-cache",   no_argument,       NULL, 'C'},
+        {"from",       required_argument, NULL, 'f'},
+        {"to",         required_argument, NULL, 'T'},
+        {"week",       no_argument,       NULL, 'W'},
+        {"month",      no_argument,       NULL, 'M'},
+        {"year",       no_argument,       NULL, 'Y'},
+        {"jobs",       required_argument, NULL, 'j'},
         {"help",       no_argument,       NULL, 'h'},
         {NULL, 0, NULL, 0}
     };
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "sd:n:t:g:c:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "sd:n:t:g:c:j:h", long_options, NULL)) != -1) {
         switch (opt) {
         case 's':
             explicit_stats = TRUE;
             break;
+        case 'N':
+            now_mode = TRUE;
+            break;
+        case 'O':
+            follow_mode = TRUE;
+            break;
         case 'd':
             date_str = optarg;
             explicit_stats = TRUE;
@@ -511,6 +1221,77 @@ int main(int argc, char *argv[])
             opts.cols = (int)val;
             break;
         }
+        case 'S':
+            if (!parse_durability_mode(optarg, &durability_mode)) {
+                g_printerr("--sync must be strict, interval or rotation\n");
+                return 1;
+            }
+            break;
+        case 'I': {
+            char *endptr;
+            errno = 0;
+            long val = strtol(optarg, &endptr, 10);
+            if (errno || *endptr != '\0' || val < 0 || val > 86400) {
+                g_printerr("--sync-interval must be between 0 and 86400 seconds\n");
+                return 1;
+            }
+            sync_interval = (int)val;
+            break;
+        }
+        case 'R': {
+            char *endptr;
+            errno = 0;
+            long val = strtol(optarg, &endptr, 10);
+            if (errno || *endptr != '\0' || val < 0 || val > INT_MAX) {
+                g_printerr("--sync-records must be a non-negative integer\n");
+                return 1;
+            }
+            sync_records = (int)val;
+            break;
+        }
+        case 'L':
+            loop_stats_enabled = TRUE;
+            break;
+        case 'F':
+            if (!parse_output_format(optarg, &output_format)) {
+                g_printerr("--format must be csv or binary\n");
+                return 1;
+            }
+            break;
+        case 'E':
+            export_path = optarg;
+            break;
+        case 'Z':
+            compress_closed = FALSE;
+            break;
+        case 'C':
+            stats_cache = FALSE;
+            break;
+        case 'f':
+            from_str = optarg;
+            explicit_stats = TRUE;
+            break;
+        case 'T':
+            to_str = optarg;
+            explicit_stats = TRUE;
+            break;
+        case 'W':
+        case 'M':
+        case 'Y':
+            period = opt == 'W' ? RANGE_WEEK : opt == 'M' ? RANGE_MONTH : RANGE_YEAR;
+            explicit_stats = TRUE;
+            break;
+        case 'j': {
+            char *endptr;
+            errno = 0;
+            long val = strtol(optarg, &endptr, 10);
+            if (errno || *endptr != '\0' || val < 1 || val > 1024) {
+                g_printerr("--jobs must be between 1 and 1024\n");
+                return 1;
+            }
+            jobs = (guint)val;
+            break;
+        }
         case 'h':
             print_usage(argv[0]);
             return 0;
@@ -520,6 +1301,14 @@ int main(int argc, char *argv[])
         }
     }
 
+    if (export_path)
+        return binlog_export_csv(export_path, stdout) ? 0 : 1;
+
+    if (now_mode)
+        return run_now_mode();
+    if (follow_mode)
+        return run_follow_mode();
+
     /* Resolve date */
     int year, month, day;
     if (date_str) {
@@ -537,13 +1326,54 @@ int main(int argc, char *argv[])
         day = tm.tm_mday;
     }
 
+    if ((from_str || to_str || period >= 0) &&
+        !g_date_valid_dmy(day, month, year)) {
+        g_printerr("Invalid date: %s\n", date_str);
+        return 1;
+    }
+
+    if (from_str || to_str) {
+        GDate first, last;
+        if (!from_str || period >= 0) {
+            g_printerr("--to needs --from, which cannot be combined with "
+                       "--week, --month or --year\n");
+            return 1;
+        }
+        if (!parse_gdate(from_str, &first)) {
+            g_printerr("Invalid date: %s (expected YYYY-MM-DD)\n", from_str);
+            return 1;
+        }
+        if (to_str) {
+            if (!parse_gdate(to_str, &last)) {
+                g_printerr("Invalid date: %s (expected YYYY-MM-DD)\n", to_str);
+                return 1;
+            }
+        } else {
+            g_date_clear(&last, 1);
+            g_date_set_dmy(&last, day, month, year);
+        }
+        if (g_date_compare(&first, &last) > 0) {
+            g_printerr("--from must not be after --to\n");
+            return 1;
+        }
+        return run_range_mode(&first, &last, jobs, &opts);
+    }
+
+    if (period >= 0) {
+        GDate date, first, last;
+        g_date_clear(&date, 1);
+        g_date_set_dmy(&date, day, month, year);
+        range_for_period(period, &date, &first, &last);
+        return run_range_mode(&first, &last, jobs, &opts);
+    }
+
     if (explicit_stats)
-        return run_stats_mode(year, month, day, &opts);
+        return run_stats_mode(year, month, day, jobs, &opts);
 
     /* Auto-detect: try to acquire lock */
     int lock_fd = try_acquire_lock();
     if (lock_fd < 0)
-        return run_stats_mode(year, month, day, &opts);
+        return run_stats_mode(year, month, day, jobs, &opts);
 
     return run_tracker_mode(lock_fd);
 }
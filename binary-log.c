@@ -0,0 +1,401 @@
+#define _GNU_SOURCE
+#include "binary-log.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+gboolean binlog_has_magic(const gchar *data, gsize len)
+{
+    return len >= BINLOG_MAGIC_LEN &&
+           memcmp(data, BINLOG_MAGIC, BINLOG_MAGIC_LEN) == 0;
+}
+
+const gchar *binlog_status_name(BinlogStatus status)
+{
+    switch (status) {
+    case BINLOG_STATUS_IDLE:   return "idle";
+    case BINLOG_STATUS_LOCKED: return "locked";
+    case BINLOG_STATUS_ACTIVE:
+    default:                   return "active";
+    }
+}
+
+static BinlogStatus binlog_status_from_name(const gchar *name)
+{
+    if (g_strcmp0(name, "locked") == 0)
+        return BINLOG_STATUS_LOCKED;
+    if (g_strcmp0(name, "idle") == 0)
+        return BINLOG_STATUS_IDLE;
+    return BINLOG_STATUS_ACTIVE;
+}
+
+/* ── Varints ────────────────────────────────────────── */
+
+static void put_varint(GByteArray *buf, guint64 v)
+{
+    guint8 bytes[10];
+    guint n = 0;
+    while (v >= 0x80) {
+        bytes[n++] = (guint8)(v | 0x80);
+        v >>= 7;
+    }
+    bytes[n++] = (guint8)v;
+    g_byte_array_append(buf, bytes, n);
+}
+
+static gboolean get_varint(const guint8 *data, gsize len, gsize *pos,
+                           guint64 *out)
+{
+    guint64 v = 0;
+    for (guint shift = 0; shift < 64 && *pos < len; shift += 7) {
+        guint8 b = data[(*pos)++];
+        v |= (guint64)(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static inline guint64 zigzag_encode(gint64 v)
+{
+    return ((guint64)v << 1) ^ (guint64)(v >> 63);
+}
+
+static inline gint64 zigzag_decode(guint64 v)
+{
+    return (gint64)(v >> 1) ^ -(gint64)(v & 1);
+}
+
+/* ── Reader ─────────────────────────────────────────── */
+
+gboolean binlog_reader_init(BinlogReader *reader, const gchar *data, gsize len)
+{
+    memset(reader, 0, sizeof(*reader));
+    if (!binlog_has_magic(data, len))
+        return FALSE;
+
+    reader->data = (const guint8 *)data;
+    reader->len = len;
+    reader->pos = BINLOG_MAGIC_LEN;
+    reader->strings = g_ptr_array_new();
+    g_ptr_array_add(reader->strings, "");
+    /* Every STRING entry is at least one byte longer than its copy plus
+     * the NUL, so the pool never has to grow and the strings never move */
+    reader->pool = g_malloc(len);
+    return TRUE;
+}
+
+static gboolean get_string_id(const BinlogReader *reader, gsize *pos,
+                              guint32 *id)
+{
+    guint64 v;
+    if (!get_varint(reader->data, reader->len, pos, &v) ||
+        v >= reader->strings->len)
+        return FALSE;
+    *id = (guint32)v;
+    return TRUE;
+}
+
+gboolean binlog_reader_next(BinlogReader *reader, BinlogRecord *rec)
+{
+    const guint8 *data = reader->data;
+    gsize len = reader->len;
+
+    while (reader->pos < len) {
+        gsize p = reader->pos;
+        guint64 v;
+
+        switch (data[p++]) {
+        case BINLOG_ENTRY_STRING: {
+            if (!get_varint(data, len, &p, &v) || v > len - p)
+                return FALSE;
+            gchar *copy = reader->pool + reader->pool_used;
+            memcpy(copy, data + p, v);
+            copy[v] = '\0';
+            reader->pool_used += v + 1;
+            g_ptr_array_add(reader->strings, copy);
+            reader->pos = p + v;
+            continue;
+        }
+
+        case BINLOG_ENTRY_RECORD: {
+            guint64 delta, duration;
+            if (p >= len || data[p] > BINLOG_STATUS_LOCKED)
+                return FALSE;
+            rec->status = data[p++];
+            if (!get_varint(data, len, &p, &delta) ||
+                !get_varint(data, len, &p, &duration) ||
+                duration > G_MAXLONG ||
+                !get_string_id(reader, &p, &rec->title) ||
+                !get_string_id(reader, &p, &rec->wm_class) ||
+                !get_string_id(reader, &p, &rec->wm_class_instance) ||
+                !get_string_id(reader, &p, &rec->rp_state) ||
+                !get_string_id(reader, &p, &rec->rp_details))
+                return FALSE;
+            rec->wall = reader->last_end + zigzag_decode(delta);
+            rec->duration = (long)duration;
+            reader->last_end = rec->wall + rec->duration;
+            reader->pos = p;
+            return TRUE;
+        }
+
+        default:
+            return FALSE;
+        }
+    }
+    return FALSE;
+}
+
+const gchar *binlog_reader_string(const BinlogReader *reader, guint32 id)
+{
+    return g_ptr_array_index(reader->strings, id);
+}
+
+void binlog_reader_to_csv(const BinlogReader *reader, const BinlogRecord *rec,
+                          CsvRecord *out)
+{
+    out->wall = (time_t)rec->wall;
+    out->duration = rec->duration;
+    out->status = binlog_status_name(rec->status);
+    out->title = binlog_reader_string(reader, rec->title);
+    out->wm_class = binlog_reader_string(reader, rec->wm_class);
+    out->wm_class_instance = binlog_reader_string(reader, rec->wm_class_instance);
+    out->rp_state = binlog_reader_string(reader, rec->rp_state);
+    out->rp_details = binlog_reader_string(reader, rec->rp_details);
+}
+
+void binlog_reader_clear(BinlogReader *reader)
+{
+    if (reader->strings)
+        g_ptr_array_free(reader->strings, TRUE);
+    g_free(reader->pool);
+    memset(reader, 0, sizeof(*reader));
+}
+
+gboolean binlog_export_csv(const gchar *path, FILE *out)
+{
+    gchar *contents = NULL;
+    gsize len = 0;
+    if (!g_file_get_contents(path, &contents, &len, NULL)) {
+        g_printerr("Failed to read %s\n", path);
+        return FALSE;
+    }
+
+    BinlogReader reader;
+    if (!binlog_reader_init(&reader, contents, len)) {
+        g_printerr("%s is not a binary activity log\n", path);
+        g_free(contents);
+        return FALSE;
+    }
+
+    fputs(CSV_HEADER, out);
+    GString *line = g_string_sized_new(512);
+    TimestampCache cache = {0};
+    BinlogRecord rec;
+    while (binlog_reader_next(&reader, &rec)) {
+        CsvRecord csv;
+        binlog_reader_to_csv(&reader, &rec, &csv);
+        g_string_truncate(line, 0);
+        serialize_csv_record(line, &csv, &cache);
+        fwrite(line->str, 1, line->len, out);
+    }
+
+    if (reader.pos < len)
+        g_printerr("Ignored %" G_GSIZE_FORMAT " bytes of an incomplete entry at the end of %s\n",
+                   len - reader.pos, path);
+
+    g_string_free(line, TRUE);
+    binlog_reader_clear(&reader);
+    g_free(contents);
+    return fflush(out) == 0;
+}
+
+/* ── Writer ─────────────────────────────────────────── */
+
+struct _BinlogWriter {
+    int fd;
+    off_t size;            /* end of the last complete entry */
+    gint64 last_end;       /* wall + duration of the last record */
+    GPtrArray *strings;    /* gchar*, index = string id */
+    GHashTable *ids;       /* string (owned by strings) -> id */
+    GByteArray *buf;       /* entry being built, reused */
+};
+
+static gboolean write_all(int fd, const guint8 *data, gsize len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+        data += n;
+        len -= n;
+    }
+    return TRUE;
+}
+
+/* Reads the whole file behind fd */
+static gchar *read_fd(int fd, gsize size)
+{
+    gchar *data = g_malloc(size ? size : 1);
+    gsize done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, data + done, size - done, done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0) {
+            g_free(data);
+            return NULL;
+        }
+        done += n;
+    }
+    return data;
+}
+
+BinlogWriter *binlog_writer_new(int fd, const gchar *path)
+{
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        return NULL;
+
+    gchar *data = read_fd(fd, st.st_size);
+    if (!data) {
+        g_printerr("Failed to read %s: %s\n", path, g_strerror(errno));
+        return NULL;
+    }
+
+    BinlogWriter *w = g_new0(BinlogWriter, 1);
+    w->fd = fd;
+    w->buf = g_byte_array_sized_new(512);
+
+    gsize size = st.st_size;
+    BinlogReader reader;
+    if (binlog_reader_init(&reader, data, size)) {
+        BinlogRecord rec;
+        while (binlog_reader_next(&reader, &rec))
+            ;
+        w->size = reader.pos;
+        w->last_end = reader.last_end;
+        w->strings = g_ptr_array_new_full(reader.strings->len, g_free);
+        for (guint i = 0; i < reader.strings->len; i++)
+            g_ptr_array_add(w->strings, g_strdup(g_ptr_array_index(reader.strings, i)));
+        binlog_reader_clear(&reader);
+    } else if (size < BINLOG_MAGIC_LEN &&
+               memcmp(data, BINLOG_MAGIC, size) == 0) {
+        /* Empty, or the magic itself was torn */
+        w->size = 0;
+        w->strings = g_ptr_array_new_with_free_func(g_free);
+        g_ptr_array_add(w->strings, g_strdup(""));
+    } else {
+        g_printerr("%s is not a binary activity log\n", path);
+        g_free(data);
+        binlog_writer_free(w);
+        return NULL;
+    }
+    g_free(data);
+
+    if ((gsize)w->size < size) {
+        if (!truncate_day_file(fd, w->size) || fsync(fd) != 0) {
+            g_printerr("Failed to truncate %s: %s\n", path, g_strerror(errno));
+            binlog_writer_free(w);
+            return NULL;
+        }
+        if (w->size > 0)
+            g_printerr("Dropped %" G_GSIZE_FORMAT " bytes of an incomplete entry from %s\n",
+                       size - (gsize)w->size, path);
+    }
+
+    if (w->size == 0) {
+        if (!write_all(fd, (const guint8 *)BINLOG_MAGIC, BINLOG_MAGIC_LEN)) {
+            g_printerr("Failed to write %s: %s\n", path, g_strerror(errno));
+            binlog_writer_free(w);
+            return NULL;
+        }
+        w->size = BINLOG_MAGIC_LEN;
+    }
+
+    w->ids = g_hash_table_new(g_str_hash, g_str_equal);
+    for (guint i = 0; i < w->strings->len; i++)
+        g_hash_table_insert(w->ids, g_ptr_array_index(w->strings, i),
+                            GUINT_TO_POINTER(i));
+    return w;
+}
+
+/* Id of str, queueing a STRING entry into the buffer when it is new */
+static guint32 writer_intern(BinlogWriter *w, const gchar *str)
+{
+    if (!str || !str[0])
+        return 0;
+
+    gpointer id;
+    if (g_hash_table_lookup_extended(w->ids, str, NULL, &id))
+        return GPOINTER_TO_UINT(id);
+
+    gsize len = strlen(str);
+    guint8 tag = BINLOG_ENTRY_STRING;
+    g_byte_array_append(w->buf, &tag, 1);
+    put_varint(w->buf, len);
+    g_byte_array_append(w->buf, (const guint8 *)str, len);
+
+    gchar *copy = g_strndup(str, len);
+    guint32 new_id = w->strings->len;
+    g_ptr_array_add(w->strings, copy);
+    g_hash_table_insert(w->ids, copy, GUINT_TO_POINTER(new_id));
+    return new_id;
+}
+
+gboolean binlog_writer_append(BinlogWriter *w, const CsvRecord *rec)
+{
+    guint known = w->strings->len;
+    g_byte_array_set_size(w->buf, 0);
+
+    guint32 ids[5] = {
+        writer_intern(w, rec->title),
+        writer_intern(w, rec->wm_class),
+        writer_intern(w, rec->wm_class_instance),
+        writer_intern(w, rec->rp_state),
+        writer_intern(w, rec->rp_details),
+    };
+
+    guint8 head[2] = {BINLOG_ENTRY_RECORD, binlog_status_from_name(rec->status)};
+    g_byte_array_append(w->buf, head, 2);
+    long duration = MAX(rec->duration, 0);
+    put_varint(w->buf, zigzag_encode((gint64)rec->wall - w->last_end));
+    put_varint(w->buf, (guint64)duration);
+    for (int i = 0; i < 5; i++)
+        put_varint(w->buf, ids[i]);
+
+    if (!write_all(w->fd, w->buf->data, w->buf->len)) {
+        int saved = errno;
+        /* Forget the strings that did not make it and drop a partial
+         * entry, so the next record is not appended to garbage */
+        for (guint i = known; i < w->strings->len; i++)
+            g_hash_table_remove(w->ids, g_ptr_array_index(w->strings, i));
+        g_ptr_array_set_size(w->strings, known);
+        if (!truncate_day_file(w->fd, w->size))
+            g_printerr("Failed to drop a partial entry: %s\n", g_strerror(errno));
+        errno = saved;
+        return FALSE;
+    }
+
+    w->size += w->buf->len;
+    w->last_end = (gint64)rec->wall + duration;
+    return TRUE;
+}
+
+void binlog_writer_free(BinlogWriter *writer)
+{
+    if (!writer)
+        return;
+    if (writer->ids)
+        g_hash_table_destroy(writer->ids);
+    if (writer->strings)
+        g_ptr_array_free(writer->strings, TRUE);
+    g_byte_array_free(writer->buf, TRUE);
+    g_free(writer);
+}
@@ -0,0 +1,101 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <glib.h>
+#include "tracker-core.h"
+
+/* ── Binary activity log ────────────────────────────── *
+ *
+ * An append-only alternative to the daily CSV.  Every distinct string is
+ * stored once, in a STRING entry that assigns it the next id; RECORD
+ * entries refer to strings by id.  Layout, all integers unsigned LEB128
+ * varints unless noted:
+ *
+ *   magic    8 bytes, BINLOG_MAGIC (the last byte is the version)
+ *   STRING   0x01, length, bytes                  -> id 1, 2, 3, ...
+ *   RECORD   0x02, status byte, zigzag difference between the start time
+ *            and the end (start + duration) of the previous record, 0 for
+ *            the first, then the duration and the ids of title, wm_class,
+ *            wm_class_instance, rp_state and rp_details
+ *
+ * Intervals follow each other, so the start time usually takes one byte.
+ *
+ * Id 0 is the empty string and is never written.  The strings a record
+ * introduces go out in the same write(2) as the record, directly before
+ * it, so a torn write leaves at most one incomplete entry at the end. */
+
+#define BINLOG_MAGIC     "\x89" "ATLOG\n\x01"
+#define BINLOG_MAGIC_LEN 8
+
+enum {
+    BINLOG_ENTRY_STRING = 0x01,
+    BINLOG_ENTRY_RECORD = 0x02,
+};
+
+typedef enum {
+    BINLOG_STATUS_ACTIVE = 0,
+    BINLOG_STATUS_IDLE   = 1,
+    BINLOG_STATUS_LOCKED = 2,
+} BinlogStatus;
+
+typedef struct {
+    gint64 wall;
+    long duration;
+    BinlogStatus status;
+    guint32 title;             /* string ids, see binlog_reader_string() */
+    guint32 wm_class;
+    guint32 wm_class_instance;
+    guint32 rp_state;
+    guint32 rp_details;
+} BinlogRecord;
+
+gboolean binlog_has_magic(const gchar *data, gsize len);
+const gchar *binlog_status_name(BinlogStatus status);
+
+/* ── Reader ─────────────────────────────────────────── */
+
+/* Decodes a log held in memory.  strings grows as STRING entries are
+ * read and stays valid until binlog_reader_clear(). */
+typedef struct {
+    const guint8 *data;
+    gsize len;
+    gsize pos;             /* end of the last complete entry */
+    gint64 last_end;       /* wall + duration of the last record */
+    GPtrArray *strings;    /* const gchar* into pool, index = string id */
+    gchar *pool;           /* NUL-terminated copies of the strings */
+    gsize pool_used;
+} BinlogReader;
+
+/* FALSE when data does not start with BINLOG_MAGIC. */
+gboolean binlog_reader_init(BinlogReader *reader, const gchar *data, gsize len);
+
+/* Next record, FALSE at the end of the data or at the first incomplete or
+ * malformed entry; reader->pos then tells how much of the data is valid. */
+gboolean binlog_reader_next(BinlogReader *reader, BinlogRecord *rec);
+
+const gchar *binlog_reader_string(const BinlogReader *reader, guint32 id);
+
+/* rec as a CsvRecord whose strings point into the reader's dictionary */
+void binlog_reader_to_csv(const BinlogReader *reader, const BinlogRecord *rec,
+                          CsvRecord *out);
+void binlog_reader_clear(BinlogReader *reader);
+
+/* Writes the log at path to out as CSV, header included. */
+gboolean binlog_export_csv(const gchar *path, FILE *out);
+
+/* ── Writer ─────────────────────────────────────────── */
+
+typedef struct _BinlogWriter BinlogWriter;
+
+/* Takes over the dictionary of the log open for appending on fd: writes
+ * the magic into an empty file, otherwise reads the existing entries and
+ * cuts off a torn one at the end.  NULL when the file is not a binary log
+ * or cannot be read.  fd stays owned by the caller. */
+BinlogWriter *binlog_writer_new(int fd, const gchar *path);
+
+/* Appends rec, together with any strings it introduces, in one write(2). */
+gboolean binlog_writer_append(BinlogWriter *writer, const CsvRecord *rec);
+
+void binlog_writer_free(BinlogWriter *writer);
+
+#endif /* BINARY_LOG_H */
@@ -0,0 +1,423 @@
+#define _GNU_SOURCE
+#include "csv-scan.h"
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOCK_SIZE 64
+#define NO_BLOCK   G_MAXSIZE
+
+/* ── Classification kernels ─────────────────────────── */
+
+/* Sets bit i of each mask when byte i of the 64 at p is that character */
+typedef void (*ClassifyFunc)(const guint8 *p, guint64 *quotes,
+                             guint64 *commas, guint64 *newlines);
+
+/* Bit i of the result is set when byte i of the 8 in w equals c.  The
+ * high bit of each byte of ~t is set only for bytes of x that are zero. */
+static inline guint bytes_equal(guint64 w, guint8 c)
+{
+    const guint64 low7 = G_GUINT64_CONSTANT(0x7f7f7f7f7f7f7f7f);
+    guint64 x = w ^ (G_GUINT64_CONSTANT(0x0101010101010101) * c);
+    guint64 t = ((x & low7) + low7) | x | low7;
+    /* Gathers the eight high bits into one byte */
+    return (guint)(((~t >> 7) * G_GUINT64_CONSTANT(0x0102040810204080)) >> 56);
+}
+
+static void classify_scalar(const guint8 *p, guint64 *quotes,
+                            guint64 *commas, guint64 *newlines)
+{
+    guint64 q = 0, c = 0, n = 0;
+    for (int i = 0; i < BLOCK_SIZE; i += 8) {
+        guint64 w;
+        memcpy(&w, p + i, sizeof(w));
+        w = GUINT64_FROM_LE(w);
+        q |= (guint64)bytes_equal(w, '"') << i;
+        c |= (guint64)bytes_equal(w, ',') << i;
+        n |= (guint64)bytes_equal(w, '\n') << i;
+    }
+    *quotes = q;
+    *commas = c;
+    *newlines = n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#define HAVE_X86_KERNELS 1
+#include <immintrin.h>
+
+__attribute__((target("sse2")))
+static void classify_sse2(const guint8 *p, guint64 *quotes,
+                          guint64 *commas, guint64 *newlines)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i newline = _mm_set1_epi8('\n');
+    guint64 q = 0, c = 0, n = 0;
+    for (int i = 0; i < BLOCK_SIZE; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+        q |= (guint64)(guint16)_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)) << i;
+        c |= (guint64)(guint16)_mm_movemask_epi8(_mm_cmpeq_epi8(v, comma)) << i;
+        n |= (guint64)(guint16)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)) << i;
+    }
+    *quotes = q;
+    *commas = c;
+    *newlines = n;
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const guint8 *p, guint64 *quotes,
+                          guint64 *commas, guint64 *newlines)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i *)p);
+    __m256i hi = _mm256_loadu_si256((const __m256i *)(p + 32));
+#define MASK64(c) ((guint64)(guint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, c)) | \
+                   (guint64)(guint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, c)) << 32)
+    *quotes = MASK64(quote);
+    *commas = MASK64(comma);
+    *newlines = MASK64(newline);
+#undef MASK64
+}
+#endif
+
+/* ── Scanner ────────────────────────────────────────── */
+
+/* Bits from..63 */
+static inline guint64 bits_from(gsize from)
+{
+    return from >= BLOCK_SIZE ? 0 : ~(guint64)0 << from;
+}
+
+/* Bit i becomes the XOR of bits 0..i, so between an opening quote and
+ * its closing quote every bit is set; a doubled quote flips twice */
+static inline guint64 prefix_xor(guint64 x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* Classifies the block at offset, ignoring quotes before first, which
+ * only records that were already returned can hold.  inside is the quote
+ * state carried over from the previous block. */
+static inline __attribute__((always_inline))
+void classify_block(CsvScanner *scanner, gsize offset, gsize first,
+                    guint64 inside, ClassifyFunc classify)
+{
+    guint64 quotes, commas, newlines;
+    gsize left = scanner->len - offset;
+    if (left >= BLOCK_SIZE) {
+        classify((const guint8 *)scanner->data + offset,
+                 &quotes, &commas, &newlines);
+    } else {
+        /* NUL padding is none of the three */
+        guint8 tail[BLOCK_SIZE] = {0};
+        memcpy(tail, scanner->data + offset, left);
+        classify(tail, &quotes, &commas, &newlines);
+    }
+
+    quotes &= bits_from(first);
+    guint64 quoted = prefix_xor(quotes) ^ inside;
+    scanner->block_offset = offset;
+    scanner->quotes = quotes;
+    scanner->delims = (commas | newlines) & ~quoted;
+    scanner->newlines = newlines & ~quoted;
+    scanner->inside = (guint64)((gint64)quoted >> 63);
+}
+
+/* start..end is the field with its quotes.  quote_bits marks the quotes
+ * of the field when it lies within one block, else crossed is set. */
+static inline CsvField make_field(const gchar *data, gsize start, gsize end,
+                                  guint64 quote_bits, gboolean crossed,
+                                  gboolean ends_record)
+{
+    const gchar *p = data + start;
+    gsize span = end - start;
+    CsvField field = {p, span, FALSE};
+
+    if (span > 0 && p[0] == '"') {
+        /* Usually right before the delimiter */
+        const gchar *close = span > 1 && p[span - 1] == '"' ? p + span - 1 :
+                             span > 1 ? memrchr(p + 1, '"', span - 1) : NULL;
+        field.ptr = p + 1;
+        field.len = close ? (gsize)(close - field.ptr) : span - 1;
+        if (crossed) {
+            field.escaped = memchr(field.ptr, '"', field.len) != NULL;
+        } else {
+            /* Any quote besides the opening and closing one */
+            quote_bits &= quote_bits - 1;
+            if (close)
+                quote_bits &= quote_bits - 1;
+            field.escaped = quote_bits != 0;
+        }
+    } else if (ends_record && span > 0 && p[span - 1] == '\r') {
+        field.len--;
+    }
+    return field;
+}
+
+/* csv_scanner_next() with classify inlined, see SCANNER_NEXT() */
+static inline __attribute__((always_inline))
+guint scanner_next(CsvScanner *scanner, CsvField *fields, guint max_fields,
+                   ClassifyFunc classify)
+{
+    if (scanner->pos >= scanner->len)
+        return 0;
+
+    const gchar *data = scanner->data;
+    gsize field_start = scanner->pos;
+    gsize block = field_start & ~(gsize)(BLOCK_SIZE - 1);
+    gboolean crossed = FALSE;
+    guint n = 0;
+
+    /* The block where the previous record ended is usually already
+     * classified; a record starts outside quotes either way */
+    if (scanner->block_offset != block)
+        classify_block(scanner, block, field_start - block, 0, classify);
+
+    /* Locals, as the stores into fields could otherwise alias them */
+    guint64 quote_bits = scanner->quotes & bits_from(field_start - block);
+    guint64 newline_bits = scanner->newlines;
+    guint64 pending = scanner->delims & bits_from(field_start - block);
+
+    for (;;) {
+        while (pending) {
+            guint bit = __builtin_ctzll(pending);
+            gsize at = block + bit;
+            guint64 below = ((guint64)1 << bit) - 1;
+            gboolean newline = (newline_bits >> bit) & 1;
+            if (n < max_fields)
+                fields[n++] = make_field(data, field_start, at,
+                                         quote_bits & below, crossed, newline);
+            quote_bits &= ~below;
+            if (newline) {
+                scanner->pos = at + 1;
+                return n;
+            }
+            field_start = at + 1;
+            crossed = FALSE;
+            pending &= pending - 1;
+        }
+
+        crossed = TRUE;
+        block += BLOCK_SIZE;
+        if (block >= scanner->len)
+            break;
+        classify_block(scanner, block, 0, scanner->inside, classify);
+        quote_bits = scanner->quotes;
+        newline_bits = scanner->newlines;
+        pending = scanner->delims;
+    }
+
+    /* The data ends inside this record */
+    if (!scanner->complete)
+        return 0;
+    if (n < max_fields)
+        fields[n++] = make_field(data, field_start, scanner->len, quote_bits,
+                                 crossed, TRUE);
+    scanner->pos = scanner->len;
+    return n;
+}
+
+/* csv_scan_quotes_odd() with classify inlined */
+static inline __attribute__((always_inline))
+gboolean quotes_odd(const gchar *data, gsize len, ClassifyFunc classify)
+{
+    guint64 acc = 0, quotes, commas, newlines;
+    gsize i = 0;
+    for (; i + BLOCK_SIZE <= len; i += BLOCK_SIZE) {
+        classify((const guint8 *)data + i, &quotes, &commas, &newlines);
+        acc ^= quotes;
+    }
+    if (i < len) {
+        guint8 tail[BLOCK_SIZE] = {0};
+        memcpy(tail, data + i, len - i);
+        classify(tail, &quotes, &commas, &newlines);
+        acc ^= quotes;
+    }
+    /* Parity of the bits left set */
+    for (int shift = 32; shift; shift >>= 1)
+        acc ^= acc >> shift;
+    return acc & 1;
+}
+
+/* One copy of the scanner per kernel, compiled for its instruction set */
+#define SCANNER_NEXT(name, kernel, attrs)                                   \
+    attrs static guint name(CsvScanner *scanner, CsvField *fields,          \
+                            guint max)                                      \
+    {                                                                       \
+        return scanner_next(scanner, fields, max, kernel);                  \
+    }                                                                       \
+    attrs static gboolean name##_quotes_odd(const gchar *data, gsize len)   \
+    {                                                                       \
+        return quotes_odd(data, len, kernel);                               \
+    }
+
+typedef guint (*ScannerNextFunc)(CsvScanner *scanner, CsvField *fields,
+                                 guint max_fields);
+typedef gboolean (*QuotesOddFunc)(const gchar *data, gsize len);
+
+SCANNER_NEXT(next_scalar, classify_scalar, )
+#ifdef HAVE_X86_KERNELS
+SCANNER_NEXT(next_sse2, classify_sse2, __attribute__((target("sse2"))))
+SCANNER_NEXT(next_avx2, classify_avx2, __attribute__((target("avx2"))))
+#endif
+
+static const struct {
+    const gchar *name;
+    ScannerNextFunc func;
+    QuotesOddFunc quotes_odd;
+} kernels[] = {
+    [CSV_SCAN_SCALAR] = {"scalar", next_scalar, next_scalar_quotes_odd},
+#ifdef HAVE_X86_KERNELS
+    [CSV_SCAN_SSE2] = {"sse2", next_sse2, next_sse2_quotes_odd},
+    [CSV_SCAN_AVX2] = {"avx2", next_avx2, next_avx2_quotes_odd},
+#else
+    [CSV_SCAN_SSE2] = {"sse2", NULL, NULL},
+    [CSV_SCAN_AVX2] = {"avx2", NULL, NULL},
+#endif
+};
+
+static CsvScanKernel active_kernel;
+static ScannerNextFunc scan_next;
+
+gboolean csv_scan_kernel_supported(CsvScanKernel kernel)
+{
+    if (kernel > CSV_SCAN_AVX2 || !kernels[kernel].func)
+        return FALSE;
+#ifdef HAVE_X86_KERNELS
+    __builtin_cpu_init();
+    if (kernel == CSV_SCAN_SSE2)
+        return __builtin_cpu_supports("sse2");
+    if (kernel == CSV_SCAN_AVX2)
+        return __builtin_cpu_supports("avx2");
+#endif
+    return TRUE;
+}
+
+static ScannerNextFunc get_scan_next(void)
+{
+    static gsize initialized;
+    if (g_once_init_enter(&initialized)) {
+        if (!scan_next) {
+            CsvScanKernel best = CSV_SCAN_SCALAR;
+            if (csv_scan_kernel_supported(CSV_SCAN_AVX2))
+                best = CSV_SCAN_AVX2;
+            else if (csv_scan_kernel_supported(CSV_SCAN_SSE2))
+                best = CSV_SCAN_SSE2;
+            active_kernel = best;
+            scan_next = kernels[best].func;
+        }
+        g_once_init_leave(&initialized, 1);
+    }
+    return scan_next;
+}
+
+CsvScanKernel csv_scan_get_kernel(void)
+{
+    get_scan_next();
+    return active_kernel;
+}
+
+const gchar *csv_scan_kernel_name(CsvScanKernel kernel)
+{
+    return kernel <= CSV_SCAN_AVX2 ? kernels[kernel].name : "unknown";
+}
+
+gboolean csv_scan_set_kernel(CsvScanKernel kernel)
+{
+    if (!csv_scan_kernel_supported(kernel))
+        return FALSE;
+    get_scan_next();
+    active_kernel = kernel;
+    scan_next = kernels[kernel].func;
+    return TRUE;
+}
+
+void csv_scanner_init(CsvScanner *scanner, const gchar *data, gsize len,
+                      gboolean complete)
+{
+    scanner->data = data;
+    scanner->len = len;
+    scanner->pos = 0;
+    scanner->complete = complete;
+    scanner->block_offset = NO_BLOCK;
+    get_scan_next();
+}
+
+guint csv_scanner_next(CsvScanner *scanner, CsvField *fields, guint max_fields)
+{
+    return scan_next(scanner, fields, max_fields);
+}
+
+gboolean csv_scan_quotes_odd(const gchar *data, gsize len)
+{
+    get_scan_next();
+    return kernels[active_kernel].quotes_odd(data, len);
+}
+
+gsize csv_scan_record_start(const gchar *data, gsize len, gsize from,
+                            gboolean inside)
+{
+    for (gsize i = from; i < len; i++) {
+        if (data[i] == '"')
+            inside = !inside;
+        else if (data[i] == '\n' && !inside)
+            return i + 1;
+    }
+    return len;
+}
+
+gboolean csv_field_equal(const CsvField *field, const gchar *str)
+{
+    gsize len = strlen(str);
+    return !field->escaped && field->len == len &&
+           memcmp(field->ptr, str, len) == 0;
+}
+
+gboolean csv_field_to_long(const CsvField *field, long *value)
+{
+    /* Short enough for any long; the copy also ends the number */
+    char buf[32];
+    if (field->len == 0 || field->len >= sizeof(buf) || field->escaped)
+        return FALSE;
+    memcpy(buf, field->ptr, field->len);
+    buf[field->len] = '\0';
+
+    char *endptr;
+    errno = 0;
+    long v = strtol(buf, &endptr, 10);
+    if (errno || *endptr != '\0')
+        return FALSE;
+    *value = v;
+    return TRUE;
+}
+
+void csv_field_append(GString *buf, const CsvField *field)
+{
+    if (!field->escaped) {
+        g_string_append_len(buf, field->ptr, field->len);
+        return;
+    }
+
+    const gchar *p = field->ptr;
+    gsize left = field->len;
+    for (;;) {
+        const gchar *q = memchr(p, '"', left);
+        if (!q) {
+            g_string_append_len(buf, p, left);
+            return;
+        }
+        /* Keep one quote of the pair */
+        gsize run = q - p + 1;
+        g_string_append_len(buf, p, run);
+        p += run + 1;
+        left -= MIN(run + 1, left);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef CSV_SCAN_H
+#define CSV_SCAN_H
+
+#include <glib.h>
+
+/* ── CSV scanner ────────────────────────────────────── *
+ *
+ * Splits CSV held in memory, typically a mapped day file, into records
+ * and fields without copying: a field is a slice of the data.  Quoted
+ * fields may hold commas, newlines and doubled quotes; only a field with
+ * doubled quotes needs csv_field_append() to be read back unescaped.
+ *
+ * The data is classified 64 bytes at a time into bitmasks of quotes,
+ * commas and newlines.  A running XOR over the quote bits marks the bytes
+ * inside quotes, so the commas and newlines that end fields and records
+ * are found without looking at bytes one by one.  A quoted field runs
+ * from its opening quote to the last quote before its delimiter. */
+
+/* Ways to build the bitmasks; all give the same result */
+typedef enum {
+    CSV_SCAN_SCALAR,
+    CSV_SCAN_SSE2,
+    CSV_SCAN_AVX2,
+} CsvScanKernel;
+
+typedef struct {
+    const gchar *ptr;   /* into the scanned data, not NUL-terminated */
+    gsize len;
+    gboolean escaped;   /* holds doubled quotes */
+} CsvField;
+
+typedef struct {
+    const gchar *data;
+    gsize len;
+    gsize pos;          /* start of the next record */
+    gboolean complete;  /* the data ends a record even without a newline */
+
+    /* Classification of the block at block_offset, kept for the next
+     * record */
+    gsize block_offset;
+    guint64 quotes;     /* '"' */
+    guint64 delims;     /* ',' or '\n' outside quotes */
+    guint64 newlines;   /* '\n' outside quotes */
+    guint64 inside;     /* all ones when the block ends inside quotes */
+} CsvScanner;
+
+/* Without complete, a last record not ended by a newline is treated as
+ * still being written and never returned. */
+void csv_scanner_init(CsvScanner *scanner, const gchar *data, gsize len,
+                      gboolean complete);
+
+/* Stores up to max_fields fields of the next record, skipping any others,
+ * and returns how many it stored; 0 once no complete record is left.  A
+ * blank line is one empty field. */
+guint csv_scanner_next(CsvScanner *scanner, CsvField *fields, guint max_fields);
+
+/* The widest kernel the CPU supports is picked on first use. */
+gboolean csv_scan_kernel_supported(CsvScanKernel kernel);
+CsvScanKernel csv_scan_get_kernel(void);
+const gchar *csv_scan_kernel_name(CsvScanKernel kernel);
+/* For tests and benchmarks; must not race with running scanners.  FALSE
+ * when the CPU lacks kernel. */
+gboolean csv_scan_set_kernel(CsvScanKernel kernel);
+
+/* For splitting data between threads: whether a byte is inside quotes
+ * depends on every quote before it, which is only a parity to carry from
+ * one piece to the next. */
+gboolean csv_scan_quotes_odd(const gchar *data, gsize len);
+/* The offset just past the first record-ending newline at or after from,
+ * len when there is none; inside tells whether from is inside quotes. */
+gsize csv_scan_record_start(const gchar *data, gsize len, gsize from,
+                            gboolean inside);
+
+gboolean csv_field_equal(const CsvField *field, const gchar *str);
+
+/* Parses a decimal integer that spans the whole field. */
+gboolean csv_field_to_long(const CsvField *field, long *value);
+
+/* Appends the unescaped field. */
+void csv_field_append(GString *buf, const CsvField *field);
+
+#endif /* CSV_SCAN_H */
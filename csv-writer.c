@@ -0,0 +1,268 @@
+#include "csv-writer.h"
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+
+/* A queued record; its strings live in one allocation owned by the slot */
+typedef struct {
+    CsvRecord rec;
+    gchar *strings;
+} RingSlot;
+
+struct _CsvWriter {
+    AppState out;          /* file state, owned by the writer thread */
+
+    RingSlot *slots;
+    guint mask;            /* capacity - 1 */
+    guint head;            /* next slot to fill, advanced by the producer */
+    guint tail;            /* next slot to drain, advanced by the consumer */
+
+    GQueue overflow;       /* RingSlot*, producer only */
+    guint retry_source_id;
+    guint64 pushed;
+    guint64 overflowed;
+    guint max_depth;
+    gsize written;         /* atomic, advanced by the consumer */
+
+    int wake_fd;           /* eventfd the consumer sleeps on */
+    gint stopping;
+    GThread *thread;
+};
+
+/* ── Slots ──────────────────────────────────────────── */
+
+static void slot_fill(RingSlot *slot, const CsvRecord *rec)
+{
+    const gchar *src[5] = {rec->title, rec->wm_class, rec->wm_class_instance,
+                           rec->rp_state, rec->rp_details};
+    gsize len[5], total = 0;
+    for (int i = 0; i < 5; i++) {
+        len[i] = src[i] ? strlen(src[i]) + 1 : 0;
+        total += len[i];
+    }
+
+    slot->strings = g_malloc(total ? total : 1);
+    const gchar *dst[5];
+    gchar *p = slot->strings;
+    for (int i = 0; i < 5; i++) {
+        dst[i] = src[i] ? memcpy(p, src[i], len[i]) : NULL;
+        p += len[i];
+    }
+
+    slot->rec = *rec;
+    slot->rec.title = dst[0];
+    slot->rec.wm_class = dst[1];
+    slot->rec.wm_class_instance = dst[2];
+    slot->rec.rp_state = dst[3];
+    slot->rec.rp_details = dst[4];
+}
+
+/* ── Ring ───────────────────────────────────────────── */
+
+/* Producer: move slot into the ring, FALSE when full */
+static gboolean ring_put(CsvWriter *w, RingSlot *slot)
+{
+    guint head = w->head;
+    guint depth = head - (guint)g_atomic_int_get(&w->tail);
+    if (depth > w->mask)
+        return FALSE;
+
+    w->slots[head & w->mask] = *slot;
+    g_atomic_int_set(&w->head, head + 1);
+    if (depth + 1 > w->max_depth)
+        w->max_depth = depth + 1;
+    return TRUE;
+}
+
+/* Consumer: write out everything published so far */
+static void ring_drain(CsvWriter *w)
+{
+    guint tail = w->tail;
+    guint head = (guint)g_atomic_int_get(&w->head);
+
+    while (tail != head) {
+        RingSlot *slot = &w->slots[tail & w->mask];
+        write_csv_record(&w->out, &slot->rec);
+        g_free(slot->strings);
+        slot->strings = NULL;
+        g_atomic_int_set(&w->tail, ++tail);
+        g_atomic_pointer_add(&w->written, 1);
+        if (tail == head)
+            head = (guint)g_atomic_int_get(&w->head);
+    }
+}
+
+static void writer_wake(CsvWriter *w)
+{
+    guint64 one = 1;
+    /* EAGAIN only means the counter is saturated: a wakeup is pending */
+    if (write(w->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        g_warning("csv writer: wakeup failed: %s", g_strerror(errno));
+}
+
+/* Producer: move queued overflow into the ring while there is room */
+static gboolean flush_overflow(CsvWriter *w)
+{
+    RingSlot *slot;
+    while ((slot = g_queue_peek_head(&w->overflow))) {
+        if (!ring_put(w, slot))
+            return FALSE;
+        g_free(g_queue_pop_head(&w->overflow));
+    }
+    return TRUE;
+}
+
+static gboolean on_overflow_retry(gpointer user_data)
+{
+    CsvWriter *w = user_data;
+    gboolean done = flush_overflow(w);
+    writer_wake(w);
+    if (done) {
+        w->retry_source_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+/* ── Writer thread ──────────────────────────────────── */
+
+/* Milliseconds until an interval-mode fsync falls due, -1 for none */
+static int next_sync_timeout(const AppState *out)
+{
+    if (out->durability != DURABILITY_INTERVAL || out->sync_interval <= 0 ||
+        out->unsynced_records == 0)
+        return -1;
+
+    gint64 due = out->last_sync + (gint64)out->sync_interval * G_USEC_PER_SEC;
+    gint64 remaining = due - g_get_monotonic_time();
+    return remaining <= 0 ? 0 : (int)((remaining + 999) / 1000);
+}
+
+static gpointer writer_thread(gpointer data)
+{
+    CsvWriter *w = data;
+
+    for (;;) {
+        /* Read the flag before draining: everything pushed before
+         * csv_writer_free() set it is then guaranteed to be written. */
+        gboolean stopping = g_atomic_int_get(&w->stopping);
+        ring_drain(w);
+        if (stopping)
+            break;
+
+        struct pollfd pfd = {w->wake_fd, POLLIN, 0};
+        if (poll(&pfd, 1, next_sync_timeout(&w->out)) > 0) {
+            guint64 count;
+            if (read(w->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+                g_warning("csv writer: %s", g_strerror(errno));
+        }
+
+        if (output_sync_due(&w->out, g_get_monotonic_time()))
+            sync_output_file(&w->out);
+    }
+    return NULL;
+}
+
+/* ── Lifecycle ──────────────────────────────────────── */
+
+CsvWriter *csv_writer_new(const AppState *config, time_t wall_time,
+                          guint capacity)
+{
+    CsvWriter *w = g_new0(CsvWriter, 1);
+    w->out.data_dir = config->data_dir;
+    w->out.durability = config->durability;
+    w->out.sync_interval = config->sync_interval;
+    w->out.sync_records = config->sync_records;
+    w->out.output_format = config->output_format;
+    w->out.compress_closed = config->compress_closed;
+
+    if (!ensure_output_file(&w->out, wall_time)) {
+        g_free(w);
+        return NULL;
+    }
+
+    w->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (w->wake_fd < 0) {
+        g_printerr("csv writer: eventfd: %s\n", g_strerror(errno));
+        close_output_file(&w->out);
+        g_free(w);
+        return NULL;
+    }
+
+    guint size = 1;
+    while (size < MAX(capacity, 1u))
+        size <<= 1;
+    w->slots = g_new0(RingSlot, size);
+    w->mask = size - 1;
+    g_queue_init(&w->overflow);
+    return w;
+}
+
+void csv_writer_start(CsvWriter *writer)
+{
+    g_return_if_fail(writer && !writer->thread);
+    writer->thread = g_thread_new("csv-writer", writer_thread, writer);
+}
+
+void csv_writer_free(CsvWriter *writer)
+{
+    if (!writer)
+        return;
+
+    if (writer->retry_source_id)
+        g_source_remove(writer->retry_source_id);
+
+    if (writer->thread) {
+        /* Shutdown may block: hand over the overflow as the ring drains */
+        while (!flush_overflow(writer)) {
+            writer_wake(writer);
+            g_usleep(1000);
+        }
+        g_atomic_int_set(&writer->stopping, 1);
+        writer_wake(writer);
+        g_thread_join(writer->thread);
+    } else {
+        do
+            ring_drain(writer);
+        while (!flush_overflow(writer));
+        ring_drain(writer);
+    }
+
+    close_output_file(&writer->out);
+    close(writer->wake_fd);
+    g_free(writer->slots);
+    g_free(writer);
+}
+
+/* ── Producer ───────────────────────────────────────── */
+
+void csv_writer_push(CsvWriter *writer, const CsvRecord *rec)
+{
+    RingSlot slot;
+    slot_fill(&slot, rec);
+    writer->pushed++;
+
+    /* Older overflow goes first to keep records in order */
+    if (!flush_overflow(writer) || !ring_put(writer, &slot)) {
+        g_queue_push_tail(&writer->overflow, g_memdup2(&slot, sizeof(slot)));
+        writer->overflowed++;
+        if (!writer->retry_source_id)
+            writer->retry_source_id = g_timeout_add(50, on_overflow_retry, writer);
+    }
+    writer_wake(writer);
+}
+
+void csv_writer_sink(const CsvRecord *rec, gpointer user_data)
+{
+    csv_writer_push(user_data, rec);
+}
+
+void csv_writer_get_stats(CsvWriter *writer, CsvWriterStats *stats)
+{
+    stats->pushed = writer->pushed;
+    stats->written = (gsize)g_atomic_pointer_get(&writer->written);
+    stats->overflowed = writer->overflowed;
+    stats->max_depth = writer->max_depth;
+}
@@ -0,0 +1,48 @@
+#ifndef CSV_WRITER_H
+#define CSV_WRITER_H
+
+#include <glib.h>
+#include "tracker-core.h"
+
+/* ── Background CSV writer ──────────────────────────── *
+ *
+ * The main loop pushes finished intervals into a single-producer /
+ * single-consumer ring; a writer thread drains it, formats the lines and
+ * does all file I/O including fsync, so slow storage never delays D-Bus
+ * handling.  Pushing never blocks: when the ring is full the record waits
+ * in a producer-side queue and is moved into the ring as space frees up. */
+
+#define CSV_WRITER_DEFAULT_CAPACITY 1024
+
+typedef struct _CsvWriter CsvWriter;
+
+typedef struct {
+    guint64 pushed;       /* records handed to csv_writer_push() */
+    guint64 written;      /* records written by the writer thread */
+    guint64 overflowed;   /* records that found the ring full */
+    guint max_depth;      /* highest ring occupancy seen by the producer */
+} CsvWriterStats;
+
+/* ── Lifecycle ──────────────────────────────────────── */
+
+/* Opens the day file for wall_time synchronously, so a bad data directory
+ * is reported at startup.  Output settings (data_dir, output_format,
+ * compress_closed, durability, sync_interval, sync_records) are copied from
+ * config.  capacity is rounded up to a power of two.  The thread starts with csv_writer_start(). */
+CsvWriter *csv_writer_new(const AppState *config, time_t wall_time,
+                          guint capacity);
+void csv_writer_start(CsvWriter *writer);
+
+/* Writes everything still queued, closes the file and frees the writer. */
+void csv_writer_free(CsvWriter *writer);
+
+/* ── Producer side (main loop thread only) ──────────── */
+
+void csv_writer_push(CsvWriter *writer, const CsvRecord *rec);
+
+/* CsvRecordSink adapter: state->record_sink = csv_writer_sink */
+void csv_writer_sink(const CsvRecord *rec, gpointer user_data);
+
+void csv_writer_get_stats(CsvWriter *writer, CsvWriterStats *stats);
+
+#endif /* CSV_WRITER_H */
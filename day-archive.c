@@ -0,0 +1,224 @@
+#include "day-archive.h"
+#include <gio/gunixinputstream.h>
+#include <gio/gunixoutputstream.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define CHUNK_SIZE (64 * 1024)
+
+static gboolean set_errno_error(GError **error, const gchar *what,
+                                const gchar *path)
+{
+    int saved = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved),
+                "%s %s: %s", what, path, g_strerror(saved));
+    return FALSE;
+}
+
+gboolean day_archive_is_compressed(const gchar *path)
+{
+    return g_str_has_suffix(path, DAY_ARCHIVE_SUFFIX);
+}
+
+gchar *day_archive_find(const gchar *csv_path)
+{
+    if (g_file_test(csv_path, G_FILE_TEST_EXISTS))
+        return g_strdup(csv_path);
+
+    gchar *gz_path = g_strconcat(csv_path, DAY_ARCHIVE_SUFFIX, NULL);
+    if (g_file_test(gz_path, G_FILE_TEST_EXISTS))
+        return gz_path;
+    g_free(gz_path);
+    return NULL;
+}
+
+/* Streams src_fd through converter into a new file at tmp_path, fsyncs it
+ * and renames it to dst_path.  src_fd is closed. */
+static gboolean convert_to_file(int src_fd, GConverter *converter,
+                                gboolean compress, const gchar *tmp_path,
+                                const gchar *dst_path, GError **error)
+{
+    int dst_fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (dst_fd < 0) {
+        close(src_fd);
+        return set_errno_error(error, "Failed to create", tmp_path);
+    }
+
+    GInputStream *in = g_unix_input_stream_new(src_fd, TRUE);
+    GOutputStream *out = g_unix_output_stream_new(dst_fd, FALSE);
+    if (compress) {
+        GOutputStream *z = g_converter_output_stream_new(out, converter);
+        g_object_unref(out);
+        out = z;
+    } else {
+        GInputStream *z = g_converter_input_stream_new(in, converter);
+        g_object_unref(in);
+        in = z;
+    }
+
+    gboolean ok = g_output_stream_splice(out, in,
+                                         G_OUTPUT_STREAM_SPLICE_CLOSE_SOURCE |
+                                         G_OUTPUT_STREAM_SPLICE_CLOSE_TARGET,
+                                         NULL, error) >= 0;
+    g_object_unref(in);
+    g_object_unref(out);
+
+    if (ok && fsync(dst_fd) != 0)
+        ok = set_errno_error(error, "Failed to sync", tmp_path);
+    close(dst_fd);
+    if (ok && rename(tmp_path, dst_path) != 0)
+        ok = set_errno_error(error, "Failed to rename", tmp_path);
+    if (!ok)
+        unlink(tmp_path);
+    return ok;
+}
+
+gboolean day_archive_compress(const gchar *csv_path, GError **error)
+{
+    int src_fd = open(csv_path, O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0)
+        return set_errno_error(error, "Failed to open", csv_path);
+
+    gchar *gz_path = g_strconcat(csv_path, DAY_ARCHIVE_SUFFIX, NULL);
+    gchar *tmp_path = g_strconcat(gz_path, ".tmp", NULL);
+    GZlibCompressor *compressor =
+        g_zlib_compressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP, -1);
+
+    gboolean ok = convert_to_file(src_fd, G_CONVERTER(compressor), TRUE,
+                                  tmp_path, gz_path, error);
+    /* Only now that the copy is complete and synced */
+    if (ok && unlink(csv_path) != 0)
+        ok = set_errno_error(error, "Failed to remove", csv_path);
+
+    g_object_unref(compressor);
+    g_free(tmp_path);
+    g_free(gz_path);
+    return ok;
+}
+
+gboolean day_archive_restore(const gchar *csv_path, GError **error)
+{
+    if (g_file_test(csv_path, G_FILE_TEST_EXISTS))
+        return TRUE;
+
+    gchar *gz_path = g_strconcat(csv_path, DAY_ARCHIVE_SUFFIX, NULL);
+    int src_fd = open(gz_path, O_RDONLY | O_CLOEXEC);
+    if (src_fd < 0) {
+        gboolean missing = errno == ENOENT;
+        if (!missing)
+            set_errno_error(error, "Failed to open", gz_path);
+        g_free(gz_path);
+        return missing;
+    }
+
+    gchar *tmp_path = g_strconcat(csv_path, ".tmp", NULL);
+    GZlibDecompressor *decompressor =
+        g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+
+    gboolean ok = convert_to_file(src_fd, G_CONVERTER(decompressor), FALSE,
+                                  tmp_path, csv_path, error);
+    if (ok && unlink(gz_path) != 0)
+        ok = set_errno_error(error, "Failed to remove", gz_path);
+
+    g_object_unref(decompressor);
+    g_free(tmp_path);
+    g_free(gz_path);
+    return ok;
+}
+
+static gpointer compress_thread(gpointer data)
+{
+    gchar *csv_path = data;
+    GError *error = NULL;
+    if (!day_archive_compress(csv_path, &error)) {
+        g_printerr("Failed to compress %s: %s\n", csv_path, error->message);
+        g_error_free(error);
+    }
+    g_free(csv_path);
+    return NULL;
+}
+
+GThread *day_archive_compress_in_background(gchar *csv_path)
+{
+    return g_thread_new("compress", compress_thread, csv_path);
+}
+
+gboolean day_archive_foreach_chunk(const gchar *path, DayArchiveChunkFunc func,
+                                   gpointer user_data, GError **error)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return set_errno_error(error, "Failed to open", path);
+
+    GInputStream *in = g_unix_input_stream_new(fd, TRUE);
+    if (day_archive_is_compressed(path)) {
+        GZlibDecompressor *decompressor =
+            g_zlib_decompressor_new(G_ZLIB_COMPRESSOR_FORMAT_GZIP);
+        GInputStream *z = g_converter_input_stream_new(in, G_CONVERTER(decompressor));
+        g_object_unref(decompressor);
+        g_object_unref(in);
+        in = z;
+    }
+
+    /* Holds what func left unused of the previous chunk */
+    GString *buf = g_string_sized_new(CHUNK_SIZE + 256);
+    gboolean ok = TRUE;
+    for (;;) {
+        gsize carried = buf->len;
+        g_string_set_size(buf, carried + CHUNK_SIZE);
+        gssize n = g_input_stream_read(in, buf->str + carried, CHUNK_SIZE,
+                                       NULL, error);
+        if (n < 0) {
+            ok = FALSE;
+            break;
+        }
+        g_string_set_size(buf, carried + n);
+        if (n == 0)
+            break;
+
+        gsize used = func(buf->str, buf->len, FALSE, user_data);
+        g_string_erase(buf, 0, used);
+    }
+
+    if (ok)
+        func(buf->str, buf->len, TRUE, user_data);
+
+    g_string_free(buf, TRUE);
+    g_input_stream_close(in, NULL, NULL);
+    g_object_unref(in);
+    return ok;
+}
+
+typedef struct {
+    DayArchiveLineFunc func;
+    gpointer user_data;
+} LineSplit;
+
+static gsize split_lines(gchar *data, gsize len, gboolean last,
+                         gpointer user_data)
+{
+    LineSplit *split = user_data;
+    gchar *line = data;
+    gchar *end = data + len;
+    gchar *nl;
+    while ((nl = memchr(line, '\n', end - line))) {
+        *nl = '\0';
+        split->func(line, split->user_data);
+        line = nl + 1;
+    }
+    /* The chunk is NUL-terminated after len */
+    if (last && line < end) {
+        split->func(line, split->user_data);
+        line = end;
+    }
+    return line - data;
+}
+
+gboolean day_archive_foreach_line(const gchar *path, DayArchiveLineFunc func,
+                                  gpointer user_data, GError **error)
+{
+    LineSplit split = {func, user_data};
+    return day_archive_foreach_chunk(path, split_lines, &split, error);
+}
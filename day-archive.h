@@ -0,0 +1,53 @@
+#ifndef DAY_ARCHIVE_H
+#define DAY_ARCHIVE_H
+
+#include <gio/gio.h>
+#include "tracker-core.h"
+
+/* ── Compressed day files ───────────────────────────── *
+ *
+ * A CSV day file is never written again after midnight, so once the
+ * tracker rotates away from it it is gzipped next to itself
+ * (YYYY-MM-DD.csv.gz) and the original removed.  While both exist the
+ * plain file is authoritative: it is only deleted once the compressed copy
+ * is complete and on disk. */
+
+#define DAY_ARCHIVE_SUFFIX ".gz"
+
+/* csv_path itself, else its compressed copy, whichever exists; NULL when
+ * there is neither. */
+gchar *day_archive_find(const gchar *csv_path);
+
+gboolean day_archive_is_compressed(const gchar *path);
+
+/* Compresses csv_path into csv_path.gz and removes csv_path. */
+gboolean day_archive_compress(const gchar *csv_path, GError **error);
+
+/* Puts csv_path back from csv_path.gz, e.g. when a closed day is written
+ * to again.  TRUE with nothing to do when csv_path exists or there is no
+ * compressed copy. */
+gboolean day_archive_restore(const gchar *csv_path, GError **error);
+
+/* Runs day_archive_compress() on a thread of its own.  Join it with
+ * g_thread_join(), which frees path. */
+GThread *day_archive_compress_in_background(gchar *csv_path);
+
+/* Calls func with the contents of a possibly compressed file, read in
+ * fixed-size chunks.  func returns how many bytes it used; the rest is
+ * passed again in front of the next chunk, so a record cut off by the
+ * read can wait for its end.  The final call has last set and holds
+ * whatever is left, possibly nothing.  data is NUL-terminated after len
+ * and only valid during the call. */
+typedef gsize (*DayArchiveChunkFunc)(gchar *data, gsize len, gboolean last,
+                                     gpointer user_data);
+gboolean day_archive_foreach_chunk(const gchar *path, DayArchiveChunkFunc func,
+                                   gpointer user_data, GError **error);
+
+/* Calls func for every line of a possibly compressed file, reading it in
+ * fixed-size chunks.  line is NUL-terminated without its newline and only
+ * valid during the call. */
+typedef void (*DayArchiveLineFunc)(gchar *line, gpointer user_data);
+gboolean day_archive_foreach_line(const gchar *path, DayArchiveLineFunc func,
+                                  gpointer user_data, GError **error);
+
+#endif /* DAY_ARCHIVE_H */
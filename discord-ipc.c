@@ -1,23 +1,182 @@
+#define _GNU_SOURCE
 #include "discord-ipc.h"
 #include <json-glib/json-glib.h>
 #include <glib-unix.h>
 #include <stdio.h>
 #include <string.h>
+#include <signal.h>
 #include <unistd.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <sys/syscall.h>
+
+#define PRESENCE_SWEEP_INTERVAL_S 60
+#define RING_MIN_SIZE             4096
+#define CONNECT_RETRY_MS          20
+#define CONNECT_ATTEMPTS          100  /* 2 s of a full backlog */
+
+/* ── Byte rings ─────────────────────────────────────── */
+
+/* Bytes on their way from one socket to the other.  The size is a power
+ * of two, doubled when full until it reaches DISCORD_BUFFER_LIMIT. */
+typedef struct {
+    guint8 *data;
+    gsize size;
+    gsize head;   /* offset of the oldest byte */
+    gsize len;
+} ByteRing;
+
+/* The iovecs covering len bytes from offset from; from == ring->len gives
+ * the free space */
+static int ring_span(const ByteRing *ring, gsize from, gsize len,
+                     struct iovec iov[2])
+{
+    if (len == 0)
+        return 0;
+    gsize start = (ring->head + from) & (ring->size - 1);
+    gsize first = MIN(len, ring->size - start);
+    iov[0].iov_base = ring->data + start;
+    iov[0].iov_len = first;
+    if (first == len)
+        return 1;
+    iov[1].iov_base = ring->data;
+    iov[1].iov_len = len - first;
+    return 2;
+}
+
+static void ring_copy(const ByteRing *ring, gsize from, void *dest, gsize len)
+{
+    struct iovec iov[2];
+    int n = ring_span(ring, from, len, iov);
+    guint8 *p = dest;
+    for (int i = 0; i < n; i++) {
+        memcpy(p, iov[i].iov_base, iov[i].iov_len);
+        p += iov[i].iov_len;
+    }
+}
+
+static void ring_grow(ByteRing *ring)
+{
+    gsize size = ring->size ? ring->size * 2 : RING_MIN_SIZE;
+    guint8 *data = g_malloc(size);
+    ring_copy(ring, 0, data, ring->len);
+    g_free(ring->data);
+    ring->data = data;
+    ring->size = size;
+    ring->head = 0;
+}
+
+static gboolean ring_has_room(const ByteRing *ring)
+{
+    return ring->len < DISCORD_BUFFER_LIMIT;
+}
+
+/* The limit only holds back reads; what the proxy says itself is kept */
+static void ring_append(ByteRing *ring, const guint8 *data, gsize len)
+{
+    while (ring->size - ring->len < len)
+        ring_grow(ring);
+    struct iovec iov[2];
+    int n = ring_span(ring, ring->len, len, iov);
+    for (int i = 0; i < n; i++) {
+        memcpy(iov[i].iov_base, data, iov[i].iov_len);
+        data += iov[i].iov_len;
+    }
+    ring->len += len;
+}
+
+static void ring_consume(ByteRing *ring, gsize len)
+{
+    ring->len -= len;
+    ring->head = ring->len ? (ring->head + len) & (ring->size - 1) : 0;
+}
+
+static void ring_clear(ByteRing *ring)
+{
+    g_free(ring->data);
+    memset(ring, 0, sizeof(*ring));
+}
+
+/* Reads fd until EAGAIN or the ring is full.  *eof is set when the peer
+ * is done sending, once what it sent before is in the ring. */
+static gsize ring_fill(ByteRing *ring, int fd, gboolean *eof,
+                       DiscordProxyStats *stats)
+{
+    gsize total = 0;
+    for (;;) {
+        if (ring->len == ring->size) {
+            if (ring->size >= DISCORD_BUFFER_LIMIT) {
+                stats->read_pauses++;
+                break;
+            }
+            ring_grow(ring);
+        }
+        struct iovec iov[2];
+        int n = ring_span(ring, ring->len, ring->size - ring->len, iov);
+        ssize_t got = readv(fd, iov, n);
+        if (got > 0) {
+            ring->len += got;
+            total += got;
+            continue;
+        }
+        if (got < 0 && errno == EINTR)
+            continue;
+        if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+            *eof = TRUE;
+        break;
+    }
+    stats->max_buffered = MAX(stats->max_buffered, ring->len);
+    return total;
+}
+
+/* Sends up to len bytes from the front of the ring until EAGAIN.  Returns
+ * how many went, -1 when the peer is gone. */
+static gssize ring_flush(ByteRing *ring, gsize len, int fd)
+{
+    gsize total = 0;
+    while (total < len) {
+        struct iovec iov[2];
+        struct msghdr msg = {.msg_iov = iov};
+        msg.msg_iovlen = ring_span(ring, 0, len - total, iov);
+        ssize_t sent = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+        ring_consume(ring, sent);
+        total += sent;
+    }
+    return total;
+}
 
 /* ── Per-connection state ───────────────────────────── */
 
 struct _ClientConnection {
     int client_fd;
     int upstream_fd;     /* -1 if no upstream (passive mode) */
-    GSource *client_source;
-    GSource *upstream_source;
-    GByteArray *client_buf;
-    GByteArray *upstream_buf;
+    GSource *client_source;        /* while to_upstream has room */
+    GSource *client_out_source;    /* while to_client holds bytes */
+    GSource *upstream_source;      /* while to_client has room */
+    GSource *upstream_out_source;  /* connecting, or frames to forward */
+    ByteRing to_upstream;  /* from the client */
+    ByteRing to_client;    /* from Discord without a pipe, or the fake READY */
+    gsize parsed;          /* whole frames at the front of to_upstream */
+    int pipe_fds[2];       /* Discord to client through splice(), or -1 */
+    gsize pipe_size;
+    gsize piped;           /* bytes in the pipe */
+    gboolean pipe_full;
+    gboolean connecting;   /* upstream_fd is not connected yet */
+    GSource *connect_retry_source;
+    guint connect_attempts;
+    gboolean client_eof;
+    gboolean upstream_eof;
     DiscordIpcState *ipc_state;
     gboolean handshake_done;
 };
@@ -26,18 +185,35 @@ struct _ClientConnection {
 
 static void close_connection(ClientConnection *conn);
 static gboolean on_server_accept(gint fd, GIOCondition cond, gpointer user_data);
-static gboolean on_client_data(gint fd, GIOCondition cond, gpointer user_data);
-static gboolean on_upstream_data(gint fd, GIOCondition cond, gpointer user_data);
-static void process_client_buffer(ClientConnection *conn);
+static gboolean on_client_in(gint fd, GIOCondition cond, gpointer user_data);
+static gboolean on_client_out(gint fd, GIOCondition cond, gpointer user_data);
+static gboolean on_upstream_in(gint fd, GIOCondition cond, gpointer user_data);
+static gboolean on_upstream_out(gint fd, GIOCondition cond, gpointer user_data);
 
 /* ── RichPresenceEntry lifecycle ────────────────────── */
 
+/* An entry with what ties it to its client.  The entry comes first, so
+ * lookups hand out a pointer to it. */
+typedef struct {
+    RichPresenceEntry entry;
+    DiscordIpcState *ipc_state;
+    ClientConnection *conn;   /* client that set it last, NULL if none */
+    int pidfd;                /* -1 when the process is not watched */
+    GSource *exit_source;
+} PresenceSlot;
+
 static void free_rp_entry(gpointer data)
 {
-    RichPresenceEntry *e = data;
-    g_free(e->state);
-    g_free(e->details);
-    g_free(e);
+    PresenceSlot *slot = data;
+    if (slot->exit_source) {
+        g_source_destroy(slot->exit_source);
+        g_source_unref(slot->exit_source);
+    }
+    if (slot->pidfd >= 0)
+        close(slot->pidfd);
+    g_free(slot->entry.state);
+    g_free(slot->entry.details);
+    g_free(slot);
 }
 
 /* ── Socket liveness check ──────────────────────────── */
@@ -177,22 +353,410 @@ void discord_build_ready_response(guint8 **out, gsize *out_len)
     *out_len = total;
 }
 
+/* ── Proxy thread ───────────────────────────────────── *
+ *
+ * With a thread of its own the proxy's sources live on a private context,
+ * and the thread that set it up sees presence through immutable
+ * snapshots.  Every change swaps in a new one.  The old one is freed
+ * once that thread's main context has been through a prepare after the
+ * swap: a pointer handed out by a lookup in an earlier dispatch cannot
+ * be in use any more, so lookups never wait for the proxy. */
+
+typedef struct {
+    GHashTable *by_pid;   /* GINT_TO_POINTER(pid) → RichPresenceEntry* */
+    gint retired_at;      /* epoch that replaced it */
+} PresenceSnapshot;
+
+struct _DiscordIpcThread {
+    GThread *thread;
+    gint stopping;
+    GMainContext *owner;          /* context of the thread that set it up */
+    PresenceSnapshot *snapshot;   /* swapped atomically */
+    gint epoch;                   /* bumped with every swap */
+    gint owner_epoch;             /* epoch at the owner's last prepare */
+    GQueue retired;               /* proxy thread only */
+    GSource *quiescent_source;    /* on owner */
+    GSource *notice_source;       /* on owner, ready while notices wait */
+    GAsyncQueue *notices;         /* entry copies for presence_changed */
+};
+
+typedef struct {
+    GSource source;
+    DiscordIpcThread *thread;
+} QuiescentSource;
+
+static RichPresenceEntry *copy_entry(const RichPresenceEntry *entry)
+{
+    RichPresenceEntry *copy = g_new(RichPresenceEntry, 1);
+    copy->state = g_strdup(entry->state);
+    copy->details = g_strdup(entry->details);
+    copy->pid = entry->pid;
+    copy->last_updated = entry->last_updated;
+    return copy;
+}
+
+static void free_entry_copy(gpointer data)
+{
+    RichPresenceEntry *entry = data;
+    g_free(entry->state);
+    g_free(entry->details);
+    g_free(entry);
+}
+
+static PresenceSnapshot *snapshot_new(GHashTable *presence_by_pid)
+{
+    PresenceSnapshot *snap = g_new0(PresenceSnapshot, 1);
+    snap->by_pid = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                         NULL, free_entry_copy);
+    GHashTableIter iter;
+    gpointer key, value;
+    g_hash_table_iter_init(&iter, presence_by_pid);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        g_hash_table_insert(snap->by_pid, key, copy_entry(value));
+    return snap;
+}
+
+static void snapshot_free(gpointer data)
+{
+    PresenceSnapshot *snap = data;
+    g_hash_table_destroy(snap->by_pid);
+    g_free(snap);
+}
+
+/* Frees the snapshots the owner can no longer be reading */
+static void reclaim_snapshots(DiscordIpcThread *t)
+{
+    gint seen = g_atomic_int_get(&t->owner_epoch);
+    PresenceSnapshot *snap;
+    while ((snap = g_queue_peek_head(&t->retired)) &&
+           seen - snap->retired_at >= 0)
+        snapshot_free(g_queue_pop_head(&t->retired));
+}
+
+/* After every change to presence_by_pid */
+static void publish_presence(DiscordIpcState *state)
+{
+    DiscordIpcThread *t = state->thread;
+    if (!t)
+        return;
+
+    PresenceSnapshot *old = g_atomic_pointer_get(&t->snapshot);
+    g_atomic_pointer_set(&t->snapshot, snapshot_new(state->presence_by_pid));
+    old->retired_at = g_atomic_int_add(&t->epoch, 1) + 1;
+    g_queue_push_tail(&t->retired, old);
+    reclaim_snapshots(t);
+}
+
+/* Called on the owner before it polls, between any two dispatches */
+static gboolean quiescent_prepare(GSource *source, gint *timeout)
+{
+    DiscordIpcThread *t = ((QuiescentSource *)source)->thread;
+    g_atomic_int_set(&t->owner_epoch, g_atomic_int_get(&t->epoch));
+    *timeout = -1;
+    return FALSE;
+}
+
+static gboolean source_dispatch(GSource *source G_GNUC_UNUSED,
+                                GSourceFunc callback, gpointer user_data)
+{
+    return callback ? callback(user_data) : G_SOURCE_CONTINUE;
+}
+
+static GSourceFuncs quiescent_source_funcs = {
+    quiescent_prepare, NULL, source_dispatch, NULL, NULL, NULL
+};
+
+static GSourceFuncs notice_source_funcs = {
+    NULL, NULL, source_dispatch, NULL, NULL, NULL
+};
+
+/* On the owner: presence_changed for what the proxy thread queued */
+static gboolean deliver_notices(gpointer user_data)
+{
+    DiscordIpcState *state = user_data;
+    DiscordIpcThread *t = state->thread;
+    RichPresenceEntry *entry;
+
+    /* Before draining, so a notice queued meanwhile sets it again */
+    g_source_set_ready_time(t->notice_source, -1);
+    while ((entry = g_async_queue_try_pop(t->notices))) {
+        if (state->presence_changed)
+            state->presence_changed(entry, state->presence_changed_data);
+        free_entry_copy(entry);
+    }
+    return G_SOURCE_CONTINUE;
+}
+
+static void notify_entry(DiscordIpcState *state, const RichPresenceEntry *entry)
+{
+    DiscordIpcThread *t = state->thread;
+
+    if (!t) {
+        if (state->presence_changed)
+            state->presence_changed(entry, state->presence_changed_data);
+        return;
+    }
+    g_async_queue_push(t->notices, copy_entry(entry));
+    g_source_set_ready_time(t->notice_source, 0);
+}
+
+static void notify_presence(DiscordIpcState *state, pid_t pid)
+{
+    notify_entry(state, g_hash_table_lookup(state->presence_by_pid,
+                                            GINT_TO_POINTER((gint)pid)));
+}
+
+/* pid's entry left the store at monotonic time removed */
+static void notify_removed(DiscordIpcState *state, pid_t pid, gint64 removed)
+{
+    RichPresenceEntry entry = {NULL, NULL, pid, removed};
+    notify_entry(state, &entry);
+}
+
+static DiscordIpcThread *ipc_thread_new(DiscordIpcState *state)
+{
+    DiscordIpcThread *t = g_new0(DiscordIpcThread, 1);
+    t->owner = g_main_context_ref_thread_default();
+    t->snapshot = snapshot_new(state->presence_by_pid);
+    g_queue_init(&t->retired);
+    t->notices = g_async_queue_new_full(free_entry_copy);
+
+    t->quiescent_source = g_source_new(&quiescent_source_funcs,
+                                       sizeof(QuiescentSource));
+    ((QuiescentSource *)t->quiescent_source)->thread = t;
+    g_source_attach(t->quiescent_source, t->owner);
+
+    t->notice_source = g_source_new(&notice_source_funcs, sizeof(GSource));
+    g_source_set_callback(t->notice_source, deliver_notices, state, NULL);
+    g_source_attach(t->notice_source, t->owner);
+    return t;
+}
+
+static void ipc_thread_free(DiscordIpcThread *t)
+{
+    g_source_destroy(t->quiescent_source);
+    g_source_unref(t->quiescent_source);
+    g_source_destroy(t->notice_source);
+    g_source_unref(t->notice_source);
+    g_async_queue_unref(t->notices);
+    g_queue_clear_full(&t->retired, snapshot_free);
+    snapshot_free(t->snapshot);
+    g_main_context_unref(t->owner);
+    g_free(t);
+}
+
+static gpointer proxy_thread(gpointer user_data)
+{
+    DiscordIpcState *state = user_data;
+    DiscordIpcThread *t = state->thread;
+
+    g_main_context_push_thread_default(state->context);
+    while (!g_atomic_int_get(&t->stopping))
+        g_main_context_iteration(state->context, TRUE);
+    g_main_context_pop_thread_default(state->context);
+    return NULL;
+}
+
 /* ── Presence store ─────────────────────────────────── */
 
-void discord_presence_store(DiscordIpcState *state, pid_t pid,
-                            const gchar *rp_state, const gchar *rp_details)
+static gboolean presence_field_equal(const gchar *a, const gchar *b)
+{
+    return g_strcmp0(a ? a : "", b ? b : "") == 0;
+}
+
+gboolean discord_presence_matches(const RichPresenceEntry *entry,
+                                  const gchar *rp_state,
+                                  const gchar *rp_details)
+{
+    return presence_field_equal(entry->state, rp_state) &&
+           presence_field_equal(entry->details, rp_details);
+}
+
+/* Replaces *field with value unless they are equal; TRUE when replaced */
+static gboolean update_presence_field(gchar **field, const gchar *value)
+{
+    if (presence_field_equal(*field, value))
+        return FALSE;
+    g_free(*field);
+    *field = g_strdup(value);
+    return TRUE;
+}
+
+static int open_pidfd(pid_t pid)
+{
+#ifdef SYS_pidfd_open
+    return syscall(SYS_pidfd_open, pid, 0);
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
+static gboolean on_presence_process_exit(gint fd G_GNUC_UNUSED,
+                                         GIOCondition cond G_GNUC_UNUSED,
+                                         gpointer user_data)
+{
+    PresenceSlot *slot = user_data;
+    DiscordIpcState *state = slot->ipc_state;
+    pid_t pid = slot->entry.pid;
+
+    state->presence_stats.evicted_exited++;
+    g_hash_table_remove(state->presence_by_pid, GINT_TO_POINTER((gint)pid));
+    publish_presence(state);
+    notify_removed(state, pid, g_get_monotonic_time());
+    return G_SOURCE_REMOVE;
+}
+
+/* Watches for the process to exit.  FALSE when it already has; without
+ * pidfds the entry lives until its client disconnects or it expires. */
+static gboolean watch_process(PresenceSlot *slot)
+{
+    slot->pidfd = open_pidfd(slot->entry.pid);
+    if (slot->pidfd < 0)
+        return errno != ESRCH;
+
+    slot->exit_source = g_unix_fd_source_new(slot->pidfd, G_IO_IN);
+    g_source_set_callback(slot->exit_source,
+        G_SOURCE_FUNC(on_presence_process_exit), slot, NULL);
+    g_source_attach(slot->exit_source, slot->ipc_state->context);
+    return TRUE;
+}
+
+static void evict_least_recent(DiscordIpcState *state, gint64 now)
+{
+    GHashTableIter iter;
+    gpointer key, value, oldest_key = NULL;
+    gint64 oldest = G_MAXINT64;
+
+    g_hash_table_iter_init(&iter, state->presence_by_pid);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        const RichPresenceEntry *e = value;
+        if (e->last_updated < oldest) {
+            oldest = e->last_updated;
+            oldest_key = key;
+        }
+    }
+    if (oldest_key) {
+        g_hash_table_remove(state->presence_by_pid, oldest_key);
+        state->presence_stats.evicted_lru++;
+        notify_removed(state, GPOINTER_TO_INT(oldest_key), now);
+    }
+}
+
+/* discord_presence_store() for a frame from conn, or from nowhere */
+static gboolean store_presence(DiscordIpcState *state, ClientConnection *conn,
+                               pid_t pid, const gchar *rp_state,
+                               const gchar *rp_details, gint64 arrived)
 {
     if (!state->presence_by_pid || pid <= 0)
+        return FALSE;
+
+    /* Games repeat SET_ACTIVITY every few seconds with the same content,
+     * which then costs a lookup and two compares */
+    PresenceSlot *slot = g_hash_table_lookup(state->presence_by_pid,
+                                             GINT_TO_POINTER((gint)pid));
+    gboolean added = !slot;
+    if (!slot) {
+        if (state->max_presence &&
+            g_hash_table_size(state->presence_by_pid) >= state->max_presence)
+            evict_least_recent(state, arrived);
+
+        slot = g_new0(PresenceSlot, 1);
+        slot->entry.pid = pid;
+        slot->ipc_state = state;
+        slot->pidfd = -1;
+        if (conn && !watch_process(slot)) {
+            state->presence_stats.evicted_exited++;
+            free_rp_entry(slot);
+            return FALSE;
+        }
+        g_hash_table_insert(state->presence_by_pid,
+                            GINT_TO_POINTER((gint)pid), slot);
+    }
+    if (conn)
+        slot->conn = conn;
+    slot->entry.last_updated = arrived;
+
+    gboolean changed = update_presence_field(&slot->entry.state, rp_state);
+    changed |= update_presence_field(&slot->entry.details, rp_details);
+    if (added || changed)
+        publish_presence(state);
+    return changed;
+}
+
+gboolean discord_presence_store(DiscordIpcState *state, pid_t pid,
+                                const gchar *rp_state, const gchar *rp_details,
+                                gint64 arrived)
+{
+    return store_presence(state, NULL, pid, rp_state, rp_details, arrived);
+}
+
+/* Removes the entries pred picks, telling presence_changed that each
+ * one ended at monotonic time now.  Returns how many went. */
+static guint evict_presence(DiscordIpcState *state, GHRFunc pred,
+                            gpointer pred_data, gint64 now)
+{
+    GArray *pids = g_array_new(FALSE, FALSE, sizeof(pid_t));
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init(&iter, state->presence_by_pid);
+    while (g_hash_table_iter_next(&iter, &key, &value)) {
+        if (!pred(key, value, pred_data))
+            continue;
+        pid_t pid = GPOINTER_TO_INT(key);
+        g_array_append_val(pids, pid);
+        g_hash_table_iter_remove(&iter);
+    }
+
+    guint evicted = pids->len;
+    if (evicted)
+        publish_presence(state);
+    for (guint i = 0; i < evicted; i++)
+        notify_removed(state, g_array_index(pids, pid_t, i), now);
+    g_array_free(pids, TRUE);
+    return evicted;
+}
+
+static gboolean presence_set_by(gpointer key G_GNUC_UNUSED, gpointer value,
+                                gpointer user_data)
+{
+    const PresenceSlot *slot = value;
+    return slot->conn == user_data;
+}
+
+static gboolean presence_expired(gpointer key G_GNUC_UNUSED, gpointer value,
+                                 gpointer user_data)
+{
+    const RichPresenceEntry *e = value;
+    return e->last_updated < *(const gint64 *)user_data;
+}
+
+void discord_presence_expire(DiscordIpcState *state, gint64 now)
+{
+    if (!state->presence_by_pid || state->presence_ttl <= 0)
         return;
 
-    RichPresenceEntry *entry = g_new0(RichPresenceEntry, 1);
-    entry->state = g_strdup(rp_state);
-    entry->details = g_strdup(rp_details);
-    entry->pid = pid;
-    entry->last_updated = g_get_monotonic_time();
+    gint64 cutoff = now - state->presence_ttl;
+    state->presence_stats.evicted_expired +=
+        evict_presence(state, presence_expired, &cutoff, now);
+}
+
+static gboolean on_presence_sweep(gpointer user_data)
+{
+    DiscordIpcState *state = user_data;
+    discord_presence_expire(state, g_get_monotonic_time());
+    if (state->thread)
+        reclaim_snapshots(state->thread);
+    return G_SOURCE_CONTINUE;
+}
 
-    g_hash_table_insert(state->presence_by_pid,
-                        GINT_TO_POINTER((gint)pid), entry);
+void discord_ipc_get_presence_stats(const DiscordIpcState *state,
+                                    DiscordPresenceStats *stats)
+{
+    *stats = state->presence_stats;
+    stats->size = state->presence_by_pid
+                ? g_hash_table_size(state->presence_by_pid) : 0;
 }
 
 const RichPresenceEntry *discord_ipc_lookup_pid(DiscordIpcState *state, pid_t pid)
@@ -200,10 +764,124 @@ const RichPresenceEntry *discord_ipc_lookup_pid(DiscordIpcState *state, pid_t pi
     if (!state || !state->presence_by_pid || pid <= 0)
         return NULL;
 
+    if (state->thread) {
+        PresenceSnapshot *snap = g_atomic_pointer_get(&state->thread->snapshot);
+        return g_hash_table_lookup(snap->by_pid, GINT_TO_POINTER((gint)pid));
+    }
     return g_hash_table_lookup(state->presence_by_pid,
                                GINT_TO_POINTER((gint)pid));
 }
 
+/* ── Splice relay ───────────────────────────────────── *
+ *
+ * The tracker never looks at what Discord sends, so it goes to the client
+ * through a pipe with splice() and is not copied in and out of user
+ * space.  Without a pipe, or where splice() fails, it takes the
+ * to_client ring instead. */
+
+static void open_pipe(ClientConnection *conn)
+{
+    if (pipe2(conn->pipe_fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        conn->pipe_fds[0] = conn->pipe_fds[1] = -1;
+        return;
+    }
+    fcntl(conn->pipe_fds[1], F_SETPIPE_SZ, DISCORD_BUFFER_LIMIT);
+    int size = fcntl(conn->pipe_fds[1], F_GETPIPE_SZ);
+    conn->pipe_size = size > 0 ? (gsize)size : 65536;
+}
+
+static void close_pipe(ClientConnection *conn)
+{
+    for (int i = 0; i < 2; i++) {
+        if (conn->pipe_fds[i] >= 0)
+            close(conn->pipe_fds[i]);
+        conn->pipe_fds[i] = -1;
+    }
+    conn->piped = 0;
+    conn->pipe_full = FALSE;
+}
+
+/* What is in the pipe moves to the ring, which takes over */
+static void splice_fallback(ClientConnection *conn)
+{
+    gboolean eof = FALSE;
+    g_printerr("[discord-ipc] splice() failed: %s, copying instead\n",
+               g_strerror(errno));
+    ring_fill(&conn->to_client, conn->pipe_fds[0], &eof,
+              &conn->ipc_state->proxy_stats);
+    close_pipe(conn);
+}
+
+/* Moves what Discord sent into the pipe until EAGAIN or the pipe is
+ * full.  FALSE when it fell back to the ring. */
+static gboolean splice_fill(ClientConnection *conn, int fd)
+{
+    DiscordProxyStats *stats = &conn->ipc_state->proxy_stats;
+
+    while (conn->piped < conn->pipe_size) {
+        ssize_t n = splice(fd, NULL, conn->pipe_fds[1], NULL,
+                           conn->pipe_size - conn->piped,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            conn->piped += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            splice_fallback(conn);
+            return FALSE;
+        }
+        if (n < 0 && errno == EAGAIN) {
+            /* Pipe buffers hold whole socket buffers, so the pipe can be
+             * out of slots short of pipe_size: data still waiting says so.
+             * An empty pipe is not full; the data arrived after the splice
+             * and the read watch stays armed for it, since only flushing
+             * the pipe would clear the flag. */
+            int waiting = 0;
+            if (conn->piped > 0 &&
+                ioctl(fd, FIONREAD, &waiting) == 0 && waiting > 0)
+                conn->pipe_full = TRUE;
+            break;
+        }
+        conn->upstream_eof = TRUE;
+        break;
+    }
+    if (conn->piped >= conn->pipe_size)
+        conn->pipe_full = TRUE;
+    if (conn->pipe_full)
+        stats->read_pauses++;
+    stats->max_buffered = MAX(stats->max_buffered, conn->piped);
+    return TRUE;
+}
+
+/* Moves the pipe's bytes on to the client until EAGAIN.  Returns how many
+ * went, -1 when the client is gone. */
+static gssize splice_flush(ClientConnection *conn)
+{
+    gsize total = 0;
+    while (conn->piped > 0) {
+        ssize_t n = splice(conn->pipe_fds[0], NULL, conn->client_fd, NULL,
+                           conn->piped, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n > 0) {
+            conn->piped -= n;
+            conn->pipe_full = FALSE;
+            total += n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && errno == EAGAIN)
+            break;
+        if (n < 0 && (errno == EINVAL || errno == ENOSYS)) {
+            splice_fallback(conn);
+            break;
+        }
+        return -1;
+    }
+    return total;
+}
+
 /* ── Connection management ──────────────────────────── */
 
 static void close_connection(ClientConnection *conn)
@@ -211,15 +889,15 @@ static void close_connection(ClientConnection *conn)
     if (!conn)
         return;
 
-    if (conn->client_source) {
-        g_source_destroy(conn->client_source);
-        g_source_unref(conn->client_source);
-        conn->client_source = NULL;
-    }
-    if (conn->upstream_source) {
-        g_source_destroy(conn->upstream_source);
-        g_source_unref(conn->upstream_source);
-        conn->upstream_source = NULL;
+    GSource **sources[] = {&conn->client_source, &conn->client_out_source,
+                           &conn->upstream_source, &conn->upstream_out_source,
+                           &conn->connect_retry_source};
+    for (gsize i = 0; i < G_N_ELEMENTS(sources); i++) {
+        if (*sources[i]) {
+            g_source_destroy(*sources[i]);
+            g_source_unref(*sources[i]);
+            *sources[i] = NULL;
+        }
     }
     if (conn->client_fd >= 0) {
         close(conn->client_fd);
@@ -229,118 +907,308 @@ static void close_connection(ClientConnection *conn)
         close(conn->upstream_fd);
         conn->upstream_fd = -1;
     }
-    if (conn->client_buf) {
-        g_byte_array_free(conn->client_buf, TRUE);
-        conn->client_buf = NULL;
-    }
-    if (conn->upstream_buf) {
-        g_byte_array_free(conn->upstream_buf, TRUE);
-        conn->upstream_buf = NULL;
+    close_pipe(conn);
+    ring_clear(&conn->to_upstream);
+    ring_clear(&conn->to_client);
+
+    /* What it set goes with it */
+    DiscordIpcState *state = conn->ipc_state;
+    if (state && state->presence_by_pid) {
+        state->presence_stats.evicted_closed +=
+            evict_presence(state, presence_set_by, conn,
+                           g_get_monotonic_time());
     }
 
     /* Remove from connections array */
-    if (conn->ipc_state && conn->ipc_state->connections)
-        g_ptr_array_remove(conn->ipc_state->connections, conn);
+    if (state && state->connections)
+        g_ptr_array_remove(state->connections, conn);
 
     g_free(conn);
 }
 
 /* ── Client data handler ───────────────────────────── */
 
-static void process_client_buffer(ClientConnection *conn)
+static void handle_frame(ClientConnection *conn, guint32 opcode,
+                         const gchar *json, gint64 arrived)
 {
-    while (conn->client_buf->len >= DISCORD_HEADER_SIZE) {
-        guint32 opcode;
-        gchar *json = NULL;
-        gsize consumed;
-
-        if (!discord_parse_frame(conn->client_buf->data,
-                                 conn->client_buf->len,
-                                 &opcode, &json, &consumed))
-            break; /* incomplete frame */
+    DiscordIpcState *state = conn->ipc_state;
+
+    /* Handle handshake in passive mode */
+    if (opcode == DISCORD_OP_HANDSHAKE && !state->upstream_active &&
+        !conn->handshake_done) {
+        guint8 *resp;
+        gsize resp_len;
+        discord_build_ready_response(&resp, &resp_len);
+        ring_append(&conn->to_client, resp, resp_len);
+        g_free(resp);
+        conn->handshake_done = TRUE;
+    }
 
-        /* Handle handshake in passive mode */
-        if (opcode == DISCORD_OP_HANDSHAKE &&
-            !conn->ipc_state->upstream_active &&
-            !conn->handshake_done) {
-            guint8 *resp;
-            gsize resp_len;
-            discord_build_ready_response(&resp, &resp_len);
-            /* Best effort send */
-            if (conn->client_fd >= 0)
-                (void)send(conn->client_fd, resp, resp_len, MSG_NOSIGNAL);
-            g_free(resp);
-            conn->handshake_done = TRUE;
+    /* Intercept SET_ACTIVITY */
+    if (opcode == DISCORD_OP_FRAME) {
+        pid_t pid;
+        gchar *rp_state = NULL, *rp_details = NULL;
+        if (discord_extract_activity(json, &pid, &rp_state, &rp_details)) {
+            if (store_presence(state, conn, pid, rp_state, rp_details,
+                               arrived))
+                notify_presence(state, pid);
+            g_free(rp_state);
+            g_free(rp_details);
         }
+    }
+}
 
-        /* Intercept SET_ACTIVITY */
-        if (opcode == DISCORD_OP_FRAME && json) {
-            pid_t pid;
-            gchar *rp_state = NULL, *rp_details = NULL;
-            if (discord_extract_activity(json, &pid, &rp_state, &rp_details)) {
-                discord_presence_store(conn->ipc_state, pid,
-                                       rp_state, rp_details);
-                g_free(rp_state);
-                g_free(rp_details);
-            }
+/* Handles the whole frames read since the last call; arrived is when
+ * their last bytes were read.  FALSE for a frame that can never fit. */
+static gboolean process_client_buffer(ClientConnection *conn, gint64 arrived)
+{
+    ByteRing *ring = &conn->to_upstream;
+
+    while (ring->len - conn->parsed >= DISCORD_HEADER_SIZE) {
+        guint32 header[2];
+        ring_copy(ring, conn->parsed, header, DISCORD_HEADER_SIZE);
+        guint32 opcode = GUINT32_FROM_LE(header[0]);
+        guint32 payload_len = GUINT32_FROM_LE(header[1]);
+
+        if (payload_len > DISCORD_BUFFER_LIMIT - DISCORD_HEADER_SIZE) {
+            g_printerr("[discord-ipc] Frame of %u bytes from client, "
+                       "disconnecting\n", payload_len);
+            return FALSE;
         }
+        if (ring->len - conn->parsed < DISCORD_HEADER_SIZE + payload_len)
+            break; /* incomplete frame */
 
+        gchar *json = g_malloc(payload_len + 1);
+        ring_copy(ring, conn->parsed + DISCORD_HEADER_SIZE, json, payload_len);
+        json[payload_len] = '\0';
+        handle_frame(conn, opcode, json, arrived);
         g_free(json);
 
-        /* Forward to upstream if connected */
-        if (conn->upstream_fd >= 0) {
-            (void)send(conn->upstream_fd, conn->client_buf->data,
-                       consumed, MSG_NOSIGNAL);
-        }
+        conn->parsed += DISCORD_HEADER_SIZE + payload_len;
+    }
 
-        g_byte_array_remove_range(conn->client_buf, 0, consumed);
+    /* Frames are forwarded whole; with no upstream they end here */
+    if (conn->upstream_fd < 0) {
+        ring_consume(ring, conn->parsed);
+        conn->parsed = 0;
     }
+    return TRUE;
 }
 
-static gboolean on_client_data(gint fd, GIOCondition cond, gpointer user_data)
+/* ── Forwarding ─────────────────────────────────────── */
+
+static void watch_fd(ClientConnection *conn, GSource **source, int fd,
+                     GIOCondition cond, gboolean want, GSourceFunc func)
 {
-    ClientConnection *conn = user_data;
+    if (want && !*source && fd >= 0) {
+        *source = g_unix_fd_source_new(fd, cond);
+        g_source_set_callback(*source, func, conn, NULL);
+        g_source_attach(*source, conn->ipc_state->context);
+    } else if (!want && *source) {
+        g_source_destroy(*source);
+        g_source_unref(*source);
+        *source = NULL;
+    }
+}
 
-    if (cond & (G_IO_HUP | G_IO_ERR | G_IO_NVAL)) {
-        close_connection(conn);
-        return G_SOURCE_REMOVE;
+/* A side is read only while there is room for what it sends and watched
+ * for writing only while bytes wait for it, so a slow reader holds back
+ * its peer instead of having bytes pile up or get lost. */
+static void update_watches(ClientConnection *conn)
+{
+    gboolean upstream_ready = conn->upstream_fd >= 0 && !conn->connecting;
+
+    watch_fd(conn, &conn->client_source, conn->client_fd,
+             G_IO_IN | G_IO_HUP | G_IO_ERR,
+             !conn->client_eof && ring_has_room(&conn->to_upstream),
+             G_SOURCE_FUNC(on_client_in));
+    watch_fd(conn, &conn->client_out_source, conn->client_fd, G_IO_OUT,
+             conn->to_client.len > 0 || conn->piped > 0,
+             G_SOURCE_FUNC(on_client_out));
+    watch_fd(conn, &conn->upstream_source, conn->upstream_fd,
+             G_IO_IN | G_IO_HUP | G_IO_ERR,
+             upstream_ready && !conn->upstream_eof &&
+             (conn->pipe_fds[1] >= 0 ? !conn->pipe_full
+                                     : ring_has_room(&conn->to_client)),
+             G_SOURCE_FUNC(on_upstream_in));
+    watch_fd(conn, &conn->upstream_out_source, conn->upstream_fd, G_IO_OUT,
+             (conn->connecting && !conn->connect_retry_source) ||
+             (upstream_ready && conn->parsed > 0),
+             G_SOURCE_FUNC(on_upstream_out));
+}
+
+/* Sends what both sockets take.  FALSE when one of them is gone. */
+static gboolean flush_connection(ClientConnection *conn)
+{
+    DiscordProxyStats *stats = &conn->ipc_state->proxy_stats;
+
+    if (conn->upstream_fd >= 0 && !conn->connecting && conn->parsed > 0) {
+        gssize sent = ring_flush(&conn->to_upstream, conn->parsed,
+                                 conn->upstream_fd);
+        if (sent < 0)
+            return FALSE;
+        conn->parsed -= sent;
+        stats->to_upstream += sent;
     }
+    if (conn->to_client.len > 0) {
+        gssize sent = ring_flush(&conn->to_client, conn->to_client.len,
+                                 conn->client_fd);
+        if (sent < 0)
+            return FALSE;
+        stats->to_client += sent;
+    }
+    if (conn->piped > 0) {
+        gssize sent = splice_flush(conn);
+        if (sent < 0)
+            return FALSE;
+        stats->to_client += sent;
+        stats->spliced += sent;
+    }
+    return TRUE;
+}
 
-    guint8 buf[4096];
-    ssize_t n = recv(fd, buf, sizeof(buf), 0);
-    if (n <= 0) {
+/* Once a side has hung up, the connection lasts until what it sent is
+ * through */
+static gboolean connection_done(const ClientConnection *conn)
+{
+    if (conn->client_eof &&
+        (conn->upstream_fd < 0 || (!conn->connecting && conn->parsed == 0)))
+        return TRUE;
+    return conn->upstream_eof && conn->to_client.len == 0 && conn->piped == 0;
+}
+
+/* After every event: forward, then close or watch for what comes next */
+static void connection_changed(ClientConnection *conn)
+{
+    if (!flush_connection(conn) || connection_done(conn)) {
         close_connection(conn);
-        return G_SOURCE_REMOVE;
+        return;
     }
-
-    g_byte_array_append(conn->client_buf, buf, n);
-    process_client_buffer(conn);
-    return G_SOURCE_CONTINUE;
+    update_watches(conn);
 }
 
-static gboolean on_upstream_data(gint fd, GIOCondition cond, gpointer user_data)
+static gboolean on_client_in(gint fd, GIOCondition cond G_GNUC_UNUSED,
+                             gpointer user_data)
 {
     ClientConnection *conn = user_data;
 
-    if (cond & (G_IO_HUP | G_IO_ERR | G_IO_NVAL)) {
+    /* A hang-up comes after the bytes sent before it */
+    if (ring_fill(&conn->to_upstream, fd, &conn->client_eof,
+                  &conn->ipc_state->proxy_stats) > 0 &&
+        !process_client_buffer(conn, g_get_monotonic_time())) {
         close_connection(conn);
         return G_SOURCE_REMOVE;
     }
+    connection_changed(conn);
+    return G_SOURCE_CONTINUE;
+}
 
-    guint8 buf[4096];
-    ssize_t n = recv(fd, buf, sizeof(buf), 0);
-    if (n <= 0) {
-        close_connection(conn);
-        return G_SOURCE_REMOVE;
+static gboolean on_upstream_in(gint fd, GIOCondition cond G_GNUC_UNUSED,
+                               gpointer user_data)
+{
+    ClientConnection *conn = user_data;
+    if (conn->pipe_fds[1] < 0 || !splice_fill(conn, fd))
+        ring_fill(&conn->to_client, fd, &conn->upstream_eof,
+                  &conn->ipc_state->proxy_stats);
+    connection_changed(conn);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_client_out(gint fd G_GNUC_UNUSED,
+                              GIOCondition cond G_GNUC_UNUSED,
+                              gpointer user_data)
+{
+    connection_changed(user_data);
+    return G_SOURCE_CONTINUE;
+}
+
+/* ── Upstream connect ───────────────────────────────── */
+
+/* Without Discord the client's frames are only read, as in passive mode */
+static void upstream_failed(ClientConnection *conn, int err)
+{
+    g_printerr("[discord-ipc] Failed to connect to upstream: %s\n",
+               g_strerror(err));
+    close(conn->upstream_fd);
+    conn->upstream_fd = -1;
+    conn->connecting = FALSE;
+    close_pipe(conn);
+    ring_consume(&conn->to_upstream, conn->parsed);
+    conn->parsed = 0;
+}
+
+static gboolean on_connect_retry(gpointer user_data);
+
+static void try_connect(ClientConnection *conn)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, conn->ipc_state->real_ipc_path,
+            sizeof(addr.sun_path) - 1);
+
+    if (connect(conn->upstream_fd, (struct sockaddr *)&addr,
+                sizeof(addr)) == 0 || errno == EISCONN) {
+        conn->connecting = FALSE;
+    } else if (errno == EINPROGRESS) {
+        /* G_IO_OUT tells when it is done */
+    } else if (errno == EAGAIN && ++conn->connect_attempts < CONNECT_ATTEMPTS) {
+        /* Discord's listen backlog is full */
+        conn->connect_retry_source = g_timeout_source_new(CONNECT_RETRY_MS);
+        g_source_set_callback(conn->connect_retry_source, on_connect_retry,
+                              conn, NULL);
+        g_source_attach(conn->connect_retry_source, conn->ipc_state->context);
+    } else {
+        upstream_failed(conn, errno);
     }
+}
+
+static gboolean on_connect_retry(gpointer user_data)
+{
+    ClientConnection *conn = user_data;
+    g_source_unref(conn->connect_retry_source);
+    conn->connect_retry_source = NULL;
+    try_connect(conn);
+    connection_changed(conn);
+    return G_SOURCE_REMOVE;
+}
 
-    /* Forward upstream response to client */
-    if (conn->client_fd >= 0)
-        (void)send(conn->client_fd, buf, n, MSG_NOSIGNAL);
+static gboolean on_upstream_out(gint fd, GIOCondition cond G_GNUC_UNUSED,
+                                gpointer user_data)
+{
+    ClientConnection *conn = user_data;
 
+    if (conn->connecting) {
+        int err = 0;
+        socklen_t len = sizeof(err);
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0)
+            err = errno;
+        if (err)
+            upstream_failed(conn, err);
+        else
+            conn->connecting = FALSE;
+    }
+    connection_changed(conn);
     return G_SOURCE_CONTINUE;
 }
 
+/* Connects to Discord without blocking the main loop; what the client
+ * sends meanwhile waits in to_upstream */
+static void connect_upstream(ClientConnection *conn)
+{
+    conn->upstream_fd = socket(AF_UNIX,
+                               SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (conn->upstream_fd < 0) {
+        g_printerr("[discord-ipc] Failed to connect to upstream: %s\n",
+                   g_strerror(errno));
+        return;
+    }
+    conn->connecting = TRUE;
+    if (conn->ipc_state->splice_to_client)
+        open_pipe(conn);
+    try_connect(conn);
+}
+
 /* ── Server accept handler ──────────────────────────── */
 
 static gboolean on_server_accept(gint fd, GIOCondition cond, gpointer user_data)
@@ -350,61 +1218,38 @@ static gboolean on_server_accept(gint fd, GIOCondition cond, gpointer user_data)
     if (cond & (G_IO_HUP | G_IO_ERR | G_IO_NVAL))
         return G_SOURCE_REMOVE;
 
-    int client_fd = accept(fd, NULL, NULL);
-    if (client_fd < 0)
-        return G_SOURCE_CONTINUE;
+    for (;;) {
+        int client_fd = accept(fd, NULL, NULL);
+        if (client_fd < 0)
+            return G_SOURCE_CONTINUE;
 
-    /* Set non-blocking */
-    fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+        /* Set non-blocking */
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+        fcntl(client_fd, F_SETFD, FD_CLOEXEC);
 
-    ClientConnection *conn = g_new0(ClientConnection, 1);
-    conn->client_fd = client_fd;
-    conn->upstream_fd = -1;
-    conn->client_buf = g_byte_array_new();
-    conn->upstream_buf = g_byte_array_new();
-    conn->ipc_state = state;
-    conn->handshake_done = FALSE;
-
-    /* Connect to upstream if available */
-    if (state->upstream_active && state->real_ipc_path) {
-        int ufd = socket(AF_UNIX, SOCK_STREAM, 0);
-        if (ufd >= 0) {
-            struct sockaddr_un addr;
-            memset(&addr, 0, sizeof(addr));
-            addr.sun_family = AF_UNIX;
-            strncpy(addr.sun_path, state->real_ipc_path,
-                    sizeof(addr.sun_path) - 1);
-
-            if (connect(ufd, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
-                fcntl(ufd, F_SETFL, fcntl(ufd, F_GETFL) | O_NONBLOCK);
-                conn->upstream_fd = ufd;
-
-                conn->upstream_source = g_unix_fd_source_new(ufd,
-                    G_IO_IN | G_IO_HUP | G_IO_ERR);
-                g_source_set_callback(conn->upstream_source,
-                    G_SOURCE_FUNC(on_upstream_data), conn, NULL);
-                g_source_attach(conn->upstream_source, NULL);
-            } else {
-                close(ufd);
-                g_printerr("[discord-ipc] Failed to connect to upstream\n");
-            }
-        }
-    }
+        ClientConnection *conn = g_new0(ClientConnection, 1);
+        conn->client_fd = client_fd;
+        conn->upstream_fd = -1;
+        conn->pipe_fds[0] = conn->pipe_fds[1] = -1;
+        conn->ipc_state = state;
+        conn->handshake_done = FALSE;
 
-    /* Watch client for data */
-    conn->client_source = g_unix_fd_source_new(client_fd,
-        G_IO_IN | G_IO_HUP | G_IO_ERR);
-    g_source_set_callback(conn->client_source,
-        G_SOURCE_FUNC(on_client_data), conn, NULL);
-    g_source_attach(conn->client_source, NULL);
+        if (state->upstream_active && state->real_ipc_path)
+            connect_upstream(conn);
 
-    g_ptr_array_add(state->connections, conn);
-    return G_SOURCE_CONTINUE;
+        g_ptr_array_add(state->connections, conn);
+        update_watches(conn);
+    }
 }
 
 /* ── Setup / Cleanup ────────────────────────────────── */
 
 gboolean discord_ipc_setup(DiscordIpcState *state)
+{
+    return discord_ipc_setup_full(state, FALSE);
+}
+
+gboolean discord_ipc_setup_full(DiscordIpcState *state, gboolean own_thread)
 {
     memset(state, 0, sizeof(*state));
     state->server_fd = -1;
@@ -422,7 +1267,18 @@ gboolean discord_ipc_setup(DiscordIpcState *state)
 
     state->presence_by_pid = g_hash_table_new_full(g_direct_hash, g_direct_equal,
                                                     NULL, free_rp_entry);
+    state->max_presence = DISCORD_PRESENCE_MAX;
+    state->presence_ttl = DISCORD_PRESENCE_TTL;
     state->connections = g_ptr_array_new();
+    state->splice_to_client = TRUE;
+    if (own_thread) {
+        state->context = g_main_context_new();
+        state->thread = ipc_thread_new(state);
+    }
+
+    /* Unlike send(), splice() into a socket has no MSG_NOSIGNAL: a client
+     * hanging up must not take the tracker down with it */
+    signal(SIGPIPE, SIG_IGN);
 
     /* Crash recovery: leftover backup socket from previous run */
     if (g_file_test(state->real_ipc_path, G_FILE_TEST_EXISTS)) {
@@ -484,7 +1340,10 @@ gboolean discord_ipc_setup(DiscordIpcState *state)
     state->server_source = g_unix_fd_source_new(state->server_fd, G_IO_IN);
     g_source_set_callback(state->server_source,
         G_SOURCE_FUNC(on_server_accept), state, NULL);
-    g_source_attach(state->server_source, NULL);
+    g_source_attach(state->server_source, state->context);
+    state->sweep_source = g_timeout_source_new_seconds(PRESENCE_SWEEP_INTERVAL_S);
+    g_source_set_callback(state->sweep_source, on_presence_sweep, state, NULL);
+    g_source_attach(state->sweep_source, state->context);
 
     state->active = TRUE;
     g_printerr("[discord-ipc] Listening on %s\n", state->ipc_path);
@@ -503,12 +1362,33 @@ fail:
     return FALSE;
 }
 
+void discord_ipc_start(DiscordIpcState *state)
+{
+    DiscordIpcThread *t = state->thread;
+    if (t && state->active && !t->thread)
+        t->thread = g_thread_new("discord-ipc", proxy_thread, state);
+}
+
+void discord_ipc_stop(DiscordIpcState *state)
+{
+    DiscordIpcThread *t = state->thread;
+    if (!t || !t->thread)
+        return;
+    g_atomic_int_set(&t->stopping, 1);
+    g_main_context_wakeup(state->context);
+    g_thread_join(t->thread);
+    t->thread = NULL;
+}
+
 void discord_ipc_cleanup(DiscordIpcState *state)
 {
     if (!state)
         return;
 
+    discord_ipc_stop(state);
     state->active = FALSE;
+    /* Closing the connections below is no change to report */
+    state->presence_changed = NULL;
 
     /* Close all connections */
     if (state->connections) {
@@ -520,6 +1400,12 @@ void discord_ipc_cleanup(DiscordIpcState *state)
         state->connections = NULL;
     }
 
+    if (state->sweep_source) {
+        g_source_destroy(state->sweep_source);
+        g_source_unref(state->sweep_source);
+        state->sweep_source = NULL;
+    }
+
     /* Close server */
     if (state->server_source) {
         g_source_destroy(state->server_source);
@@ -546,6 +1432,14 @@ void discord_ipc_cleanup(DiscordIpcState *state)
         g_hash_table_destroy(state->presence_by_pid);
         state->presence_by_pid = NULL;
     }
+    if (state->thread) {
+        ipc_thread_free(state->thread);
+        state->thread = NULL;
+    }
+    if (state->context) {
+        g_main_context_unref(state->context);
+        state->context = NULL;
+    }
 
     g_free(state->ipc_path);
     g_free(state->real_ipc_path);
@@ -10,6 +10,17 @@
 #define DISCORD_OP_FRAME     1
 #define DISCORD_HEADER_SIZE  8
 
+/* ── Presence store limits ──────────────────────────── */
+
+#define DISCORD_PRESENCE_MAX 256                          /* entries */
+#define DISCORD_PRESENCE_TTL (24 * 3600 * G_USEC_PER_SEC) /* since update */
+
+/* ── Proxy buffering ────────────────────────────────── */
+
+/* Bytes held per direction of a connection.  A side is not read while
+ * that many wait for the other side to take them; a frame must fit. */
+#define DISCORD_BUFFER_LIMIT (256 * 1024)
+
 /* ── Data structures ────────────────────────────────── */
 
 typedef struct {
@@ -19,7 +30,33 @@ typedef struct {
     gint64 last_updated;  /* monotonic time */
 } RichPresenceEntry;
 
+/* Called when a SET_ACTIVITY frame changes a PID's presence.  entry stays
+ * owned by the proxy; its last_updated is when the frame arrived.  When
+ * the entry is evicted, state and details are NULL and last_updated is
+ * when it went. */
+typedef void (*PresenceChangedFunc)(const RichPresenceEntry *entry,
+                                    gpointer user_data);
+
 typedef struct _ClientConnection ClientConnection;
+typedef struct _DiscordIpcThread DiscordIpcThread;
+
+/* Presence store size and why entries left it */
+typedef struct {
+    guint size;
+    guint64 evicted_closed;   /* the client that set it disconnected */
+    guint64 evicted_exited;   /* the process exited */
+    guint64 evicted_expired;  /* not updated within presence_ttl */
+    guint64 evicted_lru;      /* least recently updated, store full */
+} DiscordPresenceStats;
+
+/* What the proxy passed along */
+typedef struct {
+    guint64 to_upstream;      /* bytes from clients forwarded to Discord */
+    guint64 to_client;        /* bytes sent to clients */
+    guint64 spliced;          /* of those, moved with splice() */
+    guint64 read_pauses;      /* reads held back for a full buffer */
+    gsize max_buffered;       /* most bytes one direction held */
+} DiscordProxyStats;
 
 typedef struct {
     gchar *ipc_path;            /* $XDG_RUNTIME_DIR/discord-ipc-0 */
@@ -28,19 +65,59 @@ typedef struct {
     int server_fd;              /* listening socket fd */
     GSource *server_source;     /* GSource for accept */
     GHashTable *presence_by_pid; /* GINT_TO_POINTER(pid) → RichPresenceEntry* */
+    guint max_presence;         /* entries kept, 0 for no limit */
+    gint64 presence_ttl;        /* µs without update before expiry, 0: never */
+    GSource *sweep_source;      /* expires entries once a minute */
+    DiscordPresenceStats presence_stats; /* size is filled in on request */
     GPtrArray *connections;     /* active ClientConnection* */
+    DiscordProxyStats proxy_stats;
+    gboolean splice_to_client;  /* relay Discord's bytes with splice() */
     gboolean active;            /* TRUE when proxy is running */
+    PresenceChangedFunc presence_changed; /* set after discord_ipc_setup() */
+    gpointer presence_changed_data;
+    GMainContext *context;      /* the proxy's sources, NULL: default */
+    DiscordIpcThread *thread;   /* NULL unless it has a thread of its own */
 } DiscordIpcState;
 
 /* ── Lifecycle ──────────────────────────────────────── */
 
+/* Runs the proxy on the caller's thread-default main context */
 gboolean discord_ipc_setup(DiscordIpcState *state);
 void discord_ipc_cleanup(DiscordIpcState *state);
 
+/* ── Own thread ─────────────────────────────────────────
+ *
+ * With own_thread the proxy runs on a thread and GMainContext of its
+ * own, from discord_ipc_start() until discord_ipc_stop(), so stalls in
+ * the caller's main loop do not delay RPC traffic.  presence_changed is
+ * still called on the thread that set it up, from its thread-default
+ * context, and lookups from that thread take no lock.  Presence stats
+ * are read once the proxy has stopped. */
+
+gboolean discord_ipc_setup_full(DiscordIpcState *state, gboolean own_thread);
+/* Starts the thread; without one this does nothing */
+void discord_ipc_start(DiscordIpcState *state);
+/* Joins the thread, leaving the state to the caller; cleanup stops it */
+void discord_ipc_stop(DiscordIpcState *state);
+
 /* ── Lookup ─────────────────────────────────────────── */
 
+/* The entry stays valid until the caller's main context next iterates */
 const RichPresenceEntry *discord_ipc_lookup_pid(DiscordIpcState *state, pid_t pid);
 
+/* ── Presence store lifetime ────────────────────────────
+ *
+ * An entry set by a client goes when that client disconnects or the
+ * process exits (watched with a pidfd where the kernel has them), so a
+ * recycled PID never inherits it.  Past max_presence the least recently
+ * updated entry makes room, and entries not updated within presence_ttl
+ * expire. */
+
+/* Drops entries last updated before now - presence_ttl */
+void discord_presence_expire(DiscordIpcState *state, gint64 now);
+void discord_ipc_get_presence_stats(const DiscordIpcState *state,
+                                    DiscordPresenceStats *stats);
+
 /* ── Testable helpers ───────────────────────────────── */
 
 gboolean discord_parse_frame(const guint8 *data, gsize len,
@@ -52,8 +129,15 @@ gboolean discord_extract_activity(const gchar *json,
 
 void discord_build_ready_response(guint8 **out, gsize *out_len);
 
-void discord_presence_store(DiscordIpcState *state, pid_t pid,
-                            const gchar *rp_state, const gchar *rp_details);
+/* Records pid's presence as of monotonic time arrived, updating its entry
+ * in place.  TRUE when state or details differ from what was stored. */
+gboolean discord_presence_store(DiscordIpcState *state, pid_t pid,
+                                const gchar *rp_state, const gchar *rp_details,
+                                gint64 arrived);
+/* Whether entry holds this state and details; NULL and "" are the same */
+gboolean discord_presence_matches(const RichPresenceEntry *entry,
+                                  const gchar *rp_state,
+                                  const gchar *rp_details);
 
 gboolean is_discord_socket_alive(const gchar *path);
 
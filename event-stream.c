@@ -0,0 +1,500 @@
+#include "event-stream.h"
+#include <glib-unix.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#define EVENT_HEADER_SIZE 16    /* kind to count, after the length */
+#define EVENT_STRING_MAX  65536 /* longer strings are cut */
+#define FLUSH_IOVECS      64
+
+/* ── Per-subscriber state ───────────────────────────── */
+
+struct _EventSubscriber {
+    EventStream *stream;
+    int fd;
+    GSource *in_source;   /* hang-up, and anything the subscriber sends */
+    GSource *out_source;  /* while records are queued */
+    GQueue queue;         /* GBytes* not yet sent in full */
+    gsize head_sent;      /* bytes of the first one already sent */
+    gsize queued;         /* bytes in queue still to send */
+    guint32 lost;         /* records dropped since the queue filled up */
+};
+
+static gboolean on_subscriber_out(gint fd, GIOCondition cond, gpointer user_data);
+
+gchar *event_stream_default_path(void)
+{
+    return build_runtime_path(EVENT_STREAM_FILE);
+}
+
+/* ── Encoding ───────────────────────────────────────── */
+
+static void put_u32(GByteArray *buf, guint32 v)
+{
+    v = GUINT32_TO_LE(v);
+    g_byte_array_append(buf, (const guint8 *)&v, sizeof(v));
+}
+
+/* A string cut to EVENT_STRING_MAX at a character boundary */
+static void put_string(GByteArray *buf, const gchar *str)
+{
+    gsize len = str ? strlen(str) : 0;
+    if (len > EVENT_STRING_MAX) {
+        len = EVENT_STRING_MAX;
+        while (len > 0 && ((guchar)str[len] & 0xc0) == 0x80)
+            len--;
+    }
+    put_u32(buf, (guint32)len);
+    g_byte_array_append(buf, (const guint8 *)str, len);
+}
+
+static guint8 status_code(const gchar *status)
+{
+    if (g_strcmp0(status, "locked") == 0)
+        return EVENT_STATUS_LOCKED;
+    if (g_strcmp0(status, "idle") == 0)
+        return EVENT_STATUS_IDLE;
+    return EVENT_STATUS_ACTIVE;
+}
+
+void event_record_encode(GByteArray *buf, guint8 kind, const CsvRecord *rec,
+                         guint32 count)
+{
+    guint length_at = buf->len;
+    put_u32(buf, 0);
+
+    guint8 head[4] = {kind, rec ? status_code(rec->status) : 0, 0, 0};
+    g_byte_array_append(buf, head, sizeof(head));
+    guint64 wall = GUINT64_TO_LE((guint64)(rec ? (gint64)rec->wall : 0));
+    g_byte_array_append(buf, (const guint8 *)&wall, sizeof(wall));
+    put_u32(buf, count);
+    put_string(buf, rec ? rec->title : NULL);
+    put_string(buf, rec ? rec->wm_class : NULL);
+    put_string(buf, rec ? rec->wm_class_instance : NULL);
+    put_string(buf, rec ? rec->rp_state : NULL);
+    put_string(buf, rec ? rec->rp_details : NULL);
+
+    guint32 length = GUINT32_TO_LE(buf->len - length_at - sizeof(guint32));
+    memcpy(buf->data + length_at, &length, sizeof(length));
+}
+
+static guint32 get_u32(const guint8 *p)
+{
+    guint32 v;
+    memcpy(&v, p, sizeof(v));
+    return GUINT32_FROM_LE(v);
+}
+
+int event_record_parse(const guint8 *data, gsize len, EventRecord *rec,
+                       gsize *consumed)
+{
+    if (len < sizeof(guint32))
+        return 0;
+    guint32 length = get_u32(data);
+    if (length < EVENT_HEADER_SIZE + 5 * sizeof(guint32) ||
+        length > EVENT_RECORD_MAX)
+        return -1;
+    if (len < sizeof(guint32) + length)
+        return 0;
+
+    const guint8 *p = data + sizeof(guint32);
+    const guint8 *end = p + length;
+    guint64 wall;
+    memcpy(&wall, p + 4, sizeof(wall));
+
+    memset(rec, 0, sizeof(*rec));
+    rec->kind = p[0];
+    rec->status = p[1];
+    rec->wall = (gint64)GUINT64_FROM_LE(wall);
+    rec->count = get_u32(p + 12);
+    p += EVENT_HEADER_SIZE;
+
+    gchar **fields[] = {&rec->title, &rec->wm_class, &rec->wm_class_instance,
+                        &rec->rp_state, &rec->rp_details};
+    for (gsize i = 0; i < G_N_ELEMENTS(fields); i++) {
+        if ((gsize)(end - p) < sizeof(guint32) ||
+            (gsize)(end - p) - sizeof(guint32) < get_u32(p)) {
+            event_record_clear(rec);
+            return -1;
+        }
+        guint32 n = get_u32(p);
+        *fields[i] = g_strndup((const gchar *)p + sizeof(guint32), n);
+        p += sizeof(guint32) + n;
+    }
+    *consumed = sizeof(guint32) + length;
+    return 1;
+}
+
+const gchar *event_status_name(guint8 status)
+{
+    switch (status) {
+    case EVENT_STATUS_IDLE:
+        return "idle";
+    case EVENT_STATUS_LOCKED:
+        return "locked";
+    default:
+        return "active";
+    }
+}
+
+void event_record_clear(EventRecord *rec)
+{
+    g_free(rec->title);
+    g_free(rec->wm_class);
+    g_free(rec->wm_class_instance);
+    g_free(rec->rp_state);
+    g_free(rec->rp_details);
+    memset(rec, 0, sizeof(*rec));
+}
+
+/* The interval in progress, NULL before the first one.  Away intervals
+ * carry no window, as in the day file. */
+static GBytes *encode_start(const AppState *state)
+{
+    if (!state || !state->current_title)
+        return NULL;
+
+    gboolean away = state->is_locked || state->is_idle;
+    CsvRecord rec = {
+        .wall = state->current_wall,
+        .status = state->is_locked ? "locked" : (state->is_idle ? "idle" : "active"),
+        .title = away ? NULL : state->current_title,
+        .wm_class = away ? NULL : state->current_wm_class,
+        .wm_class_instance = away ? NULL : state->current_wm_class_instance,
+        .rp_state = away ? NULL : state->current_rp_state,
+        .rp_details = away ? NULL : state->current_rp_details,
+    };
+    GByteArray *buf = g_byte_array_new();
+    event_record_encode(buf, EVENT_STARTED, &rec, 0);
+    return g_byte_array_free_to_bytes(buf);
+}
+
+/* ── Subscribers ────────────────────────────────────── */
+
+static void subscriber_close(EventSubscriber *sub)
+{
+    if (sub->in_source) {
+        g_source_destroy(sub->in_source);
+        g_source_unref(sub->in_source);
+    }
+    if (sub->out_source) {
+        g_source_destroy(sub->out_source);
+        g_source_unref(sub->out_source);
+    }
+    close(sub->fd);
+    g_queue_clear_full(&sub->queue, (GDestroyNotify)g_bytes_unref);
+    g_ptr_array_remove_fast(sub->stream->subscribers, sub);
+    g_free(sub);
+}
+
+static void subscriber_enqueue(EventSubscriber *sub, GBytes *record)
+{
+    g_queue_push_tail(&sub->queue, g_bytes_ref(record));
+    sub->queued += g_bytes_get_size(record);
+}
+
+/* Sends what the socket takes.  FALSE when the subscriber was closed. */
+static gboolean subscriber_flush(EventSubscriber *sub)
+{
+    for (;;) {
+        if (g_queue_is_empty(&sub->queue)) {
+            if (!sub->lost)
+                break;
+            /* Caught up after dropping: say how much, then where we are */
+            GByteArray *buf = g_byte_array_new();
+            event_record_encode(buf, EVENT_LOST, NULL, sub->lost);
+            GBytes *lost = g_byte_array_free_to_bytes(buf);
+            subscriber_enqueue(sub, lost);
+            g_bytes_unref(lost);
+            GBytes *start = encode_start(sub->stream->state);
+            if (start) {
+                subscriber_enqueue(sub, start);
+                g_bytes_unref(start);
+            }
+            sub->lost = 0;
+        }
+
+        struct iovec iov[FLUSH_IOVECS];
+        int n = 0;
+        for (GList *l = sub->queue.head; l && n < FLUSH_IOVECS; l = l->next, n++) {
+            gsize size;
+            const guint8 *data = g_bytes_get_data(l->data, &size);
+            gsize skip = n == 0 ? sub->head_sent : 0;
+            iov[n].iov_base = (gpointer)(data + skip);
+            iov[n].iov_len = size - skip;
+        }
+
+        struct msghdr msg = {.msg_iov = iov, .msg_iovlen = n};
+        ssize_t sent = sendmsg(sub->fd, &msg, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (sent < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            subscriber_close(sub);
+            return FALSE;
+        }
+
+        sub->queued -= sent;
+        while (sent > 0) {
+            gsize size = g_bytes_get_size(g_queue_peek_head(&sub->queue));
+            gsize left = size - sub->head_sent;
+            if ((gsize)sent < left) {
+                sub->head_sent += sent;
+                break;
+            }
+            sent -= left;
+            g_bytes_unref(g_queue_pop_head(&sub->queue));
+            sub->head_sent = 0;
+        }
+    }
+
+    /* Watch for room only while something waits for it */
+    if (g_queue_is_empty(&sub->queue) && sub->out_source) {
+        g_source_destroy(sub->out_source);
+        g_source_unref(sub->out_source);
+        sub->out_source = NULL;
+    } else if (!g_queue_is_empty(&sub->queue) && !sub->out_source) {
+        sub->out_source = g_unix_fd_source_new(sub->fd, G_IO_OUT);
+        g_source_set_callback(sub->out_source,
+            G_SOURCE_FUNC(on_subscriber_out), sub, NULL);
+        g_source_attach(sub->out_source, NULL);
+    }
+    return TRUE;
+}
+
+/* Queues a record behind what the subscriber has not taken yet */
+static void subscriber_push(EventSubscriber *sub, GBytes *record)
+{
+    EventStream *stream = sub->stream;
+
+    /* Already behind: drop until it has caught up, so EVENT_LOST marks
+     * one gap */
+    if (sub->lost) {
+        sub->lost++;
+        stream->dropped++;
+        return;
+    }
+
+    /* An empty queue takes any record, so one over the limit still goes */
+    gsize size = g_bytes_get_size(record);
+    if (sub->queued > 0 && sub->queued + size > stream->queue_limit) {
+        if (stream->policy == EVENT_STREAM_DISCONNECT) {
+            stream->disconnected++;
+            subscriber_close(sub);
+            return;
+        }
+        sub->lost = 1;
+        stream->dropped++;
+        return;
+    }
+
+    gboolean idle = g_queue_is_empty(&sub->queue);
+    subscriber_enqueue(sub, record);
+    if (idle)
+        subscriber_flush(sub);
+}
+
+static gboolean on_subscriber_out(gint fd G_GNUC_UNUSED, GIOCondition cond,
+                                  gpointer user_data)
+{
+    EventSubscriber *sub = user_data;
+    if (cond & (G_IO_HUP | G_IO_ERR)) {
+        subscriber_close(sub);
+        return G_SOURCE_REMOVE;
+    }
+    /* The source is gone if the queue drained or the subscriber closed */
+    subscriber_flush(sub);
+    return G_SOURCE_CONTINUE;
+}
+
+static gboolean on_subscriber_in(gint fd, GIOCondition cond, gpointer user_data)
+{
+    EventSubscriber *sub = user_data;
+    char buf[256];
+
+    /* Subscribers have nothing to say; reading tells when they leave */
+    if (!(cond & (G_IO_HUP | G_IO_ERR))) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n > 0 || (n < 0 && (errno == EAGAIN || errno == EINTR)))
+            return G_SOURCE_CONTINUE;
+    }
+    subscriber_close(sub);
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean on_stream_accept(gint fd, GIOCondition cond, gpointer user_data)
+{
+    EventStream *stream = user_data;
+
+    if (cond & (G_IO_HUP | G_IO_ERR | G_IO_NVAL))
+        return G_SOURCE_REMOVE;
+
+    for (;;) {
+        int client_fd = accept(fd, NULL, NULL);
+        if (client_fd < 0)
+            return G_SOURCE_CONTINUE;
+        if (stream->subscribers->len >= stream->max_subscribers) {
+            close(client_fd);
+            continue;
+        }
+        fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL) | O_NONBLOCK);
+        fcntl(client_fd, F_SETFD, FD_CLOEXEC);
+
+        EventSubscriber *sub = g_new0(EventSubscriber, 1);
+        sub->stream = stream;
+        sub->fd = client_fd;
+        g_queue_init(&sub->queue);
+        sub->in_source = g_unix_fd_source_new(client_fd,
+            G_IO_IN | G_IO_HUP | G_IO_ERR);
+        g_source_set_callback(sub->in_source,
+            G_SOURCE_FUNC(on_subscriber_in), sub, NULL);
+        g_source_attach(sub->in_source, NULL);
+        g_ptr_array_add(stream->subscribers, sub);
+
+        GBytes *start = encode_start(stream->state);
+        if (start) {
+            subscriber_push(sub, start);
+            g_bytes_unref(start);
+        }
+    }
+}
+
+/* ── Setup / Cleanup ────────────────────────────────── */
+
+gboolean event_stream_setup(EventStream *stream, const gchar *path,
+                            const AppState *state, GError **error)
+{
+    memset(stream, 0, sizeof(*stream));
+    stream->server_fd = -1;
+    stream->path = g_strdup(path);
+    stream->state = state;
+    stream->queue_limit = EVENT_STREAM_QUEUE_LIMIT;
+    stream->max_subscribers = EVENT_STREAM_MAX_SUBSCRIBERS;
+    stream->policy = EVENT_STREAM_DROP;
+    stream->subscribers = g_ptr_array_new();
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_FILENAME_TOO_LONG,
+                    "Socket path too long: %s", path);
+        event_stream_cleanup(stream);
+        return FALSE;
+    }
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    /* Only the tracker holding the lock gets here, so a socket already
+     * at path was left by one that crashed */
+    unlink(path);
+    stream->server_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (stream->server_fd < 0 ||
+        bind(stream->server_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(stream->server_fd, SOMAXCONN) != 0) {
+        int saved = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved),
+                    "Failed to listen on %s: %s", path, g_strerror(saved));
+        event_stream_cleanup(stream);
+        return FALSE;
+    }
+    fcntl(stream->server_fd, F_SETFL,
+          fcntl(stream->server_fd, F_GETFL) | O_NONBLOCK);
+
+    stream->server_source = g_unix_fd_source_new(stream->server_fd, G_IO_IN);
+    g_source_set_callback(stream->server_source,
+        G_SOURCE_FUNC(on_stream_accept), stream, NULL);
+    g_source_attach(stream->server_source, NULL);
+    return TRUE;
+}
+
+void event_stream_cleanup(EventStream *stream)
+{
+    if (!stream->path)
+        return;
+    if (stream->subscribers) {
+        while (stream->subscribers->len > 0)
+            subscriber_close(g_ptr_array_index(stream->subscribers, 0));
+        g_ptr_array_free(stream->subscribers, TRUE);
+    }
+    if (stream->server_source) {
+        g_source_destroy(stream->server_source);
+        g_source_unref(stream->server_source);
+    }
+    if (stream->server_fd >= 0) {
+        close(stream->server_fd);
+        unlink(stream->path);
+    }
+    g_free(stream->path);
+    memset(stream, 0, sizeof(*stream));
+    stream->server_fd = -1;
+}
+
+/* ── Publishing ─────────────────────────────────────── */
+
+/* Nothing to encode before setup, after cleanup or without subscribers */
+static gboolean has_subscribers(const EventStream *stream)
+{
+    return stream->subscribers && stream->subscribers->len > 0;
+}
+
+static void publish(EventStream *stream, GBytes *record)
+{
+    stream->published++;
+    /* Backwards, as a subscriber may be closed and swapped out */
+    for (guint i = stream->subscribers->len; i > 0; i--)
+        subscriber_push(g_ptr_array_index(stream->subscribers, i - 1), record);
+}
+
+void event_stream_publish_start(EventStream *stream)
+{
+    if (!has_subscribers(stream))
+        return;
+    GBytes *record = encode_start(stream->state);
+    if (!record)
+        return;
+    publish(stream, record);
+    g_bytes_unref(record);
+}
+
+void event_stream_publish_record(EventStream *stream, const CsvRecord *rec)
+{
+    if (!has_subscribers(stream))
+        return;
+    GByteArray *buf = g_byte_array_new();
+    event_record_encode(buf, EVENT_FINISHED, rec, (guint32)rec->duration);
+    GBytes *record = g_byte_array_free_to_bytes(buf);
+    publish(stream, record);
+    g_bytes_unref(record);
+}
+
+gsize event_subscriber_queued(const EventSubscriber *sub)
+{
+    return sub->queued;
+}
+
+/* ── Subscribing ────────────────────────────────────── */
+
+int event_stream_connect(const gchar *path, GError **error)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        int saved = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved),
+                    "Failed to connect to %s: %s", path, g_strerror(saved));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    return fd;
+}
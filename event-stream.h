@@ -0,0 +1,119 @@
+#ifndef EVENT_STREAM_H
+#define EVENT_STREAM_H
+
+#include <gio/gio.h>
+#include "tracker-core.h"
+
+/* ── Interval events on a Unix socket ───────────────── *
+ *
+ * Subscribers connect to $XDG_RUNTIME_DIR/activity-tracker.events and are
+ * sent a record whenever an interval starts or finishes, beginning with
+ * the interval in progress.  Sending never blocks the main loop: what a
+ * subscriber's socket does not take is queued, up to queue_limit bytes,
+ * and beyond that the stream's policy drops records or the subscriber.
+ *
+ * A record is a little-endian u32 length followed by that many bytes:
+ *
+ *   u8  kind       EVENT_STARTED, EVENT_FINISHED or EVENT_LOST
+ *   u8  status     EVENT_STATUS_ACTIVE, _IDLE or _LOCKED
+ *   u16 reserved   0
+ *   i64 wall       start of the interval, seconds since the epoch
+ *   u32 count      FINISHED: duration in seconds, LOST: records dropped
+ *   5 × (u32 length, bytes)
+ *                  title, wm_class, wm_class_instance, rp_state, rp_details
+ *
+ * EVENT_LOST tells a subscriber that records were dropped while its queue
+ * was full; an EVENT_STARTED for the interval in progress follows it. */
+
+#define EVENT_STREAM_FILE "activity-tracker.events"
+
+#define EVENT_STREAM_QUEUE_LIMIT     (256 * 1024)
+#define EVENT_STREAM_MAX_SUBSCRIBERS 1024
+#define EVENT_RECORD_MAX             (1024 * 1024)
+
+enum {
+    EVENT_STARTED = 1,
+    EVENT_FINISHED = 2,
+    EVENT_LOST = 3,
+};
+
+enum {
+    EVENT_STATUS_ACTIVE,
+    EVENT_STATUS_IDLE,
+    EVENT_STATUS_LOCKED,
+};
+
+/* What happens to a subscriber whose queue is full */
+typedef enum {
+    EVENT_STREAM_DROP,        /* new records are dropped, then EVENT_LOST */
+    EVENT_STREAM_DISCONNECT,  /* the subscriber is disconnected */
+} EventStreamPolicy;
+
+typedef struct _EventSubscriber EventSubscriber;
+
+typedef struct {
+    gchar *path;
+    int server_fd;
+    GSource *server_source;
+    GPtrArray *subscribers;      /* EventSubscriber* */
+    const AppState *state;       /* interval in progress */
+    gsize queue_limit;           /* bytes queued per subscriber */
+    guint max_subscribers;
+    EventStreamPolicy policy;
+    guint64 published;           /* records sent to subscribers */
+    guint64 dropped;             /* records dropped for full queues */
+    guint64 disconnected;        /* subscribers dropped for full queues */
+} EventStream;
+
+/* A decoded record; strings are owned */
+typedef struct {
+    guint8 kind;
+    guint8 status;
+    gint64 wall;
+    guint32 count;
+    gchar *title;
+    gchar *wm_class;
+    gchar *wm_class_instance;
+    gchar *rp_state;
+    gchar *rp_details;
+} EventRecord;
+
+/* $XDG_RUNTIME_DIR/activity-tracker.events */
+gchar *event_stream_default_path(void);
+
+/* ── Lifecycle ──────────────────────────────────────── */
+
+/* Listens on path, replacing a stale socket left there */
+gboolean event_stream_setup(EventStream *stream, const gchar *path,
+                            const AppState *state, GError **error);
+void event_stream_cleanup(EventStream *stream);
+
+/* ── Publishing ─────────────────────────────────────── */
+
+/* The interval state has just started */
+void event_stream_publish_start(EventStream *stream);
+/* A finished interval, as handed to the writer */
+void event_stream_publish_record(EventStream *stream, const CsvRecord *rec);
+
+/* Bytes waiting in a subscriber's queue, for tests */
+gsize event_subscriber_queued(const EventSubscriber *sub);
+
+/* ── Subscribing ────────────────────────────────────── */
+
+/* A blocking socket to read records from, -1 when nobody listens */
+int event_stream_connect(const gchar *path, GError **error);
+
+/* ── Encoding ───────────────────────────────────────── */
+
+/* Appends a record; count is the duration, or records lost */
+void event_record_encode(GByteArray *buf, guint8 kind, const CsvRecord *rec,
+                         guint32 count);
+/* 1 and *consumed set when data starts with a whole record, 0 when more
+ * bytes are needed, -1 when it is not a record */
+int event_record_parse(const guint8 *data, gsize len, EventRecord *rec,
+                       gsize *consumed);
+void event_record_clear(EventRecord *rec);
+/* "active", "idle" or "locked", as in the day file */
+const gchar *event_status_name(guint8 status);
+
+#endif /* EVENT_STREAM_H */
@@ -0,0 +1,276 @@
+#include "live-stats.h"
+#include <string.h>
+
+static const gchar live_stats_xml[] =
+    "<node>"
+    "  <interface name='" LIVE_STATS_INTERFACE "'>"
+    "    <method name='GetDayStats'>"
+    "      <arg type='i' direction='in' name='year'/>"
+    "      <arg type='i' direction='in' name='month'/>"
+    "      <arg type='i' direction='in' name='day'/>"
+    "      <arg type='b' direction='out' name='live'/>"
+    "      <arg type='(xxxa(sa(sx)))' direction='out' name='stats'/>"
+    "    </method>"
+    "  </interface>"
+    "</node>";
+
+#define DAY_STATS_TYPE "(xxxa(sa(sx)))"
+
+/* YYYYMMDD as a number, so days compare in calendar order */
+static int day_number(int year, int month, int day)
+{
+    return year * 10000 + month * 100 + day;
+}
+
+static int day_number_of(time_t t)
+{
+    struct tm tm;
+    localtime_r(&t, &tm);
+    return day_number(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+}
+
+/* ── Counting ───────────────────────────────────────── */
+
+/* Starts counting a day over from its day files */
+static void live_stats_load_day(LiveStats *live, int number)
+{
+    live->year = number / 10000;
+    live->month = number / 100 % 100;
+    live->day = number % 100;
+
+    gboolean found;
+    free_day_stats(live->stats);
+    live->stats = load_day_stats(live->state->data_dir, live->year, live->month,
+                                 live->day, live->max_threads, live->cache_dir,
+                                 &found);
+    if (!live->stats) {
+        if (found)
+            g_printerr("[stats] Could not read %04d-%02d-%02d, live totals "
+                       "start empty\n", live->year, live->month, live->day);
+        live->stats = day_stats_new();
+    }
+}
+
+static int live_day_number(const LiveStats *live)
+{
+    return day_number(live->year, live->month, live->day);
+}
+
+void live_stats_init(LiveStats *live, const AppState *state, time_t now,
+                     guint max_threads, const gchar *cache_dir)
+{
+    memset(live, 0, sizeof(*live));
+    live->state = state;
+    live->max_threads = max_threads;
+    live->cache_dir = g_strdup(cache_dir);
+    live_stats_load_day(live, day_number_of(now));
+}
+
+void live_stats_add_record(LiveStats *live, const CsvRecord *rec)
+{
+    /* A record goes to the file of the day it started; one from before
+     * the clock went back is only on disk */
+    int number = day_number_of(rec->wall);
+    if (number < live_day_number(live))
+        return;
+    if (number > live_day_number(live))
+        live_stats_load_day(live, number);
+    day_stats_add_record(live->stats, rec);
+}
+
+void live_stats_clear(LiveStats *live)
+{
+    live_stats_unexport(live);
+    free_day_stats(live->stats);
+    g_free(live->cache_dir);
+    memset(live, 0, sizeof(*live));
+}
+
+DayStats *live_stats_snapshot(LiveStats *live, int year, int month, int day,
+                              gint64 now)
+{
+    /* Nothing finished yet today: the day still has to be started */
+    int number = day_number(year, month, day);
+    if (number == day_number_of(time(NULL)) && number > live_day_number(live))
+        live_stats_load_day(live, number);
+    if (number != live_day_number(live))
+        return NULL;
+
+    DayStats *snapshot = day_stats_new();
+    merge_day_stats(snapshot, live->stats);
+    CsvRecord rec;
+    if (fill_csv_record(live->state, now, &rec) &&
+        day_number_of(rec.wall) == number) {
+        day_stats_add_record(snapshot, &rec);
+        day_stats_sort(snapshot);
+    }
+    return snapshot;
+}
+
+/* ── D-Bus service ──────────────────────────────────── */
+
+static void live_stats_method_call(GDBusConnection *connection G_GNUC_UNUSED,
+                                   const gchar *sender G_GNUC_UNUSED,
+                                   const gchar *object_path G_GNUC_UNUSED,
+                                   const gchar *interface_name G_GNUC_UNUSED,
+                                   const gchar *method_name,
+                                   GVariant *parameters,
+                                   GDBusMethodInvocation *invocation,
+                                   gpointer user_data)
+{
+    LiveStats *live = user_data;
+    if (g_strcmp0(method_name, "GetDayStats") != 0) {
+        g_dbus_method_invocation_return_dbus_error(
+            invocation, "org.freedesktop.DBus.Error.UnknownMethod", method_name);
+        return;
+    }
+
+    gint32 year, month, day;
+    g_variant_get(parameters, "(iii)", &year, &month, &day);
+    live->queries++;
+    DayStats *stats = live_stats_snapshot(live, year, month, day,
+                                          g_get_monotonic_time());
+    gboolean found = stats != NULL;
+    if (!stats)
+        stats = day_stats_new();
+    g_dbus_method_invocation_return_value(
+        invocation, g_variant_new("(b@" DAY_STATS_TYPE ")", found,
+                                  day_stats_to_variant(stats)));
+    free_day_stats(stats);
+}
+
+static const GDBusInterfaceVTable live_stats_vtable = {
+    live_stats_method_call, NULL, NULL, {0}
+};
+
+gboolean live_stats_export(LiveStats *live, GDBusConnection *connection,
+                           GError **error)
+{
+    GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(live_stats_xml, NULL);
+    live->registration_id = g_dbus_connection_register_object(
+        connection, LIVE_STATS_OBJECT_PATH, node->interfaces[0],
+        &live_stats_vtable, live, NULL, error);
+    g_dbus_node_info_unref(node);
+    if (!live->registration_id)
+        return FALSE;
+    live->connection = g_object_ref(connection);
+
+    /* The lock file already keeps a second tracker out; a name owned by
+     * someone else means a stale or foreign process */
+    GVariant *reply = g_dbus_connection_call_sync(
+        connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+        "org.freedesktop.DBus", "RequestName",
+        g_variant_new("(su)", LIVE_STATS_BUS_NAME,
+                      G_BUS_NAME_OWNER_FLAGS_DO_NOT_QUEUE),
+        G_VARIANT_TYPE("(u)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, error);
+    guint32 result = 0;
+    if (reply) {
+        g_variant_get(reply, "(u)", &result);
+        g_variant_unref(reply);
+        /* 1: primary owner, 4: already the owner */
+        if (result != 1 && result != 4)
+            g_set_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS,
+                        "%s is owned by another process", LIVE_STATS_BUS_NAME);
+    }
+    if (result != 1 && result != 4) {
+        live_stats_unexport(live);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void live_stats_unexport(LiveStats *live)
+{
+    if (!live->connection)
+        return;
+    g_dbus_connection_unregister_object(live->connection, live->registration_id);
+    g_dbus_connection_call(live->connection, "org.freedesktop.DBus",
+                           "/org/freedesktop/DBus", "org.freedesktop.DBus",
+                           "ReleaseName",
+                           g_variant_new("(s)", LIVE_STATS_BUS_NAME),
+                           NULL, G_DBUS_CALL_FLAGS_NONE, -1, NULL, NULL, NULL);
+    live->registration_id = 0;
+    g_clear_object(&live->connection);
+}
+
+/* ── Queries ────────────────────────────────────────── */
+
+gboolean live_stats_query(GDBusConnection *connection,
+                          int year, int month, int day,
+                          DayStats **stats, GError **error)
+{
+    *stats = NULL;
+    GVariant *reply = g_dbus_connection_call_sync(
+        connection, LIVE_STATS_BUS_NAME, LIVE_STATS_OBJECT_PATH,
+        LIVE_STATS_INTERFACE, "GetDayStats",
+        g_variant_new("(iii)", year, month, day),
+        G_VARIANT_TYPE("(b" DAY_STATS_TYPE ")"),
+        G_DBUS_CALL_FLAGS_NO_AUTO_START,
+        2000, /* timeout ms */
+        NULL, error);
+    if (!reply)
+        return FALSE;
+
+    gboolean found;
+    GVariant *value;
+    g_variant_get(reply, "(b@" DAY_STATS_TYPE ")", &found, &value);
+    if (found)
+        *stats = day_stats_from_variant(value);
+    g_variant_unref(value);
+    g_variant_unref(reply);
+    return TRUE;
+}
+
+/* ── Encoding ───────────────────────────────────────── */
+
+/* D-Bus strings must be UTF-8; a day file may hold anything */
+static GVariant *string_variant(const gchar *str)
+{
+    if (g_utf8_validate(str, -1, NULL))
+        return g_variant_new_string(str);
+    return g_variant_new_take_string(g_utf8_make_valid(str, -1));
+}
+
+GVariant *day_stats_to_variant(const DayStats *stats)
+{
+    GVariantBuilder apps;
+    g_variant_builder_init(&apps, G_VARIANT_TYPE("a(sa(sx))"));
+    for (guint i = 0; i < stats->apps->len; i++) {
+        const AppStat *app = g_ptr_array_index(stats->apps, i);
+        GVariantBuilder titles;
+        g_variant_builder_init(&titles, G_VARIANT_TYPE("a(sx)"));
+        for (const TitleStat *t = app->titles; t; t = t->next)
+            g_variant_builder_add(&titles, "(@sx)", string_variant(t->title),
+                                  (gint64)t->total_seconds);
+        g_variant_builder_add(&apps, "(@s@a(sx))", string_variant(app->wm_class),
+                              g_variant_builder_end(&titles));
+    }
+    return g_variant_new(DAY_STATS_TYPE,
+                         (gint64)stats->total_locked_seconds,
+                         (gint64)stats->total_afk_active_seconds,
+                         (gint64)stats->total_active_seconds, &apps);
+}
+
+DayStats *day_stats_from_variant(GVariant *value)
+{
+    gint64 locked, afk, active;
+    GVariantIter *apps;
+    g_variant_get(value, DAY_STATS_TYPE, &locked, &afk, &active, &apps);
+
+    DayStats *stats = day_stats_new();
+    stats->total_locked_seconds = (long)locked;
+    stats->total_afk_active_seconds = (long)afk;
+    stats->total_active_seconds = (long)active;
+
+    const gchar *wm_class, *title;
+    GVariantIter *titles;
+    gint64 seconds;
+    while (g_variant_iter_next(apps, "(&sa(sx))", &wm_class, &titles)) {
+        while (g_variant_iter_next(titles, "(&sx)", &title, &seconds))
+            day_stats_add_title(stats, wm_class, title, (long)seconds);
+        g_variant_iter_free(titles);
+    }
+    g_variant_iter_free(apps);
+    day_stats_sort(stats);
+    return stats;
+}
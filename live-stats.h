@@ -0,0 +1,66 @@
+#ifndef LIVE_STATS_H
+#define LIVE_STATS_H
+
+#include <gio/gio.h>
+#include "tracker-core.h"
+
+/* ── Live statistics on the session bus ─────────────── *
+ *
+ * The running tracker counts each finished interval of the current day as
+ * it is handed to the writer, on top of what the day file held when it
+ * started.  GetDayStats returns these totals together with the interval
+ * still in progress, so a second instance reports without reading the day
+ * file and sees the last minutes too. */
+
+#define LIVE_STATS_BUS_NAME    "io.github.novoj.ActivityTracker"
+#define LIVE_STATS_OBJECT_PATH "/io/github/novoj/ActivityTracker"
+#define LIVE_STATS_INTERFACE   "io.github.novoj.ActivityTracker.Stats"
+
+typedef struct {
+    const AppState *state;  /* interval in progress */
+    guint max_threads;      /* reading a day file, 0 for one per processor */
+    gchar *cache_dir;       /* stats cache for day files, NULL for none */
+    int year, month, day;   /* day counted in stats */
+    DayStats *stats;        /* finished intervals of that day */
+    GDBusConnection *connection;
+    guint registration_id;
+    guint64 queries;
+} LiveStats;
+
+/* ── Lifecycle ──────────────────────────────────────── */
+
+/* Starts counting the day of now from what its day files hold */
+void live_stats_init(LiveStats *live, const AppState *state, time_t now,
+                     guint max_threads, const gchar *cache_dir);
+/* Counts a finished interval; one of a later day starts that day over */
+void live_stats_add_record(LiveStats *live, const CsvRecord *rec);
+void live_stats_clear(LiveStats *live);
+
+/* Serves GetDayStats on connection under LIVE_STATS_BUS_NAME.  Fails when
+ * another process owns the name. */
+gboolean live_stats_export(LiveStats *live, GDBusConnection *connection,
+                           GError **error);
+void live_stats_unexport(LiveStats *live);
+
+/* The statistics of a day with the interval in progress at now counted
+ * too, NULL unless it is the day being counted or today */
+DayStats *live_stats_snapshot(LiveStats *live, int year, int month, int day,
+                              gint64 now);
+
+/* ── Queries ────────────────────────────────────────── */
+
+/* Asks a running tracker for a day's statistics.  FALSE when no tracker
+ * answers; otherwise stats is set, to NULL when the day is not live and
+ * has to be read from disk. */
+gboolean live_stats_query(GDBusConnection *connection,
+                          int year, int month, int day,
+                          DayStats **stats, GError **error);
+
+/* ── Encoding ───────────────────────────────────────── */
+
+/* (xxxa(sa(sx))): locked, away and active seconds, then per app its
+ * titles with their seconds */
+GVariant *day_stats_to_variant(const DayStats *stats);
+DayStats *day_stats_from_variant(GVariant *value);
+
+#endif /* LIVE_STATS_H */
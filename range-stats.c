@@ -0,0 +1,118 @@
+#include "range-stats.h"
+
+typedef struct {
+    const gchar *data_dir;
+    GDate first;
+    guint threads_per_day;  /* for days too large for one thread */
+    DayStats **days;        /* one slot per day, filled by the workers */
+    gboolean *found;
+} RangeJob;
+
+void range_for_period(RangePeriod period, const GDate *date,
+                      GDate *first, GDate *last)
+{
+    GDateYear year = g_date_get_year(date);
+    GDateMonth month = g_date_get_month(date);
+
+    switch (period) {
+    case RANGE_WEEK:
+        *first = *date;
+        g_date_subtract_days(first, g_date_get_weekday(date) - G_DATE_MONDAY);
+        *last = *first;
+        g_date_add_days(last, 6);
+        break;
+    case RANGE_MONTH:
+        g_date_clear(first, 1);
+        g_date_clear(last, 1);
+        g_date_set_dmy(first, 1, month, year);
+        g_date_set_dmy(last, g_date_get_days_in_month(month, year), month, year);
+        break;
+    case RANGE_YEAR:
+        g_date_clear(first, 1);
+        g_date_clear(last, 1);
+        g_date_set_dmy(first, 1, G_DATE_JANUARY, year);
+        g_date_set_dmy(last, 31, G_DATE_DECEMBER, year);
+        break;
+    }
+}
+
+static void load_day(RangeJob *job, guint index)
+{
+    GDate date = job->first;
+    g_date_add_days(&date, index);
+    job->days[index] = load_day_stats(job->data_dir, g_date_get_year(&date),
+                                      g_date_get_month(&date),
+                                      g_date_get_day(&date),
+                                      job->threads_per_day, NULL,
+                                      &job->found[index]);
+}
+
+static void load_day_worker(gpointer data, gpointer user_data)
+{
+    load_day(user_data, GPOINTER_TO_UINT(data) - 1);
+}
+
+DayStats *compute_range_stats(const gchar *data_dir, const GDate *first,
+                              const GDate *last, guint max_threads,
+                              RangeStatsInfo *info)
+{
+    int days = g_date_days_between(first, last) + 1;
+    RangeJob job = {
+        .data_dir = data_dir,
+        .first = *first,
+        .days = g_new0(DayStats *, MAX(days, 1)),
+        .found = g_new0(gboolean, MAX(days, 1)),
+    };
+
+    if (max_threads == 0)
+        max_threads = g_get_num_processors();
+    /* Threads left over once every day has one split the largest files */
+    job.threads_per_day = MAX(max_threads / MAX(days, 1), 1);
+    if ((int)max_threads > days)
+        max_threads = MAX(days, 1);
+
+    if (max_threads == 1) {
+        for (int i = 0; i < days; i++)
+            load_day(&job, i);
+    } else {
+        GThreadPool *pool = g_thread_pool_new(load_day_worker, &job,
+                                              (gint)max_threads, TRUE, NULL);
+        for (int i = 0; i < days; i++)
+            g_thread_pool_push(pool, GUINT_TO_POINTER(i + 1), NULL);
+        /* Waits for every queued day */
+        g_thread_pool_free(pool, FALSE, TRUE);
+    }
+
+    /* In calendar order, whatever order the days were read in */
+    DayStats *total = day_stats_new();
+    *info = (RangeStatsInfo){ .days = MAX(days, 0) };
+    for (int i = 0; i < days; i++) {
+        if (!job.found[i])
+            continue;
+        info->days_found++;
+        if (!job.days[i]) {
+            info->days_failed++;
+            continue;
+        }
+        merge_day_stats(total, job.days[i]);
+        free_day_stats(job.days[i]);
+    }
+
+    g_free(job.days);
+    g_free(job.found);
+    return total;
+}
+
+void print_range_report(FILE *out, const DayStats *stats,
+                        const GDate *first, const GDate *last,
+                        const RangeStatsInfo *info, const StatsOptions *opts)
+{
+    gchar from[16], to[16];
+    g_date_strftime(from, sizeof(from), "%Y-%m-%d", first);
+    g_date_strftime(to, sizeof(to), "%Y-%m-%d", last);
+    int tracked = info->days_found - info->days_failed;
+    gchar *period = g_strdup_printf("%s to %s (%d %s tracked)", from, to,
+                                    tracked, tracked == 1 ? "day" : "days");
+    print_period_report(out, stats, period, opts);
+    g_free(period);
+}
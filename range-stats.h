@@ -0,0 +1,41 @@
+#ifndef RANGE_STATS_H
+#define RANGE_STATS_H
+
+#include <glib.h>
+#include "tracker-core.h"
+
+/* ── Multi-day reports ──────────────────────────────── *
+ *
+ * The day files of a range are read on a GThreadPool, each day into a
+ * DayStats of its own, and merged in calendar order once all workers are
+ * done, so the report does not depend on which worker finished first. */
+
+typedef enum {
+    RANGE_WEEK,   /* Monday to Sunday */
+    RANGE_MONTH,
+    RANGE_YEAR,
+} RangePeriod;
+
+typedef struct {
+    int days;          /* days in the range */
+    int days_found;    /* days with at least one day file */
+    int days_failed;   /* days with a day file that could not be read */
+} RangeStatsInfo;
+
+/* The week, month or year containing date. */
+void range_for_period(RangePeriod period, const GDate *date,
+                      GDate *first, GDate *last);
+
+/* Adds up first..last inclusive on up to max_threads threads (0 for one
+ * per processor).  Days that cannot be read are left out and counted in
+ * info.  Never NULL; with no data the stats are empty. */
+DayStats *compute_range_stats(const gchar *data_dir, const GDate *first,
+                              const GDate *last, guint max_threads,
+                              RangeStatsInfo *info);
+
+/* print_stats_report() for a range, e.g. "2026-01-01 to 2026-01-31" */
+void print_range_report(FILE *out, const DayStats *stats,
+                        const GDate *first, const GDate *last,
+                        const RangeStatsInfo *info, const StatsOptions *opts);
+
+#endif /* RANGE_STATS_H */
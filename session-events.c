@@ -0,0 +1,376 @@
+#include "session-events.h"
+#include <string.h>
+
+/* ── FocusChanged signal ────────────────────────────── */
+
+static void on_focus_changed_signal(GDBusConnection *connection G_GNUC_UNUSED,
+                                    const gchar *sender_name G_GNUC_UNUSED,
+                                    const gchar *object_path G_GNUC_UNUSED,
+                                    const gchar *interface_name G_GNUC_UNUSED,
+                                    const gchar *signal_name G_GNUC_UNUSED,
+                                    GVariant *parameters,
+                                    gpointer user_data)
+{
+    FocusEvents *events = user_data;
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(s)")))
+        return;
+
+    const gchar *json = NULL;
+    g_variant_get(parameters, "(&s)", &json);
+
+    /* The payload uses the Window Calls List() format restricted to the
+     * focused window, so the regular parser handles it. */
+    FocusedWindowInfo info = parse_focused_window(json);
+    events->events_received++;
+    if (events->callback)
+        events->callback(&info, events->user_data);
+    free_focused_window_info(&info);
+}
+
+gboolean focus_events_subscribe(FocusEvents *events,
+                                GDBusConnection *connection,
+                                FocusChangedFunc callback,
+                                gpointer user_data)
+{
+    memset(events, 0, sizeof(*events));
+    if (!connection)
+        return FALSE;
+
+    events->connection = g_object_ref(connection);
+    events->callback = callback;
+    events->user_data = user_data;
+    events->signal_id = g_dbus_connection_signal_subscribe(
+        connection,
+        FOCUS_EVENTS_BUS_NAME,
+        FOCUS_EVENTS_INTERFACE,
+        "FocusChanged",
+        FOCUS_EVENTS_OBJECT_PATH,
+        NULL,
+        G_DBUS_SIGNAL_FLAGS_NONE,
+        on_focus_changed_signal,
+        events,
+        NULL);
+
+    return events->signal_id != 0;
+}
+
+void focus_events_unsubscribe(FocusEvents *events)
+{
+    if (!events)
+        return;
+
+    if (events->connection && events->signal_id)
+        g_dbus_connection_signal_unsubscribe(events->connection,
+                                             events->signal_id);
+    events->signal_id = 0;
+    g_clear_object(&events->connection);
+    events->callback = NULL;
+    events->user_data = NULL;
+}
+
+/* ── GetFocused ─────────────────────────────────────── */
+
+void focus_events_query_async(FocusEvents *events,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data)
+{
+    g_return_if_fail(events && events->connection);
+
+    g_dbus_connection_call(events->connection,
+                           FOCUS_EVENTS_BUS_NAME,
+                           FOCUS_EVENTS_OBJECT_PATH,
+                           FOCUS_EVENTS_INTERFACE,
+                           "GetFocused",
+                           NULL,
+                           G_VARIANT_TYPE("(s)"),
+                           G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                           500, /* timeout ms */
+                           cancellable,
+                           callback,
+                           user_data);
+}
+
+gboolean focus_events_query_finish(FocusEvents *events,
+                                   GAsyncResult *result,
+                                   FocusedWindowInfo *info,
+                                   GError **error)
+{
+    FocusedWindowInfo empty = {NULL, NULL, NULL, 0};
+    *info = empty;
+
+    GVariant *reply = g_dbus_connection_call_finish(events->connection,
+                                                    result, error);
+    if (!reply)
+        return FALSE;
+
+    const gchar *json = NULL;
+    g_variant_get(reply, "(&s)", &json);
+    *info = parse_focused_window(json);
+    g_variant_unref(reply);
+    return TRUE;
+}
+
+/* ── Idle monitor watches ───────────────────────────── */
+
+static void idle_watch_call(IdleWatch *watch, const gchar *method,
+                            GVariant *parameters,
+                            const GVariantType *reply_type,
+                            GAsyncReadyCallback callback)
+{
+    g_dbus_connection_call(watch->connection,
+                           IDLE_MONITOR_BUS_NAME,
+                           IDLE_MONITOR_OBJECT_PATH,
+                           IDLE_MONITOR_INTERFACE,
+                           method,
+                           parameters,
+                           reply_type,
+                           G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                           500, /* timeout ms */
+                           watch->cancellable,
+                           callback,
+                           watch);
+}
+
+/* The reply to an idle monitor call, NULL when it failed.  *cancelled is
+ * set when the watch was stopped meanwhile and must not be touched. */
+static GVariant *idle_watch_call_finish(GObject *source, GAsyncResult *res,
+                                        const gchar *method,
+                                        gboolean *cancelled)
+{
+    GError *error = NULL;
+    GVariant *reply = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source),
+                                                    res, &error);
+    *cancelled = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    if (error) {
+        if (!*cancelled)
+            g_printerr("[idle] %s failed: %s\n", method, error->message);
+        g_error_free(error);
+    }
+    return reply;
+}
+
+static void remove_watch(IdleWatch *watch, guint32 *id)
+{
+    if (!*id)
+        return;
+    g_dbus_connection_call(watch->connection,
+                           IDLE_MONITOR_BUS_NAME,
+                           IDLE_MONITOR_OBJECT_PATH,
+                           IDLE_MONITOR_INTERFACE,
+                           "RemoveWatch",
+                           g_variant_new("(u)", *id),
+                           NULL,
+                           G_DBUS_CALL_FLAGS_NO_AUTO_START,
+                           -1, NULL, NULL, NULL);
+    *id = 0;
+}
+
+static void report_idle(IdleWatch *watch, gboolean idle)
+{
+    watch->is_idle = idle;
+    if (watch->callback)
+        watch->callback(idle, watch->user_data);
+}
+
+/* After idle_watch_id changed from what made was_active */
+static void report_active(IdleWatch *watch, gboolean was_active)
+{
+    gboolean active = idle_watch_active(watch);
+    if (active != was_active && watch->active_changed)
+        watch->active_changed(active, watch->user_data);
+}
+
+static void on_add_active_watch_reply(GObject *source, GAsyncResult *res,
+                                      gpointer user_data)
+{
+    gboolean cancelled;
+    GVariant *reply = idle_watch_call_finish(source, res, "AddUserActiveWatch",
+                                             &cancelled);
+    if (cancelled)
+        return;
+
+    IdleWatch *watch = user_data;
+    if (!reply) {
+        /* Nothing would end the idle interval: polling has to */
+        gboolean was_active = idle_watch_active(watch);
+        remove_watch(watch, &watch->idle_watch_id);
+        report_active(watch, was_active);
+        return;
+    }
+    g_variant_get(reply, "(u)", &watch->active_watch_id);
+    g_variant_unref(reply);
+}
+
+/* User-active watches fire once, so one is added for every idle period */
+static void enter_idle(IdleWatch *watch)
+{
+    idle_watch_call(watch, "AddUserActiveWatch", NULL, G_VARIANT_TYPE("(u)"),
+                    on_add_active_watch_reply);
+    report_idle(watch, TRUE);
+}
+
+static void on_watch_fired(GDBusConnection *connection G_GNUC_UNUSED,
+                           const gchar *sender_name G_GNUC_UNUSED,
+                           const gchar *object_path G_GNUC_UNUSED,
+                           const gchar *interface_name G_GNUC_UNUSED,
+                           const gchar *signal_name G_GNUC_UNUSED,
+                           GVariant *parameters,
+                           gpointer user_data)
+{
+    IdleWatch *watch = user_data;
+    if (!g_variant_is_of_type(parameters, G_VARIANT_TYPE("(u)")))
+        return;
+
+    guint32 id;
+    g_variant_get(parameters, "(u)", &id);
+    if (id == 0)
+        return;
+
+    if (id == watch->idle_watch_id) {
+        watch->watches_fired++;
+        if (!watch->is_idle)
+            enter_idle(watch);
+    } else if (id == watch->active_watch_id) {
+        watch->watches_fired++;
+        watch->active_watch_id = 0;
+        report_idle(watch, FALSE);
+    }
+}
+
+/* The idle watch only fires on crossing the threshold, so whether the
+ * user already is idle has to be asked once */
+static void on_initial_idletime_reply(GObject *source, GAsyncResult *res,
+                                      gpointer user_data)
+{
+    gboolean cancelled;
+    GVariant *reply = idle_watch_call_finish(source, res, "GetIdletime",
+                                             &cancelled);
+    if (!reply)
+        return;
+
+    IdleWatch *watch = user_data;
+    guint64 idle_ms;
+    g_variant_get(reply, "(t)", &idle_ms);
+    g_variant_unref(reply);
+
+    gboolean idle = idle_ms >= watch->threshold_ms;
+    if (idle && !watch->is_idle)
+        enter_idle(watch);
+    else
+        report_idle(watch, idle);
+}
+
+static void on_add_idle_watch_reply(GObject *source, GAsyncResult *res,
+                                    gpointer user_data)
+{
+    gboolean cancelled;
+    GVariant *reply = idle_watch_call_finish(source, res, "AddIdleWatch",
+                                             &cancelled);
+    if (!reply)
+        return;
+
+    IdleWatch *watch = user_data;
+    gboolean was_active = idle_watch_active(watch);
+    g_variant_get(reply, "(u)", &watch->idle_watch_id);
+    g_variant_unref(reply);
+    g_printerr("[idle] Idle watches active\n");
+    report_active(watch, was_active);
+
+    idle_watch_call(watch, "GetIdletime", NULL, G_VARIANT_TYPE("(t)"),
+                    on_initial_idletime_reply);
+}
+
+static void on_idle_monitor_appeared(GDBusConnection *connection G_GNUC_UNUSED,
+                                     const gchar *name G_GNUC_UNUSED,
+                                     const gchar *name_owner G_GNUC_UNUSED,
+                                     gpointer user_data)
+{
+    IdleWatch *watch = user_data;
+    idle_watch_call(watch, "AddIdleWatch",
+                    g_variant_new("(t)", watch->threshold_ms),
+                    G_VARIANT_TYPE("(u)"), on_add_idle_watch_reply);
+}
+
+static void on_idle_monitor_vanished(GDBusConnection *connection G_GNUC_UNUSED,
+                                     const gchar *name G_GNUC_UNUSED,
+                                     gpointer user_data)
+{
+    IdleWatch *watch = user_data;
+    gboolean was_active = idle_watch_active(watch);
+
+    /* The watches went with their owner; answers still on their way
+     * belong to it too */
+    if (was_active)
+        g_printerr("[idle] Idle monitor gone, polling GetIdletime\n");
+    g_cancellable_cancel(watch->cancellable);
+    g_object_unref(watch->cancellable);
+    watch->cancellable = g_cancellable_new();
+    watch->idle_watch_id = 0;
+    watch->active_watch_id = 0;
+    watch->is_idle = FALSE;
+    report_active(watch, was_active);
+}
+
+gboolean idle_watch_start(IdleWatch *watch, GDBusConnection *connection,
+                          guint64 threshold_ms, IdleChangedFunc callback,
+                          gpointer user_data)
+{
+    memset(watch, 0, sizeof(*watch));
+    if (!connection)
+        return FALSE;
+
+    watch->connection = g_object_ref(connection);
+    watch->cancellable = g_cancellable_new();
+    watch->threshold_ms = threshold_ms;
+    watch->callback = callback;
+    watch->user_data = user_data;
+    watch->signal_id = g_dbus_connection_signal_subscribe(
+        connection,
+        IDLE_MONITOR_BUS_NAME,
+        IDLE_MONITOR_INTERFACE,
+        "WatchFired",
+        IDLE_MONITOR_OBJECT_PATH,
+        NULL,
+        G_DBUS_SIGNAL_FLAGS_NONE,
+        on_watch_fired,
+        watch,
+        NULL);
+    watch->name_watch_id = g_bus_watch_name_on_connection(
+        connection,
+        IDLE_MONITOR_BUS_NAME,
+        G_BUS_NAME_WATCHER_FLAGS_NONE,
+        on_idle_monitor_appeared,
+        on_idle_monitor_vanished,
+        watch,
+        NULL);
+
+    return watch->signal_id != 0;
+}
+
+void idle_watch_stop(IdleWatch *watch)
+{
+    if (!watch || !watch->connection)
+        return;
+
+    g_cancellable_cancel(watch->cancellable);
+    g_clear_object(&watch->cancellable);
+    if (watch->name_watch_id)
+        g_bus_unwatch_name(watch->name_watch_id);
+    watch->name_watch_id = 0;
+    if (watch->signal_id)
+        g_dbus_connection_signal_unsubscribe(watch->connection,
+                                             watch->signal_id);
+    watch->signal_id = 0;
+    remove_watch(watch, &watch->idle_watch_id);
+    remove_watch(watch, &watch->active_watch_id);
+    g_clear_object(&watch->connection);
+    watch->callback = NULL;
+    watch->active_changed = NULL;
+    watch->user_data = NULL;
+}
+
+gboolean idle_watch_active(const IdleWatch *watch)
+{
+    return watch->idle_watch_id != 0;
+}
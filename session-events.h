@@ -0,0 +1,88 @@
+#ifndef SESSION_EVENTS_H
+#define SESSION_EVENTS_H
+
+#include <gio/gio.h>
+#include "tracker-core.h"
+
+/* ── Companion shell extension (shell-extension/) ───── */
+
+#define FOCUS_EVENTS_BUS_NAME    "org.gnome.Shell"
+#define FOCUS_EVENTS_OBJECT_PATH "/org/gnome/Shell/Extensions/ActivityTracker"
+#define FOCUS_EVENTS_INTERFACE   "org.gnome.Shell.Extensions.ActivityTracker"
+
+/* Called for every FocusChanged signal.  info is owned by the caller and
+ * freed after the callback returns. */
+typedef void (*FocusChangedFunc)(FocusedWindowInfo *info, gpointer user_data);
+
+typedef struct {
+    GDBusConnection *connection;
+    guint signal_id;
+    FocusChangedFunc callback;
+    gpointer user_data;
+    guint64 events_received;
+} FocusEvents;
+
+/* ── Lifecycle ──────────────────────────────────────── */
+
+gboolean focus_events_subscribe(FocusEvents *events,
+                                GDBusConnection *connection,
+                                FocusChangedFunc callback,
+                                gpointer user_data);
+void focus_events_unsubscribe(FocusEvents *events);
+
+/* ── Queries ────────────────────────────────────────── */
+
+/* Ask the extension for the focused window without blocking the main
+ * loop.  _finish() returns FALSE when the extension is not installed or
+ * not responding; info is always initialised and must be freed. */
+void focus_events_query_async(FocusEvents *events,
+                              GCancellable *cancellable,
+                              GAsyncReadyCallback callback,
+                              gpointer user_data);
+gboolean focus_events_query_finish(FocusEvents *events,
+                                   GAsyncResult *result,
+                                   FocusedWindowInfo *info,
+                                   GError **error);
+
+/* ── Mutter idle monitor ────────────────────────────── */
+
+#define IDLE_MONITOR_BUS_NAME    "org.gnome.Mutter.IdleMonitor"
+#define IDLE_MONITOR_OBJECT_PATH "/org/gnome/Mutter/IdleMonitor/Core"
+#define IDLE_MONITOR_INTERFACE   "org.gnome.Mutter.IdleMonitor"
+
+/* Called when the user goes idle or becomes active again, as Mutter
+ * notices it.  Repeats are possible after the monitor reappears. */
+typedef void (*IdleChangedFunc)(gboolean idle, gpointer user_data);
+
+/* Called when the watches come into place or go away, i.e. whenever
+ * idle_watch_active() changes */
+typedef void (*IdleWatchActiveFunc)(gboolean active, gpointer user_data);
+
+/* An idle watch for the threshold and, while idle, a user-active watch.
+ * Both are added again whenever the monitor's owner changes. */
+typedef struct {
+    GDBusConnection *connection;
+    guint signal_id;
+    guint name_watch_id;
+    GCancellable *cancellable;   /* calls in flight, cancelled on stop */
+    guint64 threshold_ms;
+    guint32 idle_watch_id;       /* 0 while the idle watch is not in place */
+    guint32 active_watch_id;     /* 0 unless armed */
+    gboolean is_idle;
+    IdleChangedFunc callback;
+    IdleWatchActiveFunc active_changed; /* set after idle_watch_start() */
+    gpointer user_data;
+    guint64 watches_fired;
+} IdleWatch;
+
+/* Adds the watches whenever the idle monitor is on the bus */
+gboolean idle_watch_start(IdleWatch *watch, GDBusConnection *connection,
+                          guint64 threshold_ms, IdleChangedFunc callback,
+                          gpointer user_data);
+void idle_watch_stop(IdleWatch *watch);
+
+/* TRUE while the watches report idle changes; GetIdletime has to be
+ * polled otherwise */
+gboolean idle_watch_active(const IdleWatch *watch);
+
+#endif /* SESSION_EVENTS_H */
@@ -0,0 +1,87 @@
+/*
+ * Companion extension for activity-tracker.
+ *
+ * Exports org.gnome.Shell.Extensions.ActivityTracker on the session bus and
+ * emits FocusChanged whenever the focused window or its title changes, so
+ * the tracker can react immediately instead of polling Window Calls.
+ */
+
+import GLib from 'gi://GLib';
+import Gio from 'gi://Gio';
+import {Extension} from 'resource:///org/gnome/shell/extensions/extension.js';
+
+const OBJECT_PATH = '/org/gnome/Shell/Extensions/ActivityTracker';
+const INTERFACE_XML = `
+<node>
+  <interface name="org.gnome.Shell.Extensions.ActivityTracker">
+    <method name="GetFocused">
+      <arg type="s" direction="out" name="windows"/>
+    </method>
+    <signal name="FocusChanged">
+      <arg type="s" name="windows"/>
+    </signal>
+  </interface>
+</node>`;
+
+/* Same JSON shape as Window Calls List(), restricted to the focused window,
+ * so the tracker parses both sources with the same code. */
+function describeWindow(win) {
+    if (!win)
+        return '[]';
+    return JSON.stringify([{
+        title: win.get_title() ?? '',
+        wm_class: win.get_wm_class() ?? '',
+        wm_class_instance: win.get_wm_class_instance() ?? '',
+        pid: win.get_pid(),
+        focus: true,
+    }]);
+}
+
+export default class ActivityTrackerExtension extends Extension {
+    enable() {
+        this._window = null;
+        this._titleId = 0;
+        this._lastPayload = null;
+        this._dbus = Gio.DBusExportedObject.wrapJSObject(INTERFACE_XML, this);
+        this._dbus.export(Gio.DBus.session, OBJECT_PATH);
+        this._focusId = global.display.connect('notify::focus-window',
+            () => this._onFocusWindowChanged());
+        this._onFocusWindowChanged();
+    }
+
+    disable() {
+        global.display.disconnect(this._focusId);
+        this._focusId = 0;
+        this._trackWindow(null);
+        this._dbus.unexport();
+        this._dbus = null;
+        this._lastPayload = null;
+    }
+
+    GetFocused() {
+        return describeWindow(global.display.focus_window);
+    }
+
+    _trackWindow(win) {
+        if (this._window && this._titleId)
+            this._window.disconnect(this._titleId);
+        this._window = win;
+        this._titleId = win
+            ? win.connect('notify::title', () => this._emitFocusChanged())
+            : 0;
+    }
+
+    _onFocusWindowChanged() {
+        this._trackWindow(global.display.focus_window);
+        this._emitFocusChanged();
+    }
+
+    _emitFocusChanged() {
+        const payload = describeWindow(this._window);
+        if (payload === this._lastPayload)
+            return;
+        this._lastPayload = payload;
+        this._dbus.emit_signal('FocusChanged',
+            new GLib.Variant('(s)', [payload]));
+    }
+}
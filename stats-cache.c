@@ -0,0 +1,247 @@
+#include "stats-cache.h"
+#include "string-table.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define STATS_CACHE_MAGIC     "ATSTATS1"
+#define STATS_CACHE_MAGIC_LEN 8
+/* Bytes before the covered end that must be unchanged for the cache to
+ * hold: enough to tell a rewritten file from an appended one */
+#define TAIL_CHECK_LEN        256
+
+gchar *stats_cache_path(const gchar *cache_dir, const gchar *csv_path)
+{
+    /* The day's name to find it by, the full path to keep data dirs apart */
+    gchar *full = g_canonicalize_filename(csv_path, NULL);
+    gchar *base = g_path_get_basename(csv_path);
+    gchar *name = g_strdup_printf("%s-%016" G_GINT64_MODIFIER "x.stats", base,
+                                  string_hash(full, strlen(full)));
+    gchar *path = g_build_filename(cache_dir, name, NULL);
+    g_free(name);
+    g_free(base);
+    g_free(full);
+    return path;
+}
+
+static guint64 tail_hash(const gchar *data, gsize covered)
+{
+    gsize from = covered > TAIL_CHECK_LEN ? covered - TAIL_CHECK_LEN : 0;
+    return string_hash(data + from, covered - from);
+}
+
+/* ── Encoding ───────────────────────────────────────── */
+
+static void put_u64(GByteArray *buf, guint64 v)
+{
+    guint64 le = GUINT64_TO_LE(v);
+    g_byte_array_append(buf, (const guint8 *)&le, sizeof(le));
+}
+
+static void put_string(GByteArray *buf, const gchar *str)
+{
+    gsize len = strlen(str);
+    put_u64(buf, len);
+    g_byte_array_append(buf, (const guint8 *)str, len);
+}
+
+typedef struct {
+    const guint8 *p;
+    const guint8 *end;
+} CacheReader;
+
+static gboolean get_u64(CacheReader *r, guint64 *v)
+{
+    if ((gsize)(r->end - r->p) < sizeof(*v))
+        return FALSE;
+    memcpy(v, r->p, sizeof(*v));
+    *v = GUINT64_FROM_LE(*v);
+    r->p += sizeof(*v);
+    return TRUE;
+}
+
+/* A copy of the next string, NULL past the end or on an embedded NUL */
+static gchar *get_string(CacheReader *r)
+{
+    guint64 len;
+    if (!get_u64(r, &len) || len > (guint64)(r->end - r->p) ||
+        memchr(r->p, '\0', len))
+        return NULL;
+    gchar *str = g_strndup((const gchar *)r->p, len);
+    r->p += len;
+    return str;
+}
+
+/* ── Cache files ────────────────────────────────────── */
+
+static gboolean parse_cache(CacheReader *r, DayStats *stats,
+                            const struct stat *st, const gchar *data,
+                            gsize len, gsize *covered)
+{
+    guint64 dev, ino, end, hash, locked, afk, apps;
+    if (!get_u64(r, &dev) || !get_u64(r, &ino) || !get_u64(r, &end) ||
+        !get_u64(r, &hash))
+        return FALSE;
+    /* Another file, or this one shrank or changed below the covered end */
+    if (dev != (guint64)st->st_dev || ino != (guint64)st->st_ino ||
+        end > len || hash != tail_hash(data, end))
+        return FALSE;
+
+    if (!get_u64(r, &locked) || !get_u64(r, &afk) || !get_u64(r, &apps))
+        return FALSE;
+    stats->total_locked_seconds = (long)locked;
+    stats->total_afk_active_seconds = (long)afk;
+
+    for (guint64 a = 0; a < apps; a++) {
+        gchar *wm_class = get_string(r);
+        guint64 titles;
+        if (!wm_class || !get_u64(r, &titles)) {
+            g_free(wm_class);
+            return FALSE;
+        }
+        for (guint64 t = 0; t < titles; t++) {
+            gchar *title = get_string(r);
+            guint64 seconds;
+            if (!title || !get_u64(r, &seconds)) {
+                g_free(title);
+                g_free(wm_class);
+                return FALSE;
+            }
+            day_stats_add_title(stats, wm_class, title, (long)seconds);
+            stats->total_active_seconds += (long)seconds;
+            g_free(title);
+        }
+        g_free(wm_class);
+    }
+
+    if (r->p != r->end)
+        return FALSE;
+    *covered = end;
+    return TRUE;
+}
+
+DayStats *stats_cache_load(const gchar *cache_path, const struct stat *st,
+                           const gchar *data, gsize len, gsize *covered)
+{
+    gchar *contents;
+    gsize size;
+    if (!g_file_get_contents(cache_path, &contents, &size, NULL))
+        return NULL;
+
+    /* The magic, a hash of the rest, then the rest */
+    DayStats *stats = NULL;
+    gsize head = STATS_CACHE_MAGIC_LEN + sizeof(guint64);
+    guint64 check;
+    if (size >= head &&
+        memcmp(contents, STATS_CACHE_MAGIC, STATS_CACHE_MAGIC_LEN) == 0 &&
+        (memcpy(&check, contents + STATS_CACHE_MAGIC_LEN, sizeof(check)),
+         GUINT64_FROM_LE(check) == string_hash(contents + head, size - head))) {
+        CacheReader r = {(const guint8 *)contents + head,
+                         (const guint8 *)contents + size};
+        stats = day_stats_new();
+        if (parse_cache(&r, stats, st, data, len, covered)) {
+            day_stats_sort(stats);
+        } else {
+            free_day_stats(stats);
+            stats = NULL;
+        }
+    }
+    g_free(contents);
+    return stats;
+}
+
+gboolean stats_cache_save(const gchar *cache_path, const DayStats *stats,
+                          const struct stat *st, const gchar *data,
+                          gsize covered, GError **error)
+{
+    gchar *dir = g_path_get_dirname(cache_path);
+    int rc = g_mkdir_with_parents(dir, 0700);
+    g_free(dir);
+    if (rc != 0) {
+        int saved = errno;
+        g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved),
+                    "Failed to create directory for %s: %s", cache_path,
+                    g_strerror(saved));
+        return FALSE;
+    }
+
+    GByteArray *buf = g_byte_array_new();
+    g_byte_array_append(buf, (const guint8 *)STATS_CACHE_MAGIC,
+                        STATS_CACHE_MAGIC_LEN);
+    put_u64(buf, 0);
+    put_u64(buf, st->st_dev);
+    put_u64(buf, st->st_ino);
+    put_u64(buf, covered);
+    put_u64(buf, tail_hash(data, covered));
+    put_u64(buf, stats->total_locked_seconds);
+    put_u64(buf, stats->total_afk_active_seconds);
+    put_u64(buf, stats->apps->len);
+    for (guint i = 0; i < stats->apps->len; i++) {
+        const AppStat *app = g_ptr_array_index(stats->apps, i);
+        put_string(buf, app->wm_class);
+        put_u64(buf, app->n_titles);
+        for (const TitleStat *t = app->titles; t; t = t->next) {
+            put_string(buf, t->title);
+            put_u64(buf, t->total_seconds);
+        }
+    }
+
+    gsize head = STATS_CACHE_MAGIC_LEN + sizeof(guint64);
+    guint64 check = GUINT64_TO_LE(string_hash((const gchar *)buf->data + head,
+                                              buf->len - head));
+    memcpy(buf->data + STATS_CACHE_MAGIC_LEN, &check, sizeof(check));
+
+    /* Replaced in one rename, so a concurrent report reads either copy */
+    gboolean ok = g_file_set_contents(cache_path, (const gchar *)buf->data,
+                                      buf->len, error);
+    g_byte_array_free(buf, TRUE);
+    return ok;
+}
+
+DayStats *stats_cache_compute(const gchar *csv_path, const gchar *cache_dir,
+                              guint max_threads)
+{
+    /* Mapped from the descriptor it was identified by, under the shared
+     * lock that keeps the tracker from truncating it meanwhile */
+    int fd = open_day_file_locked(csv_path);
+    if (fd < 0)
+        return NULL;
+    struct stat st;
+    GMappedFile *file = fstat(fd, &st) == 0
+        ? g_mapped_file_new_from_fd(fd, FALSE, NULL) : NULL;
+    if (!file) {
+        close(fd);
+        return NULL;
+    }
+    const gchar *data = g_mapped_file_get_contents(file);
+    gsize len = g_mapped_file_get_length(file);
+
+    gchar *cache_path = stats_cache_path(cache_dir, csv_path);
+    gsize covered = 0, parsed;
+    DayStats *stats = stats_cache_load(cache_path, &st, data, len, &covered);
+    gboolean hit = stats != NULL;
+
+    DayStats *tail = compute_csv_stats(data + covered, len - covered,
+                                       max_threads, CSV_STATS_MIN_CHUNK, &parsed);
+    if (stats) {
+        merge_day_stats(stats, tail);
+        free_day_stats(tail);
+    } else {
+        stats = tail;
+    }
+
+    if (!hit || parsed > 0) {
+        GError *error = NULL;
+        if (!stats_cache_save(cache_path, stats, &st, data, covered + parsed,
+                              &error)) {
+            g_printerr("Failed to write stats cache: %s\n", error->message);
+            g_error_free(error);
+        }
+    }
+
+    g_free(cache_path);
+    g_mapped_file_unref(file);
+    close(fd);
+    return stats;
+}
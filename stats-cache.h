@@ -0,0 +1,35 @@
+#ifndef STATS_CACHE_H
+#define STATS_CACHE_H
+
+#include "tracker-core.h"
+#include <sys/stat.h>
+
+/* ── Stats cache ────────────────────────────────────── *
+ *
+ * The tracker only appends to a day's CSV, so the statistics of its first
+ * bytes never change.  The cache keeps them per file, together with how
+ * many bytes they cover and what identifies the file: its device and
+ * inode, and a hash of the bytes just before the covered end.  A later
+ * report parses only what was appended since and adds it in.  A file that
+ * was replaced, shrank or rewritten no longer matches and is parsed from
+ * the start again. */
+
+/* Where the cache of csv_path goes inside cache_dir */
+gchar *stats_cache_path(const gchar *cache_dir, const gchar *csv_path);
+
+/* The cached statistics, or NULL when there are none for this content of
+ * the file; covered is set to how many bytes of data they count, and left
+ * alone with NULL. */
+DayStats *stats_cache_load(const gchar *cache_path, const struct stat *st,
+                           const gchar *data, gsize len, gsize *covered);
+gboolean stats_cache_save(const gchar *cache_path, const DayStats *stats,
+                          const struct stat *st, const gchar *data,
+                          gsize covered, GError **error);
+
+/* compute_day_stats_threaded() for a plain CSV, reading and updating its
+ * cache in cache_dir.  A cache that cannot be written only costs the next
+ * report a full parse. */
+DayStats *stats_cache_compute(const gchar *csv_path, const gchar *cache_dir,
+                              guint max_threads);
+
+#endif /* STATS_CACHE_H */
@@ -0,0 +1,221 @@
+#include "status-page.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Retries of a read that keeps finding the writer inside before yielding
+ * the processor to it, and yields before giving the page up as abandoned */
+#define READ_SPINS  100
+#define READ_YIELDS 100000
+
+struct _StatusPageWriter {
+    gchar *path;
+    StatusPage *page;
+};
+
+struct _StatusPageReader {
+    const StatusPage *page;
+};
+
+static gboolean set_errno_error(GError **error, const gchar *what,
+                                const gchar *path)
+{
+    int saved = errno;
+    g_set_error(error, G_IO_ERROR, g_io_error_from_errno(saved),
+                "%s %s: %s", what, path, g_strerror(saved));
+    return FALSE;
+}
+
+gchar *status_page_default_path(void)
+{
+    return build_runtime_path(STATUS_PAGE_FILE);
+}
+
+/* ── Writer ─────────────────────────────────────────── */
+
+StatusPageWriter *status_page_writer_open(const gchar *path, GError **error)
+{
+    /* Built under a temporary name and renamed over the old page, so a
+     * reader never maps one that is not set up yet */
+    gchar *tmp_path = g_strconcat(path, ".XXXXXX", NULL);
+    int fd = g_mkstemp_full(tmp_path, O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        set_errno_error(error, "Failed to create", tmp_path);
+        g_free(tmp_path);
+        return NULL;
+    }
+
+    StatusPage *page = MAP_FAILED;
+    if (ftruncate(fd, sizeof(StatusPage)) == 0)
+        page = mmap(NULL, sizeof(StatusPage), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+    if (page == MAP_FAILED || rename(tmp_path, path) != 0) {
+        set_errno_error(error, "Failed to set up", path);
+        if (page != MAP_FAILED)
+            munmap(page, sizeof(StatusPage));
+        close(fd);
+        unlink(tmp_path);
+        g_free(tmp_path);
+        return NULL;
+    }
+    close(fd);
+    g_free(tmp_path);
+
+    /* The file starts zeroed: sequence 0 and STATUS_PAGE_STOPPED */
+    page->magic = STATUS_PAGE_MAGIC;
+    page->version = STATUS_PAGE_VERSION;
+    page->size = sizeof(StatusPage);
+
+    StatusPageWriter *writer = g_new0(StatusPageWriter, 1);
+    writer->path = g_strdup(path);
+    writer->page = page;
+    return writer;
+}
+
+void status_page_publish(StatusPageWriter *writer, const StatusSnapshot *snap)
+{
+    StatusPage *page = writer->page;
+    guint32 seq = page->seq; /* only this thread stores it */
+
+    __atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(&page->current, snap, sizeof(*snap));
+    __atomic_store_n(&page->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/* Copies src into a field of size bytes, cut at a character boundary */
+static void copy_field(gchar *dst, gsize size, const gchar *src)
+{
+    gsize len = src ? strlen(src) : 0;
+    if (len >= size) {
+        len = size - 1;
+        while (len > 0 && ((guchar)src[len] & 0xc0) == 0x80)
+            len--;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+void status_page_publish_state(StatusPageWriter *writer, const AppState *state)
+{
+    StatusSnapshot snap;
+    memset(&snap, 0, sizeof(snap));
+    snap.start_wall = state->current_wall;
+    snap.start_monotonic = state->current_start;
+
+    /* Away intervals carry no window, as in the day file */
+    if (state->is_locked || state->is_idle) {
+        snap.state = state->is_locked ? STATUS_PAGE_LOCKED : STATUS_PAGE_IDLE;
+    } else {
+        snap.state = STATUS_PAGE_ACTIVE;
+        snap.pid = state->current_pid;
+        copy_field(snap.title, sizeof(snap.title), state->current_title);
+        copy_field(snap.wm_class, sizeof(snap.wm_class), state->current_wm_class);
+        copy_field(snap.rp_state, sizeof(snap.rp_state), state->current_rp_state);
+        copy_field(snap.rp_details, sizeof(snap.rp_details),
+                   state->current_rp_details);
+    }
+    status_page_publish(writer, &snap);
+}
+
+void status_page_writer_close(StatusPageWriter *writer)
+{
+    if (!writer)
+        return;
+
+    /* Readers that still have it mapped see the tracker gone */
+    StatusSnapshot snap;
+    memset(&snap, 0, sizeof(snap));
+    status_page_publish(writer, &snap);
+    munmap(writer->page, sizeof(StatusPage));
+    unlink(writer->path);
+    g_free(writer->path);
+    g_free(writer);
+}
+
+/* ── Reader ─────────────────────────────────────────── */
+
+StatusPageReader *status_page_reader_open(const gchar *path, GError **error)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        set_errno_error(error, "Failed to open", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        set_errno_error(error, "Failed to stat", path);
+        close(fd);
+        return NULL;
+    }
+    if (st.st_size < (off_t)sizeof(StatusPage)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                    "%s is not a status page", path);
+        close(fd);
+        return NULL;
+    }
+
+    const StatusPage *page = mmap(NULL, sizeof(StatusPage), PROT_READ,
+                                  MAP_SHARED, fd, 0);
+    if (page == MAP_FAILED) {
+        set_errno_error(error, "Failed to map", path);
+        close(fd);
+        return NULL;
+    }
+    close(fd);
+
+    if (page->magic != STATUS_PAGE_MAGIC ||
+        page->version != STATUS_PAGE_VERSION ||
+        page->size != sizeof(StatusPage)) {
+        g_set_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                    "%s is not a status page of this version", path);
+        munmap((gpointer)page, sizeof(StatusPage));
+        return NULL;
+    }
+
+    StatusPageReader *reader = g_new0(StatusPageReader, 1);
+    reader->page = page;
+    return reader;
+}
+
+gboolean status_page_read(const StatusPageReader *reader, StatusSnapshot *snap)
+{
+    const StatusPage *page = reader->page;
+    guint waits = 0;
+
+    for (;;) {
+        guint32 seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+        if (!(seq & 1)) {
+            memcpy(snap, &page->current, sizeof(*snap));
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (__atomic_load_n(&page->seq, __ATOMIC_RELAXED) == seq)
+                break;
+        }
+        /* The writer is inside: a publish is a few memcpy()s unless it
+         * lost the processor, or died there */
+        if (++waits > READ_SPINS) {
+            if (waits > READ_SPINS + READ_YIELDS)
+                return FALSE;
+            g_thread_yield();
+        }
+    }
+
+    /* Whatever the file held, the strings end inside their fields */
+    snap->title[sizeof(snap->title) - 1] = '\0';
+    snap->wm_class[sizeof(snap->wm_class) - 1] = '\0';
+    snap->rp_state[sizeof(snap->rp_state) - 1] = '\0';
+    snap->rp_details[sizeof(snap->rp_details) - 1] = '\0';
+    return TRUE;
+}
+
+void status_page_reader_close(StatusPageReader *reader)
+{
+    if (!reader)
+        return;
+    munmap((gpointer)reader->page, sizeof(StatusPage));
+    g_free(reader);
+}
@@ -0,0 +1,77 @@
+#ifndef STATUS_PAGE_H
+#define STATUS_PAGE_H
+
+#include <glib.h>
+#include "tracker-core.h"
+
+/* ── Status page ────────────────────────────────────── *
+ *
+ * The running tracker publishes the interval it is tracking in a small
+ * file in $XDG_RUNTIME_DIR that readers map once and then read without
+ * system calls.  There is one writer.  A sequence number guards the
+ * contents: it is odd while the writer is inside, and a reader that saw it
+ * odd or changed across its copy reads again. */
+
+#define STATUS_PAGE_FILE    "activity-tracker.status"
+#define STATUS_PAGE_MAGIC   0x50535441u  /* "ATSP" */
+#define STATUS_PAGE_VERSION 1
+
+#define STATUS_PAGE_TITLE_MAX 1024
+#define STATUS_PAGE_NAME_MAX  256
+
+typedef enum {
+    STATUS_PAGE_STOPPED,     /* no tracker is running */
+    STATUS_PAGE_ACTIVE,
+    STATUS_PAGE_IDLE,
+    STATUS_PAGE_LOCKED,
+} StatusPageState;
+
+/* The interval being tracked.  Strings are NUL-terminated and cut at a
+ * character boundary when longer than their field. */
+typedef struct {
+    guint32 state;             /* StatusPageState */
+    gint32 pid;                /* of the focused window, 0 if unknown */
+    gint64 start_wall;         /* seconds since the epoch */
+    gint64 start_monotonic;    /* CLOCK_MONOTONIC, microseconds */
+    gchar title[STATUS_PAGE_TITLE_MAX];
+    gchar wm_class[STATUS_PAGE_NAME_MAX];
+    gchar rp_state[STATUS_PAGE_NAME_MAX];
+    gchar rp_details[STATUS_PAGE_NAME_MAX];
+} StatusSnapshot;
+
+/* The file's layout, in host byte order */
+typedef struct {
+    guint32 magic;
+    guint32 version;
+    guint32 size;              /* sizeof(StatusPage) */
+    guint32 seq;               /* odd while being written */
+    StatusSnapshot current;
+} StatusPage;
+
+/* $XDG_RUNTIME_DIR/activity-tracker.status */
+gchar *status_page_default_path(void);
+
+/* ── Writer ─────────────────────────────────────────── */
+
+typedef struct _StatusPageWriter StatusPageWriter;
+
+/* Replaces the file at path with a page showing STATUS_PAGE_STOPPED */
+StatusPageWriter *status_page_writer_open(const gchar *path, GError **error);
+void status_page_publish(StatusPageWriter *writer, const StatusSnapshot *snap);
+/* Publishes the interval state is tracking */
+void status_page_publish_state(StatusPageWriter *writer, const AppState *state);
+/* Publishes STATUS_PAGE_STOPPED and removes the file */
+void status_page_writer_close(StatusPageWriter *writer);
+
+/* ── Reader ─────────────────────────────────────────── */
+
+typedef struct _StatusPageReader StatusPageReader;
+
+StatusPageReader *status_page_reader_open(const gchar *path, GError **error);
+/* A consistent copy of the current interval; FALSE if the writer died
+ * while publishing.  STATUS_PAGE_STOPPED means the tracker has exited, and
+ * one started since has a new file to open. */
+gboolean status_page_read(const StatusPageReader *reader, StatusSnapshot *snap);
+void status_page_reader_close(StatusPageReader *reader);
+
+#endif /* STATUS_PAGE_H */
@@ -0,0 +1,148 @@
+#include "string-table.h"
+#include <string.h>
+
+#define MIX_MULTIPLIER G_GUINT64_CONSTANT(0x9e3779b97f4a7c15)
+#define MIN_SLOTS      16
+
+/* ── String hashing ─────────────────────────────────── */
+
+static inline guint64 hash_mix(guint64 h, guint64 word)
+{
+    h = (h ^ word) * MIX_MULTIPLIER;
+    return h ^ (h >> 29);
+}
+
+void string_hash_init(StringHash *state, guint64 seed)
+{
+    *state = (StringHash){ .h = seed };
+}
+
+void string_hash_update(StringHash *state, const gchar *data, gsize len)
+{
+    const guint8 *p = (const guint8 *)data;
+    guint64 h = state->h, word = state->word;
+    guint filled = state->filled;
+    state->total += len;
+
+    while (len) {
+        /* Whole words while none is part way through */
+        if (filled == 0 && len >= 8) {
+            guint64 w;
+            memcpy(&w, p, 8);
+            h = hash_mix(h, GUINT64_FROM_LE(w));
+            p += 8;
+            len -= 8;
+            continue;
+        }
+        word |= (guint64)*p++ << (8 * filled);
+        len--;
+        if (++filled == 8) {
+            h = hash_mix(h, word);
+            word = 0;
+            filled = 0;
+        }
+    }
+
+    state->h = h;
+    state->word = word;
+    state->filled = filled;
+}
+
+guint64 string_hash_finish(const StringHash *state)
+{
+    /* The length tells "a" from "a\0"; the final steps spread every input
+     * bit over the low bits that pick a slot */
+    guint64 h = hash_mix(hash_mix(state->h, state->word), state->total);
+    h ^= h >> 33;
+    h *= G_GUINT64_CONSTANT(0xff51afd7ed558ccd);
+    h ^= h >> 33;
+    return h;
+}
+
+guint64 string_hash(const gchar *data, gsize len)
+{
+    StringHash state;
+    string_hash_init(&state, 0);
+    string_hash_update(&state, data, len);
+    return string_hash_finish(&state);
+}
+
+/* ── String table ───────────────────────────────────── */
+
+void string_table_init(StringTable *table)
+{
+    *table = (StringTable){0};
+}
+
+void string_table_clear(StringTable *table)
+{
+    g_free(table->slots);
+    string_table_init(table);
+}
+
+gpointer string_table_lookup(const StringTable *table, guint64 hash,
+                             gconstpointer key, StringTableEqualFunc equal)
+{
+    if (!table->slots)
+        return NULL;
+    /* Linear probing: the next slots share the cache line */
+    for (gsize i = hash & table->mask;; i = (i + 1) & table->mask) {
+        const StringTableSlot *slot = &table->slots[i];
+        if (!slot->item)
+            return NULL;
+        if (slot->hash == hash && equal(slot->item, key))
+            return slot->item;
+    }
+}
+
+static void place(StringTableSlot *slots, gsize mask, guint64 hash,
+                  gpointer item)
+{
+    gsize i = hash & mask;
+    while (slots[i].item)
+        i = (i + 1) & mask;
+    slots[i] = (StringTableSlot){hash, item};
+}
+
+void string_table_insert(StringTable *table, guint64 hash, gpointer item)
+{
+    g_return_if_fail(item != NULL);
+
+    /* At most three quarters full, so probe runs stay short */
+    gsize slots = table->slots ? table->mask + 1 : 0;
+    if ((table->size + 1) * 4 > slots * 3) {
+        gsize grown = MAX(slots * 2, MIN_SLOTS);
+        StringTableSlot *fresh = g_new0(StringTableSlot, grown);
+        for (gsize i = 0; i < slots; i++)
+            if (table->slots[i].item)
+                place(fresh, grown - 1, table->slots[i].hash,
+                      table->slots[i].item);
+        g_free(table->slots);
+        table->slots = fresh;
+        table->mask = grown - 1;
+    }
+
+    place(table->slots, table->mask, hash, item);
+    table->size++;
+}
+
+void string_table_iter_init(StringTableIter *iter, const StringTable *table)
+{
+    iter->table = table;
+    iter->index = 0;
+}
+
+gboolean string_table_iter_next(StringTableIter *iter, gpointer *item)
+{
+    const StringTable *table = iter->table;
+    if (!table->slots)
+        return FALSE;
+    while (iter->index <= table->mask) {
+        const StringTableSlot *slot = &table->slots[iter->index++];
+        if (slot->item) {
+            *item = slot->item;
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
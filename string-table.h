@@ -0,0 +1,69 @@
+#ifndef STRING_TABLE_H
+#define STRING_TABLE_H
+
+#include <glib.h>
+
+/* ── String hashing ─────────────────────────────────── *
+ *
+ * A 64-bit hash taken eight bytes at a time.  It can be fed a string in
+ * pieces: any split of the same bytes gives the same hash. */
+
+typedef struct {
+    guint64 h;
+    guint64 word;       /* bytes not yet mixed in */
+    guint filled;
+    gsize total;
+} StringHash;
+
+void string_hash_init(StringHash *state, guint64 seed);
+void string_hash_update(StringHash *state, const gchar *data, gsize len);
+guint64 string_hash_finish(const StringHash *state);
+guint64 string_hash(const gchar *data, gsize len);
+
+/* ── String table ───────────────────────────────────── *
+ *
+ * An open-addressing hash table of items keyed by strings, for counting:
+ * items are added and looked up, never removed.  Each slot keeps the full
+ * hash next to its item, so a probe compares hashes within one array and
+ * only calls equal() on a hash match.  The caller hashes keys, typically
+ * with string_hash(), and owns the items. */
+
+typedef struct {
+    guint64 hash;
+    gpointer item;      /* NULL in an empty slot */
+} StringTableSlot;
+
+typedef struct {
+    StringTableSlot *slots;
+    gsize mask;         /* slot count - 1, a power of two minus one */
+    gsize size;
+} StringTable;
+
+/* Whether item is the one stored for key */
+typedef gboolean (*StringTableEqualFunc)(gconstpointer item, gconstpointer key);
+
+void string_table_init(StringTable *table);
+void string_table_clear(StringTable *table);
+
+/* The item stored under hash that equal() matches with key, NULL if none */
+gpointer string_table_lookup(const StringTable *table, guint64 hash,
+                             gconstpointer key, StringTableEqualFunc equal);
+/* Stores item, which must not already be there, under hash */
+void string_table_insert(StringTable *table, guint64 hash, gpointer item);
+
+static inline gsize string_table_size(const StringTable *table)
+{
+    return table->size;
+}
+
+/* Visits every item once, in no particular order; the table must not
+ * change meanwhile. */
+typedef struct {
+    const StringTable *table;
+    gsize index;
+} StringTableIter;
+
+void string_table_iter_init(StringTableIter *iter, const StringTable *table);
+gboolean string_table_iter_next(StringTableIter *iter, gpointer *item);
+
+#endif /* STRING_TABLE_H */
@@ -0,0 +1,454 @@
+#include <glib.h>
+#include "binary-log.h"
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("binary-log-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+static time_t test_time(int hour, int min)
+{
+    struct tm tm = {0};
+    tm.tm_year = 126;
+    tm.tm_mon = 0;
+    tm.tm_mday = 28;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+/* Quotes, empty fields, every status, repeated strings and a clock that
+ * steps backwards */
+static const CsvRecord sample[] = {
+    {0, 120, "active", "Main.java - \"app\" - IntelliJ IDEA", "jetbrains-idea",
+     "jetbrains-idea", "Editing Main.java", "app"},
+    {0, 30, "active", "Inbox - Mail", "Thunderbird", "Mail", "", ""},
+    {0, 600, "locked", "", "", "", "", ""},
+    {0, 45, "active", "Main.java - \"app\" - IntelliJ IDEA", "jetbrains-idea",
+     "jetbrains-idea", "Editing Main.java", "app"},
+    {0, 300, "idle", "", "", "", "", ""},
+    {0, 15, "active", "", "gnome-shell", "", "", ""},
+    {0, 60, "active", "Příliš žluťoučký kůň", "org.gnome.TextEditor",
+     "gnome-text-editor", "", ""},
+};
+
+static void write_sample(AppState *state, OutputFormat format, const gchar *dir)
+{
+    static const int minutes[] = {0, 2, 3, 13, 14, 12, 20};
+    state->data_dir = dir;
+    state->output_format = format;
+    state->durability = DURABILITY_ROTATION;
+    for (gsize i = 0; i < G_N_ELEMENTS(sample); i++) {
+        CsvRecord rec = sample[i];
+        rec.wall = test_time(12, minutes[i]);
+        write_csv_record(state, &rec);
+    }
+}
+
+static gchar *read_file(const gchar *path, gsize *len)
+{
+    gchar *contents = NULL;
+    g_assert_true(g_file_get_contents(path, &contents, len, NULL));
+    return contents;
+}
+
+static gchar *export_to_string(const gchar *path)
+{
+    gchar *out_path = g_strconcat(path, ".export", NULL);
+    FILE *out = fopen(out_path, "w");
+    g_assert_nonnull(out);
+    g_assert_true(binlog_export_csv(path, out));
+    fclose(out);
+    gchar *contents = read_file(out_path, NULL);
+    unlink(out_path);
+    g_free(out_path);
+    return contents;
+}
+
+static void assert_stats_equal(const DayStats *a, const DayStats *b)
+{
+    g_assert_cmpint(a->total_active_seconds, ==, b->total_active_seconds);
+    g_assert_cmpint(a->total_locked_seconds, ==, b->total_locked_seconds);
+    g_assert_cmpint(a->total_afk_active_seconds, ==, b->total_afk_active_seconds);
+    g_assert_cmpuint(a->apps->len, ==, b->apps->len);
+    for (guint i = 0; i < a->apps->len; i++) {
+        AppStat *x = g_ptr_array_index(a->apps, i);
+        AppStat *y = g_ptr_array_index(b->apps, i);
+        g_assert_cmpstr(x->wm_class, ==, y->wm_class);
+        g_assert_cmpint(x->total_seconds, ==, y->total_seconds);
+        g_assert_cmpuint(x->n_titles, ==, y->n_titles);
+
+        for (const TitleStat *t = x->titles; t; t = t->next) {
+            const TitleStat *other = app_stat_find_title(y, t->title);
+            g_assert_nonnull(other);
+            g_assert_cmpint(t->total_seconds, ==, other->total_seconds);
+        }
+    }
+}
+
+/* ── Tests ─────────────────────────────────────────── */
+
+static void test_export_matches_csv(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState csv = {0}, bin = {0};
+    write_sample(&csv, OUTPUT_CSV, tmpdir);
+    write_sample(&bin, OUTPUT_BINARY, tmpdir);
+    close_output_file(&csv);
+    close_output_file(&bin);
+
+    gchar *csv_path = build_csv_path(tmpdir, 2026, 1, 28);
+    gchar *bin_path = build_binlog_path(tmpdir, 2026, 1, 28);
+    gsize csv_len, bin_len;
+    gchar *want = read_file(csv_path, &csv_len);
+    gchar *bin_data = read_file(bin_path, &bin_len);
+    gchar *got = export_to_string(bin_path);
+
+    g_assert_true(binlog_has_magic(bin_data, bin_len));
+    g_assert_cmpstr(got, ==, want);
+    g_assert_cmpuint(bin_len, <, csv_len / 2);
+
+    g_free(want);
+    g_free(got);
+    g_free(bin_data);
+    g_free(csv_path);
+    g_free(bin_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_reopen_reuses_dictionary(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = build_binlog_path(tmpdir, 2026, 1, 28);
+    AppState state = {0};
+
+    write_sample(&state, OUTPUT_BINARY, tmpdir);
+    close_output_file(&state);
+    gsize first;
+    g_free(read_file(path, &first));
+
+    /* Same strings again after a restart: only RECORD entries are added */
+    write_sample(&state, OUTPUT_BINARY, tmpdir);
+    close_output_file(&state);
+    gsize second;
+    gchar *data = read_file(path, &second);
+    g_assert_cmpuint(second - first, <=, G_N_ELEMENTS(sample) * 16);
+
+    BinlogReader reader;
+    g_assert_true(binlog_reader_init(&reader, data, second));
+    BinlogRecord rec;
+    guint count = 0;
+    while (binlog_reader_next(&reader, &rec)) {
+        CsvRecord csv;
+        binlog_reader_to_csv(&reader, &rec, &csv);
+        const CsvRecord *want = &sample[count % G_N_ELEMENTS(sample)];
+        g_assert_cmpstr(csv.title, ==, want->title);
+        g_assert_cmpstr(csv.status, ==, want->status);
+        g_assert_cmpint(csv.duration, ==, want->duration);
+        count++;
+    }
+    g_assert_cmpuint(count, ==, 2 * G_N_ELEMENTS(sample));
+    g_assert_cmpuint(reader.pos, ==, second);
+
+    binlog_reader_clear(&reader);
+    g_free(data);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_torn_entry_recovered(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = build_binlog_path(tmpdir, 2026, 1, 28);
+    AppState state = {0};
+
+    write_sample(&state, OUTPUT_BINARY, tmpdir);
+    close_output_file(&state);
+    gsize len;
+    gchar *data = read_file(path, &len);
+
+    /* Cut into the last record, as a crash mid-write would */
+    g_assert_cmpint(truncate(path, len - 2), ==, 0);
+    BinlogReader reader;
+    BinlogRecord rec;
+    g_assert_true(binlog_reader_init(&reader, data, len - 2));
+    guint count = 0;
+    while (binlog_reader_next(&reader, &rec))
+        count++;
+    g_assert_cmpuint(count, ==, G_N_ELEMENTS(sample) - 1);
+    gsize valid = reader.pos;
+    binlog_reader_clear(&reader);
+    g_free(data);
+
+    /* Reopening cuts the torn entry before appending */
+    CsvRecord extra = sample[1];
+    extra.wall = test_time(13, 0);
+    write_csv_record(&state, &extra);
+    close_output_file(&state);
+
+    data = read_file(path, &len);
+    g_assert_true(binlog_reader_init(&reader, data, len));
+    count = 0;
+    while (binlog_reader_next(&reader, &rec))
+        count++;
+    g_assert_cmpuint(count, ==, G_N_ELEMENTS(sample));
+    g_assert_cmpuint(reader.pos, ==, len);
+    g_assert_cmpuint(len, >, valid);
+    g_assert_cmpint(reader.last_end, ==, extra.wall + extra.duration);
+
+    binlog_reader_clear(&reader);
+    g_free(data);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_rejects_foreign_file(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = build_binlog_path(tmpdir, 2026, 1, 28);
+    gchar *dir = g_path_get_dirname(path);
+    g_assert_cmpint(g_mkdir_with_parents(dir, 0700), ==, 0);
+    g_assert_true(g_file_set_contents(path, CSV_HEADER, -1, NULL));
+
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.output_format = OUTPUT_BINARY;
+    g_assert_false(ensure_output_file(&state, test_time(12, 0)));
+    g_assert_cmpint(state.file_day, ==, 0);
+
+    /* Left untouched */
+    gchar *contents = read_file(path, NULL);
+    g_assert_cmpstr(contents, ==, CSV_HEADER);
+
+    g_free(contents);
+    g_free(dir);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_reader_stops_at_malformed_entry(void)
+{
+    static const struct {
+        const char *name;
+        const char *bytes;
+        gsize len;
+    } cases[] = {
+        {"unknown tag",     "\x07", 1},
+        {"zero fill",       "\x00\x00\x00\x00", 4},
+        {"string too long", "\x01\x05" "ab", 4},
+        {"undefined id",    "\x02\x00\x02\x01\x00\x05\x00\x00\x00", 9},
+        {"bad status",      "\x02\x09\x02\x01\x00\x00\x00\x00\x00", 9},
+        {"torn varint",     "\x02\x00\x82\x80", 4},
+    };
+
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        GByteArray *data = g_byte_array_new();
+        g_byte_array_append(data, (const guint8 *)BINLOG_MAGIC, BINLOG_MAGIC_LEN);
+        /* One valid record first */
+        g_byte_array_append(data, (const guint8 *)"\x01\x01x\x02\x00\x02\x01\x01\x01\x00\x00\x00", 12);
+        gsize valid = data->len;
+        g_byte_array_append(data, (const guint8 *)cases[i].bytes, cases[i].len);
+
+        BinlogReader reader;
+        BinlogRecord rec;
+        g_assert_true(binlog_reader_init(&reader, (const gchar *)data->data, data->len));
+        g_assert_true(binlog_reader_next(&reader, &rec));
+        g_assert_cmpint(rec.wall, ==, 1);
+        g_assert_cmpstr(binlog_reader_string(&reader, rec.title), ==, "x");
+        if (binlog_reader_next(&reader, &rec))
+            g_error("%s: read past a malformed entry", cases[i].name);
+        g_assert_cmpuint(reader.pos, ==, valid);
+
+        binlog_reader_clear(&reader);
+        g_byte_array_free(data, TRUE);
+    }
+}
+
+static void test_stats_match_csv(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState csv = {0}, bin = {0};
+    write_sample(&csv, OUTPUT_CSV, tmpdir);
+    write_sample(&bin, OUTPUT_BINARY, tmpdir);
+    close_output_file(&csv);
+    close_output_file(&bin);
+
+    gchar *csv_path = build_csv_path(tmpdir, 2026, 1, 28);
+    gchar *bin_path = build_binlog_path(tmpdir, 2026, 1, 28);
+    DayStats *from_csv = compute_day_stats(csv_path);
+    DayStats *from_bin = compute_day_stats(bin_path);
+    g_assert_nonnull(from_csv);
+    g_assert_nonnull(from_bin);
+    assert_stats_equal(from_bin, from_csv);
+
+    g_assert_cmpint(from_bin->total_locked_seconds, ==, 900);
+    g_assert_cmpint(from_bin->total_afk_active_seconds, ==, 15);
+    AppStat *top = g_ptr_array_index(from_bin->apps, 0);
+    g_assert_cmpstr(top->wm_class, ==, "jetbrains-idea");
+    TitleStat *title = app_stat_find_title(top, "Editing Main.java | app");
+    g_assert_nonnull(title);
+    g_assert_cmpint(title->total_seconds, ==, 165);
+
+    /* A day logged in both formats adds up */
+    merge_day_stats(from_csv, from_bin);
+    g_assert_cmpint(from_csv->total_active_seconds, ==,
+                    2 * from_bin->total_active_seconds);
+    top = g_ptr_array_index(from_csv->apps, 0);
+    g_assert_cmpint(top->total_seconds, ==, 330);
+    g_assert_cmpint(app_stat_find_title(top, "Editing Main.java | app")->total_seconds,
+                    ==, 330);
+
+    free_day_stats(from_csv);
+    free_day_stats(from_bin);
+    g_free(csv_path);
+    g_free(bin_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+/* A workday-like mix: a few dozen apps and about a hundred distinct documents a day,
+ * drawn with a skew so some repeat constantly and a tail appears rarely. */
+static void fill_random_record(GRand *rand, CsvRecord *rec, gchar *title,
+                               gsize title_size, gchar *wm_class,
+                               gsize class_size)
+{
+    static const char *const statuses[] = {"active", "active", "active",
+                                           "active", "active", "active",
+                                           "active", "idle", "locked"};
+    int doc = (int)(g_rand_double(rand) * g_rand_double(rand) * 150);
+    int app = doc % 40;
+    g_snprintf(wm_class, class_size, "org.example.Application%d", app);
+    g_snprintf(title, title_size, "Document %d - Project %d - Application %d",
+               doc, doc % 17, app);
+
+    rec->duration = g_rand_int_range(rand, 1, 180);
+    rec->status = statuses[g_rand_int_range(rand, 0, G_N_ELEMENTS(statuses))];
+    gboolean away = strcmp(rec->status, "active") != 0;
+    rec->title = away ? "" : title;
+    rec->wm_class = away ? "" : wm_class;
+    rec->wm_class_instance = away ? "" : wm_class + 12;
+    gboolean rp = !away && app < 4;
+    rec->rp_state = rp ? title : "";
+    rec->rp_details = rp ? wm_class : "";
+}
+
+static void test_perf_year_of_stats(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    const int days = 365, per_day = 400;
+    gchar *tmpdir = create_test_tmpdir();
+    AppState csv = {0}, bin = {0};
+    csv.data_dir = bin.data_dir = tmpdir;
+    csv.durability = bin.durability = DURABILITY_ROTATION;
+    bin.output_format = OUTPUT_BINARY;
+
+    GRand *rand = g_rand_new_with_seed(42);
+    struct tm tm = {0};
+    tm.tm_year = 125;
+    tm.tm_mday = 1;
+    tm.tm_hour = 8;
+    tm.tm_isdst = -1;
+    for (int d = 0; d < days; d++, tm.tm_mday++) {
+        time_t t = mktime(&tm);
+        for (int i = 0; i < per_day; i++) {
+            gchar title[128], wm_class[64];
+            CsvRecord rec;
+            fill_random_record(rand, &rec, title, sizeof(title),
+                               wm_class, sizeof(wm_class));
+            /* Back to back, as the tracker writes them */
+            rec.wall = t;
+            t += rec.duration;
+            write_csv_record(&csv, &rec);
+            write_csv_record(&bin, &rec);
+        }
+        tm.tm_hour = 8;
+    }
+    g_rand_free(rand);
+    close_output_file(&csv);
+    close_output_file(&bin);
+
+    /* Walk the files back in calendar order */
+    double csv_time = 0, bin_time = 0;
+    goffset csv_bytes = 0, bin_bytes = 0;
+    tm.tm_mday = 1;
+    tm.tm_mon = 0;
+    for (int d = 0; d < days; d++, tm.tm_mday++) {
+        time_t t = mktime(&tm);
+        struct tm day;
+        localtime_r(&t, &day);
+        gchar *csv_path = build_csv_path(tmpdir, day.tm_year + 1900,
+                                         day.tm_mon + 1, day.tm_mday);
+        gchar *bin_path = build_binlog_path(tmpdir, day.tm_year + 1900,
+                                            day.tm_mon + 1, day.tm_mday);
+        struct stat csv_st, bin_st;
+        g_assert_cmpint(stat(csv_path, &csv_st), ==, 0);
+        g_assert_cmpint(stat(bin_path, &bin_st), ==, 0);
+        csv_bytes += csv_st.st_size;
+        bin_bytes += bin_st.st_size;
+
+        g_test_timer_start();
+        DayStats *from_csv = compute_day_stats(csv_path);
+        csv_time += g_test_timer_elapsed();
+
+        g_test_timer_start();
+        DayStats *from_bin = compute_day_stats(bin_path);
+        bin_time += g_test_timer_elapsed();
+
+        assert_stats_equal(from_bin, from_csv);
+        free_day_stats(from_csv);
+        free_day_stats(from_bin);
+        g_free(csv_path);
+        g_free(bin_path);
+    }
+
+    g_test_message("%d days x %d records: CSV %.1f MiB in %.3f s, "
+                   "binary %.2f MiB in %.3f s (%.1fx smaller, %.1fx faster)",
+                   days, per_day, csv_bytes / 1048576.0, csv_time,
+                   bin_bytes / 1048576.0, bin_time,
+                   (double)csv_bytes / bin_bytes, csv_time / bin_time);
+    g_test_minimized_result(bin_time, "compute_day_stats over a binary year: %.3f s",
+                            bin_time);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/binary-log/export_matches_csv", test_export_matches_csv);
+    g_test_add_func("/binary-log/reopen_reuses_dictionary", test_reopen_reuses_dictionary);
+    g_test_add_func("/binary-log/torn_entry_recovered", test_torn_entry_recovered);
+    g_test_add_func("/binary-log/rejects_foreign_file", test_rejects_foreign_file);
+    g_test_add_func("/binary-log/reader_stops_at_malformed_entry",
+                    test_reader_stops_at_malformed_entry);
+    g_test_add_func("/binary-log/stats_match_csv", test_stats_match_csv);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/binary_log_stats", test_perf_year_of_stats);
+
+    return g_test_run();
+}
@@ -0,0 +1,653 @@
+#include <glib.h>
+#include "csv-scan.h"
+#include "tracker-core.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *field_str(const CsvField *field)
+{
+    GString *buf = g_string_new(NULL);
+    csv_field_append(buf, field);
+    return g_string_free(buf, FALSE);
+}
+
+/* The next record as "a|b|c", NULL at the end */
+static gchar *next_joined(CsvScanner *scanner)
+{
+    CsvField fields[16];
+    guint n = csv_scanner_next(scanner, fields, G_N_ELEMENTS(fields));
+    if (!n)
+        return NULL;
+    GString *out = g_string_new(NULL);
+    for (guint i = 0; i < n; i++) {
+        if (i)
+            g_string_append_c(out, '|');
+        csv_field_append(out, &fields[i]);
+    }
+    return g_string_free(out, FALSE);
+}
+
+static void assert_next(CsvScanner *scanner, const gchar *expected)
+{
+    gchar *got = next_joined(scanner);
+    g_assert_cmpstr(got, ==, expected);
+    g_free(got);
+}
+
+static gchar *report_to_string(const DayStats *stats)
+{
+    gchar *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    g_assert_nonnull(out);
+    StatsOptions opts = {.top_apps = 1000, .top_titles = 1000, .cols = 120};
+    print_stats_report(out, stats, 2026, 1, 28, &opts);
+    fclose(out);
+    return buf;
+}
+
+/* Every record of data as fields and end positions, scanned with kernel */
+static GArray *scan_all(CsvScanKernel kernel, const gchar *data, gsize len,
+                        gboolean complete)
+{
+    g_assert_true(csv_scan_set_kernel(kernel));
+    GArray *out = g_array_new(FALSE, FALSE, sizeof(CsvField));
+    CsvScanner scanner;
+    CsvField fields[4];
+    guint n;
+    csv_scanner_init(&scanner, data, len, complete);
+    while ((n = csv_scanner_next(&scanner, fields, G_N_ELEMENTS(fields)))) {
+        g_array_append_vals(out, fields, n);
+        /* The record boundary, as a field no scan can produce */
+        CsvField end = {NULL, scanner.pos, n};
+        g_array_append_val(out, end);
+    }
+    return out;
+}
+
+static void assert_same_scan(const GArray *expected, const GArray *got)
+{
+    g_assert_cmpuint(got->len, ==, expected->len);
+    for (guint i = 0; i < expected->len; i++) {
+        const CsvField *a = &g_array_index(expected, CsvField, i);
+        const CsvField *b = &g_array_index(got, CsvField, i);
+        g_assert_true(a->ptr == b->ptr);
+        g_assert_cmpuint(a->len, ==, b->len);
+        g_assert_cmpint(a->escaped, ==, b->escaped);
+    }
+}
+
+/* ── Tests ─────────────────────────────────────────── */
+
+static void test_fields(void)
+{
+    static const gchar data[] =
+        "2026-01-28T12:00:00+0100,120,active,\"Main.java - \"\"app\"\"\",idea,,\"\",x\n"
+        "\n"
+        "a,\"b,c\",\"\"\"\"\r\n"
+        "plain\r\n"
+        ",\n";
+    CsvScanner scanner;
+    csv_scanner_init(&scanner, data, strlen(data), FALSE);
+
+    CsvField fields[8];
+    guint n = csv_scanner_next(&scanner, fields, 8);
+    g_assert_cmpuint(n, ==, 8);
+    g_assert_true(csv_field_equal(&fields[2], "active"));
+    g_assert_false(fields[2].escaped);
+    g_assert_true(fields[3].escaped);
+    gchar *title = field_str(&fields[3]);
+    g_assert_cmpstr(title, ==, "Main.java - \"app\"");
+    g_free(title);
+    long duration;
+    g_assert_true(csv_field_to_long(&fields[1], &duration));
+    g_assert_cmpint(duration, ==, 120);
+    g_assert_cmpuint(fields[5].len, ==, 0);
+    g_assert_cmpuint(fields[6].len, ==, 0);
+
+    assert_next(&scanner, "");
+    assert_next(&scanner, "a|b,c|\"");
+    assert_next(&scanner, "plain");
+    assert_next(&scanner, "|");
+    assert_next(&scanner, NULL);
+}
+
+static void test_field_to_long(void)
+{
+    static const struct {
+        const gchar *text;
+        gboolean ok;
+        long value;
+    } cases[] = {
+        {"0", TRUE, 0}, {"86400", TRUE, 86400}, {"-5", TRUE, -5},
+        {"", FALSE, 0}, {"12a", FALSE, 0}, {"duration_seconds", FALSE, 0},
+        {"99999999999999999999999", FALSE, 0},
+        {"123456789012345678901234567890123", FALSE, 0},
+    };
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        CsvField field = {cases[i].text, strlen(cases[i].text), FALSE};
+        long value = -1;
+        g_assert_cmpint(csv_field_to_long(&field, &value), ==, cases[i].ok);
+        if (cases[i].ok)
+            g_assert_cmpint(value, ==, cases[i].value);
+    }
+}
+
+static void test_quoted_newline(void)
+{
+    static const gchar data[] = "1,\"two\nlines\",3\n4\n";
+    CsvScanner scanner;
+    csv_scanner_init(&scanner, data, strlen(data), FALSE);
+    assert_next(&scanner, "1|two\nlines|3");
+    assert_next(&scanner, "4");
+    assert_next(&scanner, NULL);
+}
+
+static void test_partial_last_line(void)
+{
+    /* Cut anywhere, including inside a quoted field and between the two
+     * quotes of a pair, the incomplete record is never returned */
+    static const gchar data[] = "a,1\nb,\"x\"\"y\",2\n";
+    gsize first_end = strchr(data, '\n') + 1 - data;
+    for (gsize cut = first_end; cut < strlen(data); cut++) {
+        CsvScanner scanner;
+        csv_scanner_init(&scanner, data, cut, FALSE);
+        assert_next(&scanner, "a|1");
+        assert_next(&scanner, NULL);
+        /* A later call still sees nothing new */
+        assert_next(&scanner, NULL);
+        g_assert_cmpuint(scanner.pos, ==, first_end);
+    }
+
+    /* Complete data ends the record without a newline */
+    CsvScanner scanner;
+    csv_scanner_init(&scanner, data, strlen(data) - 1, TRUE);
+    assert_next(&scanner, "a|1");
+    assert_next(&scanner, "b|x\"y|2");
+    assert_next(&scanner, NULL);
+}
+
+static void test_matches_parse_csv_line(void)
+{
+    static const CsvRecord records[] = {
+        {0, 120, "active", "Main.java - \"app\" - IntelliJ IDEA",
+         "jetbrains-idea", "jetbrains-idea", "Editing Main.java", "app"},
+        {0, 30, "active", "Inbox, 3 unread - Mail", "Thunderbird", "Mail", "", ""},
+        {0, 600, "locked", "", "", "", "", ""},
+        {0, 60, "active", "Příliš žluťoučký kůň", "org.gnome.TextEditor",
+         "gnome-text-editor", "\"\"", ","},
+    };
+    GString *csv = g_string_new(CSV_HEADER);
+    TimestampCache cache = {0};
+    for (gsize i = 0; i < G_N_ELEMENTS(records); i++) {
+        CsvRecord rec = records[i];
+        rec.wall = 1769598000 + (time_t)i * 60;
+        serialize_csv_record(csv, &rec, &cache);
+    }
+    /* A record from before rich presence was logged */
+    g_string_append(csv, "2026-01-28T13:00:00+0100,5,active,\"Old\",old,old\n");
+
+    gchar **lines = g_strsplit(csv->str, "\n", -1);
+    CsvScanner scanner;
+    csv_scanner_init(&scanner, csv->str, csv->len, FALSE);
+    for (int i = 0; lines[i][0]; i++) {
+        CsvField fields[8];
+        guint n = csv_scanner_next(&scanner, fields, 8);
+        g_assert_cmpuint(n, >=, 6);
+
+        gchar *ts, *status, *title, *wm_class, *wm_instance, *rps, *rpd;
+        long duration, scanned;
+        gboolean ok = parse_csv_line(lines[i], &ts, &duration, &status, &title,
+                                     &wm_class, &wm_instance, &rps, &rpd);
+        g_assert_cmpint(ok, ==, csv_field_to_long(&fields[1], &scanned));
+        if (!ok)
+            continue;  /* the header */
+
+        const gchar *expected[] = {ts, NULL, status, title, wm_class,
+                                   wm_instance, rps, rpd};
+        g_assert_cmpint(scanned, ==, duration);
+        for (guint f = 0; f < G_N_ELEMENTS(expected); f++) {
+            if (f == 1)
+                continue;
+            gchar *got = f < n ? field_str(&fields[f]) : g_strdup("");
+            g_assert_cmpstr(got, ==, expected[f]);
+            g_free(got);
+        }
+        g_free(ts); g_free(status); g_free(title);
+        g_free(wm_class); g_free(wm_instance); g_free(rps); g_free(rpd);
+    }
+    g_assert_cmpuint(csv_scanner_next(&scanner, NULL, 0), ==, 0);
+
+    g_strfreev(lines);
+    g_string_free(csv, TRUE);
+}
+
+static void test_stats_skip_record_being_written(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("csv-scan-test-XXXXXX", NULL);
+    gchar *path = g_build_filename(tmpdir, "day.csv", NULL);
+    const gchar *complete = CSV_HEADER
+        "2026-01-28T12:00:00+0100,100,active,\"Doc\",app,app,\"\",\"\"\n";
+    gchar *contents = g_strconcat(complete,
+                                  "2026-01-28T12:01:40+0100,50,active,\"Do", NULL);
+    g_assert_true(g_file_set_contents(path, contents, -1, NULL));
+
+    DayStats *stats = compute_day_stats(path);
+    g_assert_nonnull(stats);
+    g_assert_cmpint(stats->total_active_seconds, ==, 100);
+    g_assert_cmpuint(stats->apps->len, ==, 1);
+    free_day_stats(stats);
+
+    /* An empty file maps to nothing */
+    g_assert_true(g_file_set_contents(path, "", 0, NULL));
+    stats = compute_day_stats(path);
+    g_assert_nonnull(stats);
+    g_assert_cmpuint(stats->apps->len, ==, 0);
+    free_day_stats(stats);
+
+    unlink(path);
+    rmdir(tmpdir);
+    g_free(contents);
+    g_free(path);
+    g_free(tmpdir);
+}
+
+static void test_kernels_agree(void)
+{
+    /* Runs of quotes, delimiters and multibyte UTF-8 placed so that they
+     * straddle the 64 byte blocks at every offset */
+    static const gchar *const pieces[] = {
+        "\"", "\"\"", ",", "\n", "\r\n", "a", "žluť", "😀", "\xff\x80",
+        "\",\"", "\"\n\"",
+    };
+    CsvScanKernel saved = csv_scan_get_kernel();
+    GRand *rand = g_rand_new_with_seed(12);
+    GString *buf = g_string_new(NULL);
+    /* Unaligned starts inside one allocation */
+    gchar *copy = g_malloc(1024 + 64);
+
+    for (int round = 0; round < 400; round++) {
+        g_string_truncate(buf, 0);
+        gsize target = g_rand_int_range(rand, 0, 1024);
+        while (buf->len < target)
+            g_string_append(buf, pieces[g_rand_int_range(rand, 0,
+                                                         G_N_ELEMENTS(pieces))]);
+        g_string_truncate(buf, target);
+        gsize shift = round % 64;
+        memcpy(copy + shift, buf->str, buf->len);
+
+        for (int complete = 0; complete <= 1; complete++) {
+            GArray *expected = scan_all(CSV_SCAN_SCALAR, copy + shift,
+                                        buf->len, complete);
+            for (CsvScanKernel k = CSV_SCAN_SSE2; k <= CSV_SCAN_AVX2; k++) {
+                if (!csv_scan_kernel_supported(k))
+                    continue;
+                GArray *got = scan_all(k, copy + shift, buf->len, complete);
+                assert_same_scan(expected, got);
+                g_array_unref(got);
+            }
+            g_array_unref(expected);
+        }
+    }
+
+    g_free(copy);
+    g_string_free(buf, TRUE);
+    g_rand_free(rand);
+    g_assert_true(csv_scan_set_kernel(saved));
+}
+
+static void test_kernels_long_fields(void)
+{
+    /* A quoted field spanning several blocks, with a doubled quote far
+     * from its ends, then fields ending exactly on block boundaries */
+    GString *data = g_string_new("\"");
+    g_string_append_printf(data, "%0150d", 0);
+    g_string_append(data, "\"\"ž,\n\"\n");
+    g_string_append_printf(data, "%0100d,\n", 0);
+    while ((data->len + 1) % 64)
+        g_string_append_c(data, 'x');
+    g_string_append(data, ",");
+    g_string_append_printf(data, "%063d\n", 0);
+
+    CsvScanKernel saved = csv_scan_get_kernel();
+    for (CsvScanKernel k = CSV_SCAN_SCALAR; k <= CSV_SCAN_AVX2; k++) {
+        if (!csv_scan_kernel_supported(k))
+            continue;
+        g_assert_true(csv_scan_set_kernel(k));
+        CsvScanner scanner;
+        CsvField fields[4];
+        csv_scanner_init(&scanner, data->str, data->len, FALSE);
+
+        g_assert_cmpuint(csv_scanner_next(&scanner, fields, 4), ==, 1);
+        g_assert_true(fields[0].escaped);
+        gchar *field = field_str(&fields[0]);
+        g_assert_cmpuint(strlen(field), ==, 150 + strlen("\"ž,\n"));
+        g_assert_true(g_str_has_suffix(field, "0\"ž,\n"));
+        g_free(field);
+
+        g_assert_cmpuint(csv_scanner_next(&scanner, fields, 4), ==, 2);
+        g_assert_cmpuint(fields[0].len, ==, 100);
+        g_assert_cmpuint(fields[1].len, ==, 0);
+        g_assert_cmpuint(csv_scanner_next(&scanner, fields, 4), ==, 2);
+        g_assert_cmpuint((fields[0].ptr - data->str + fields[0].len) % 64, ==, 63);
+        g_assert_cmpuint(fields[1].len, ==, 63);
+        g_assert_cmpuint(csv_scanner_next(&scanner, fields, 4), ==, 0);
+        g_assert_cmpuint(scanner.pos, ==, data->len);
+    }
+    g_assert_true(csv_scan_set_kernel(saved));
+    g_string_free(data, TRUE);
+}
+
+static void test_parallel_stats_match_serial(void)
+{
+    /* Titles with newlines, commas and quotes, so that most even cuts
+     * land inside a quoted field */
+    GString *csv = g_string_new(CSV_HEADER);
+    TimestampCache cache = {0};
+    GRand *rand = g_rand_new_with_seed(3);
+    for (int i = 0; i < 3000; i++) {
+        gchar title[256], wm_class[32];
+        int doc = g_rand_int_range(rand, 0, 60);
+        g_snprintf(wm_class, sizeof(wm_class), "app%d", doc % 7);
+        g_snprintf(title, sizeof(title), "Doc %d,\n\"%s\"\n%s", doc,
+                   doc % 3 ? "x" : "žluť\n\n", doc % 2 ? "😀" : "\"\"");
+        gboolean locked = doc % 11 == 0;
+        CsvRecord rec = {1769598000 + i, g_rand_int_range(rand, 1, 90),
+                         locked ? "locked" : "active", doc % 13 ? title : "",
+                         wm_class, wm_class, doc % 4 ? "" : "Editing",
+                         doc % 5 ? "" : title};
+        serialize_csv_record(csv, &rec, &cache);
+    }
+    g_rand_free(rand);
+    /* The tracker is part way through the next record */
+    g_string_append(csv, "2026-01-28T23:59:00+0100,40,active,\"half\nwri");
+
+    DayStats *serial = compute_csv_stats(csv->str, csv->len, 1, 1, NULL);
+    gchar *expected = report_to_string(serial);
+    g_assert_cmpint(serial->total_active_seconds, >, 0);
+
+    static const guint threads[] = {2, 3, 4, 7, 16, 64};
+    static const gsize min_chunks[] = {1, 1000, 65536};
+    for (gsize t = 0; t < G_N_ELEMENTS(threads); t++) {
+        for (gsize c = 0; c < G_N_ELEMENTS(min_chunks); c++) {
+            DayStats *stats = compute_csv_stats(csv->str, csv->len, threads[t],
+                                                min_chunks[c], NULL);
+            g_assert_cmpint(stats->total_active_seconds, ==,
+                            serial->total_active_seconds);
+            g_assert_cmpint(stats->total_locked_seconds, ==,
+                            serial->total_locked_seconds);
+            g_assert_cmpint(stats->total_afk_active_seconds, ==,
+                            serial->total_afk_active_seconds);
+            gchar *report = report_to_string(stats);
+            g_assert_cmpstr(report, ==, expected);
+            g_free(report);
+            free_day_stats(stats);
+        }
+    }
+
+    g_free(expected);
+    free_day_stats(serial);
+    g_string_free(csv, TRUE);
+}
+
+static void test_parallel_stats_one_long_field(void)
+{
+    /* Every cut falls inside one quoted field full of newlines: all but
+     * one piece end up empty */
+    GString *csv = g_string_new(CSV_HEADER "2026-01-28T12:00:00+0100,7,active,\"");
+    for (int i = 0; i < 2000; i++)
+        g_string_append(csv, "line\n\"\"");
+    g_string_append(csv, "\",app,app,\"\",\"\"\n"
+                    "2026-01-28T12:00:07+0100,5,active,\"b\",app,app,,\n");
+
+    for (guint threads = 1; threads <= 8; threads++) {
+        DayStats *stats = compute_csv_stats(csv->str, csv->len, threads, 1, NULL);
+        g_assert_cmpint(stats->total_active_seconds, ==, 12);
+        g_assert_cmpuint(stats->apps->len, ==, 1);
+        AppStat *app = g_ptr_array_index(stats->apps, 0);
+        g_assert_cmpuint(app->n_titles, ==, 2);
+        free_day_stats(stats);
+    }
+    g_string_free(csv, TRUE);
+}
+
+static void test_quote_parity_and_record_start(void)
+{
+    /* Records end at offsets 13 and 15; the first newline is quoted */
+    static const gchar data[] = "a,\"x\ny\",\"\"\"\"\nb\n";
+    gsize len = strlen(data);
+    CsvScanKernel saved = csv_scan_get_kernel();
+    for (CsvScanKernel k = CSV_SCAN_SCALAR; k <= CSV_SCAN_AVX2; k++) {
+        if (!csv_scan_set_kernel(k))
+            continue;
+        for (gsize cut = 0; cut <= len; cut++) {
+            guint quotes = 0;
+            for (gsize i = 0; i < cut; i++)
+                quotes += data[i] == '"';
+            g_assert_cmpint(csv_scan_quotes_odd(data, cut), ==, quotes % 2);
+
+            gsize start = csv_scan_record_start(data, len, cut, quotes % 2);
+            g_assert_cmpuint(start, ==, cut <= 12 ? 13 : len);
+        }
+    }
+    g_assert_true(csv_scan_set_kernel(saved));
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+/* A heavy day: 20k records over a few hundred titles */
+static GString *heavy_day(void)
+{
+    GString *csv = g_string_new(CSV_HEADER);
+    TimestampCache cache = {0};
+    GRand *rand = g_rand_new_with_seed(7);
+    time_t t = 1769583600;
+    for (int i = 0; i < 20000; i++) {
+        gchar title[128], wm_class[64];
+        int doc = (int)(g_rand_double(rand) * g_rand_double(rand) * 400);
+        g_snprintf(wm_class, sizeof(wm_class), "org.example.Application%d",
+                   doc % 40);
+        g_snprintf(title, sizeof(title), "Document %d - \"Project %d\" - "
+                   "Application %d", doc, doc % 17, doc % 40);
+        CsvRecord rec = {t, g_rand_int_range(rand, 1, 30), "active", title,
+                         wm_class, wm_class + 12, doc % 5 ? "" : "Editing",
+                         doc % 5 ? "" : title};
+        t += rec.duration;
+        serialize_csv_record(csv, &rec, &cache);
+    }
+    g_rand_free(rand);
+    return csv;
+}
+
+static void test_perf_scan(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    GString *csv = heavy_day();
+    gchar *tmpdir = g_dir_make_tmp("csv-scan-test-XXXXXX", NULL);
+    gchar *path = g_build_filename(tmpdir, "day.csv", NULL);
+    g_assert_true(g_file_set_contents(path, csv->str, csv->len, NULL));
+    const int rounds = 20;
+
+    /* What compute_day_stats did before: read, split, parse every field */
+    long old_sum = 0;
+    g_test_timer_start();
+    for (int r = 0; r < rounds; r++) {
+        gchar *contents;
+        g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+        gchar **lines = g_strsplit(contents, "\n", -1);
+        for (int i = 0; lines[i]; i++) {
+            gchar *ts, *status, *title, *wm_class, *wm_instance, *rps, *rpd;
+            long duration;
+            if (!lines[i][0] ||
+                !parse_csv_line(lines[i], &ts, &duration, &status, &title,
+                                &wm_class, &wm_instance, &rps, &rpd))
+                continue;
+            old_sum += duration + strlen(title);
+            g_free(ts); g_free(status); g_free(title);
+            g_free(wm_class); g_free(wm_instance); g_free(rps); g_free(rpd);
+        }
+        g_strfreev(lines);
+        g_free(contents);
+    }
+    double old_time = g_test_timer_elapsed() / rounds;
+
+    long new_sum = 0;
+    g_test_timer_start();
+    for (int r = 0; r < rounds; r++) {
+        GMappedFile *file = g_mapped_file_new(path, FALSE, NULL);
+        g_assert_nonnull(file);
+        CsvScanner scanner;
+        CsvField fields[8];
+        GString *scratch = g_string_new(NULL);
+        guint n;
+        csv_scanner_init(&scanner, g_mapped_file_get_contents(file),
+                         g_mapped_file_get_length(file), FALSE);
+        while ((n = csv_scanner_next(&scanner, fields, 8))) {
+            long duration;
+            if (n < 4 || !csv_field_to_long(&fields[1], &duration))
+                continue;
+            /* Titles are quoted, so count them as the old parser does */
+            g_string_truncate(scratch, 0);
+            csv_field_append(scratch, &fields[3]);
+            new_sum += duration + scratch->len;
+        }
+        g_string_free(scratch, TRUE);
+        g_mapped_file_unref(file);
+    }
+    double new_time = g_test_timer_elapsed() / rounds;
+    g_assert_cmpint(new_sum, ==, old_sum);
+
+    g_test_timer_start();
+    for (int r = 0; r < rounds; r++)
+        free_day_stats(compute_day_stats(path));
+    double stats_time = g_test_timer_elapsed() / rounds;
+
+    g_test_message("20000 records, %.1f MiB: parse_csv_line %.2f ms, "
+                   "mapped scanner %.2f ms (%.1fx); compute_day_stats %.2f ms",
+                   csv->len / 1048576.0, old_time * 1e3, new_time * 1e3,
+                   old_time / new_time, stats_time * 1e3);
+    g_test_minimized_result(new_time, "scan of a 20000 record day: %.2f ms",
+                            new_time * 1e3);
+
+    unlink(path);
+    rmdir(tmpdir);
+    g_free(path);
+    g_free(tmpdir);
+    g_string_free(csv, TRUE);
+}
+
+static void test_perf_kernels(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    GString *csv = heavy_day();
+    CsvScanKernel saved = csv_scan_get_kernel();
+    const int rounds = 50;
+    for (CsvScanKernel k = CSV_SCAN_SCALAR; k <= CSV_SCAN_AVX2; k++) {
+        if (!csv_scan_set_kernel(k))
+            continue;
+        guint records = 0;
+        CsvScanner scanner;
+        CsvField fields[8];
+        g_test_timer_start();
+        for (int r = 0; r < rounds; r++) {
+            csv_scanner_init(&scanner, csv->str, csv->len, FALSE);
+            while (csv_scanner_next(&scanner, fields, 8))
+                records++;
+        }
+        double elapsed = g_test_timer_elapsed() / rounds;
+        g_assert_cmpuint(records, ==, 20001 * rounds);
+        g_test_message("%s kernel: %.2f ms, %.0f MiB/s%s",
+                       csv_scan_kernel_name(k), elapsed * 1e3,
+                       csv->len / 1048576.0 / elapsed,
+                       k == saved ? " (picked for this CPU)" : "");
+        g_test_minimized_result(elapsed, "%s scan of a 20000 record day: %.2f ms",
+                                csv_scan_kernel_name(k), elapsed * 1e3);
+    }
+    g_assert_true(csv_scan_set_kernel(saved));
+    g_string_free(csv, TRUE);
+}
+
+static void test_perf_parallel_stats(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    /* A kiosk seat's day: ten heavy days back to back */
+    GString *day = heavy_day();
+    GString *csv = g_string_sized_new(day->len * 10);
+    for (int i = 0; i < 10; i++)
+        g_string_append_len(csv, day->str, day->len);
+    g_string_free(day, TRUE);
+
+    guint cpus = g_get_num_processors();
+    gchar *expected = NULL;
+    double single = 0;
+    for (guint threads = 1; threads <= MAX(cpus, 4); threads *= 2) {
+        g_test_timer_start();
+        DayStats *stats = compute_csv_stats(csv->str, csv->len, threads,
+                                            CSV_STATS_MIN_CHUNK, NULL);
+        double elapsed = g_test_timer_elapsed();
+        gchar *report = report_to_string(stats);
+        free_day_stats(stats);
+        if (!expected)
+            expected = report;
+        else {
+            g_assert_cmpstr(report, ==, expected);
+            g_free(report);
+        }
+
+        if (threads == 1)
+            single = elapsed;
+        g_test_message("200000 records, %.0f MiB, %u thread%s: %.1f ms "
+                       "(%.2fx, %u processors)", csv->len / 1048576.0, threads,
+                       threads == 1 ? "" : "s", elapsed * 1e3,
+                       single / elapsed, cpus);
+        g_test_minimized_result(elapsed, "200000 records on %u threads: %.1f ms",
+                                threads, elapsed * 1e3);
+    }
+    g_free(expected);
+    g_string_free(csv, TRUE);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/csv-scan/fields", test_fields);
+    g_test_add_func("/csv-scan/field_to_long", test_field_to_long);
+    g_test_add_func("/csv-scan/quoted_newline", test_quoted_newline);
+    g_test_add_func("/csv-scan/partial_last_line", test_partial_last_line);
+    g_test_add_func("/csv-scan/matches_parse_csv_line", test_matches_parse_csv_line);
+    g_test_add_func("/csv-scan/stats_skip_record_being_written",
+                    test_stats_skip_record_being_written);
+    g_test_add_func("/csv-scan/kernels_agree", test_kernels_agree);
+    g_test_add_func("/csv-scan/kernels_long_fields", test_kernels_long_fields);
+    g_test_add_func("/csv-scan/quote_parity_and_record_start",
+                    test_quote_parity_and_record_start);
+    g_test_add_func("/csv-scan/parallel_stats_match_serial",
+                    test_parallel_stats_match_serial);
+    g_test_add_func("/csv-scan/parallel_stats_one_long_field",
+                    test_parallel_stats_one_long_field);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/csv_scan", test_perf_scan);
+    g_test_add_func("/perf/csv_scan_kernels", test_perf_kernels);
+    g_test_add_func("/perf/csv_stats_parallel", test_perf_parallel_stats);
+
+    return g_test_run();
+}
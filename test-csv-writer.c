@@ -0,0 +1,297 @@
+#include <glib.h>
+#include "csv-writer.h"
+#include <string.h>
+#include <time.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("csv-writer-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+static time_t test_time(int mday, int hour)
+{
+    struct tm tm = {0};
+    tm.tm_year = 126;
+    tm.tm_mon = 0;
+    tm.tm_mday = mday;
+    tm.tm_hour = hour;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+static void push_numbered(CsvWriter *writer, time_t wall, int n)
+{
+    gchar *title = g_strdup_printf("Window %d", n);
+    CsvRecord rec = {
+        .wall = wall, .duration = n, .status = "active",
+        .title = title, .wm_class = "App", .wm_class_instance = "app",
+        .rp_state = "", .rp_details = "",
+    };
+    csv_writer_push(writer, &rec);
+    g_free(title);
+}
+
+/* Lines of a day file without the header and the trailing empty string */
+static gchar **read_records(const gchar *dir, int mday)
+{
+    gchar *path = build_csv_path(dir, 2026, 1, mday);
+    gchar *contents = NULL;
+    g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+    g_assert_true(g_str_has_prefix(contents, "timestamp,"));
+    g_assert_true(g_str_has_suffix(contents, "\n"));
+    contents[strlen(contents) - 1] = '\0';
+    gchar **lines = g_strsplit(strchr(contents, '\n') ? strchr(contents, '\n') + 1 : "",
+                               "\n", -1);
+    g_free(contents);
+    g_free(path);
+    return lines;
+}
+
+static void assert_numbered(gchar **lines, int count)
+{
+    g_assert_cmpuint(g_strv_length(lines), ==, (guint)count);
+    for (int i = 0; i < count; i++) {
+        gchar *expected = g_strdup_printf(",%d,active,\"Window %d\",", i, i);
+        if (!strstr(lines[i], expected))
+            g_error("line %d out of order: %s", i, lines[i]);
+        g_free(expected);
+    }
+}
+
+/* ── Tests ─────────────────────────────────────────── */
+
+static void test_writes_in_order(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState config = {0};
+    config.data_dir = tmpdir;
+    config.durability = DURABILITY_ROTATION;
+    time_t t = test_time(28, 12);
+
+    CsvWriter *writer = csv_writer_new(&config, t, 64);
+    g_assert_nonnull(writer);
+    csv_writer_start(writer);
+    for (int i = 0; i < 5000; i++)
+        push_numbered(writer, t, i);
+
+    CsvWriterStats stats;
+    csv_writer_get_stats(writer, &stats);
+    g_assert_cmpuint(stats.pushed, ==, 5000);
+    g_assert_cmpuint(stats.max_depth, <=, 64);
+    csv_writer_free(writer);
+
+    gchar **lines = read_records(tmpdir, 28);
+    assert_numbered(lines, 5000);
+    g_strfreev(lines);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_overflow_keeps_order(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState config = {0};
+    config.data_dir = tmpdir;
+    time_t t = test_time(28, 12);
+
+    /* Thread not running yet: the ring fills and the rest overflows */
+    CsvWriter *writer = csv_writer_new(&config, t, 4);
+    for (int i = 0; i < 100; i++)
+        push_numbered(writer, t, i);
+
+    CsvWriterStats stats;
+    csv_writer_get_stats(writer, &stats);
+    g_assert_cmpuint(stats.pushed, ==, 100);
+    g_assert_cmpuint(stats.overflowed, ==, 96);
+    g_assert_cmpuint(stats.written, ==, 0);
+    g_assert_cmpuint(stats.max_depth, ==, 4);
+
+    /* The retry source moves overflow into the ring as it drains */
+    csv_writer_start(writer);
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    do {
+        g_main_context_iteration(NULL, FALSE);
+        csv_writer_get_stats(writer, &stats);
+    } while (stats.written < 100 && g_get_monotonic_time() < deadline);
+    g_assert_cmpuint(stats.written, ==, 100);
+    csv_writer_free(writer);
+
+    gchar **lines = read_records(tmpdir, 28);
+    assert_numbered(lines, 100);
+    g_strfreev(lines);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_free_drains_everything(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState config = {0};
+    config.data_dir = tmpdir;
+    time_t t = test_time(28, 12);
+
+    /* Overflowing pushes right before shutdown must not be lost */
+    CsvWriter *writer = csv_writer_new(&config, t, 8);
+    csv_writer_start(writer);
+    for (int i = 0; i < 500; i++)
+        push_numbered(writer, t, i);
+    csv_writer_free(writer);
+
+    gchar **lines = read_records(tmpdir, 28);
+    assert_numbered(lines, 500);
+    g_strfreev(lines);
+
+    /* Same without the thread ever starting */
+    writer = csv_writer_new(&config, t, 8);
+    for (int i = 500; i < 520; i++)
+        push_numbered(writer, t, i);
+    csv_writer_free(writer);
+
+    lines = read_records(tmpdir, 28);
+    g_assert_cmpuint(g_strv_length(lines), ==, 520);
+    g_assert_nonnull(strstr(lines[519], "\"Window 519\""));
+    g_strfreev(lines);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_rotation_on_writer_thread(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState config = {0};
+    config.data_dir = tmpdir;
+
+    CsvWriter *writer = csv_writer_new(&config, test_time(28, 23), 16);
+    csv_writer_start(writer);
+    push_numbered(writer, test_time(28, 23), 0);
+    push_numbered(writer, test_time(29, 0), 0);
+    push_numbered(writer, test_time(29, 1), 1);
+    csv_writer_free(writer);
+
+    gchar **day1 = read_records(tmpdir, 28);
+    gchar **day2 = read_records(tmpdir, 29);
+    assert_numbered(day1, 1);
+    assert_numbered(day2, 2);
+    g_strfreev(day1);
+    g_strfreev(day2);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_emit_through_sink(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    time_t t = test_time(28, 12);
+
+    CsvWriter *writer = csv_writer_new(&state, t, 16);
+    state.record_sink = csv_writer_sink;
+    state.record_sink_data = writer;
+    csv_writer_start(writer);
+
+    state.current_title = g_strdup("Editor");
+    state.current_wm_class = g_strdup("Code");
+    state.current_wall = t;
+    state.current_start = g_get_monotonic_time() - 3 * G_USEC_PER_SEC;
+    emit_csv_line(&state);
+
+    /* Nothing is written on the calling thread */
+    g_assert_cmpint(state.file_day, ==, 0);
+    csv_writer_free(writer);
+
+    gchar **lines = read_records(tmpdir, 28);
+    g_assert_cmpuint(g_strv_length(lines), ==, 1);
+    g_assert_nonnull(strstr(lines[0], ",3,active,\"Editor\",\"Code\","));
+    g_strfreev(lines);
+
+    g_free(state.current_title);
+    g_free(state.current_wm_class);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_new_fails_on_bad_dir(void)
+{
+    AppState config = {0};
+    config.data_dir = "/proc/activity-tracker-test";
+    g_assert_null(csv_writer_new(&config, test_time(28, 12), 16));
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+static void test_perf_push_vs_inline(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;  /* strict: fsync per record */
+    time_t t = test_time(28, 12);
+    const int n = 500;
+
+    CsvRecord rec = {
+        .wall = t, .duration = 1, .status = "active",
+        .title = "Benchmark window", .wm_class = "App",
+        .wm_class_instance = "app", .rp_state = "", .rp_details = "",
+    };
+
+    double worst_inline = 0;
+    g_test_timer_start();
+    for (int i = 0; i < n; i++) {
+        double before = g_test_timer_elapsed();
+        write_csv_record(&state, &rec);
+        worst_inline = MAX(worst_inline, g_test_timer_elapsed() - before);
+    }
+    double inline_total = g_test_timer_elapsed();
+    close_output_file(&state);
+
+    CsvWriter *writer = csv_writer_new(&state, t, CSV_WRITER_DEFAULT_CAPACITY);
+    csv_writer_start(writer);
+    double worst_push = 0;
+    g_test_timer_start();
+    for (int i = 0; i < n; i++) {
+        double before = g_test_timer_elapsed();
+        csv_writer_push(writer, &rec);
+        worst_push = MAX(worst_push, g_test_timer_elapsed() - before);
+    }
+    double push_total = g_test_timer_elapsed();
+    csv_writer_free(writer);
+
+    g_test_message("strict fsync, %d records: inline %.1f us/record (worst %.1f us), "
+                   "push %.2f us/record (worst %.1f us)",
+                   n, inline_total / n * 1e6, worst_inline * 1e6,
+                   push_total / n * 1e6, worst_push * 1e6);
+    g_test_minimized_result(push_total / n, "csv_writer_push: %.2f us",
+                            push_total / n * 1e6);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/csv-writer/writes_in_order", test_writes_in_order);
+    g_test_add_func("/csv-writer/overflow_keeps_order", test_overflow_keeps_order);
+    g_test_add_func("/csv-writer/free_drains_everything", test_free_drains_everything);
+    g_test_add_func("/csv-writer/rotation_on_writer_thread", test_rotation_on_writer_thread);
+    g_test_add_func("/csv-writer/emit_through_sink", test_emit_through_sink);
+    g_test_add_func("/csv-writer/new_fails_on_bad_dir", test_new_fails_on_bad_dir);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/csv_writer_push", test_perf_push_vs_inline);
+
+    return g_test_run();
+}
@@ -0,0 +1,466 @@
+#include <glib.h>
+#include "day-archive.h"
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("day-archive-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+static time_t test_time(int mday, int hour, int min)
+{
+    struct tm tm = {0};
+    tm.tm_year = 126;
+    tm.tm_mon = 0;
+    tm.tm_mday = mday;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+static void write_day(AppState *state, int mday)
+{
+    static const CsvRecord sample[] = {
+        {0, 120, "active", "Main.java - \"app\" - IntelliJ IDEA",
+         "jetbrains-idea", "jetbrains-idea", "Editing Main.java", "app"},
+        {0, 30, "active", "Inbox - Mail", "Thunderbird", "Mail", "", ""},
+        {0, 600, "locked", "", "", "", "", ""},
+        {0, 300, "idle", "", "", "", "", ""},
+        {0, 60, "active", "Příliš žluťoučký kůň", "org.gnome.TextEditor",
+         "gnome-text-editor", "", ""},
+    };
+    for (gsize i = 0; i < G_N_ELEMENTS(sample); i++) {
+        CsvRecord rec = sample[i];
+        rec.wall = test_time(mday, 12, (int)i * 15);
+        write_csv_record(state, &rec);
+    }
+}
+
+static gchar *day_path(const gchar *dir, int mday)
+{
+    return build_csv_path(dir, 2026, 1, mday);
+}
+
+static gchar *gz_path_of(const gchar *csv_path)
+{
+    return g_strconcat(csv_path, DAY_ARCHIVE_SUFFIX, NULL);
+}
+
+static void assert_stats_equal(const DayStats *a, const DayStats *b)
+{
+    g_assert_cmpint(a->total_active_seconds, ==, b->total_active_seconds);
+    g_assert_cmpint(a->total_locked_seconds, ==, b->total_locked_seconds);
+    g_assert_cmpint(a->total_afk_active_seconds, ==, b->total_afk_active_seconds);
+    g_assert_cmpuint(a->apps->len, ==, b->apps->len);
+    for (guint i = 0; i < a->apps->len; i++) {
+        AppStat *x = g_ptr_array_index(a->apps, i);
+        AppStat *y = g_ptr_array_index(b->apps, i);
+        g_assert_cmpstr(x->wm_class, ==, y->wm_class);
+        g_assert_cmpint(x->total_seconds, ==, y->total_seconds);
+        g_assert_cmpuint(x->n_titles, ==, y->n_titles);
+    }
+}
+
+static void collect_line(gchar *line, gpointer user_data)
+{
+    g_ptr_array_add(user_data, g_strdup(line));
+}
+
+static GPtrArray *read_lines(const gchar *path)
+{
+    GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+    GError *error = NULL;
+    g_assert_true(day_archive_foreach_line(path, collect_line, lines, &error));
+    g_assert_no_error(error);
+    return lines;
+}
+
+/* ── Tests ─────────────────────────────────────────── */
+
+static void test_compress_roundtrip(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+    write_day(&state, 28);
+    close_output_file(&state);
+
+    gchar *csv_path = day_path(tmpdir, 28);
+    gchar *gz_path = gz_path_of(csv_path);
+    gchar *original = NULL;
+    g_assert_true(g_file_get_contents(csv_path, &original, NULL, NULL));
+    DayStats *plain = compute_day_stats(csv_path);
+    g_assert_nonnull(plain);
+
+    GError *error = NULL;
+    g_assert_true(day_archive_compress(csv_path, &error));
+    g_assert_no_error(error);
+    g_assert_false(g_file_test(csv_path, G_FILE_TEST_EXISTS));
+    g_assert_true(g_file_test(gz_path, G_FILE_TEST_EXISTS));
+
+    /* Same lines, same report */
+    GPtrArray *lines = read_lines(gz_path);
+    gchar **expected = g_strsplit(original, "\n", -1);
+    g_assert_cmpuint(lines->len, ==, g_strv_length(expected) - 1);
+    for (guint i = 0; i < lines->len; i++)
+        g_assert_cmpstr(g_ptr_array_index(lines, i), ==, expected[i]);
+
+    DayStats *compressed = compute_day_stats(gz_path);
+    g_assert_nonnull(compressed);
+    assert_stats_equal(compressed, plain);
+
+    g_strfreev(expected);
+    g_ptr_array_unref(lines);
+    free_day_stats(plain);
+    free_day_stats(compressed);
+    g_free(original);
+    g_free(gz_path);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_multiline_title_compressed(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+
+    /* Titles holding newlines, in a day long enough that some records
+     * straddle the chunks the archive is read in */
+    long expected = 0;
+    for (int i = 0; i < 4000; i++) {
+        gchar *title = g_strdup_printf("Draft %d\nsecond line\n\"quoted\"",
+                                       i % 7);
+        CsvRecord rec = {test_time(28, 8, 0) + i * 5, 5, "active", title,
+                         "gedit", "gedit", "", ""};
+        write_csv_record(&state, &rec);
+        expected += rec.duration;
+        g_free(title);
+    }
+    close_output_file(&state);
+
+    gchar *csv_path = day_path(tmpdir, 28);
+    gchar *gz_path = gz_path_of(csv_path);
+    DayStats *plain = compute_day_stats(csv_path);
+    g_assert_nonnull(plain);
+    g_assert_cmpint(plain->total_active_seconds, ==, expected);
+
+    GError *error = NULL;
+    g_assert_true(day_archive_compress(csv_path, &error));
+    g_assert_no_error(error);
+    DayStats *compressed = compute_day_stats(gz_path);
+    g_assert_nonnull(compressed);
+    assert_stats_equal(compressed, plain);
+
+    AppStat *app = g_ptr_array_index(compressed->apps, 0);
+    g_assert_cmpstr(app->wm_class, ==, "gedit");
+    g_assert_cmpuint(app->n_titles, ==, 7);
+    for (TitleStat *t = app->titles; t; t = t->next)
+        g_assert_true(g_str_has_suffix(t->title, "\nsecond line\n\"quoted\""));
+
+    free_day_stats(plain);
+    free_day_stats(compressed);
+    g_free(gz_path);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_find_prefers_plain(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *csv_path = day_path(tmpdir, 28);
+    gchar *gz_path = gz_path_of(csv_path);
+    gchar *dir = g_path_get_dirname(csv_path);
+    g_assert_cmpint(g_mkdir_with_parents(dir, 0700), ==, 0);
+
+    g_assert_null(day_archive_find(csv_path));
+
+    g_assert_true(g_file_set_contents(gz_path, "", 0, NULL));
+    gchar *found = day_archive_find(csv_path);
+    g_assert_cmpstr(found, ==, gz_path);
+    g_free(found);
+
+    /* Compression was interrupted before the original was removed */
+    g_assert_true(g_file_set_contents(csv_path, CSV_HEADER, -1, NULL));
+    found = day_archive_find(csv_path);
+    g_assert_cmpstr(found, ==, csv_path);
+    g_free(found);
+
+    g_free(dir);
+    g_free(gz_path);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_rotation_compresses_closed_day(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+    state.compress_closed = TRUE;
+    write_day(&state, 28);
+    g_assert_null(state.compress_thread);
+    write_day(&state, 29);
+    g_assert_nonnull(state.compress_thread);
+    close_output_file(&state);
+    g_assert_null(state.compress_thread);
+
+    gchar *closed = day_path(tmpdir, 28);
+    gchar *closed_gz = gz_path_of(closed);
+    gchar *current = day_path(tmpdir, 29);
+    gchar *current_gz = gz_path_of(current);
+    g_assert_false(g_file_test(closed, G_FILE_TEST_EXISTS));
+    g_assert_true(g_file_test(closed_gz, G_FILE_TEST_EXISTS));
+    /* Closing at shutdown is not a rotation */
+    g_assert_true(g_file_test(current, G_FILE_TEST_EXISTS));
+    g_assert_false(g_file_test(current_gz, G_FILE_TEST_EXISTS));
+
+    DayStats *a = compute_day_stats(closed_gz);
+    DayStats *b = compute_day_stats(current);
+    g_assert_nonnull(a);
+    g_assert_nonnull(b);
+    assert_stats_equal(a, b);
+
+    free_day_stats(a);
+    free_day_stats(b);
+    g_free(closed);
+    g_free(closed_gz);
+    g_free(current);
+    g_free(current_gz);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_reopen_restores_day(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+    write_day(&state, 28);
+    close_output_file(&state);
+
+    gchar *csv_path = day_path(tmpdir, 28);
+    gchar *gz_path = gz_path_of(csv_path);
+    GError *error = NULL;
+    g_assert_true(day_archive_compress(csv_path, &error));
+
+    /* The clock went back, or the tracker restarted into a compressed day */
+    CsvRecord rec = {test_time(28, 18, 0), 42, "active", "Late", "gedit",
+                     "gedit", "", ""};
+    write_csv_record(&state, &rec);
+    close_output_file(&state);
+    g_assert_false(g_file_test(gz_path, G_FILE_TEST_EXISTS));
+
+    GPtrArray *lines = read_lines(csv_path);
+    g_assert_cmpuint(lines->len, ==, 7);
+    g_assert_cmpstr(g_ptr_array_index(lines, 0), ==, "timestamp,duration_seconds,"
+                    "status,window_title,wm_class,wm_class_instance,rp_state,"
+                    "rp_details");
+    g_assert_true(strstr(g_ptr_array_index(lines, 6), ",42,active,\"Late\",") != NULL);
+
+    g_ptr_array_unref(lines);
+    g_free(gz_path);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_corrupt_archive_fails(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *gz_path = g_build_filename(tmpdir, "2026-01-28.csv.gz", NULL);
+    g_assert_true(g_file_set_contents(gz_path, "not gzip at all\n", -1, NULL));
+
+    g_assert_null(compute_day_stats(gz_path));
+
+    GError *error = NULL;
+    GPtrArray *lines = g_ptr_array_new_with_free_func(g_free);
+    g_assert_false(day_archive_foreach_line(gz_path, collect_line, lines, &error));
+    g_assert_nonnull(error);
+    g_error_free(error);
+    g_ptr_array_unref(lines);
+
+    g_free(gz_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_lines_across_chunks(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = g_build_filename(tmpdir, "lines.csv", NULL);
+
+    /* Lines of every length up to well past one read, the last one
+     * unterminated */
+    GString *contents = g_string_new(NULL);
+    GPtrArray *expected = g_ptr_array_new_with_free_func(g_free);
+    for (gsize len = 0; len < 200 * 1024; len = len * 2 + 7) {
+        gchar *line = g_strnfill(len, 'a' + expected->len % 26);
+        g_string_append(contents, line);
+        g_string_append_c(contents, '\n');
+        g_ptr_array_add(expected, line);
+    }
+    g_string_append(contents, "last");
+    g_ptr_array_add(expected, g_strdup("last"));
+    g_assert_true(g_file_set_contents(path, contents->str, contents->len, NULL));
+
+    GPtrArray *lines = read_lines(path);
+    g_assert_cmpuint(lines->len, ==, expected->len);
+    for (guint i = 0; i < lines->len; i++)
+        g_assert_cmpstr(g_ptr_array_index(lines, i), ==,
+                        g_ptr_array_index(expected, i));
+    g_ptr_array_unref(lines);
+
+    GError *error = NULL;
+    g_assert_true(day_archive_compress(path, &error));
+    gchar *gz_path = gz_path_of(path);
+    lines = read_lines(gz_path);
+    g_assert_cmpuint(lines->len, ==, expected->len);
+    for (guint i = 0; i < lines->len; i++)
+        g_assert_cmpstr(g_ptr_array_index(lines, i), ==,
+                        g_ptr_array_index(expected, i));
+    g_ptr_array_unref(lines);
+
+    g_ptr_array_unref(expected);
+    g_string_free(contents, TRUE);
+    g_free(gz_path);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+/* Drops the file from the page cache so the next read goes to disk */
+static void evict_from_cache(const gchar *path)
+{
+    int fd = open(path, O_RDONLY);
+    g_assert_cmpint(fd, >=, 0);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static double report_year(const gchar *dir, int days, goffset *bytes)
+{
+    double elapsed = 0;
+    *bytes = 0;
+    for (int d = 0; d < days; d++) {
+        time_t t = test_time(1 + d, 12, 0);
+        struct tm day;
+        localtime_r(&t, &day);
+        gchar *csv_path = build_csv_path(dir, day.tm_year + 1900,
+                                         day.tm_mon + 1, day.tm_mday);
+        gchar *path = day_archive_find(csv_path);
+        g_assert_nonnull(path);
+
+        struct stat st;
+        g_assert_cmpint(stat(path, &st), ==, 0);
+        *bytes += st.st_size;
+        evict_from_cache(path);
+
+        g_test_timer_start();
+        DayStats *stats = compute_day_stats(path);
+        elapsed += g_test_timer_elapsed();
+
+        g_assert_nonnull(stats);
+        free_day_stats(stats);
+        g_free(path);
+        g_free(csv_path);
+    }
+    return elapsed;
+}
+
+static void test_perf_year_report(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    const int days = 365, per_day = 400;
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+
+    GRand *rand = g_rand_new_with_seed(42);
+    for (int d = 0; d < days; d++) {
+        time_t t = test_time(1 + d, 8, 0);
+        for (int i = 0; i < per_day; i++) {
+            gchar title[128], wm_class[64];
+            int doc = (int)(g_rand_double(rand) * g_rand_double(rand) * 150);
+            g_snprintf(wm_class, sizeof(wm_class), "org.example.Application%d",
+                       doc % 40);
+            g_snprintf(title, sizeof(title), "Document %d - Project %d - "
+                       "Application %d", doc, doc % 17, doc % 40);
+            CsvRecord rec = {t, g_rand_int_range(rand, 1, 180), "active",
+                             title, wm_class, wm_class + 12, "", ""};
+            t += rec.duration;
+            write_csv_record(&state, &rec);
+        }
+    }
+    g_rand_free(rand);
+    close_output_file(&state);
+
+    goffset raw_bytes, gz_bytes;
+    double raw_time = report_year(tmpdir, days, &raw_bytes);
+
+    for (int d = 0; d < days; d++) {
+        time_t t = test_time(1 + d, 12, 0);
+        struct tm day;
+        localtime_r(&t, &day);
+        gchar *csv_path = build_csv_path(tmpdir, day.tm_year + 1900,
+                                         day.tm_mon + 1, day.tm_mday);
+        g_assert_true(day_archive_compress(csv_path, NULL));
+        g_free(csv_path);
+    }
+    double gz_time = report_year(tmpdir, days, &gz_bytes);
+
+    g_test_message("%d days x %d records, cold cache: raw %.1f MiB in %.3f s, "
+                   "gzip %.2f MiB in %.3f s (%.1fx smaller)",
+                   days, per_day, raw_bytes / 1048576.0, raw_time,
+                   gz_bytes / 1048576.0, gz_time,
+                   (double)raw_bytes / gz_bytes);
+    g_test_minimized_result(gz_time, "year report from compressed days: %.3f s",
+                            gz_time);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/day-archive/compress_roundtrip", test_compress_roundtrip);
+    g_test_add_func("/day-archive/multiline_title_compressed",
+                    test_multiline_title_compressed);
+    g_test_add_func("/day-archive/find_prefers_plain", test_find_prefers_plain);
+    g_test_add_func("/day-archive/rotation_compresses_closed_day",
+                    test_rotation_compresses_closed_day);
+    g_test_add_func("/day-archive/reopen_restores_day", test_reopen_restores_day);
+    g_test_add_func("/day-archive/corrupt_archive_fails", test_corrupt_archive_fails);
+    g_test_add_func("/day-archive/lines_across_chunks", test_lines_across_chunks);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/day_archive_year_report", test_perf_year_report);
+
+    return g_test_run();
+}
@@ -1,8 +1,15 @@
 #include <glib.h>
 #include "discord-ipc.h"
+#include "tracker-core.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <string.h>
 #include <sys/socket.h>
+#include <sys/syscall.h>
 #include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 
 /* ── Helper: build a Discord IPC frame ─────────────── */
@@ -346,16 +353,50 @@ static void test_presence_overwrite(void)
     state.presence_by_pid = g_hash_table_new_full(g_direct_hash, g_direct_equal,
                                                    NULL, NULL);
 
-    discord_presence_store(&state, 1234, "First", "project-a");
-    discord_presence_store(&state, 1234, "Second", "project-b");
+    g_assert_true(discord_presence_store(&state, 1234, "First", "project-a", 10));
+    const RichPresenceEntry *first = discord_ipc_lookup_pid(&state, 1234);
+    g_assert_true(discord_presence_store(&state, 1234, "Second", "project-b", 20));
 
+    /* The entry is updated in place */
     const RichPresenceEntry *found = discord_ipc_lookup_pid(&state, 1234);
-    g_assert_nonnull(found);
+    g_assert_true(found == first);
     g_assert_cmpstr(found->state, ==, "Second");
     g_assert_cmpstr(found->details, ==, "project-b");
+    g_assert_cmpint(found->last_updated, ==, 20);
+
+    /* Cleanup */
+    g_free(found->state);
+    g_free(found->details);
+    g_free((gpointer)found);
+    g_hash_table_destroy(state.presence_by_pid);
+}
+
+static void test_presence_repeated(void)
+{
+    DiscordIpcState state = {0};
+    state.presence_by_pid = g_hash_table_new_full(g_direct_hash, g_direct_equal,
+                                                   NULL, NULL);
+
+    g_assert_true(discord_presence_store(&state, 1234, "In menus", NULL, 10));
+    const RichPresenceEntry *found = discord_ipc_lookup_pid(&state, 1234);
+    const gchar *state_str = found->state;
+
+    /* Same content again, or "" for a missing field: nothing changes but
+     * the time, and nothing is allocated */
+    g_assert_false(discord_presence_store(&state, 1234, "In menus", "", 20));
+    g_assert_false(discord_presence_store(&state, 1234, "In menus", NULL, 30));
+    g_assert_true(discord_ipc_lookup_pid(&state, 1234) == found);
+    g_assert_true(found->state == state_str);
+    g_assert_null(found->details);
+    g_assert_cmpint(found->last_updated, ==, 30);
+    g_assert_true(discord_presence_matches(found, "In menus", ""));
+    g_assert_false(discord_presence_matches(found, "In game", NULL));
+
+    /* Only details change */
+    g_assert_true(discord_presence_store(&state, 1234, "In menus", "Lobby", 40));
+    g_assert_true(found->state == state_str);
+    g_assert_cmpstr(found->details, ==, "Lobby");
 
-    /* Cleanup: the first entry was leaked since we used NULL destroy.
-     * Use proper cleanup for this test */
     g_free(found->state);
     g_free(found->details);
     g_free((gpointer)found);
@@ -379,9 +420,9 @@ static void test_presence_multiple_pids(void)
     state.presence_by_pid = g_hash_table_new_full(g_direct_hash, g_direct_equal,
                                                    NULL, NULL);
 
-    discord_presence_store(&state, 100, "State-A", "Details-A");
-    discord_presence_store(&state, 200, "State-B", "Details-B");
-    discord_presence_store(&state, 300, "State-C", "Details-C");
+    discord_presence_store(&state, 100, "State-A", "Details-A", 10);
+    discord_presence_store(&state, 200, "State-B", "Details-B", 10);
+    discord_presence_store(&state, 300, "State-C", "Details-C", 10);
 
     const RichPresenceEntry *a = discord_ipc_lookup_pid(&state, 100);
     const RichPresenceEntry *b = discord_ipc_lookup_pid(&state, 200);
@@ -401,6 +442,1104 @@ static void test_presence_multiple_pids(void)
     g_hash_table_destroy(state.presence_by_pid);
 }
 
+/* ── Presence changes through the proxy ────────────── *
+ *
+ * A client talks to a proxy in passive mode, set up in a private
+ * XDG_RUNTIME_DIR, and its frames go through the same path as a game's. */
+
+typedef struct {
+    guint calls;
+    const RichPresenceEntry *entry;
+    gchar *states[8];
+    gint64 arrived[8];
+} PresenceRecorder;
+
+static void record_presence(const RichPresenceEntry *entry, gpointer user_data)
+{
+    PresenceRecorder *rec = user_data;
+    if (rec->calls < G_N_ELEMENTS(rec->states)) {
+        rec->states[rec->calls] = g_strdup(entry->state);
+        rec->arrived[rec->calls] = entry->last_updated;
+    }
+    rec->entry = entry;
+    rec->calls++;
+}
+
+typedef struct {
+    gchar *tmpdir;
+    gchar *saved_runtime_dir;
+    DiscordIpcState state;
+    PresenceRecorder rec;
+    int fd;
+} ProxyFixture;
+
+static int connect_unix(const gchar *path)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    g_assert_cmpint(connect(fd, (struct sockaddr *)&addr, sizeof(addr)), ==, 0);
+    return fd;
+}
+
+/* A client the proxy has accepted */
+static int proxy_connect(DiscordIpcState *state)
+{
+    int fd = connect_unix(state->ipc_path);
+    guint before = state->connections->len;
+    while (state->connections->len == before)
+        g_main_context_iteration(NULL, TRUE);
+    return fd;
+}
+
+static void proxy_setup(ProxyFixture *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->tmpdir = create_test_tmpdir();
+    f->saved_runtime_dir = g_strdup(g_getenv("XDG_RUNTIME_DIR"));
+    g_setenv("XDG_RUNTIME_DIR", f->tmpdir, TRUE);
+
+    g_assert_true(discord_ipc_setup(&f->state));
+    g_assert_false(f->state.upstream_active);
+    f->state.presence_changed = record_presence;
+    f->state.presence_changed_data = &f->rec;
+    f->fd = proxy_connect(&f->state);
+}
+
+static void proxy_teardown(ProxyFixture *f)
+{
+    if (f->fd >= 0)
+        close(f->fd);
+    discord_ipc_cleanup(&f->state);
+    if (f->saved_runtime_dir)
+        g_setenv("XDG_RUNTIME_DIR", f->saved_runtime_dir, TRUE);
+    else
+        g_unsetenv("XDG_RUNTIME_DIR");
+    for (guint i = 0; i < MIN(f->rec.calls, G_N_ELEMENTS(f->rec.states)); i++)
+        g_free(f->rec.states[i]);
+    g_free(f->saved_runtime_dir);
+    cleanup_test_tmpdir(f->tmpdir);
+}
+
+/* Appends a SET_ACTIVITY frame for pid to buf */
+static void append_activity(GByteArray *buf, pid_t pid, const gchar *state)
+{
+    gchar *json = g_strdup_printf(
+        "{\"cmd\":\"SET_ACTIVITY\",\"args\":{\"pid\":%d,"
+        "\"activity\":{\"state\":\"%s\",\"details\":\"Ranked\"}},"
+        "\"nonce\":\"1\"}", (int)pid, state);
+    gsize len;
+    guint8 *frame = build_frame(DISCORD_OP_FRAME, json, &len);
+    g_byte_array_append(buf, frame, len);
+    g_free(frame);
+    g_free(json);
+}
+
+static void send_bytes(int fd, const guint8 *data, gsize len)
+{
+    g_assert_cmpint(send(fd, data, len, MSG_NOSIGNAL), ==, (gssize)len);
+}
+
+static void wait_for_presence(PresenceRecorder *rec, guint expected)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (rec->calls < expected && g_get_monotonic_time() < deadline)
+        g_main_context_iteration(NULL, TRUE);
+    g_assert_cmpuint(rec->calls, ==, expected);
+}
+
+static void test_presence_frames_notify(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+
+    gsize len;
+    guint8 *hello = build_frame(DISCORD_OP_HANDSHAKE,
+                                "{\"v\":1,\"client_id\":\"1\"}", &len);
+    send_bytes(f->fd, hello, len);
+    g_free(hello);
+
+    /* Three frames in one write: two changes and a repeat, each change
+     * seen on its own rather than the last one at the next poll */
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, getpid(), "In menus");
+    append_activity(buf, getpid(), "In match");
+    append_activity(buf, getpid(), "In match");
+    gint64 sent = g_get_monotonic_time();
+    send_bytes(f->fd, buf->data, buf->len);
+    wait_for_presence(&f->rec, 2);
+    gint64 seen = g_get_monotonic_time();
+
+    g_assert_cmpstr(f->rec.states[0], ==, "In menus");
+    g_assert_cmpstr(f->rec.states[1], ==, "In match");
+    for (int i = 0; i < 2; i++) {
+        g_assert_cmpint(f->rec.arrived[i], >=, sent);
+        g_assert_cmpint(f->rec.arrived[i], <=, seen);
+    }
+    g_assert_true(f->rec.entry == discord_ipc_lookup_pid(&f->state, getpid()));
+    g_assert_cmpstr(f->rec.entry->details, ==, "Ranked");
+
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+static void test_presence_repeat_in_place(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, getpid(), "In match");
+    send_bytes(f->fd, buf->data, buf->len);
+    wait_for_presence(&f->rec, 1);
+    const RichPresenceEntry *entry = f->rec.entry;
+    const gchar *state_str = entry->state;
+    gint64 first = entry->last_updated;
+
+    /* The periodic repeats a game sends, then another game's update to
+     * know they have all been handled */
+    g_usleep(1000);
+    for (int i = 0; i < 5; i++)
+        send_bytes(f->fd, buf->data, buf->len);
+    g_byte_array_set_size(buf, 0);
+    append_activity(buf, getppid(), "Exploring");
+    send_bytes(f->fd, buf->data, buf->len);
+    wait_for_presence(&f->rec, 2);
+
+    g_assert_cmpstr(f->rec.states[1], ==, "Exploring");
+    g_assert_true(discord_ipc_lookup_pid(&f->state, getpid()) == entry);
+    g_assert_true(entry->state == state_str);
+    g_assert_cmpint(entry->last_updated, >, first);
+
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+static void test_presence_split_frame(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, getpid(), "In match");
+    send_bytes(f->fd, buf->data, 20);
+    for (int i = 0; i < 10; i++) {
+        g_main_context_iteration(NULL, FALSE);
+        g_usleep(1000);
+    }
+    g_assert_cmpuint(f->rec.calls, ==, 0);
+
+    /* The frame arrives with its last bytes */
+    gint64 sent = g_get_monotonic_time();
+    send_bytes(f->fd, buf->data + 20, buf->len - 20);
+    wait_for_presence(&f->rec, 1);
+    g_assert_cmpstr(f->rec.states[0], ==, "In match");
+    g_assert_cmpint(f->rec.arrived[0], >=, sent);
+
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+/* ── Presence store lifetime ───────────────────────── */
+
+static guint presence_size(ProxyFixture *f)
+{
+    DiscordPresenceStats stats;
+    discord_ipc_get_presence_stats(&f->state, &stats);
+    return stats.size;
+}
+
+static void wait_for_presence_size(ProxyFixture *f, guint expected)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (presence_size(f) != expected) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, TRUE);
+    }
+}
+
+typedef struct {
+    AppState app;
+    guint notices;
+    guint records;
+    time_t wall[8];
+    long duration[8];
+} PresenceTracker;
+
+static void log_interval(const CsvRecord *rec, gpointer user_data)
+{
+    PresenceTracker *tracker = user_data;
+    g_assert_cmpuint(tracker->records, <, G_N_ELEMENTS(tracker->wall));
+    tracker->wall[tracker->records] = rec->wall;
+    tracker->duration[tracker->records] = rec->duration;
+    tracker->records++;
+}
+
+/* What the tracker does with a notice */
+static void apply_presence(const RichPresenceEntry *entry, gpointer user_data)
+{
+    PresenceTracker *tracker = user_data;
+    track_presence_change(&tracker->app, entry->pid, entry->state,
+                          entry->details, entry->last_updated);
+    tracker->notices++;
+}
+
+static void test_presence_evicted_on_disconnect(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, getpid(), "Editing main.c");
+    send_bytes(f->fd, buf->data, buf->len);
+    wait_for_presence(&f->rec, 1);
+    g_assert_nonnull(discord_ipc_lookup_pid(&f->state, getpid()));
+
+    /* The IDE quits while its process lives on */
+    close(f->fd);
+    f->fd = -1;
+    wait_for_presence_size(f, 0);
+    g_assert_null(discord_ipc_lookup_pid(&f->state, getpid()));
+    g_assert_cmpuint(f->state.presence_stats.evicted_closed, ==, 1);
+    g_assert_cmpuint(f->rec.calls, ==, 2);
+    g_assert_null(f->rec.states[1]);
+
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+/* The window's presence interval ends when its client goes, not at the
+ * next poll */
+static void test_presence_eviction_ends_interval(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+
+    PresenceTracker tracker = {0};
+    AppState *app = &tracker.app;
+    app->record_sink = log_interval;
+    app->record_sink_data = &tracker;
+    start_tracking(app, "main.c - Code", "code", "code", "", "", getpid(),
+                   FALSE);
+    f->state.presence_changed = apply_presence;
+    f->state.presence_changed_data = &tracker;
+
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, getpid(), "Editing main.c");
+    send_bytes(f->fd, buf->data, buf->len);
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (tracker.notices < 1) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpstr(app->current_rp_state, ==, "Editing main.c");
+    /* Long enough ago to make a record */
+    app->current_start -= 30 * G_USEC_PER_SEC;
+    app->current_wall -= 30;
+
+    gint64 closed = g_get_monotonic_time();
+    close(f->fd);
+    f->fd = -1;
+    while (tracker.notices < 2) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpuint(tracker.records, ==, 1);
+    g_assert_cmpint(tracker.duration[0], ==, 30);
+    g_assert_cmpstr(app->current_rp_state, ==, "");
+    g_assert_cmpstr(app->current_rp_details, ==, "");
+    g_assert_cmpint(app->current_start, >=, closed);
+    g_assert_cmpint(app->current_start, <=, g_get_monotonic_time());
+
+    g_free(app->current_title);
+    g_free(app->current_wm_class);
+    g_free(app->current_wm_class_instance);
+    g_free(app->current_rp_state);
+    g_free(app->current_rp_details);
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+static void test_presence_evicted_on_exit(void)
+{
+    int probe = syscall(SYS_pidfd_open, getpid(), 0);
+    if (probe < 0) {
+        g_test_skip("no pidfd_open() in this kernel");
+        return;
+    }
+    close(probe);
+
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+
+    pid_t child = fork();
+    g_assert_cmpint(child, >=, 0);
+    if (child == 0) {
+        pause();
+        _exit(0);
+    }
+
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, child, "In match");
+    send_bytes(f->fd, buf->data, buf->len);
+    wait_for_presence(&f->rec, 1);
+
+    /* The game exits, its connection stays up (a launcher holding it) */
+    kill(child, SIGKILL);
+    waitpid(child, NULL, 0);
+    wait_for_presence(&f->rec, 2);
+    g_assert_null(f->rec.states[1]);
+    g_assert_cmpuint(presence_size(f), ==, 0);
+    g_assert_cmpuint(f->state.presence_stats.evicted_exited, ==, 1);
+    g_assert_cmpuint(f->state.connections->len, ==, 1);
+
+    /* Presence for a process that is gone is not kept, so whoever gets
+     * the PID next cannot inherit it */
+    send_bytes(f->fd, buf->data, buf->len);
+    g_byte_array_set_size(buf, 0);
+    append_activity(buf, getpid(), "Editing main.c");
+    send_bytes(f->fd, buf->data, buf->len);
+    wait_for_presence(&f->rec, 3);
+    g_assert_null(discord_ipc_lookup_pid(&f->state, child));
+    g_assert_cmpuint(f->state.presence_stats.evicted_exited, ==, 2);
+
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+static void test_presence_limit_and_expiry(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+    f->state.max_presence = 4;
+    f->state.presence_ttl = 50;
+
+    /* Past the limit the least recently updated make room */
+    for (int i = 1; i <= 10; i++)
+        discord_presence_store(&f->state, 1000 + i, "State", NULL, i);
+    g_assert_cmpuint(presence_size(f), ==, 4);
+    g_assert_cmpuint(f->state.presence_stats.evicted_lru, ==, 6);
+    g_assert_null(discord_ipc_lookup_pid(&f->state, 1006));
+    g_assert_nonnull(discord_ipc_lookup_pid(&f->state, 1007));
+
+    discord_presence_store(&f->state, 1007, "State", NULL, 100);
+    discord_presence_store(&f->state, 1011, "State", NULL, 11);
+    g_assert_null(discord_ipc_lookup_pid(&f->state, 1008));
+    g_assert_nonnull(discord_ipc_lookup_pid(&f->state, 1007));
+
+    /* Entries nobody updated within the TTL expire */
+    discord_presence_expire(&f->state, 120);
+    g_assert_cmpuint(presence_size(f), ==, 1);
+    g_assert_nonnull(discord_ipc_lookup_pid(&f->state, 1007));
+    g_assert_cmpuint(f->state.presence_stats.evicted_expired, ==, 3);
+
+    proxy_teardown(f);
+}
+
+/* IDE restarts over a long uptime leave nothing behind */
+static void test_presence_churn(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup(f);
+    close(f->fd);
+    f->fd = -1;
+    while (f->state.connections->len > 0)
+        g_main_context_iteration(NULL, TRUE);
+
+    GByteArray *buf = g_byte_array_new();
+    for (guint i = 0; i < 300; i++) {
+        int fd = proxy_connect(&f->state);
+        gchar *file = g_strdup_printf("Editing file%u.c", i);
+        g_byte_array_set_size(buf, 0);
+        append_activity(buf, getpid(), file);
+        send_bytes(fd, buf->data, buf->len);
+        wait_for_presence(&f->rec, 2 * i + 1);
+        /* Its removal is told as well */
+        close(fd);
+        wait_for_presence(&f->rec, 2 * i + 2);
+        g_assert_cmpuint(presence_size(f), ==, 0);
+        g_free(file);
+    }
+    while (f->state.connections->len > 0)
+        g_main_context_iteration(NULL, TRUE);
+
+    DiscordPresenceStats stats;
+    discord_ipc_get_presence_stats(&f->state, &stats);
+    g_assert_cmpuint(stats.size, ==, 0);
+    g_assert_cmpuint(stats.evicted_closed, ==, 300);
+    g_assert_cmpuint(stats.evicted_lru, ==, 0);
+
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+/* ── Forwarding to Discord ─────────────────────────── *
+ *
+ * A fake Discord listens where the real one would; the proxy moves its
+ * socket aside and forwards between it and a client. */
+
+typedef struct {
+    gchar *tmpdir;
+    gchar *saved_runtime_dir;
+    DiscordIpcState state;
+    int listen_fd;
+    int client_fd;
+    int discord_fd;
+} UpstreamFixture;
+
+static void set_nonblocking(int fd)
+{
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* Accepts and closes what waits, such as the proxy's liveness check */
+static guint drain_backlog(UpstreamFixture *f)
+{
+    guint n = 0;
+    int fd;
+    while ((fd = accept(f->listen_fd, NULL, NULL)) >= 0) {
+        close(fd);
+        n++;
+    }
+    return n;
+}
+
+static void upstream_setup(UpstreamFixture *f, int backlog,
+                           gboolean own_thread)
+{
+    memset(f, 0, sizeof(*f));
+    f->tmpdir = create_test_tmpdir();
+    f->saved_runtime_dir = g_strdup(g_getenv("XDG_RUNTIME_DIR"));
+    g_setenv("XDG_RUNTIME_DIR", f->tmpdir, TRUE);
+
+    f->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    g_snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/discord-ipc-0",
+               f->tmpdir);
+    g_assert_cmpint(bind(f->listen_fd, (struct sockaddr *)&addr,
+                         sizeof(addr)), ==, 0);
+    g_assert_cmpint(listen(f->listen_fd, backlog), ==, 0);
+    set_nonblocking(f->listen_fd);
+
+    g_assert_true(discord_ipc_setup_full(&f->state, own_thread));
+    g_assert_true(f->state.upstream_active);
+    drain_backlog(f);
+    f->client_fd = -1;
+    f->discord_fd = -1;
+}
+
+static void upstream_teardown(UpstreamFixture *f)
+{
+    if (f->client_fd >= 0)
+        close(f->client_fd);
+    if (f->discord_fd >= 0)
+        close(f->discord_fd);
+    discord_ipc_cleanup(&f->state);
+    close(f->listen_fd);
+    if (f->saved_runtime_dir)
+        g_setenv("XDG_RUNTIME_DIR", f->saved_runtime_dir, TRUE);
+    else
+        g_unsetenv("XDG_RUNTIME_DIR");
+    g_free(f->saved_runtime_dir);
+    cleanup_test_tmpdir(f->tmpdir);
+}
+
+/* The proxy's connection for the client, as Discord sees it */
+static int accept_discord(UpstreamFixture *f)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    int fd;
+    while ((fd = accept(f->listen_fd, NULL, NULL)) < 0) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, FALSE);
+    }
+    set_nonblocking(fd);
+    return fd;
+}
+
+/* Reads at most max bytes into received, without blocking */
+static void read_some(int fd, GByteArray *received, gsize max)
+{
+    guint8 buf[65536];
+    ssize_t n = recv(fd, buf, MIN(max, sizeof(buf)), MSG_DONTWAIT);
+    if (n > 0)
+        g_byte_array_append(received, buf, n);
+}
+
+/* Sends what the socket takes of data from *sent on */
+static void write_some(int fd, const GByteArray *data, gsize *sent)
+{
+    if (*sent == data->len)
+        return;
+    ssize_t n = send(fd, data->data + *sent, MIN(data->len - *sent, 65536),
+                     MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n > 0)
+        *sent += n;
+    else
+        g_assert_true(errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+/* Frames of about 1 KiB each, numbered so a loss or reorder shows */
+static GByteArray *build_frames(guint count)
+{
+    GByteArray *buf = g_byte_array_new();
+    gchar *pad = g_strnfill(1000, 'x');
+    for (guint i = 0; i < count; i++) {
+        gchar *json = g_strdup_printf("{\"cmd\":\"PING\",\"nonce\":\"%u\","
+                                      "\"pad\":\"%s\"}", i, pad);
+        gsize len;
+        guint8 *frame = build_frame(DISCORD_OP_FRAME, json, &len);
+        g_byte_array_append(buf, frame, len);
+        g_free(frame);
+        g_free(json);
+    }
+    g_free(pad);
+    return buf;
+}
+
+static void forward_throttled_readers(gboolean splice)
+{
+    UpstreamFixture fixture, *f = &fixture;
+    upstream_setup(f, 5, FALSE);
+    f->state.splice_to_client = splice;
+    f->client_fd = proxy_connect(&f->state);
+    f->discord_fd = accept_discord(f);
+    set_nonblocking(f->client_fd);
+
+    GByteArray *from_client = build_frames(2048);
+    GByteArray *from_discord = g_byte_array_new();
+    GRand *rand = g_rand_new_with_seed(7);
+    for (guint i = 0; i < 2 * 1024 * 1024; i++) {
+        guint8 b = g_rand_int(rand);
+        g_byte_array_append(from_discord, &b, 1);
+    }
+    g_rand_free(rand);
+
+    /* Both sides write as fast as they can and read 4 KiB at a time */
+    GByteArray *at_discord = g_byte_array_new();
+    GByteArray *at_client = g_byte_array_new();
+    gsize client_sent = 0, discord_sent = 0;
+    gint64 deadline = g_get_monotonic_time() + 60 * G_USEC_PER_SEC;
+    while (at_discord->len < from_client->len ||
+           at_client->len < from_discord->len) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        write_some(f->client_fd, from_client, &client_sent);
+        write_some(f->discord_fd, from_discord, &discord_sent);
+        g_main_context_iteration(NULL, FALSE);
+        read_some(f->discord_fd, at_discord, 4096);
+        read_some(f->client_fd, at_client, 4096);
+    }
+
+    g_assert_cmpmem(at_discord->data, at_discord->len,
+                    from_client->data, from_client->len);
+    g_assert_cmpmem(at_client->data, at_client->len,
+                    from_discord->data, from_discord->len);
+    g_assert_cmpuint(f->state.proxy_stats.to_upstream, ==, from_client->len);
+    g_assert_cmpuint(f->state.proxy_stats.to_client, ==, from_discord->len);
+    g_assert_cmpuint(f->state.proxy_stats.spliced, ==,
+                     splice ? from_discord->len : 0);
+
+    /* The readers held the proxy back rather than it buffering it all */
+    g_assert_cmpuint(f->state.proxy_stats.read_pauses, >, 0);
+    g_assert_cmpuint(f->state.proxy_stats.max_buffered, <=,
+                     DISCORD_BUFFER_LIMIT);
+
+    g_byte_array_free(from_client, TRUE);
+    g_byte_array_free(from_discord, TRUE);
+    g_byte_array_free(at_discord, TRUE);
+    g_byte_array_free(at_client, TRUE);
+    upstream_teardown(f);
+}
+
+static void test_forward_throttled_readers(void)
+{
+    forward_throttled_readers(TRUE);
+}
+
+static void test_forward_throttled_readers_copied(void)
+{
+    forward_throttled_readers(FALSE);
+}
+
+static void test_forward_while_connecting(void)
+{
+    UpstreamFixture fixture, *f = &fixture;
+    upstream_setup(f, 0, FALSE);
+
+    /* Discord is slow to accept: its backlog is full */
+    GArray *waiting = g_array_new(FALSE, FALSE, sizeof(int));
+    for (;;) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0);
+        struct sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, f->state.real_ipc_path,
+                sizeof(addr.sun_path) - 1);
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            g_assert_cmpint(errno, ==, EAGAIN);
+            close(fd);
+            break;
+        }
+        g_array_append_val(waiting, fd);
+    }
+
+    /* The client is served meanwhile and its frames are kept */
+    f->client_fd = proxy_connect(&f->state);
+    GByteArray *frames = build_frames(16);
+    append_activity(frames, getpid(), "In match");
+    send_bytes(f->client_fd, frames->data, frames->len);
+    gint64 until = g_get_monotonic_time() + 100 * 1000;
+    while (g_get_monotonic_time() < until)
+        g_main_context_iteration(NULL, FALSE);
+    g_assert_nonnull(discord_ipc_lookup_pid(&f->state, getpid()));
+    g_assert_cmpuint(f->state.proxy_stats.to_upstream, ==, 0);
+
+    g_assert_cmpuint(drain_backlog(f), ==, waiting->len);
+    for (guint i = 0; i < waiting->len; i++)
+        close(g_array_index(waiting, int, i));
+    g_array_free(waiting, TRUE);
+
+    f->discord_fd = accept_discord(f);
+    GByteArray *received = g_byte_array_new();
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (received->len < frames->len) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, FALSE);
+        read_some(f->discord_fd, received, 65536);
+    }
+    g_assert_cmpmem(received->data, received->len,
+                    frames->data, frames->len);
+
+    g_byte_array_free(frames, TRUE);
+    g_byte_array_free(received, TRUE);
+    upstream_teardown(f);
+}
+
+/* Frames sent right before the client hangs up still reach Discord */
+static void test_forward_after_client_close(void)
+{
+    UpstreamFixture fixture, *f = &fixture;
+    upstream_setup(f, 5, FALSE);
+    f->client_fd = proxy_connect(&f->state);
+    f->discord_fd = accept_discord(f);
+
+    GByteArray *frames = build_frames(64);
+    send_bytes(f->client_fd, frames->data, frames->len);
+    close(f->client_fd);
+    f->client_fd = -1;
+
+    GByteArray *received = g_byte_array_new();
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (f->state.connections->len > 0 || received->len < frames->len) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, FALSE);
+        read_some(f->discord_fd, received, 65536);
+    }
+    g_assert_cmpmem(received->data, received->len,
+                    frames->data, frames->len);
+
+    g_byte_array_free(frames, TRUE);
+    g_byte_array_free(received, TRUE);
+    upstream_teardown(f);
+}
+
+/* Discord's bytes sent right before it hangs up still reach the client */
+static void test_forward_after_discord_close(void)
+{
+    UpstreamFixture fixture, *f = &fixture;
+    upstream_setup(f, 5, FALSE);
+    f->client_fd = proxy_connect(&f->state);
+    f->discord_fd = accept_discord(f);
+    set_nonblocking(f->client_fd);
+
+    GByteArray *frames = build_frames(64);
+    send_bytes(f->discord_fd, frames->data, frames->len);
+    close(f->discord_fd);
+    f->discord_fd = -1;
+
+    GByteArray *received = g_byte_array_new();
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (f->state.connections->len > 0 || received->len < frames->len) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, FALSE);
+        read_some(f->client_fd, received, 65536);
+    }
+    g_assert_cmpmem(received->data, received->len,
+                    frames->data, frames->len);
+
+    g_byte_array_free(frames, TRUE);
+    g_byte_array_free(received, TRUE);
+    upstream_teardown(f);
+}
+
+/* ── Proxy thread ──────────────────────────────────── */
+
+static void proxy_setup_threaded(ProxyFixture *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->tmpdir = create_test_tmpdir();
+    f->saved_runtime_dir = g_strdup(g_getenv("XDG_RUNTIME_DIR"));
+    g_setenv("XDG_RUNTIME_DIR", f->tmpdir, TRUE);
+
+    g_assert_true(discord_ipc_setup_full(&f->state, TRUE));
+    f->state.presence_changed = record_presence;
+    f->state.presence_changed_data = &f->rec;
+    discord_ipc_start(&f->state);
+    f->fd = connect_unix(f->state.ipc_path);
+}
+
+/* The proxy answers while this thread's main loop is not running */
+static void test_thread_serves_while_blocked(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup_threaded(f);
+
+    gsize len;
+    guint8 *handshake = build_frame(DISCORD_OP_HANDSHAKE,
+                                    "{\"v\":1,\"client_id\":\"1\"}", &len);
+    send_bytes(f->fd, handshake, len);
+    g_free(handshake);
+
+    guint8 header[DISCORD_HEADER_SIZE];
+    g_assert_cmpint(recv(f->fd, header, sizeof(header), MSG_WAITALL), ==,
+                    DISCORD_HEADER_SIZE);
+    guint32 opcode;
+    memcpy(&opcode, header, sizeof(opcode));
+    g_assert_cmpuint(GUINT32_FROM_LE(opcode), ==, DISCORD_OP_FRAME);
+
+    proxy_teardown(f);
+}
+
+/* Lookups from this thread follow every change, through snapshots the
+ * proxy thread frees as this loop iterates */
+static void test_thread_presence_snapshot(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup_threaded(f);
+
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, getpid(), "In menus");
+    send_bytes(f->fd, buf->data, buf->len);
+    wait_for_presence(&f->rec, 1);
+    const RichPresenceEntry *entry = discord_ipc_lookup_pid(&f->state,
+                                                            getpid());
+    g_assert_nonnull(entry);
+    g_assert_cmpstr(entry->state, ==, "In menus");
+
+    for (guint i = 0; i < 200; i++) {
+        const gchar *expected = i % 2 ? "In menus" : "In match";
+        g_byte_array_set_size(buf, 0);
+        append_activity(buf, getpid(), expected);
+        send_bytes(f->fd, buf->data, buf->len);
+        wait_for_presence(&f->rec, i + 2);
+        entry = discord_ipc_lookup_pid(&f->state, getpid());
+        g_assert_cmpstr(entry->state, ==, expected);
+    }
+
+    close(f->fd);
+    f->fd = -1;
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (discord_ipc_lookup_pid(&f->state, getpid())) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, FALSE);
+    }
+
+    discord_ipc_stop(&f->state);
+    DiscordPresenceStats stats;
+    discord_ipc_get_presence_stats(&f->state, &stats);
+    g_assert_cmpuint(stats.size, ==, 0);
+    g_assert_cmpuint(stats.evicted_closed, ==, 1);
+
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+/* Two changes are still queued for this thread when a poll reads the
+ * newer one; their notices must not move the interval back over time
+ * already recorded */
+static void test_thread_late_notices(void)
+{
+    ProxyFixture fixture, *f = &fixture;
+    proxy_setup_threaded(f);
+
+    PresenceTracker late = {0};
+    AppState *app = &late.app;
+    app->record_sink = log_interval;
+    app->record_sink_data = &late;
+    start_tracking(app, "Game", "game", "game", "", "", getpid(), FALSE);
+    app->current_start -= 90 * G_USEC_PER_SEC;
+    app->current_wall -= 90;
+    f->state.presence_changed = apply_presence;
+    f->state.presence_changed_data = &late;
+
+    /* Far enough apart for the first to make a record of its own */
+    GByteArray *buf = g_byte_array_new();
+    append_activity(buf, getpid(), "In menus");
+    send_bytes(f->fd, buf->data, buf->len);
+    g_usleep(G_USEC_PER_SEC * 3 / 2);
+    g_byte_array_set_size(buf, 0);
+    append_activity(buf, getpid(), "In match");
+    send_bytes(f->fd, buf->data, buf->len);
+
+    /* The poll, as track_focused_window() makes it, before this thread's
+     * loop has delivered either notice */
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    const RichPresenceEntry *entry;
+    while (!(entry = discord_ipc_lookup_pid(&f->state, getpid())) ||
+           g_strcmp0(entry->state, "In match") != 0) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_usleep(1000);
+    }
+    gchar *rp_state = g_strdup(entry->state);
+    gchar *rp_details = g_strdup(entry->details);
+    emit_csv_line(app);
+    start_tracking(app, "Game", "game", "game", rp_state, rp_details,
+                   getpid(), FALSE);
+    gint64 polled = app->current_start;
+    g_assert_cmpuint(late.notices, ==, 0);
+
+    deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (late.notices < 2) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, TRUE);
+    }
+    g_assert_cmpint(app->current_start, ==, polled);
+    g_assert_cmpstr(app->current_rp_state, ==, "In match");
+
+    /* The interval before the poll, then the one it started */
+    emit_csv_line_at(app, polled + 5 * G_USEC_PER_SEC);
+    g_assert_cmpuint(late.records, ==, 2);
+    g_assert_cmpint(late.duration[1], ==, 5);
+    for (guint i = 1; i < late.records; i++)
+        g_assert_cmpint(late.wall[i - 1] + late.duration[i - 1], <=,
+                        late.wall[i]);
+
+    g_free(rp_state);
+    g_free(rp_details);
+    g_free(app->current_title);
+    g_free(app->current_wm_class);
+    g_free(app->current_wm_class_instance);
+    g_free(app->current_rp_state);
+    g_free(app->current_rp_details);
+    g_byte_array_free(buf, TRUE);
+    proxy_teardown(f);
+}
+
+/* ── Relay benchmark ───────────────────────────────── */
+
+#define RELAY_BYTES (256 * 1024 * 1024)
+
+typedef struct {
+    int fd;
+    gint done;
+} RelayPeer;
+
+static gpointer relay_discord_thread(gpointer data)
+{
+    RelayPeer *peer = data;
+    guint8 *chunk = g_malloc(65536);
+    memset(chunk, 'd', 65536);
+    int flags = fcntl(peer->fd, F_GETFL);
+    fcntl(peer->fd, F_SETFL, flags & ~O_NONBLOCK);
+    for (gsize sent = 0; sent < RELAY_BYTES; ) {
+        ssize_t n = send(peer->fd, chunk, MIN(65536, RELAY_BYTES - sent),
+                         MSG_NOSIGNAL);
+        g_assert_cmpint(n, >, 0);
+        sent += n;
+    }
+    g_free(chunk);
+    return NULL;
+}
+
+static gpointer relay_client_thread(gpointer data)
+{
+    RelayPeer *peer = data;
+    guint8 *buf = g_malloc(65536);
+    gsize total = 0;
+    while (total < RELAY_BYTES) {
+        ssize_t n = recv(peer->fd, buf, 65536, 0);
+        g_assert_cmpint(n, >, 0);
+        total += n;
+    }
+    g_free(buf);
+    g_atomic_int_set(&peer->done, 1);
+    g_main_context_wakeup(NULL);
+    return NULL;
+}
+
+/* Discord to client throughput, and CPU time the proxy's thread spends */
+static void relay_benchmark(gboolean splice)
+{
+    UpstreamFixture fixture, *f = &fixture;
+    upstream_setup(f, 5, FALSE);
+    f->state.splice_to_client = splice;
+    f->client_fd = proxy_connect(&f->state);
+    f->discord_fd = accept_discord(f);
+
+    RelayPeer discord = {f->discord_fd, 0}, client = {f->client_fd, 0};
+    struct timespec cpu0, cpu1;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu0);
+    g_test_timer_start();
+    GThread *writer = g_thread_new("discord", relay_discord_thread, &discord);
+    GThread *reader = g_thread_new("client", relay_client_thread, &client);
+    while (!g_atomic_int_get(&client.done))
+        g_main_context_iteration(NULL, TRUE);
+    double elapsed = g_test_timer_elapsed();
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu1);
+    g_thread_join(writer);
+    g_thread_join(reader);
+
+    double cpu = (cpu1.tv_sec - cpu0.tv_sec) +
+                 (cpu1.tv_nsec - cpu0.tv_nsec) / 1e9;
+    double mib = RELAY_BYTES / (1024.0 * 1024.0);
+    g_assert_cmpuint(f->state.proxy_stats.to_client, ==, RELAY_BYTES);
+    g_test_message("%s: %.0f MiB/s, proxy CPU %.1f ms per 100 MiB",
+                   splice ? "splice" : "copy", mib / elapsed,
+                   cpu * 1000 * 100 / mib);
+    g_test_maximized_result(mib / elapsed, "MiB/s relayed");
+
+    upstream_teardown(f);
+}
+
+static void test_perf_relay_splice(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+    relay_benchmark(TRUE);
+}
+
+static void test_perf_relay_copy(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+    relay_benchmark(FALSE);
+}
+
+/* ── Latency benchmark ─────────────────────────────── *
+ *
+ * A client makes RPC round trips through the proxy to a fake Discord
+ * echoing them, while this thread's main loop stands in for the
+ * tracker's on a slow disk: every 100 ms an fsync takes 30 ms. */
+
+#define LATENCY_ROUNDS 2000
+
+typedef struct {
+    int fd;
+    gint64 rtt[LATENCY_ROUNDS];
+    gint done;
+} LatencyRun;
+
+static gpointer echo_thread(gpointer data)
+{
+    int fd = GPOINTER_TO_INT(data);
+    guint8 buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0)
+        g_assert_cmpint(send(fd, buf, n, MSG_NOSIGNAL), ==, n);
+    return NULL;
+}
+
+static gpointer rpc_client_thread(gpointer data)
+{
+    LatencyRun *run = data;
+    gsize len;
+    guint8 *frame = build_frame(DISCORD_OP_FRAME, "{\"cmd\":\"PING\"}", &len);
+    guint8 *reply = g_malloc(len);
+    for (guint i = 0; i < LATENCY_ROUNDS; i++) {
+        gint64 start = g_get_monotonic_time();
+        send_bytes(run->fd, frame, len);
+        g_assert_cmpint(recv(run->fd, reply, len, MSG_WAITALL), ==, (gssize)len);
+        run->rtt[i] = g_get_monotonic_time() - start;
+        g_usleep(1000);
+    }
+    g_free(frame);
+    g_free(reply);
+    g_atomic_int_set(&run->done, 1);
+    g_main_context_wakeup(NULL);
+    return NULL;
+}
+
+static gboolean slow_fsync(gpointer user_data G_GNUC_UNUSED)
+{
+    g_usleep(30 * 1000);
+    return G_SOURCE_CONTINUE;
+}
+
+static int compare_gint64(const void *a, const void *b)
+{
+    gint64 x = *(const gint64 *)a, y = *(const gint64 *)b;
+    return (x > y) - (x < y);
+}
+
+static void latency_benchmark(gboolean own_thread)
+{
+    UpstreamFixture fixture, *f = &fixture;
+    upstream_setup(f, 5, own_thread);
+    discord_ipc_start(&f->state);
+    f->client_fd = connect_unix(f->state.ipc_path);
+    f->discord_fd = accept_discord(f);
+    fcntl(f->discord_fd, F_SETFL, fcntl(f->discord_fd, F_GETFL) & ~O_NONBLOCK);
+
+    LatencyRun *run = g_new0(LatencyRun, 1);
+    run->fd = f->client_fd;
+    guint stall_id = g_timeout_add(100, slow_fsync, NULL);
+    GThread *echo = g_thread_new("discord", echo_thread,
+                                 GINT_TO_POINTER(f->discord_fd));
+    GThread *client = g_thread_new("client", rpc_client_thread, run);
+    while (!g_atomic_int_get(&run->done))
+        g_main_context_iteration(NULL, TRUE);
+    g_thread_join(client);
+    g_source_remove(stall_id);
+
+    /* The proxy hangs up on Discord, which ends the echo */
+    close(f->client_fd);
+    f->client_fd = -1;
+    while (f->state.connections->len > 0 && !own_thread)
+        g_main_context_iteration(NULL, TRUE);
+    discord_ipc_cleanup(&f->state);
+    g_thread_join(echo);
+
+    qsort(run->rtt, LATENCY_ROUNDS, sizeof(gint64), compare_gint64);
+    gint64 p50 = run->rtt[LATENCY_ROUNDS / 2];
+    gint64 p90 = run->rtt[LATENCY_ROUNDS * 90 / 100];
+    gint64 p99 = run->rtt[LATENCY_ROUNDS * 99 / 100];
+    g_test_message("%s: round trip p50 %" G_GINT64_FORMAT " us, p90 %"
+                   G_GINT64_FORMAT " us, max %" G_GINT64_FORMAT " us",
+                   own_thread ? "own thread" : "main loop", p50, p90,
+                   run->rtt[LATENCY_ROUNDS - 1]);
+    g_test_minimized_result(p99, "%s round trip p99: %" G_GINT64_FORMAT " us",
+                            own_thread ? "own thread" : "main loop", p99);
+
+    g_free(run);
+    upstream_teardown(f);
+}
+
+static void test_perf_latency_main_loop(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+    latency_benchmark(FALSE);
+}
+
+static void test_perf_latency_own_thread(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+    latency_benchmark(TRUE);
+}
+
 /* ── Socket liveness tests ─────────────────────────── */
 
 static void test_socket_alive_nonexistent(void)
@@ -460,12 +1599,52 @@ int main(int argc, char *argv[])
     /* Presence store */
     g_test_add_func("/discord/presence_store_and_lookup", test_presence_store_and_lookup);
     g_test_add_func("/discord/presence_overwrite", test_presence_overwrite);
+    g_test_add_func("/discord/presence_repeated", test_presence_repeated);
     g_test_add_func("/discord/presence_lookup_missing", test_presence_lookup_missing);
     g_test_add_func("/discord/presence_multiple_pids", test_presence_multiple_pids);
+    g_test_add_func("/discord/presence_frames_notify", test_presence_frames_notify);
+    g_test_add_func("/discord/presence_repeat_in_place", test_presence_repeat_in_place);
+    g_test_add_func("/discord/presence_split_frame", test_presence_split_frame);
+    g_test_add_func("/discord/presence_evicted_on_disconnect",
+                    test_presence_evicted_on_disconnect);
+    g_test_add_func("/discord/presence_eviction_ends_interval",
+                    test_presence_eviction_ends_interval);
+    g_test_add_func("/discord/presence_evicted_on_exit",
+                    test_presence_evicted_on_exit);
+    g_test_add_func("/discord/presence_limit_and_expiry",
+                    test_presence_limit_and_expiry);
+    g_test_add_func("/discord/presence_churn", test_presence_churn);
+
+    /* Forwarding to Discord */
+    g_test_add_func("/discord/forward_throttled_readers",
+                    test_forward_throttled_readers);
+    g_test_add_func("/discord/forward_throttled_readers_copied",
+                    test_forward_throttled_readers_copied);
+    g_test_add_func("/discord/forward_while_connecting",
+                    test_forward_while_connecting);
+    g_test_add_func("/discord/forward_after_client_close",
+                    test_forward_after_client_close);
+    g_test_add_func("/discord/forward_after_discord_close",
+                    test_forward_after_discord_close);
+
+    /* Proxy thread */
+    g_test_add_func("/discord/thread_serves_while_blocked",
+                    test_thread_serves_while_blocked);
+    g_test_add_func("/discord/thread_presence_snapshot",
+                    test_thread_presence_snapshot);
+    g_test_add_func("/discord/thread_late_notices", test_thread_late_notices);
 
     /* Socket liveness */
     g_test_add_func("/discord/socket_alive_nonexistent", test_socket_alive_nonexistent);
     g_test_add_func("/discord/socket_alive_stale", test_socket_alive_stale);
 
+    /* Benchmarks */
+    g_test_add_func("/perf/discord_relay_splice", test_perf_relay_splice);
+    g_test_add_func("/perf/discord_relay_copy", test_perf_relay_copy);
+    g_test_add_func("/perf/discord_latency_main_loop",
+                    test_perf_latency_main_loop);
+    g_test_add_func("/perf/discord_latency_own_thread",
+                    test_perf_latency_own_thread);
+
     return g_test_run();
 }
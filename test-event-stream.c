@@ -0,0 +1,579 @@
+#include <glib.h>
+#include "event-stream.h"
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("event-stream-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+static void free_state_strings(AppState *state)
+{
+    g_free(state->current_title);
+    g_free(state->current_wm_class);
+    g_free(state->current_wm_class_instance);
+    g_free(state->current_rp_state);
+    g_free(state->current_rp_details);
+}
+
+static void iterate_main_context(void)
+{
+    while (g_main_context_iteration(NULL, FALSE))
+        ;
+}
+
+/* A tracker in tmpdir, 90 s into a terminal window */
+typedef struct {
+    gchar *tmpdir;
+    gchar *path;
+    AppState state;
+    EventStream stream;
+} Fixture;
+
+static void fixture_setup(Fixture *f)
+{
+    memset(f, 0, sizeof(*f));
+    f->tmpdir = create_test_tmpdir();
+    f->path = g_build_filename(f->tmpdir, EVENT_STREAM_FILE, NULL);
+    start_tracking(&f->state, "Terminal", "Gnome-terminal", "gnome-terminal",
+                   NULL, NULL, 4242, FALSE);
+    f->state.current_wall -= 90;
+    GError *error = NULL;
+    g_assert_true(event_stream_setup(&f->stream, f->path, &f->state, &error));
+    g_assert_no_error(error);
+}
+
+static void fixture_teardown(Fixture *f)
+{
+    event_stream_cleanup(&f->stream);
+    iterate_main_context();
+    g_assert_false(g_file_test(f->path, G_FILE_TEST_EXISTS));
+    free_state_strings(&f->state);
+    g_free(f->path);
+    cleanup_test_tmpdir(f->tmpdir);
+}
+
+/* A subscriber reading on the test's side */
+typedef struct {
+    int fd;
+    GByteArray *buf;
+} Client;
+
+static Client *client_connect(Fixture *f)
+{
+    GError *error = NULL;
+    Client *c = g_new0(Client, 1);
+    c->fd = event_stream_connect(f->path, &error);
+    g_assert_no_error(error);
+    c->buf = g_byte_array_new();
+    guint before = f->stream.subscribers->len;
+    while (f->stream.subscribers->len == before)
+        g_main_context_iteration(NULL, TRUE);
+    return c;
+}
+
+static void client_free(Client *c)
+{
+    if (c->fd >= 0)
+        close(c->fd);
+    g_byte_array_free(c->buf, TRUE);
+    g_free(c);
+}
+
+/* The next record, with the tracker's side serviced meanwhile.  FALSE at
+ * end of stream. */
+static gboolean client_next(Client *c, EventRecord *ev)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    for (;;) {
+        gsize consumed;
+        int rc = event_record_parse(c->buf->data, c->buf->len, ev, &consumed);
+        g_assert_cmpint(rc, >=, 0);
+        if (rc == 1) {
+            g_byte_array_remove_range(c->buf, 0, consumed);
+            return TRUE;
+        }
+
+        guint8 chunk[4096];
+        ssize_t n = recv(c->fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (n == 0)
+            return FALSE;
+        if (n > 0) {
+            g_byte_array_append(c->buf, chunk, n);
+            continue;
+        }
+        g_assert_true(errno == EAGAIN || errno == EWOULDBLOCK);
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        iterate_main_context();
+        g_usleep(100);
+    }
+}
+
+static void assert_finished(const EventRecord *ev, const CsvRecord *rec)
+{
+    g_assert_cmpuint(ev->kind, ==, EVENT_FINISHED);
+    g_assert_cmpstr(event_status_name(ev->status), ==, rec->status);
+    g_assert_cmpint(ev->wall, ==, rec->wall);
+    g_assert_cmpuint(ev->count, ==, rec->duration);
+    g_assert_cmpstr(ev->title, ==, rec->title);
+    g_assert_cmpstr(ev->wm_class, ==, rec->wm_class);
+    g_assert_cmpstr(ev->wm_class_instance, ==, rec->wm_class_instance);
+    g_assert_cmpstr(ev->rp_state, ==, rec->rp_state);
+    g_assert_cmpstr(ev->rp_details, ==, rec->rp_details);
+}
+
+static void assert_started_terminal(const EventRecord *ev, const AppState *state)
+{
+    g_assert_cmpuint(ev->kind, ==, EVENT_STARTED);
+    g_assert_cmpuint(ev->status, ==, EVENT_STATUS_ACTIVE);
+    g_assert_cmpint(ev->wall, ==, state->current_wall);
+    g_assert_cmpstr(ev->title, ==, "Terminal");
+    g_assert_cmpstr(ev->wm_class, ==, "Gnome-terminal");
+}
+
+/* Record i of a run, with a title long enough to fill socket buffers */
+static void numbered_record(CsvRecord *rec, gchar *title, gsize size, int i)
+{
+    g_snprintf(title, size, "record %08d %0200d", i, 0);
+    *rec = (CsvRecord){1769600000 + i, 1 + i % 600, "active", title,
+                       "Firefox", "firefox", "", ""};
+}
+
+/* ── Encoding ──────────────────────────────────────── */
+
+static void test_encode_parse(void)
+{
+    CsvRecord rec = {1769600000, 754, "active",
+                     "Line one\nline two, \"quoted\" \xc5\xbe", "jetbrains-idea",
+                     "jetbrains-idea", "Editing Main.java", "app"};
+    GByteArray *buf = g_byte_array_new();
+    event_record_encode(buf, EVENT_FINISHED, &rec, 754);
+    CsvRecord locked = {1769600754, 0, "locked", "", "", "", "", ""};
+    event_record_encode(buf, EVENT_STARTED, &locked, 0);
+
+    /* Every prefix of the first record asks for more */
+    EventRecord ev;
+    gsize consumed;
+    gsize first = 0;
+    for (gsize len = 0; len < buf->len; len++) {
+        int rc = event_record_parse(buf->data, len, &ev, &consumed);
+        if (rc == 1) {
+            first = consumed;
+            event_record_clear(&ev);
+            break;
+        }
+        g_assert_cmpint(rc, ==, 0);
+    }
+    g_assert_cmpuint(first, >, 0);
+
+    g_assert_cmpint(event_record_parse(buf->data, buf->len, &ev, &consumed), ==, 1);
+    g_assert_cmpuint(consumed, ==, first);
+    assert_finished(&ev, &rec);
+    event_record_clear(&ev);
+
+    g_assert_cmpint(event_record_parse(buf->data + first, buf->len - first,
+                                       &ev, &consumed), ==, 1);
+    g_assert_cmpuint(first + consumed, ==, buf->len);
+    g_assert_cmpuint(ev.kind, ==, EVENT_STARTED);
+    g_assert_cmpuint(ev.status, ==, EVENT_STATUS_LOCKED);
+    g_assert_cmpint(ev.wall, ==, 1769600754);
+    g_assert_cmpstr(ev.title, ==, "");
+    event_record_clear(&ev);
+
+    /* A string running past its record, and an absurd length */
+    guint8 *bad = g_memdup2(buf->data, first);
+    bad[4 + 16] = 0xff;
+    g_assert_cmpint(event_record_parse(bad, first, &ev, &consumed), ==, -1);
+    memset(bad, 0xff, 4);
+    g_assert_cmpint(event_record_parse(bad, first, &ev, &consumed), ==, -1);
+    g_free(bad);
+    g_byte_array_free(buf, TRUE);
+}
+
+static void test_long_string_cut(void)
+{
+    GString *title = g_string_new(NULL);
+    while (title->len < 70000)
+        g_string_append(title, "\xe2\x82\xac");
+    CsvRecord rec = {0, 1, "active", title->str, "", "", "", ""};
+    GByteArray *buf = g_byte_array_new();
+    event_record_encode(buf, EVENT_FINISHED, &rec, 1);
+
+    EventRecord ev;
+    gsize consumed;
+    g_assert_cmpint(event_record_parse(buf->data, buf->len, &ev, &consumed), ==, 1);
+    g_assert_cmpuint(strlen(ev.title), <=, 65536);
+    g_assert_cmpuint(strlen(ev.title), >, 65530);
+    g_assert_true(g_utf8_validate(ev.title, -1, NULL));
+    event_record_clear(&ev);
+    g_byte_array_free(buf, TRUE);
+    g_string_free(title, TRUE);
+}
+
+/* ── Subscribing ───────────────────────────────────── */
+
+static void test_start_then_records(void)
+{
+    Fixture fixture, *f = &fixture;
+    fixture_setup(f);
+    Client *c = client_connect(f);
+    EventRecord ev;
+
+    /* A new subscriber first learns the interval in progress */
+    g_assert_true(client_next(c, &ev));
+    assert_started_terminal(&ev, &f->state);
+    event_record_clear(&ev);
+
+    /* Then what the tracker does, in order */
+    CsvRecord rec = {f->state.current_wall, 90, "active", "Terminal",
+                     "Gnome-terminal", "gnome-terminal", "", ""};
+    event_stream_publish_record(&f->stream, &rec);
+    f->state.is_locked = TRUE;
+    event_stream_publish_start(&f->stream);
+
+    g_assert_true(client_next(c, &ev));
+    assert_finished(&ev, &rec);
+    event_record_clear(&ev);
+    g_assert_true(client_next(c, &ev));
+    g_assert_cmpuint(ev.kind, ==, EVENT_STARTED);
+    g_assert_cmpuint(ev.status, ==, EVENT_STATUS_LOCKED);
+    g_assert_cmpstr(ev.title, ==, "");
+    event_record_clear(&ev);
+    g_assert_cmpuint(f->stream.published, ==, 2);
+
+    /* Cleanup ends the stream */
+    event_stream_cleanup(&f->stream);
+    g_assert_false(client_next(c, &ev));
+    client_free(c);
+    fixture_teardown(f);
+}
+
+static void test_subscriber_leaves(void)
+{
+    Fixture fixture, *f = &fixture;
+    fixture_setup(f);
+    Client *a = client_connect(f);
+    Client *b = client_connect(f);
+    g_assert_cmpuint(f->stream.subscribers->len, ==, 2);
+
+    close(a->fd);
+    a->fd = -1;
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (f->stream.subscribers->len > 1) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, TRUE);
+    }
+
+    /* Publishing to those left still works */
+    CsvRecord rec = {f->state.current_wall, 90, "active", "Terminal",
+                     "Gnome-terminal", "gnome-terminal", "", ""};
+    event_stream_publish_record(&f->stream, &rec);
+    EventRecord ev;
+    g_assert_true(client_next(b, &ev));
+    event_record_clear(&ev);
+    g_assert_true(client_next(b, &ev));
+    assert_finished(&ev, &rec);
+    event_record_clear(&ev);
+
+    client_free(a);
+    client_free(b);
+    fixture_teardown(f);
+}
+
+/* Publishes until sub's queue overflows; returns how many were published */
+static int publish_until_full(Fixture *f, guint64 *counter)
+{
+    gchar title[256];
+    CsvRecord rec;
+    int i = 0;
+    guint64 before = *counter;
+    while (*counter == before) {
+        numbered_record(&rec, title, sizeof(title), i++);
+        event_stream_publish_record(&f->stream, &rec);
+        g_assert_cmpint(i, <, 100000);
+    }
+    return i;
+}
+
+static void test_slow_subscriber_dropped(void)
+{
+    Fixture fixture, *f = &fixture;
+    fixture_setup(f);
+    f->stream.queue_limit = 8 * 1024;
+    Client *c = client_connect(f);
+    EventSubscriber *sub = g_ptr_array_index(f->stream.subscribers, 0);
+
+    /* Not reading: the socket fills up, then the queue */
+    int published = publish_until_full(f, &f->stream.dropped);
+    g_assert_cmpuint(event_subscriber_queued(sub), <=, f->stream.queue_limit);
+    gchar title[256];
+    CsvRecord rec;
+    for (int i = 0; i < 10; i++) {
+        numbered_record(&rec, title, sizeof(title), published + i);
+        event_stream_publish_record(&f->stream, &rec);
+    }
+    g_assert_cmpuint(f->stream.dropped, ==, 11);
+    g_assert_cmpuint(event_subscriber_queued(sub), <=, f->stream.queue_limit);
+    g_assert_cmpuint(f->stream.subscribers->len, ==, 1);
+
+    /* Reading again: everything before the gap in order, then the gap,
+     * then where the tracker is now */
+    EventRecord ev;
+    g_assert_true(client_next(c, &ev));
+    assert_started_terminal(&ev, &f->state);
+    event_record_clear(&ev);
+    int expected = 0;
+    for (;;) {
+        g_assert_true(client_next(c, &ev));
+        if (ev.kind != EVENT_FINISHED)
+            break;
+        numbered_record(&rec, title, sizeof(title), expected++);
+        assert_finished(&ev, &rec);
+        event_record_clear(&ev);
+    }
+    g_assert_cmpint(expected, ==, published - 1);
+    g_assert_cmpuint(ev.kind, ==, EVENT_LOST);
+    g_assert_cmpuint(ev.count, ==, 11);
+    event_record_clear(&ev);
+    g_assert_true(client_next(c, &ev));
+    assert_started_terminal(&ev, &f->state);
+    event_record_clear(&ev);
+
+    /* Caught up: nothing is dropped any more */
+    numbered_record(&rec, title, sizeof(title), 0);
+    event_stream_publish_record(&f->stream, &rec);
+    g_assert_true(client_next(c, &ev));
+    assert_finished(&ev, &rec);
+    event_record_clear(&ev);
+    g_assert_cmpuint(f->stream.dropped, ==, 11);
+
+    client_free(c);
+    fixture_teardown(f);
+}
+
+static void test_slow_subscriber_disconnected(void)
+{
+    Fixture fixture, *f = &fixture;
+    fixture_setup(f);
+    f->stream.queue_limit = 8 * 1024;
+    f->stream.policy = EVENT_STREAM_DISCONNECT;
+    Client *slow = client_connect(f);
+    Client *fast = client_connect(f);
+    EventRecord ev;
+    g_assert_true(client_next(fast, &ev));
+    event_record_clear(&ev);
+
+    /* The fast one reads along; the slow one is let go once full */
+    gchar title[256];
+    CsvRecord rec;
+    int i = 0;
+    while (f->stream.disconnected == 0) {
+        numbered_record(&rec, title, sizeof(title), i);
+        event_stream_publish_record(&f->stream, &rec);
+        g_assert_true(client_next(fast, &ev));
+        assert_finished(&ev, &rec);
+        event_record_clear(&ev);
+        g_assert_cmpint(++i, <, 100000);
+    }
+    g_assert_cmpuint(f->stream.subscribers->len, ==, 1);
+    g_assert_cmpuint(f->stream.dropped, ==, 0);
+
+    /* What reached its socket before is still there, then the end */
+    int received = 0;
+    while (client_next(slow, &ev)) {
+        event_record_clear(&ev);
+        received++;
+    }
+    g_assert_cmpint(received, >, 1);
+    g_assert_cmpint(received, <, i + 1);
+
+    client_free(slow);
+    client_free(fast);
+    fixture_teardown(f);
+}
+
+/* ── Load ──────────────────────────────────────────────
+ *
+ * Hundreds of subscribers, a few of which never read.  The readers poll
+ * their sockets on a thread of their own and check that every record
+ * arrives in order; the ones that never read must stay within their
+ * queue limit and cost the publisher nothing more. */
+
+#define LOAD_SUBSCRIBERS 256
+#define LOAD_STUCK       16
+#define LOAD_RECORDS     2000
+#define LOAD_BATCH       40
+
+typedef struct {
+    int fds[LOAD_SUBSCRIBERS - LOAD_STUCK];
+    GByteArray *bufs[LOAD_SUBSCRIBERS - LOAD_STUCK];
+    int next[LOAD_SUBSCRIBERS - LOAD_STUCK];  /* record expected, -1: START */
+    gint received;                            /* records, all readers */
+    gint errors;
+    gint running;
+} LoadReaders;
+
+static gpointer load_reader_thread(gpointer data)
+{
+    LoadReaders *r = data;
+    const int n = LOAD_SUBSCRIBERS - LOAD_STUCK;
+    struct pollfd pfds[LOAD_SUBSCRIBERS - LOAD_STUCK];
+    gchar title[256];
+    CsvRecord rec;
+
+    while (g_atomic_int_get(&r->running)) {
+        for (int i = 0; i < n; i++)
+            pfds[i] = (struct pollfd){r->fds[i], POLLIN, 0};
+        if (poll(pfds, n, 50) <= 0)
+            continue;
+
+        for (int i = 0; i < n; i++) {
+            if (!(pfds[i].revents & POLLIN))
+                continue;
+            guint8 chunk[16384];
+            ssize_t got = recv(r->fds[i], chunk, sizeof(chunk), MSG_DONTWAIT);
+            if (got <= 0)
+                continue;
+            g_byte_array_append(r->bufs[i], chunk, got);
+
+            EventRecord ev;
+            gsize consumed, offset = 0;
+            while (event_record_parse(r->bufs[i]->data + offset,
+                                      r->bufs[i]->len - offset,
+                                      &ev, &consumed) == 1) {
+                offset += consumed;
+                gboolean ok;
+                if (r->next[i] < 0) {
+                    ok = ev.kind == EVENT_STARTED;
+                } else {
+                    numbered_record(&rec, title, sizeof(title), r->next[i]);
+                    ok = ev.kind == EVENT_FINISHED &&
+                         g_strcmp0(ev.title, rec.title) == 0 &&
+                         ev.wall == rec.wall;
+                }
+                if (!ok)
+                    g_atomic_int_inc(&r->errors);
+                r->next[i]++;
+                event_record_clear(&ev);
+                g_atomic_int_inc(&r->received);
+            }
+            g_byte_array_remove_range(r->bufs[i], 0, offset);
+        }
+    }
+    return NULL;
+}
+
+static void test_load(void)
+{
+    Fixture fixture, *f = &fixture;
+    fixture_setup(f);
+    f->stream.queue_limit = 32 * 1024;
+    LoadReaders readers = {0};
+    int stuck[LOAD_STUCK];
+    GError *error = NULL;
+
+    /* Every 16th subscriber never reads */
+    for (int i = 0, r = 0, s = 0; i < LOAD_SUBSCRIBERS; i++) {
+        int fd = event_stream_connect(f->path, &error);
+        g_assert_no_error(error);
+        if (i % (LOAD_SUBSCRIBERS / LOAD_STUCK) == 0) {
+            stuck[s++] = fd;
+        } else {
+            readers.fds[r] = fd;
+            readers.bufs[r] = g_byte_array_new();
+            readers.next[r++] = -1;
+        }
+    }
+    while (f->stream.subscribers->len < LOAD_SUBSCRIBERS)
+        g_main_context_iteration(NULL, TRUE);
+
+    g_atomic_int_set(&readers.running, 1);
+    GThread *thread = g_thread_new("load-readers", load_reader_thread, &readers);
+
+    /* Batches well within a socket buffer, each read before the next as
+     * a real subscriber keeps up with focus changes */
+    const int n_readers = LOAD_SUBSCRIBERS - LOAD_STUCK;
+    gchar title[256];
+    CsvRecord rec;
+    double slowest = 0, total = 0;
+    for (int i = 0; i < LOAD_RECORDS; i++) {
+        numbered_record(&rec, title, sizeof(title), i);
+        gint64 start = g_get_monotonic_time();
+        event_stream_publish_record(&f->stream, &rec);
+        double took = (g_get_monotonic_time() - start) / 1e3;
+        slowest = MAX(slowest, took);
+        total += took;
+
+        if ((i + 1) % LOAD_BATCH == 0 || i + 1 == LOAD_RECORDS) {
+            gint want = n_readers * (i + 2);  /* START and records so far */
+            gint64 deadline = g_get_monotonic_time() + 10 * G_USEC_PER_SEC;
+            while (g_atomic_int_get(&readers.received) < want) {
+                g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+                iterate_main_context();
+                g_usleep(200);
+            }
+        }
+    }
+    g_atomic_int_set(&readers.running, 0);
+    g_thread_join(thread);
+
+    g_test_message("%d subscribers (%d stuck), %d records: %.3f ms per "
+                   "publish, slowest %.3f ms",
+                   LOAD_SUBSCRIBERS, LOAD_STUCK, LOAD_RECORDS,
+                   total / LOAD_RECORDS, slowest);
+
+    g_assert_cmpint(g_atomic_int_get(&readers.errors), ==, 0);
+    g_assert_cmpint(g_atomic_int_get(&readers.received), ==,
+                    n_readers * (LOAD_RECORDS + 1));
+    g_assert_cmpuint(f->stream.subscribers->len, ==, LOAD_SUBSCRIBERS);
+    g_assert_cmpuint(f->stream.dropped, >, 0);
+    for (guint i = 0; i < f->stream.subscribers->len; i++) {
+        EventSubscriber *sub = g_ptr_array_index(f->stream.subscribers, i);
+        g_assert_cmpuint(event_subscriber_queued(sub), <=,
+                         f->stream.queue_limit);
+    }
+
+    for (int i = 0; i < n_readers; i++) {
+        close(readers.fds[i]);
+        g_byte_array_free(readers.bufs[i], TRUE);
+    }
+    for (int i = 0; i < LOAD_STUCK; i++)
+        close(stuck[i]);
+    fixture_teardown(f);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/event-stream/encode_parse", test_encode_parse);
+    g_test_add_func("/event-stream/long_string_cut", test_long_string_cut);
+    g_test_add_func("/event-stream/start_then_records",
+                    test_start_then_records);
+    g_test_add_func("/event-stream/subscriber_leaves", test_subscriber_leaves);
+    g_test_add_func("/event-stream/slow_subscriber_dropped",
+                    test_slow_subscriber_dropped);
+    g_test_add_func("/event-stream/slow_subscriber_disconnected",
+                    test_slow_subscriber_disconnected);
+    g_test_add_func("/event-stream/load", test_load);
+
+    return g_test_run();
+}
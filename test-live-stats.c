@@ -0,0 +1,398 @@
+#include <glib.h>
+#include "live-stats.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("live-stats-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+static gchar *report_to_string(const DayStats *stats)
+{
+    gchar *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    g_assert_nonnull(out);
+    StatsOptions opts = {.top_apps = 1000, .top_titles = 1000, .cols = 120};
+    print_stats_report(out, stats, 2026, 1, 28, &opts);
+    fclose(out);
+    return buf;
+}
+
+static void assert_same_stats(const DayStats *a, const DayStats *b)
+{
+    g_assert_cmpint(a->total_active_seconds, ==, b->total_active_seconds);
+    g_assert_cmpint(a->total_locked_seconds, ==, b->total_locked_seconds);
+    g_assert_cmpint(a->total_afk_active_seconds, ==, b->total_afk_active_seconds);
+    gchar *ra = report_to_string(a);
+    gchar *rb = report_to_string(b);
+    g_assert_cmpstr(ra, ==, rb);
+    g_free(ra);
+    g_free(rb);
+}
+
+/* Every kind of record the tracker writes */
+static const CsvRecord sample[] = {
+    {0, 120, "active", "Main.java - \"app\" - IntelliJ IDEA", "jetbrains-idea",
+     "jetbrains-idea", "Editing Main.java", "app"},
+    {0, 30, "active", "Inbox - Mail", "Thunderbird", "Mail", "", ""},
+    {0, 600, "locked", "", "", "", "", ""},
+    {0, 300, "idle", "", "", "", "", ""},
+    {0, 45, "active", "", "gnome-shell", "gnome-shell", "", ""},
+    {0, 60, "active", "Line one\nline two, \"quoted\"", "org.gnome.TextEditor",
+     "gnome-text-editor", "", ""},
+    {0, 15, "active", "Voice chat", "discord", "discord", "", "In a call"},
+    {0, 20, "active", "Inbox - Mail", "Thunderbird", "Mail", "", ""},
+    {0, 90, "active", "Main.java - \"app\" - IntelliJ IDEA", "jetbrains-idea",
+     "jetbrains-idea", "Editing Main.java", "app"},
+};
+
+/* ── Counting ──────────────────────────────────────── */
+
+static void test_add_record_matches_file(void)
+{
+    /* Counted live or read back from the file, a record counts the same */
+    GString *csv = g_string_new(CSV_HEADER);
+    DayStats *live = day_stats_new();
+    for (gsize i = 0; i < G_N_ELEMENTS(sample); i++) {
+        CsvRecord rec = sample[i];
+        rec.wall = time(NULL);
+        serialize_csv_record(csv, &rec, NULL);
+        day_stats_add_record(live, &rec);
+    }
+    day_stats_sort(live);
+
+    DayStats *parsed = compute_csv_stats(csv->str, csv->len, 1,
+                                         CSV_STATS_MIN_CHUNK, NULL);
+    assert_same_stats(live, parsed);
+    g_assert_cmpint(live->total_afk_active_seconds, ==, 45);
+    g_assert_cmpint(live->total_locked_seconds, ==, 900);
+
+    free_day_stats(parsed);
+    free_day_stats(live);
+    g_string_free(csv, TRUE);
+}
+
+static void test_variant_round_trip(void)
+{
+    DayStats *stats = day_stats_new();
+    for (gsize i = 0; i < G_N_ELEMENTS(sample); i++)
+        day_stats_add_record(stats, &sample[i]);
+    day_stats_sort(stats);
+
+    GVariant *value = g_variant_ref_sink(day_stats_to_variant(stats));
+    DayStats *copy = day_stats_from_variant(value);
+    assert_same_stats(stats, copy);
+    g_variant_unref(value);
+    free_day_stats(copy);
+
+    /* A title that is not UTF-8 still crosses the bus */
+    CsvRecord rec = {0, 5, "active", "Caf\xe9", "Browser", "browser", "", ""};
+    day_stats_add_record(stats, &rec);
+    value = g_variant_ref_sink(day_stats_to_variant(stats));
+    copy = day_stats_from_variant(value);
+    g_assert_cmpint(copy->total_active_seconds, ==, stats->total_active_seconds);
+    for (guint i = 0; i < copy->apps->len; i++) {
+        const AppStat *app = g_ptr_array_index(copy->apps, i);
+        for (const TitleStat *t = app->titles; t; t = t->next)
+            g_assert_true(g_utf8_validate(t->title, -1, NULL));
+    }
+    g_variant_unref(value);
+    free_day_stats(copy);
+    free_day_stats(stats);
+}
+
+static void test_seeded_from_day_file(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    time_t now = time(NULL);
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+    for (gsize i = 0; i < 4; i++) {
+        CsvRecord rec = sample[i];
+        rec.wall = now;
+        write_csv_record(&state, &rec);
+    }
+    close_output_file(&state);
+
+    /* The tracker restarts: what the day file holds comes first */
+    LiveStats live;
+    live_stats_init(&live, &state, now, 1, NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    gchar *path = build_csv_path(tmpdir, tm.tm_year + 1900, tm.tm_mon + 1,
+                                 tm.tm_mday);
+    DayStats *expected = compute_day_stats(path);
+    assert_same_stats(live.stats, expected);
+
+    for (gsize i = 4; i < G_N_ELEMENTS(sample); i++) {
+        CsvRecord rec = sample[i];
+        rec.wall = now;
+        live_stats_add_record(&live, &rec);
+        day_stats_add_record(expected, &rec);
+    }
+    day_stats_sort(expected);
+    day_stats_sort(live.stats);
+    assert_same_stats(live.stats, expected);
+
+    /* A record from before the clock went back stays out */
+    CsvRecord rec = sample[1];
+    rec.wall = now - 2 * 24 * 3600;
+    live_stats_add_record(&live, &rec);
+    assert_same_stats(live.stats, expected);
+
+    /* The first record of the next day starts that day */
+    rec.wall = now + 24 * 3600;
+    live_stats_add_record(&live, &rec);
+    g_assert_cmpint(live.stats->total_active_seconds, ==, rec.duration);
+    g_assert_null(live_stats_snapshot(&live, tm.tm_year + 1900,
+                                      tm.tm_mon + 1, tm.tm_mday,
+                                      g_get_monotonic_time()));
+
+    live_stats_clear(&live);
+    free_day_stats(expected);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Tracker serving GetDayStats on a test bus ─────────
+ *
+ * The service gets its own connection and thread, as the tracker's main
+ * loop would be running while a second instance waits for the reply. */
+
+typedef struct {
+    GTestDBus *bus;
+    GThread *thread;
+    GMainContext *context;
+    GMainLoop *loop;
+    GDBusConnection *connection;
+    LiveStats live;
+    AppState state;
+    GMutex lock;
+    GCond cond;
+    gboolean ready;
+} MockTracker;
+
+static GDBusConnection *connect_test_bus(GTestDBus *bus)
+{
+    GError *error = NULL;
+    GDBusConnection *conn = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(bus),
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+        G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &error);
+    g_assert_no_error(error);
+    return conn;
+}
+
+static void close_test_bus(GDBusConnection *conn)
+{
+    g_dbus_connection_close_sync(conn, NULL, NULL);
+    g_object_unref(conn);
+}
+
+static gpointer mock_tracker_thread(gpointer data)
+{
+    MockTracker *mock = data;
+    GError *error = NULL;
+
+    g_main_context_push_thread_default(mock->context);
+    mock->connection = connect_test_bus(mock->bus);
+    g_assert_true(live_stats_export(&mock->live, mock->connection, &error));
+    g_assert_no_error(error);
+
+    g_mutex_lock(&mock->lock);
+    mock->ready = TRUE;
+    g_cond_signal(&mock->cond);
+    g_mutex_unlock(&mock->lock);
+
+    g_main_loop_run(mock->loop);
+
+    live_stats_unexport(&mock->live);
+    close_test_bus(mock->connection);
+    g_main_context_pop_thread_default(mock->context);
+    return NULL;
+}
+
+/* A tracker that has counted sample[] today and is 90 s into a window */
+static MockTracker *mock_tracker_start(GTestDBus *bus)
+{
+    MockTracker *mock = g_new0(MockTracker, 1);
+    mock->bus = bus;
+    mock->context = g_main_context_new();
+    mock->loop = g_main_loop_new(mock->context, FALSE);
+    g_mutex_init(&mock->lock);
+    g_cond_init(&mock->cond);
+
+    /* No day file: data_dir is empty */
+    gchar *tmpdir = create_test_tmpdir();
+    mock->state.data_dir = tmpdir;
+    live_stats_init(&mock->live, &mock->state, time(NULL), 1, NULL);
+    for (gsize i = 0; i < G_N_ELEMENTS(sample); i++) {
+        CsvRecord rec = sample[i];
+        rec.wall = time(NULL);
+        live_stats_add_record(&mock->live, &rec);
+    }
+    start_tracking(&mock->state, "Terminal", "Gnome-terminal",
+                   "gnome-terminal", NULL, NULL, 4242, FALSE);
+    mock->state.current_start -= 90 * G_USEC_PER_SEC;
+
+    mock->thread = g_thread_new("mock-tracker", mock_tracker_thread, mock);
+    g_mutex_lock(&mock->lock);
+    while (!mock->ready)
+        g_cond_wait(&mock->cond, &mock->lock);
+    g_mutex_unlock(&mock->lock);
+    return mock;
+}
+
+static void mock_tracker_stop(MockTracker *mock)
+{
+    g_main_loop_quit(mock->loop);
+    g_thread_join(mock->thread);
+    g_main_loop_unref(mock->loop);
+    g_main_context_unref(mock->context);
+    g_mutex_clear(&mock->lock);
+    g_cond_clear(&mock->cond);
+    live_stats_clear(&mock->live);
+    g_free(mock->state.current_title);
+    g_free(mock->state.current_wm_class);
+    g_free(mock->state.current_wm_class_instance);
+    g_free(mock->state.current_rp_state);
+    g_free(mock->state.current_rp_details);
+    cleanup_test_tmpdir((gchar *)mock->state.data_dir);
+    g_free(mock);
+}
+
+static void today(int *year, int *month, int *day)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    *year = tm.tm_year + 1900;
+    *month = tm.tm_mon + 1;
+    *day = tm.tm_mday;
+}
+
+/* ── D-Bus tests ───────────────────────────────────── */
+
+static void test_query_without_tracker(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    int year, month, day;
+    today(&year, &month, &day);
+    DayStats *stats = NULL;
+    GError *error = NULL;
+    g_assert_false(live_stats_query(conn, year, month, day, &stats, &error));
+    g_assert_error(error, G_DBUS_ERROR, G_DBUS_ERROR_NAME_HAS_NO_OWNER);
+    g_assert_null(stats);
+    g_error_free(error);
+
+    close_test_bus(conn);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_query_includes_current_interval(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockTracker *mock = mock_tracker_start(bus);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    DayStats *expected = day_stats_new();
+    for (gsize i = 0; i < G_N_ELEMENTS(sample); i++)
+        day_stats_add_record(expected, &sample[i]);
+    day_stats_sort(expected);
+
+    int year, month, day;
+    today(&year, &month, &day);
+    DayStats *stats = NULL;
+    GError *error = NULL;
+    g_assert_true(live_stats_query(conn, year, month, day, &stats, &error));
+    g_assert_no_error(error);
+    g_assert_nonnull(stats);
+
+    /* Everything finished, plus the terminal so far */
+    g_assert_cmpint(stats->total_locked_seconds, ==, expected->total_locked_seconds);
+    long in_progress = stats->total_active_seconds - expected->total_active_seconds;
+    g_assert_cmpint(in_progress, >=, 90);
+    g_assert_cmpint(in_progress, <, 120);
+    CsvRecord terminal = {0, in_progress, "active", "Terminal", "Gnome-terminal",
+                          "gnome-terminal", "", ""};
+    day_stats_add_record(expected, &terminal);
+    day_stats_sort(expected);
+    assert_same_stats(stats, expected);
+    free_day_stats(stats);
+    g_assert_cmpuint(mock->live.queries, ==, 1);
+
+    /* Another day is left to the day files */
+    g_assert_true(live_stats_query(conn, year - 1, month, day, &stats, &error));
+    g_assert_no_error(error);
+    g_assert_null(stats);
+
+    free_day_stats(expected);
+    close_test_bus(conn);
+    mock_tracker_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_second_export_refused(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockTracker *mock = mock_tracker_start(bus);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    AppState state = {0};
+    LiveStats other;
+    live_stats_init(&other, &state, time(NULL), 1, NULL);
+    GError *error = NULL;
+    g_assert_false(live_stats_export(&other, conn, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_EXISTS);
+    g_error_free(error);
+    live_stats_clear(&other);
+
+    close_test_bus(conn);
+    mock_tracker_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/live-stats/add_record_matches_file",
+                    test_add_record_matches_file);
+    g_test_add_func("/live-stats/variant_round_trip", test_variant_round_trip);
+    g_test_add_func("/live-stats/seeded_from_day_file", test_seeded_from_day_file);
+    g_test_add_func("/live-stats/query_without_tracker",
+                    test_query_without_tracker);
+    g_test_add_func("/live-stats/query_includes_current_interval",
+                    test_query_includes_current_interval);
+    g_test_add_func("/live-stats/second_export_refused",
+                    test_second_export_refused);
+
+    return g_test_run();
+}
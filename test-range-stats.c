@@ -0,0 +1,280 @@
+#include <glib.h>
+#include "range-stats.h"
+#include "day-archive.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("range-stats-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+static void set_date(GDate *date, int year, int month, int day)
+{
+    g_date_clear(date, 1);
+    g_date_set_dmy(date, day, month, year);
+}
+
+static void assert_date(const GDate *date, int year, int month, int day)
+{
+    g_assert_cmpint(g_date_get_year(date), ==, year);
+    g_assert_cmpint(g_date_get_month(date), ==, month);
+    g_assert_cmpint(g_date_get_day(date), ==, day);
+}
+
+/* Writes a day of records drawn from rand, starting at 08:00 */
+static void write_random_day(AppState *state, GRand *rand, const GDate *date,
+                             int records)
+{
+    struct tm tm = {0};
+    tm.tm_year = g_date_get_year(date) - 1900;
+    tm.tm_mon = g_date_get_month(date) - 1;
+    tm.tm_mday = g_date_get_day(date);
+    tm.tm_hour = 8;
+    tm.tm_isdst = -1;
+    time_t t = mktime(&tm);
+
+    for (int i = 0; i < records; i++) {
+        gchar title[128], wm_class[64];
+        int doc = (int)(g_rand_double(rand) * g_rand_double(rand) * 150);
+        g_snprintf(wm_class, sizeof(wm_class), "org.example.Application%d",
+                   doc % 40);
+        g_snprintf(title, sizeof(title), "Document %d - Project %d - "
+                   "Application %d", doc, doc % 17, doc % 40);
+        gboolean locked = g_rand_int_range(rand, 0, 10) == 0;
+        CsvRecord rec = {t, g_rand_int_range(rand, 1, 180),
+                         locked ? "locked" : "active",
+                         locked ? "" : title, locked ? "" : wm_class,
+                         locked ? "" : wm_class + 12, "", ""};
+        t += rec.duration;
+        write_csv_record(state, &rec);
+    }
+}
+
+static void write_random_range(const gchar *dir, const GDate *first,
+                               int days, int records)
+{
+    AppState state = {0};
+    state.data_dir = dir;
+    state.durability = DURABILITY_ROTATION;
+    GRand *rand = g_rand_new_with_seed(42);
+    GDate date = *first;
+    for (int d = 0; d < days; d++, g_date_add_days(&date, 1))
+        write_random_day(&state, rand, &date, records);
+    g_rand_free(rand);
+    close_output_file(&state);
+}
+
+static gchar *report_to_string(const DayStats *stats, const GDate *first,
+                               const GDate *last, const RangeStatsInfo *info)
+{
+    gchar *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    g_assert_nonnull(out);
+    StatsOptions opts = {.top_apps = 50, .top_titles = 200, .cols = 100};
+    print_range_report(out, stats, first, last, info, &opts);
+    fclose(out);
+    return buf;
+}
+
+/* ── Tests ─────────────────────────────────────────── */
+
+static void test_period_bounds(void)
+{
+    GDate date, first, last;
+
+    /* A Wednesday; its week crosses into February */
+    set_date(&date, 2026, 1, 28);
+    range_for_period(RANGE_WEEK, &date, &first, &last);
+    assert_date(&first, 2026, 1, 26);
+    assert_date(&last, 2026, 2, 1);
+
+    /* Sunday belongs to the week that started six days earlier */
+    set_date(&date, 2026, 2, 1);
+    range_for_period(RANGE_WEEK, &date, &first, &last);
+    assert_date(&first, 2026, 1, 26);
+
+    set_date(&date, 2024, 2, 10);
+    range_for_period(RANGE_MONTH, &date, &first, &last);
+    assert_date(&first, 2024, 2, 1);
+    assert_date(&last, 2024, 2, 29);
+
+    range_for_period(RANGE_YEAR, &date, &first, &last);
+    assert_date(&first, 2024, 1, 1);
+    assert_date(&last, 2024, 12, 31);
+}
+
+static void test_range_sums_days(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    GDate first, last;
+    set_date(&first, 2026, 1, 27);
+    write_random_range(tmpdir, &first, 4, 50);
+
+    /* A day without data in the middle */
+    gchar *gap_path = build_csv_path(tmpdir, 2026, 1, 29);
+    g_assert_cmpint(unlink(gap_path), ==, 0);
+    g_free(gap_path);
+
+    set_date(&last, 2026, 1, 31);
+    RangeStatsInfo info;
+    DayStats *range = compute_range_stats(tmpdir, &first, &last, 2, &info);
+    g_assert_cmpint(info.days, ==, 5);
+    g_assert_cmpint(info.days_found, ==, 3);
+    g_assert_cmpint(info.days_failed, ==, 0);
+
+    long active = 0, locked = 0;
+    for (int d = 27; d <= 31; d++) {
+        gboolean found;
+        DayStats *day = load_day_stats(tmpdir, 2026, 1, d, 1, NULL, &found);
+        g_assert_true(found == (d != 29 && d != 31));
+        if (day) {
+            active += day->total_active_seconds;
+            locked += day->total_locked_seconds;
+            free_day_stats(day);
+        }
+    }
+    g_assert_cmpint(range->total_active_seconds, ==, active);
+    g_assert_cmpint(range->total_locked_seconds, ==, locked);
+
+    long app_total = 0;
+    for (guint i = 0; i < range->apps->len; i++) {
+        AppStat *app = g_ptr_array_index(range->apps, i);
+        app_total += app->total_seconds;
+        if (i > 0) {
+            AppStat *prev = g_ptr_array_index(range->apps, i - 1);
+            g_assert_cmpint(prev->total_seconds, >=, app->total_seconds);
+        }
+    }
+    g_assert_cmpint(app_total, ==, active);
+
+    free_day_stats(range);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_report_independent_of_threads(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    GDate first, last;
+    set_date(&first, 2026, 1, 1);
+    write_random_range(tmpdir, &first, 31, 100);
+    set_date(&last, 2026, 1, 31);
+
+    gchar *expected = NULL;
+    static const guint threads[] = {1, 2, 3, 8, 31};
+    for (gsize i = 0; i < G_N_ELEMENTS(threads); i++) {
+        RangeStatsInfo info;
+        DayStats *stats = compute_range_stats(tmpdir, &first, &last,
+                                              threads[i], &info);
+        g_assert_cmpint(info.days_found, ==, 31);
+        gchar *report = report_to_string(stats, &first, &last, &info);
+        if (!expected)
+            expected = report;
+        else {
+            g_assert_cmpstr(report, ==, expected);
+            g_free(report);
+        }
+        free_day_stats(stats);
+    }
+    g_assert_nonnull(strstr(expected, "Activity Report for 2026-01-01 to "
+                                      "2026-01-31 (31 days tracked)\n"));
+
+    g_free(expected);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_unreadable_day_skipped(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    GDate first, last;
+    set_date(&first, 2026, 1, 27);
+    write_random_range(tmpdir, &first, 2, 20);
+    set_date(&last, 2026, 1, 29);
+
+    gchar *csv_path = build_csv_path(tmpdir, 2026, 1, 29);
+    gchar *gz_path = g_strconcat(csv_path, DAY_ARCHIVE_SUFFIX, NULL);
+    g_assert_true(g_file_set_contents(gz_path, "not gzip\n", -1, NULL));
+
+    RangeStatsInfo info;
+    DayStats *stats = compute_range_stats(tmpdir, &first, &last, 0, &info);
+    g_assert_cmpint(info.days, ==, 3);
+    g_assert_cmpint(info.days_found, ==, 3);
+    g_assert_cmpint(info.days_failed, ==, 1);
+    g_assert_cmpint(stats->total_active_seconds, >, 0);
+
+    free_day_stats(stats);
+    g_free(gz_path);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+static void test_perf_year_range(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    gchar *tmpdir = create_test_tmpdir();
+    GDate first, last;
+    set_date(&first, 2025, 1, 1);
+    set_date(&last, 2025, 12, 31);
+    write_random_range(tmpdir, &first, 365, 400);
+
+    guint cpus = g_get_num_processors();
+    double single = 0;
+    for (guint threads = 1; threads <= MAX(cpus, 4); threads *= 2) {
+        RangeStatsInfo info;
+        g_test_timer_start();
+        DayStats *stats = compute_range_stats(tmpdir, &first, &last,
+                                              threads, &info);
+        double elapsed = g_test_timer_elapsed();
+        g_assert_cmpint(info.days_found, ==, 365);
+        free_day_stats(stats);
+
+        if (threads == 1)
+            single = elapsed;
+        g_test_message("365 days x 400 records, %u thread%s: %.3f s "
+                       "(%.2fx, %u processors)", threads,
+                       threads == 1 ? "" : "s", elapsed, single / elapsed, cpus);
+        g_test_minimized_result(elapsed, "year report on %u threads: %.3f s",
+                                threads, elapsed);
+    }
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/range-stats/period_bounds", test_period_bounds);
+    g_test_add_func("/range-stats/sums_days", test_range_sums_days);
+    g_test_add_func("/range-stats/report_independent_of_threads",
+                    test_report_independent_of_threads);
+    g_test_add_func("/range-stats/unreadable_day_skipped",
+                    test_unreadable_day_skipped);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/range_stats_year", test_perf_year_range);
+
+    return g_test_run();
+}
@@ -0,0 +1,919 @@
+#include <glib.h>
+#include "session-events.h"
+#include <string.h>
+
+/* ── Mock gnome-shell exporting the companion extension interface ──
+ *
+ * The service lives on its own connection and thread, so replies arrive
+ * while the test's main context is blocked or busy, as with gnome-shell. */
+
+static const gchar mock_shell_xml[] =
+    "<node>"
+    "  <interface name='" FOCUS_EVENTS_INTERFACE "'>"
+    "    <method name='GetFocused'>"
+    "      <arg type='s' direction='out' name='windows'/>"
+    "    </method>"
+    "    <signal name='FocusChanged'>"
+    "      <arg type='s' name='windows'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+
+typedef struct {
+    GTestDBus *bus;
+    GThread *thread;
+    GMainContext *context;
+    GMainLoop *loop;
+    GDBusConnection *connection;
+    guint registration_id;
+    GMutex lock;
+    GCond cond;
+    gboolean ready;
+    gchar *focused_json;  /* reply to GetFocused, protected by lock */
+} MockShell;
+
+static void mock_shell_method_call(GDBusConnection *connection G_GNUC_UNUSED,
+                                   const gchar *sender G_GNUC_UNUSED,
+                                   const gchar *object_path G_GNUC_UNUSED,
+                                   const gchar *interface_name G_GNUC_UNUSED,
+                                   const gchar *method_name,
+                                   GVariant *parameters G_GNUC_UNUSED,
+                                   GDBusMethodInvocation *invocation,
+                                   gpointer user_data)
+{
+    MockShell *mock = user_data;
+    if (g_strcmp0(method_name, "GetFocused") != 0) {
+        g_dbus_method_invocation_return_dbus_error(
+            invocation, "org.freedesktop.DBus.Error.UnknownMethod", method_name);
+        return;
+    }
+    g_mutex_lock(&mock->lock);
+    GVariant *reply = g_variant_new("(s)", mock->focused_json);
+    g_mutex_unlock(&mock->lock);
+    g_dbus_method_invocation_return_value(invocation, reply);
+}
+
+static const GDBusInterfaceVTable mock_shell_vtable = {
+    mock_shell_method_call, NULL, NULL, {0}
+};
+
+static gpointer mock_shell_thread(gpointer data)
+{
+    MockShell *mock = data;
+    GError *error = NULL;
+
+    g_main_context_push_thread_default(mock->context);
+
+    mock->connection = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(mock->bus),
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+        G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(mock_shell_xml, &error);
+    g_assert_no_error(error);
+    mock->registration_id = g_dbus_connection_register_object(
+        mock->connection, FOCUS_EVENTS_OBJECT_PATH, node->interfaces[0],
+        &mock_shell_vtable, mock, NULL, &error);
+    g_assert_no_error(error);
+    g_dbus_node_info_unref(node);
+
+    GVariant *reply = g_dbus_connection_call_sync(
+        mock->connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+        "org.freedesktop.DBus", "RequestName",
+        g_variant_new("(su)", FOCUS_EVENTS_BUS_NAME, 4 /* DO_NOT_QUEUE */),
+        G_VARIANT_TYPE("(u)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+    g_assert_no_error(error);
+    g_variant_unref(reply);
+
+    g_mutex_lock(&mock->lock);
+    mock->ready = TRUE;
+    g_cond_signal(&mock->cond);
+    g_mutex_unlock(&mock->lock);
+
+    g_main_loop_run(mock->loop);
+
+    g_dbus_connection_unregister_object(mock->connection,
+                                        mock->registration_id);
+    g_dbus_connection_close_sync(mock->connection, NULL, NULL);
+    g_clear_object(&mock->connection);
+    g_main_context_pop_thread_default(mock->context);
+    return NULL;
+}
+
+static MockShell *mock_shell_start(GTestDBus *bus, const gchar *focused_json)
+{
+    MockShell *mock = g_new0(MockShell, 1);
+    mock->bus = bus;
+    mock->focused_json = g_strdup(focused_json);
+    mock->context = g_main_context_new();
+    mock->loop = g_main_loop_new(mock->context, FALSE);
+    g_mutex_init(&mock->lock);
+    g_cond_init(&mock->cond);
+
+    mock->thread = g_thread_new("mock-shell", mock_shell_thread, mock);
+    g_mutex_lock(&mock->lock);
+    while (!mock->ready)
+        g_cond_wait(&mock->cond, &mock->lock);
+    g_mutex_unlock(&mock->lock);
+    return mock;
+}
+
+static void mock_shell_emit(MockShell *mock, const gchar *json)
+{
+    GError *error = NULL;
+    g_dbus_connection_emit_signal(mock->connection, NULL,
+                                  FOCUS_EVENTS_OBJECT_PATH,
+                                  FOCUS_EVENTS_INTERFACE, "FocusChanged",
+                                  g_variant_new("(s)", json), &error);
+    g_assert_no_error(error);
+    g_dbus_connection_flush_sync(mock->connection, NULL, NULL);
+}
+
+static void mock_shell_stop(MockShell *mock)
+{
+    g_main_loop_quit(mock->loop);
+    g_thread_join(mock->thread);
+    g_main_loop_unref(mock->loop);
+    g_main_context_unref(mock->context);
+    g_mutex_clear(&mock->lock);
+    g_cond_clear(&mock->cond);
+    g_free(mock->focused_json);
+    g_free(mock);
+}
+
+/* ── Mock Mutter idle monitor ──────────────────────────
+ *
+ * Like the mock shell, on its own connection and thread.  Watches are
+ * fired from the test with mock_idle_fire_*(); a user-active watch goes
+ * away once fired, as in Mutter.  With watches_supported unset only
+ * GetIdletime answers, as with compositors that lack the watches. */
+
+static const gchar mock_idle_xml[] =
+    "<node>"
+    "  <interface name='" IDLE_MONITOR_INTERFACE "'>"
+    "    <method name='GetIdletime'>"
+    "      <arg type='t' direction='out' name='idletime'/>"
+    "    </method>"
+    "    <method name='AddIdleWatch'>"
+    "      <arg type='t' direction='in' name='interval'/>"
+    "      <arg type='u' direction='out' name='id'/>"
+    "    </method>"
+    "    <method name='AddUserActiveWatch'>"
+    "      <arg type='u' direction='out' name='id'/>"
+    "    </method>"
+    "    <method name='RemoveWatch'>"
+    "      <arg type='u' direction='in' name='id'/>"
+    "    </method>"
+    "    <signal name='WatchFired'>"
+    "      <arg type='u' name='id'/>"
+    "    </signal>"
+    "  </interface>"
+    "</node>";
+
+/* Everything below connection is protected by lock */
+typedef struct {
+    GTestDBus *bus;
+    GThread *thread;
+    GMainContext *context;
+    GMainLoop *loop;
+    GDBusConnection *connection;
+    guint registration_id;
+    GMutex lock;
+    GCond cond;
+    gboolean ready;
+    gboolean watches_supported;
+    guint64 idletime_ms;
+    guint32 next_id;
+    gchar *client;              /* sender of the watches */
+    guint32 idle_watch;         /* 0 when none */
+    guint64 idle_interval;
+    guint32 active_watch;
+    guint active_watches_added;
+    guint removed;
+    guint calls;
+} MockIdle;
+
+static void mock_idle_method_call(GDBusConnection *connection G_GNUC_UNUSED,
+                                  const gchar *sender,
+                                  const gchar *object_path G_GNUC_UNUSED,
+                                  const gchar *interface_name G_GNUC_UNUSED,
+                                  const gchar *method_name,
+                                  GVariant *parameters,
+                                  GDBusMethodInvocation *invocation,
+                                  gpointer user_data)
+{
+    MockIdle *mock = user_data;
+    GVariant *reply = NULL;
+
+    g_mutex_lock(&mock->lock);
+    mock->calls++;
+    if (g_strcmp0(method_name, "GetIdletime") == 0) {
+        reply = g_variant_new("(t)", mock->idletime_ms);
+    } else if (!mock->watches_supported) {
+        /* reply stays NULL */
+    } else if (g_strcmp0(method_name, "AddIdleWatch") == 0) {
+        g_variant_get(parameters, "(t)", &mock->idle_interval);
+        mock->idle_watch = ++mock->next_id;
+        g_free(mock->client);
+        mock->client = g_strdup(sender);
+        reply = g_variant_new("(u)", mock->idle_watch);
+    } else if (g_strcmp0(method_name, "AddUserActiveWatch") == 0) {
+        mock->active_watch = ++mock->next_id;
+        mock->active_watches_added++;
+        reply = g_variant_new("(u)", mock->active_watch);
+    } else if (g_strcmp0(method_name, "RemoveWatch") == 0) {
+        guint32 id;
+        g_variant_get(parameters, "(u)", &id);
+        if (id == mock->idle_watch)
+            mock->idle_watch = 0;
+        if (id == mock->active_watch)
+            mock->active_watch = 0;
+        mock->removed++;
+        reply = g_variant_new("()");
+    }
+    g_mutex_unlock(&mock->lock);
+
+    if (reply)
+        g_dbus_method_invocation_return_value(invocation, reply);
+    else
+        g_dbus_method_invocation_return_dbus_error(
+            invocation, "org.freedesktop.DBus.Error.UnknownMethod", method_name);
+}
+
+static const GDBusInterfaceVTable mock_idle_vtable = {
+    mock_idle_method_call, NULL, NULL, {0}
+};
+
+static gpointer mock_idle_thread(gpointer data)
+{
+    MockIdle *mock = data;
+    GError *error = NULL;
+
+    g_main_context_push_thread_default(mock->context);
+
+    mock->connection = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(mock->bus),
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+        G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &error);
+    g_assert_no_error(error);
+
+    GDBusNodeInfo *node = g_dbus_node_info_new_for_xml(mock_idle_xml, &error);
+    g_assert_no_error(error);
+    mock->registration_id = g_dbus_connection_register_object(
+        mock->connection, IDLE_MONITOR_OBJECT_PATH, node->interfaces[0],
+        &mock_idle_vtable, mock, NULL, &error);
+    g_assert_no_error(error);
+    g_dbus_node_info_unref(node);
+
+    GVariant *reply = g_dbus_connection_call_sync(
+        mock->connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+        "org.freedesktop.DBus", "RequestName",
+        g_variant_new("(su)", IDLE_MONITOR_BUS_NAME, 4 /* DO_NOT_QUEUE */),
+        G_VARIANT_TYPE("(u)"), G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+    g_assert_no_error(error);
+    g_variant_unref(reply);
+
+    g_mutex_lock(&mock->lock);
+    mock->ready = TRUE;
+    g_cond_signal(&mock->cond);
+    g_mutex_unlock(&mock->lock);
+
+    g_main_loop_run(mock->loop);
+
+    g_dbus_connection_unregister_object(mock->connection,
+                                        mock->registration_id);
+    g_dbus_connection_close_sync(mock->connection, NULL, NULL);
+    g_clear_object(&mock->connection);
+    g_main_context_pop_thread_default(mock->context);
+    return NULL;
+}
+
+static MockIdle *mock_idle_start(GTestDBus *bus, gboolean watches_supported,
+                                 guint64 idletime_ms)
+{
+    MockIdle *mock = g_new0(MockIdle, 1);
+    mock->bus = bus;
+    mock->watches_supported = watches_supported;
+    mock->idletime_ms = idletime_ms;
+    mock->context = g_main_context_new();
+    mock->loop = g_main_loop_new(mock->context, FALSE);
+    g_mutex_init(&mock->lock);
+    g_cond_init(&mock->cond);
+
+    mock->thread = g_thread_new("mock-idle", mock_idle_thread, mock);
+    g_mutex_lock(&mock->lock);
+    while (!mock->ready)
+        g_cond_wait(&mock->cond, &mock->lock);
+    g_mutex_unlock(&mock->lock);
+    return mock;
+}
+
+/* Sends WatchFired for *id to the client that added it */
+static void mock_idle_fire(MockIdle *mock, guint32 *id, gboolean one_shot)
+{
+    GError *error = NULL;
+    g_mutex_lock(&mock->lock);
+    guint32 fired = *id;
+    gchar *client = g_strdup(mock->client);
+    if (one_shot)
+        *id = 0;
+    g_mutex_unlock(&mock->lock);
+    g_assert_cmpuint(fired, !=, 0);
+
+    g_dbus_connection_emit_signal(mock->connection, client,
+                                  IDLE_MONITOR_OBJECT_PATH,
+                                  IDLE_MONITOR_INTERFACE, "WatchFired",
+                                  g_variant_new("(u)", fired), &error);
+    g_assert_no_error(error);
+    g_dbus_connection_flush_sync(mock->connection, NULL, NULL);
+    g_free(client);
+}
+
+static void mock_idle_fire_idle(MockIdle *mock)
+{
+    mock_idle_fire(mock, &mock->idle_watch, FALSE);
+}
+
+static void mock_idle_fire_active(MockIdle *mock)
+{
+    mock_idle_fire(mock, &mock->active_watch, TRUE);
+}
+
+static void mock_idle_stop(MockIdle *mock)
+{
+    g_main_loop_quit(mock->loop);
+    g_thread_join(mock->thread);
+    g_main_loop_unref(mock->loop);
+    g_main_context_unref(mock->context);
+    g_mutex_clear(&mock->lock);
+    g_cond_clear(&mock->cond);
+    g_free(mock->client);
+    g_free(mock);
+}
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static GDBusConnection *connect_test_bus(GTestDBus *bus)
+{
+    GError *error = NULL;
+    GDBusConnection *conn = g_dbus_connection_new_for_address_sync(
+        g_test_dbus_get_bus_address(bus),
+        G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+        G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+        NULL, NULL, &error);
+    g_assert_no_error(error);
+    return conn;
+}
+
+static void close_test_bus(GDBusConnection *conn)
+{
+    g_dbus_connection_close_sync(conn, NULL, NULL);
+    g_object_unref(conn);
+}
+
+typedef struct {
+    guint calls;
+    gchar *title;
+    gchar *wm_class;
+    pid_t pid;
+} FocusRecorder;
+
+static void record_focus(FocusedWindowInfo *info, gpointer user_data)
+{
+    FocusRecorder *rec = user_data;
+    rec->calls++;
+    g_free(rec->title);
+    g_free(rec->wm_class);
+    rec->title = g_strdup(info->title);
+    rec->wm_class = g_strdup(info->wm_class);
+    rec->pid = info->pid;
+}
+
+static void wait_for_calls(FocusRecorder *rec, guint expected)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (rec->calls < expected && g_get_monotonic_time() < deadline)
+        g_main_context_iteration(NULL, TRUE);
+}
+
+typedef struct {
+    FocusEvents *events;
+    gboolean done;
+    gboolean ok;
+    FocusedWindowInfo info;
+    GError *error;
+} QueryResult;
+
+static void on_query_done(GObject *source G_GNUC_UNUSED,
+                          GAsyncResult *res, gpointer user_data)
+{
+    QueryResult *qr = user_data;
+    qr->ok = focus_events_query_finish(qr->events, res, &qr->info, &qr->error);
+    qr->done = TRUE;
+}
+
+/* Run GetFocused to completion on the default main context. */
+static gboolean query_and_wait(FocusEvents *events, FocusedWindowInfo *info)
+{
+    QueryResult qr = {0};
+    qr.events = events;
+    focus_events_query_async(events, NULL, on_query_done, &qr);
+    while (!qr.done)
+        g_main_context_iteration(NULL, TRUE);
+    g_clear_error(&qr.error);
+    *info = qr.info;
+    return qr.ok;
+}
+
+/* ── GetFocused tests ──────────────────────────────── */
+
+static void test_query_without_extension(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    FocusEvents events;
+    g_assert_true(focus_events_subscribe(&events, conn, NULL, NULL));
+
+    FocusedWindowInfo info;
+    g_assert_false(query_and_wait(&events, &info));
+    g_assert_null(info.title);
+
+    focus_events_unsubscribe(&events);
+    close_test_bus(conn);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_query_focused(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockShell *mock = mock_shell_start(bus,
+        "[{\"title\":\"Terminal\",\"wm_class\":\"Gnome-terminal\","
+        "\"wm_class_instance\":\"gnome-terminal\",\"pid\":4242,\"focus\":true}]");
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    FocusEvents events;
+    focus_events_subscribe(&events, conn, NULL, NULL);
+
+    FocusedWindowInfo info;
+    g_assert_true(query_and_wait(&events, &info));
+    g_assert_cmpstr(info.title, ==, "Terminal");
+    g_assert_cmpstr(info.wm_class, ==, "Gnome-terminal");
+    g_assert_cmpstr(info.wm_class_instance, ==, "gnome-terminal");
+    g_assert_cmpint(info.pid, ==, 4242);
+    free_focused_window_info(&info);
+
+    focus_events_unsubscribe(&events);
+    close_test_bus(conn);
+    mock_shell_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_query_nothing_focused(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockShell *mock = mock_shell_start(bus, "[]");
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    FocusEvents events;
+    focus_events_subscribe(&events, conn, NULL, NULL);
+
+    /* The extension answered, it just has no focused window */
+    FocusedWindowInfo info;
+    g_assert_true(query_and_wait(&events, &info));
+    g_assert_null(info.title);
+
+    focus_events_unsubscribe(&events);
+    close_test_bus(conn);
+    mock_shell_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+/* ── FocusChanged tests ────────────────────────────── */
+
+static void test_signal_delivers_focus(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockShell *mock = mock_shell_start(bus, "[]");
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    FocusRecorder rec = {0};
+    FocusEvents events;
+    focus_events_subscribe(&events, conn, record_focus, &rec);
+
+    /* Round trip through the bus so the match rule is in place */
+    FocusedWindowInfo info;
+    g_assert_true(query_and_wait(&events, &info));
+    free_focused_window_info(&info);
+
+    mock_shell_emit(mock,
+        "[{\"title\":\"Firefox - Google\",\"wm_class\":\"Firefox\","
+        "\"wm_class_instance\":\"navigator\",\"pid\":100,\"focus\":true}]");
+    wait_for_calls(&rec, 1);
+
+    g_assert_cmpuint(rec.calls, ==, 1);
+    g_assert_cmpstr(rec.title, ==, "Firefox - Google");
+    g_assert_cmpstr(rec.wm_class, ==, "Firefox");
+    g_assert_cmpint(rec.pid, ==, 100);
+    g_assert_cmpuint(events.events_received, ==, 1);
+
+    g_free(rec.title);
+    g_free(rec.wm_class);
+    focus_events_unsubscribe(&events);
+    close_test_bus(conn);
+    mock_shell_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_signal_sequence(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockShell *mock = mock_shell_start(bus, "[]");
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    FocusRecorder rec = {0};
+    FocusEvents events;
+    focus_events_subscribe(&events, conn, record_focus, &rec);
+    FocusedWindowInfo info;
+    g_assert_true(query_and_wait(&events, &info));
+    free_focused_window_info(&info);
+
+    /* Sub-second switches must all be seen, in order */
+    mock_shell_emit(mock, "[{\"title\":\"A\",\"wm_class\":\"a\",\"focus\":true}]");
+    mock_shell_emit(mock, "[{\"title\":\"B\",\"wm_class\":\"b\",\"focus\":true}]");
+    mock_shell_emit(mock, "[]");
+    mock_shell_emit(mock, "[{\"title\":\"C\",\"wm_class\":\"c\",\"focus\":true}]");
+    wait_for_calls(&rec, 4);
+
+    g_assert_cmpuint(rec.calls, ==, 4);
+    g_assert_cmpstr(rec.title, ==, "C");
+    g_assert_cmpstr(rec.wm_class, ==, "c");
+
+    g_free(rec.title);
+    g_free(rec.wm_class);
+    focus_events_unsubscribe(&events);
+    close_test_bus(conn);
+    mock_shell_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_query_does_not_block(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockShell *mock = mock_shell_start(bus,
+        "[{\"title\":\"Editor\",\"focus\":true}]");
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    FocusEvents events;
+    focus_events_subscribe(&events, conn, NULL, NULL);
+
+    /* Two queries in flight at once, both answered later from the loop */
+    QueryResult a = {0}, b = {0};
+    a.events = b.events = &events;
+    focus_events_query_async(&events, NULL, on_query_done, &a);
+    focus_events_query_async(&events, NULL, on_query_done, &b);
+    g_assert_false(a.done);
+    g_assert_false(b.done);
+    while (!a.done || !b.done)
+        g_main_context_iteration(NULL, TRUE);
+
+    g_assert_true(a.ok);
+    g_assert_true(b.ok);
+    g_assert_cmpstr(a.info.title, ==, "Editor");
+    g_assert_cmpstr(b.info.title, ==, "Editor");
+    free_focused_window_info(&a.info);
+    free_focused_window_info(&b.info);
+
+    focus_events_unsubscribe(&events);
+    close_test_bus(conn);
+    mock_shell_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_unsubscribe_stops_delivery(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockShell *mock = mock_shell_start(bus, "[]");
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    FocusRecorder rec = {0};
+    FocusEvents events;
+    focus_events_subscribe(&events, conn, record_focus, &rec);
+    focus_events_unsubscribe(&events);
+    g_assert_null(events.connection);
+
+    mock_shell_emit(mock, "[{\"title\":\"A\",\"focus\":true}]");
+    /* Give a stray delivery a chance to show up */
+    for (int i = 0; i < 10; i++)
+        g_main_context_iteration(NULL, FALSE);
+    g_assert_cmpuint(rec.calls, ==, 0);
+
+    close_test_bus(conn);
+    mock_shell_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+/* ── Idle watch tests ──────────────────────────────── */
+
+#define TEST_IDLE_THRESHOLD_MS (5 * 60 * 1000)
+
+typedef struct {
+    guint calls;
+    gboolean idle;
+    guint active_calls;  /* active_changed */
+    gboolean active;
+} IdleRecorder;
+
+static void record_idle(gboolean idle, gpointer user_data)
+{
+    IdleRecorder *rec = user_data;
+    rec->calls++;
+    rec->idle = idle;
+}
+
+static void record_active(gboolean active, gpointer user_data)
+{
+    IdleRecorder *rec = user_data;
+    rec->active_calls++;
+    rec->active = active;
+}
+
+static void wait_for_idle_calls(IdleRecorder *rec, guint expected)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (rec->calls < expected && g_get_monotonic_time() < deadline)
+        g_main_context_iteration(NULL, TRUE);
+    g_assert_cmpuint(rec->calls, ==, expected);
+}
+
+static void wait_for_watch_active(IdleWatch *watch, gboolean active)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    while (idle_watch_active(watch) != active) {
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, FALSE);
+        g_usleep(1000);
+    }
+}
+
+/* Until a field of the mock turns nonzero, with the main context, which
+ * makes the calls, running meanwhile */
+static void wait_for_mock(MockIdle *mock, const guint *field)
+{
+    gint64 deadline = g_get_monotonic_time() + 5 * G_USEC_PER_SEC;
+    g_mutex_lock(&mock->lock);
+    while (!*field) {
+        g_mutex_unlock(&mock->lock);
+        g_assert_cmpint(g_get_monotonic_time(), <, deadline);
+        g_main_context_iteration(NULL, FALSE);
+        g_usleep(1000);
+        g_mutex_lock(&mock->lock);
+    }
+    g_mutex_unlock(&mock->lock);
+}
+
+/* A call to the mock and back: whatever it answered earlier has reached
+ * conn, and is handled once the main context is drained */
+static void sync_with_mock(GDBusConnection *conn)
+{
+    GError *error = NULL;
+    GVariant *reply = g_dbus_connection_call_sync(
+        conn, IDLE_MONITOR_BUS_NAME, IDLE_MONITOR_OBJECT_PATH,
+        IDLE_MONITOR_INTERFACE, "GetIdletime", NULL, G_VARIANT_TYPE("(t)"),
+        G_DBUS_CALL_FLAGS_NONE, -1, NULL, &error);
+    g_assert_no_error(error);
+    g_variant_unref(reply);
+    while (g_main_context_iteration(NULL, FALSE))
+        ;
+}
+
+static void test_idle_watch_without_monitor(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    IdleRecorder rec = {0};
+    IdleWatch watch;
+    g_assert_true(idle_watch_start(&watch, conn, TEST_IDLE_THRESHOLD_MS,
+                                   record_idle, &rec));
+    for (int i = 0; i < 10; i++)
+        g_main_context_iteration(NULL, FALSE);
+
+    /* Nothing to add watches to: the tracker keeps polling */
+    g_assert_false(idle_watch_active(&watch));
+    g_assert_cmpuint(rec.calls, ==, 0);
+
+    idle_watch_stop(&watch);
+    close_test_bus(conn);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_idle_watch_unsupported(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockIdle *mock = mock_idle_start(bus, FALSE, 0);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    IdleRecorder rec = {0};
+    IdleWatch watch;
+    idle_watch_start(&watch, conn, TEST_IDLE_THRESHOLD_MS, record_idle, &rec);
+
+    /* AddIdleWatch is refused; only GetIdletime answers */
+    wait_for_mock(mock, &mock->calls);
+    sync_with_mock(conn);
+
+    g_assert_false(idle_watch_active(&watch));
+    g_assert_cmpuint(rec.calls, ==, 0);
+
+    idle_watch_stop(&watch);
+    close_test_bus(conn);
+    mock_idle_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_idle_watch_reports_changes(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockIdle *mock = mock_idle_start(bus, TRUE, 0);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    IdleRecorder rec = {0};
+    IdleWatch watch;
+    idle_watch_start(&watch, conn, TEST_IDLE_THRESHOLD_MS, record_idle, &rec);
+
+    /* Once the watch is in place, the user is found active */
+    wait_for_idle_calls(&rec, 1);
+    g_assert_false(rec.idle);
+    g_assert_true(idle_watch_active(&watch));
+    g_mutex_lock(&mock->lock);
+    g_assert_cmpuint(mock->idle_interval, ==, TEST_IDLE_THRESHOLD_MS);
+    g_mutex_unlock(&mock->lock);
+
+    /* Two idle periods: each needs a user-active watch of its own */
+    for (guint period = 1; period <= 2; period++) {
+        mock_idle_fire_idle(mock);
+        wait_for_idle_calls(&rec, 2 * period);
+        g_assert_true(rec.idle);
+
+        wait_for_mock(mock, &mock->active_watch);
+        mock_idle_fire_active(mock);
+        wait_for_idle_calls(&rec, 2 * period + 1);
+        g_assert_false(rec.idle);
+    }
+    g_assert_cmpuint(watch.watches_fired, ==, 4);
+    g_assert_cmpuint(mock->active_watches_added, ==, 2);
+
+    idle_watch_stop(&watch);
+    close_test_bus(conn);
+    mock_idle_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_idle_watch_already_idle(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockIdle *mock = mock_idle_start(bus, TRUE, 10 * 60 * 1000);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    IdleRecorder rec = {0};
+    IdleWatch watch;
+    idle_watch_start(&watch, conn, TEST_IDLE_THRESHOLD_MS, record_idle, &rec);
+
+    /* Past the threshold already: the idle watch would not fire until the
+     * next idle period, yet the user is idle now */
+    wait_for_idle_calls(&rec, 1);
+    g_assert_true(rec.idle);
+
+    wait_for_mock(mock, &mock->active_watch);
+    mock_idle_fire_active(mock);
+    wait_for_idle_calls(&rec, 2);
+    g_assert_false(rec.idle);
+
+    idle_watch_stop(&watch);
+    close_test_bus(conn);
+    mock_idle_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_idle_watch_stop_removes_watches(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockIdle *mock = mock_idle_start(bus, TRUE, 0);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    IdleRecorder rec = {0};
+    IdleWatch watch;
+    idle_watch_start(&watch, conn, TEST_IDLE_THRESHOLD_MS, record_idle, &rec);
+    wait_for_idle_calls(&rec, 1);
+    guint32 stale = mock->idle_watch;
+
+    idle_watch_stop(&watch);
+    g_assert_null(watch.connection);
+    g_assert_false(idle_watch_active(&watch));
+    wait_for_mock(mock, &mock->removed);
+    g_mutex_lock(&mock->lock);
+    g_assert_cmpuint(mock->idle_watch, ==, 0);
+    g_mutex_unlock(&mock->lock);
+
+    /* A watch firing late is not delivered */
+    mock_idle_fire(mock, &stale, FALSE);
+    sync_with_mock(conn);
+    g_assert_cmpuint(rec.calls, ==, 1);
+
+    close_test_bus(conn);
+    mock_idle_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+static void test_idle_watch_monitor_restart(void)
+{
+    GTestDBus *bus = g_test_dbus_new(G_TEST_DBUS_NONE);
+    g_test_dbus_up(bus);
+    MockIdle *mock = mock_idle_start(bus, TRUE, 0);
+    GDBusConnection *conn = connect_test_bus(bus);
+
+    IdleRecorder rec = {0};
+    IdleWatch watch;
+    idle_watch_start(&watch, conn, TEST_IDLE_THRESHOLD_MS, record_idle, &rec);
+    watch.active_changed = record_active;
+    wait_for_idle_calls(&rec, 1);
+    g_assert_cmpuint(rec.active_calls, ==, 1);
+    g_assert_true(rec.active);
+    mock_idle_fire_idle(mock);
+    wait_for_idle_calls(&rec, 2);
+    g_assert_true(rec.idle);
+
+    /* gnome-shell restarts: polling takes over until the watches are
+     * added to the new instance, which tells the user is back */
+    mock_idle_stop(mock);
+    wait_for_watch_active(&watch, FALSE);
+    g_assert_cmpuint(rec.active_calls, ==, 2);
+    g_assert_false(rec.active);
+    mock = mock_idle_start(bus, TRUE, 0);
+    wait_for_watch_active(&watch, TRUE);
+    g_assert_cmpuint(rec.active_calls, ==, 3);
+    g_assert_true(rec.active);
+    wait_for_idle_calls(&rec, 3);
+    g_assert_false(rec.idle);
+
+    idle_watch_stop(&watch);
+    close_test_bus(conn);
+    mock_idle_stop(mock);
+    g_test_dbus_down(bus);
+    g_object_unref(bus);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    /* GetFocused */
+    g_test_add_func("/session/query_without_extension", test_query_without_extension);
+    g_test_add_func("/session/query_focused", test_query_focused);
+    g_test_add_func("/session/query_nothing_focused", test_query_nothing_focused);
+    g_test_add_func("/session/query_does_not_block", test_query_does_not_block);
+
+    /* FocusChanged */
+    g_test_add_func("/session/signal_delivers_focus", test_signal_delivers_focus);
+    g_test_add_func("/session/signal_sequence", test_signal_sequence);
+    g_test_add_func("/session/unsubscribe_stops_delivery", test_unsubscribe_stops_delivery);
+
+    /* Idle monitor watches */
+    g_test_add_func("/session/idle_watch_without_monitor", test_idle_watch_without_monitor);
+    g_test_add_func("/session/idle_watch_unsupported", test_idle_watch_unsupported);
+    g_test_add_func("/session/idle_watch_reports_changes", test_idle_watch_reports_changes);
+    g_test_add_func("/session/idle_watch_already_idle", test_idle_watch_already_idle);
+    g_test_add_func("/session/idle_watch_stop_removes_watches", test_idle_watch_stop_removes_watches);
+    g_test_add_func("/session/idle_watch_monitor_restart", test_idle_watch_monitor_restart);
+
+    return g_test_run();
+}
@@ -0,0 +1,375 @@
+#include <glib.h>
+#include "stats-cache.h"
+#include "string-table.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("stats-cache-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+#define CSV_HEADER "timestamp,duration_seconds,status,window_title,wm_class," \
+                   "wm_class_instance,rp_state,rp_details\n"
+
+/* Record i of a day: a handful of windows, some with rich presence */
+static void append_record(GString *csv, int i)
+{
+    int doc = (i * 7) % 23;
+    if (i % 11 == 0) {
+        g_string_append_printf(csv, "2026-01-28T08:%02d:%02d,%d,locked,"
+                               "\"\",\"\",\"\",\"\",\"\"\n",
+                               (i / 60) % 60, i % 60, 1 + i % 90);
+        return;
+    }
+    g_string_append_printf(csv, "2026-01-28T08:%02d:%02d,%d,active,"
+                           "\"Document %d - \"\"Project %d\"\"\","
+                           "\"org.example.App%d\",\"app%d\",\"%s\",\"%s\"\n",
+                           (i / 60) % 60, i % 60, 1 + i % 90, doc, doc % 5,
+                           doc % 4, doc % 4, doc % 3 ? "" : "Editing",
+                           doc % 3 ? "" : "Main.java");
+}
+
+static GString *make_day(int records)
+{
+    GString *csv = g_string_new(CSV_HEADER);
+    for (int i = 0; i < records; i++)
+        append_record(csv, i);
+    return csv;
+}
+
+static void write_file(const gchar *path, const gchar *data, gsize len)
+{
+    g_assert_true(g_file_set_contents(path, data, len, NULL));
+}
+
+/* Appends to path in place, as the tracker does */
+static void append_file(const gchar *path, const gchar *data, gsize len)
+{
+    int fd = open(path, O_WRONLY | O_APPEND);
+    g_assert_cmpint(fd, >=, 0);
+    g_assert_cmpint(write(fd, data, len), ==, (gssize)len);
+    close(fd);
+}
+
+static gchar *report_to_string(const DayStats *stats)
+{
+    gchar *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    g_assert_nonnull(out);
+    StatsOptions opts = {.top_apps = 1000, .top_titles = 1000, .cols = 120};
+    print_stats_report(out, stats, 2026, 1, 28, &opts);
+    fclose(out);
+    return buf;
+}
+
+static gchar *full_report(const gchar *csv_path)
+{
+    DayStats *stats = compute_day_stats(csv_path);
+    g_assert_nonnull(stats);
+    gchar *report = report_to_string(stats);
+    free_day_stats(stats);
+    return report;
+}
+
+static gchar *cached_report(const gchar *csv_path, const gchar *cache_dir)
+{
+    DayStats *stats = stats_cache_compute(csv_path, cache_dir, 1);
+    g_assert_nonnull(stats);
+    gchar *report = report_to_string(stats);
+    free_day_stats(stats);
+    return report;
+}
+
+/* The cache must give what a full parse of csv_path gives */
+static void assert_cache_matches(const gchar *csv_path, const gchar *cache_dir)
+{
+    gchar *expected = full_report(csv_path);
+    gchar *report = cached_report(csv_path, cache_dir);
+    g_assert_cmpstr(report, ==, expected);
+    g_free(report);
+    /* And again from the cache just written */
+    report = cached_report(csv_path, cache_dir);
+    g_assert_cmpstr(report, ==, expected);
+    g_free(report);
+    g_free(expected);
+}
+
+/* ── Tests ─────────────────────────────────────────── */
+
+static void test_appended_tail_only(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *csv_path = g_build_filename(tmpdir, "2026-01-28.csv", NULL);
+    gchar *cache_dir = g_build_filename(tmpdir, "cache", NULL);
+
+    GString *csv = make_day(300);
+    write_file(csv_path, csv->str, csv->len);
+    assert_cache_matches(csv_path, cache_dir);
+
+    gsize primed = csv->len;
+    for (int i = 300; i < 340; i++)
+        append_record(csv, i);
+    append_file(csv_path, csv->str + primed, csv->len - primed);
+    gchar *expected = full_report(csv_path);
+
+    /* Change a title well before the checked tail behind the cache's back:
+     * only a report that skips the cached bytes misses it */
+    gchar *early = strstr(csv->str, "Document");
+    g_assert_true(early && early - csv->str + 256 < (gssize)primed);
+    int fd = open(csv_path, O_WRONLY);
+    g_assert_cmpint(pwrite(fd, "Documant", 8, early - csv->str), ==, 8);
+    close(fd);
+
+    gchar *report = cached_report(csv_path, cache_dir);
+    g_assert_cmpstr(report, ==, expected);
+    gchar *tampered = full_report(csv_path);
+    g_assert_cmpstr(tampered, !=, expected);
+
+    g_free(tampered);
+    g_free(report);
+    g_free(expected);
+    g_string_free(csv, TRUE);
+    g_free(cache_dir);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_partial_record(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *csv_path = g_build_filename(tmpdir, "2026-01-28.csv", NULL);
+    gchar *cache_dir = g_build_filename(tmpdir, "cache", NULL);
+
+    /* The tracker is part way through a record, inside a quoted title */
+    GString *csv = make_day(50);
+    gsize complete = csv->len;
+    append_record(csv, 50);
+    gsize torn = complete + (csv->len - complete) / 2;
+    g_assert_nonnull(memchr(csv->str + complete, '"', torn - complete));
+    write_file(csv_path, csv->str, torn);
+    assert_cache_matches(csv_path, cache_dir);
+
+    /* Finished later: counted once, in full */
+    append_file(csv_path, csv->str + torn, csv->len - torn);
+    assert_cache_matches(csv_path, cache_dir);
+
+    gchar *report = cached_report(csv_path, cache_dir);
+    DayStats *stats = compute_day_stats(csv_path);
+    gchar *expected = report_to_string(stats);
+    g_assert_cmpstr(report, ==, expected);
+    g_assert_nonnull(strstr(report, "Document 5 - "));
+    free_day_stats(stats);
+
+    g_free(expected);
+    g_free(report);
+    g_string_free(csv, TRUE);
+    g_free(cache_dir);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_invalidated(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *csv_path = g_build_filename(tmpdir, "2026-01-28.csv", NULL);
+    gchar *cache_dir = g_build_filename(tmpdir, "cache", NULL);
+    gchar *cache_path = stats_cache_path(cache_dir, csv_path);
+    GString *csv = make_day(200);
+
+    /* Shrunk below what the cache covers */
+    write_file(csv_path, csv->str, csv->len);
+    assert_cache_matches(csv_path, cache_dir);
+    int fd = open(csv_path, O_WRONLY | O_TRUNC);
+    close(fd);
+    assert_cache_matches(csv_path, cache_dir);
+    fd = open(csv_path, O_WRONLY);
+    g_assert_cmpint(write(fd, csv->str, csv->len / 2), ==, (gssize)(csv->len / 2));
+    close(fd);
+    assert_cache_matches(csv_path, cache_dir);
+
+    /* Replaced by another file, longer and with other records */
+    write_file(csv_path, csv->str, csv->len);
+    assert_cache_matches(csv_path, cache_dir);
+    GString *other = make_day(260);
+    g_string_insert(other, strlen(CSV_HEADER),
+                    "2026-01-28T07:00:00,5,active,\"Early\",\"Early\",\"e\",\"\",\"\"\n");
+    write_file(csv_path, other->str, other->len);
+    assert_cache_matches(csv_path, cache_dir);
+
+    /* Rewritten in place just before the covered end */
+    write_file(csv_path, csv->str, csv->len);
+    assert_cache_matches(csv_path, cache_dir);
+    gchar *last = g_strrstr(csv->str, "Document");
+    g_assert_true(last && csv->len - (last - csv->str) < 256);
+    fd = open(csv_path, O_WRONLY);
+    g_assert_cmpint(pwrite(fd, "Documant", 8, last - csv->str), ==, 8);
+    close(fd);
+    assert_cache_matches(csv_path, cache_dir);
+
+    /* A damaged cache file is ignored and replaced */
+    gchar *contents;
+    gsize size;
+    g_assert_true(g_file_get_contents(cache_path, &contents, &size, NULL));
+    for (gsize cut = 0; cut < size; cut += 1 + cut / 3) {
+        write_file(cache_path, contents, cut);
+        assert_cache_matches(csv_path, cache_dir);
+    }
+    /* The top byte of the last title's seconds */
+    contents[size - 1] ^= 0x40;
+    write_file(cache_path, contents, size);
+    assert_cache_matches(csv_path, cache_dir);
+    write_file(cache_path, "not a stats cache", -1);
+    assert_cache_matches(csv_path, cache_dir);
+    g_free(contents);
+
+    /* Trailing bytes under a valid checksum: the whole file is parsed
+     * again, not only what the rejected cache claimed to cover */
+    g_assert_true(g_file_get_contents(cache_path, &contents, &size, NULL));
+    contents = g_realloc(contents, size + 8);
+    memset(contents + size, 0, 8);
+    size += 8;
+    guint64 check = GUINT64_TO_LE(string_hash(contents + 16, size - 16));
+    memcpy(contents + 8, &check, sizeof(check));
+    write_file(cache_path, contents, size);
+    assert_cache_matches(csv_path, cache_dir);
+    g_free(contents);
+
+    g_string_free(other, TRUE);
+    g_string_free(csv, TRUE);
+    g_free(cache_path);
+    g_free(cache_dir);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_cache_path(void)
+{
+    gchar *a = stats_cache_path("/cache", "/data/a/2026-01/2026-01-28.csv");
+    gchar *b = stats_cache_path("/cache", "/data/b/2026-01/2026-01-28.csv");
+    gchar *again = stats_cache_path("/cache", "/data/a/2026-01/../2026-01/2026-01-28.csv");
+    g_assert_true(g_str_has_prefix(a, "/cache/2026-01-28.csv-"));
+    g_assert_true(g_str_has_suffix(a, ".stats"));
+    g_assert_cmpstr(a, !=, b);
+    g_assert_cmpstr(a, ==, again);
+    g_free(again);
+    g_free(b);
+    g_free(a);
+}
+
+static void test_load_day_stats_uses_cache(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *cache_dir = g_build_filename(tmpdir, "cache", NULL);
+    gchar *csv_path = build_csv_path(tmpdir, 2026, 1, 28);
+    gchar *month_dir = g_path_get_dirname(csv_path);
+    g_assert_cmpint(g_mkdir_with_parents(month_dir, 0700), ==, 0);
+    GString *csv = make_day(100);
+    write_file(csv_path, csv->str, csv->len);
+    gchar *cache_path = stats_cache_path(cache_dir, csv_path);
+
+    gboolean found = FALSE;
+    DayStats *stats = load_day_stats(tmpdir, 2026, 1, 28, 1, NULL, &found);
+    g_assert_true(found);
+    g_assert_false(g_file_test(cache_path, G_FILE_TEST_EXISTS));
+    gchar *expected = report_to_string(stats);
+    free_day_stats(stats);
+
+    stats = load_day_stats(tmpdir, 2026, 1, 28, 1, cache_dir, &found);
+    g_assert_true(found);
+    g_assert_true(g_file_test(cache_path, G_FILE_TEST_EXISTS));
+    gchar *report = report_to_string(stats);
+    g_assert_cmpstr(report, ==, expected);
+    free_day_stats(stats);
+
+    g_free(report);
+    g_free(expected);
+    g_free(cache_path);
+    g_string_free(csv, TRUE);
+    g_free(month_dir);
+    g_free(csv_path);
+    g_free(cache_dir);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+static void test_perf_stats_cache(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    /* A long day, reported again after each new record, as a status bar
+     * refreshing every minute would */
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *csv_path = g_build_filename(tmpdir, "2026-01-28.csv", NULL);
+    gchar *cache_dir = g_build_filename(tmpdir, "cache", NULL);
+    const int records = 20000, rounds = 50;
+    GString *csv = make_day(records);
+    write_file(csv_path, csv->str, csv->len);
+
+    g_test_timer_start();
+    for (int r = 0; r < rounds; r++)
+        free_day_stats(compute_day_stats(csv_path));
+    double full = g_test_timer_elapsed() / rounds;
+
+    free_day_stats(stats_cache_compute(csv_path, cache_dir, 1));
+    double cached = 0;
+    for (int r = 0; r < rounds; r++) {
+        gsize before = csv->len;
+        append_record(csv, records + r);
+        append_file(csv_path, csv->str + before, csv->len - before);
+        g_test_timer_start();
+        free_day_stats(stats_cache_compute(csv_path, cache_dir, 1));
+        cached += g_test_timer_elapsed();
+    }
+    cached /= rounds;
+
+    g_test_message("%d records (%zu KiB): full parse %.2f ms, "
+                   "cached + one new record %.2f ms (%.1fx)",
+                   records, csv->len / 1024, full * 1e3, cached * 1e3,
+                   full / cached);
+    g_test_minimized_result(cached, "cached report: %.2f ms", cached * 1e3);
+
+    g_string_free(csv, TRUE);
+    g_free(cache_dir);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/stats-cache/appended_tail_only", test_appended_tail_only);
+    g_test_add_func("/stats-cache/partial_record", test_partial_record);
+    g_test_add_func("/stats-cache/invalidated", test_invalidated);
+    g_test_add_func("/stats-cache/cache_path", test_cache_path);
+    g_test_add_func("/stats-cache/load_day_stats_uses_cache",
+                    test_load_day_stats_uses_cache);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/stats_cache", test_perf_stats_cache);
+
+    return g_test_run();
+}
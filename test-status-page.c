@@ -0,0 +1,416 @@
+#include <glib.h>
+#include "status-page.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+static gchar *create_test_tmpdir(void)
+{
+    gchar *tmpdir = g_dir_make_tmp("status-page-test-XXXXXX", NULL);
+    g_assert_nonnull(tmpdir);
+    return tmpdir;
+}
+
+static void cleanup_test_tmpdir(gchar *tmpdir)
+{
+    gchar *argv[] = {"rm", "-rf", tmpdir, NULL};
+    g_spawn_sync(NULL, argv, NULL, G_SPAWN_SEARCH_PATH,
+                 NULL, NULL, NULL, NULL, NULL, NULL);
+    g_free(tmpdir);
+}
+
+static StatusPageReader *open_reader(const gchar *path)
+{
+    GError *error = NULL;
+    StatusPageReader *reader = status_page_reader_open(path, &error);
+    g_assert_no_error(error);
+    g_assert_nonnull(reader);
+    return reader;
+}
+
+static void free_state_strings(AppState *state)
+{
+    g_free(state->current_title);
+    g_free(state->current_wm_class);
+    g_free(state->current_wm_class_instance);
+    g_free(state->current_rp_state);
+    g_free(state->current_rp_details);
+}
+
+typedef struct {
+    StatusPageWriter *writer;
+    AppState *state;
+} Publisher;
+
+static void on_tracking_changed(gpointer user_data)
+{
+    Publisher *publisher = user_data;
+    status_page_publish_state(publisher->writer, publisher->state);
+}
+
+/* ── Publishing the tracker's state ────────────────── */
+
+static void test_publish_state(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = g_build_filename(tmpdir, STATUS_PAGE_FILE, NULL);
+    GError *error = NULL;
+    StatusPageWriter *writer = status_page_writer_open(path, &error);
+    g_assert_no_error(error);
+    StatusPageReader *reader = open_reader(path);
+
+    /* Nothing tracked yet */
+    StatusSnapshot snap;
+    g_assert_true(status_page_read(reader, &snap));
+    g_assert_cmpuint(snap.state, ==, STATUS_PAGE_STOPPED);
+
+    /* Every new interval reaches the page through start_tracking() */
+    AppState state = {0};
+    Publisher publisher = {writer, &state};
+    state.tracking_changed = on_tracking_changed;
+    state.tracking_changed_data = &publisher;
+    start_tracking(&state, "Main.java - IntelliJ IDEA", "jetbrains-idea",
+                   "jetbrains-idea", "Editing Main.java", "app", 4242, FALSE);
+    g_assert_true(status_page_read(reader, &snap));
+    g_assert_cmpuint(snap.state, ==, STATUS_PAGE_ACTIVE);
+    g_assert_cmpstr(snap.title, ==, "Main.java - IntelliJ IDEA");
+    g_assert_cmpstr(snap.wm_class, ==, "jetbrains-idea");
+    g_assert_cmpstr(snap.rp_state, ==, "Editing Main.java");
+    g_assert_cmpstr(snap.rp_details, ==, "app");
+    g_assert_cmpint(snap.pid, ==, 4242);
+    g_assert_cmpint(snap.start_wall, ==, state.current_wall);
+    g_assert_cmpint(snap.start_monotonic, ==, state.current_start);
+
+    /* Away intervals show no window, as in the day file */
+    state.is_idle = TRUE;
+    start_tracking(&state, "", "", "", NULL, NULL, 0, FALSE);
+    g_assert_true(status_page_read(reader, &snap));
+    g_assert_cmpuint(snap.state, ==, STATUS_PAGE_IDLE);
+    g_assert_cmpstr(snap.title, ==, "");
+    g_assert_cmpstr(snap.rp_state, ==, "");
+
+    state.is_idle = FALSE;
+    start_tracking(&state, "Terminal", "Gnome-terminal", "gnome-terminal",
+                   NULL, NULL, 7, FALSE);
+    state.is_locked = TRUE;
+    status_page_publish_state(writer, &state);
+    g_assert_true(status_page_read(reader, &snap));
+    g_assert_cmpuint(snap.state, ==, STATUS_PAGE_LOCKED);
+    g_assert_cmpstr(snap.wm_class, ==, "");
+    g_assert_cmpint(snap.pid, ==, 0);
+
+    /* Closing tells readers still holding the page, and removes it */
+    status_page_writer_close(writer);
+    g_assert_true(status_page_read(reader, &snap));
+    g_assert_cmpuint(snap.state, ==, STATUS_PAGE_STOPPED);
+    g_assert_false(g_file_test(path, G_FILE_TEST_EXISTS));
+    status_page_reader_close(reader);
+
+    free_state_strings(&state);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_truncated_at_character(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = g_build_filename(tmpdir, STATUS_PAGE_FILE, NULL);
+    StatusPageWriter *writer = status_page_writer_open(path, NULL);
+    g_assert_nonnull(writer);
+    StatusPageReader *reader = open_reader(path);
+
+    /* Two-byte characters, so the last one would straddle the end */
+    GString *title = g_string_new(NULL);
+    for (int i = 0; i < STATUS_PAGE_TITLE_MAX; i++)
+        g_string_append(title, "\xc5\xbe");
+    GString *rp = g_string_new("x");
+    for (int i = 0; i < STATUS_PAGE_NAME_MAX; i++)
+        g_string_append(rp, "\xe2\x82\xac");
+
+    AppState state = {0};
+    start_tracking(&state, title->str, "Browser", "browser", rp->str, NULL,
+                   0, FALSE);
+    status_page_publish_state(writer, &state);
+
+    StatusSnapshot snap;
+    g_assert_true(status_page_read(reader, &snap));
+    g_assert_cmpuint(strlen(snap.title), ==, STATUS_PAGE_TITLE_MAX - 2);
+    g_assert_true(g_str_has_prefix(title->str, snap.title));
+    g_assert_true(g_utf8_validate(snap.title, -1, NULL));
+    g_assert_cmpuint(strlen(snap.rp_state), ==, STATUS_PAGE_NAME_MAX - 3);
+    g_assert_true(g_utf8_validate(snap.rp_state, -1, NULL));
+    g_assert_cmpstr(snap.wm_class, ==, "Browser");
+
+    status_page_reader_close(reader);
+    status_page_writer_close(writer);
+    free_state_strings(&state);
+    g_string_free(title, TRUE);
+    g_string_free(rp, TRUE);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_reader_open_errors(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = g_build_filename(tmpdir, STATUS_PAGE_FILE, NULL);
+    GError *error = NULL;
+
+    g_assert_null(status_page_reader_open(path, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+    g_clear_error(&error);
+
+    /* Too short, then long enough but something else */
+    g_assert_true(g_file_set_contents(path, "ATSP", 4, NULL));
+    g_assert_null(status_page_reader_open(path, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+
+    gchar *junk = g_malloc0(sizeof(StatusPage));
+    g_assert_true(g_file_set_contents(path, junk, sizeof(StatusPage), NULL));
+    g_assert_null(status_page_reader_open(path, &error));
+    g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+    g_clear_error(&error);
+    g_free(junk);
+
+    /* A tracker starting over a stale page replaces it */
+    StatusPageWriter *writer = status_page_writer_open(path, &error);
+    g_assert_no_error(error);
+    StatusPageReader *reader = open_reader(path);
+    status_page_reader_close(reader);
+    status_page_writer_close(writer);
+
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Reading while the writer is inside ────────────── */
+
+typedef struct {
+    StatusPageReader *reader;
+    StatusSnapshot snap;
+    gboolean ok;
+    gint done;
+} PendingRead;
+
+static gpointer pending_read_thread(gpointer data)
+{
+    PendingRead *read = data;
+    read->ok = status_page_read(read->reader, &read->snap);
+    g_atomic_int_set(&read->done, 1);
+    return NULL;
+}
+
+/* The page as a writer holds it, to stop one in the middle of a publish */
+static StatusPage *map_for_writing(const gchar *path)
+{
+    int fd = open(path, O_RDWR);
+    g_assert_cmpint(fd, >=, 0);
+    StatusPage *page = mmap(NULL, sizeof(StatusPage), PROT_READ | PROT_WRITE,
+                            MAP_SHARED, fd, 0);
+    g_assert_true(page != MAP_FAILED);
+    close(fd);
+    return page;
+}
+
+static void test_read_waits_for_writer(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = g_build_filename(tmpdir, STATUS_PAGE_FILE, NULL);
+    StatusPageWriter *writer = status_page_writer_open(path, NULL);
+    g_assert_nonnull(writer);
+    StatusPage *page = map_for_writing(path);
+
+    /* Half of a publish: sequence odd and the title already replaced */
+    guint32 seq = page->seq;
+    __atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELEASE);
+    strcpy(page->current.title, "half written");
+
+    PendingRead read = {0};
+    read.reader = open_reader(path);
+    GThread *thread = g_thread_new("reader", pending_read_thread, &read);
+    g_usleep(20000);
+    g_assert_cmpint(g_atomic_int_get(&read.done), ==, 0);
+
+    /* Only the finished publish is seen */
+    strcpy(page->current.wm_class, "finished");
+    page->current.state = STATUS_PAGE_ACTIVE;
+    __atomic_store_n(&page->seq, seq + 2, __ATOMIC_RELEASE);
+    g_thread_join(thread);
+    g_assert_true(read.ok);
+    g_assert_cmpuint(read.snap.state, ==, STATUS_PAGE_ACTIVE);
+    g_assert_cmpstr(read.snap.title, ==, "half written");
+    g_assert_cmpstr(read.snap.wm_class, ==, "finished");
+
+    /* A writer that died inside leaves readers an error, not a hang */
+    __atomic_store_n(&page->seq, seq + 3, __ATOMIC_RELEASE);
+    StatusSnapshot snap;
+    g_assert_false(status_page_read(read.reader, &snap));
+
+    status_page_reader_close(read.reader);
+    munmap(page, sizeof(StatusPage));
+    status_page_writer_close(writer);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Torn reads ────────────────────────────────────────
+ *
+ * The writer publishes snapshots whose every field is derived from a
+ * counter, with titles of changing length; readers on other threads check
+ * that each read holds the fields of a single snapshot. */
+
+#define STRESS_PUBLISHES 200000
+#define STRESS_READERS   3
+
+typedef struct {
+    StatusPageWriter *writer;
+    StatusPageReader *reader;
+    gint writing;
+    guint64 reads[STRESS_READERS];
+    guint64 torn[STRESS_READERS];
+} Stress;
+
+static void fill_stress_snapshot(StatusSnapshot *snap, guint32 i)
+{
+    memset(snap, 0, sizeof(*snap));
+    snap->state = STATUS_PAGE_ACTIVE;
+    snap->pid = (gint32)i;
+    snap->start_wall = i;
+    snap->start_monotonic = (gint64)i * 3;
+    memset(snap->title, 'a' + i % 26, 1 + i % (STATUS_PAGE_TITLE_MAX - 1));
+    g_snprintf(snap->wm_class, sizeof(snap->wm_class), "class-%u", i);
+    g_snprintf(snap->rp_state, sizeof(snap->rp_state), "state-%u", i);
+    g_snprintf(snap->rp_details, sizeof(snap->rp_details), "details-%u", i);
+}
+
+static gboolean stress_snapshot_consistent(const StatusSnapshot *snap)
+{
+    if (snap->state == STATUS_PAGE_STOPPED)
+        return snap->start_wall == 0 && snap->title[0] == '\0';
+
+    StatusSnapshot expected;
+    fill_stress_snapshot(&expected, (guint32)snap->start_wall);
+    return memcmp(snap, &expected, sizeof(expected)) == 0;
+}
+
+typedef struct {
+    Stress *stress;
+    int index;
+} StressReader;
+
+static gpointer stress_reader_thread(gpointer data)
+{
+    StressReader *self = data;
+    Stress *stress = self->stress;
+    StatusSnapshot snap;
+    gint64 last = -1;
+
+    while (g_atomic_int_get(&stress->writing)) {
+        g_assert_true(status_page_read(stress->reader, &snap));
+        stress->reads[self->index]++;
+        if (!stress_snapshot_consistent(&snap) ||
+            (snap.state != STATUS_PAGE_STOPPED && snap.start_wall < last))
+            stress->torn[self->index]++;
+        if (snap.state != STATUS_PAGE_STOPPED)
+            last = snap.start_wall;
+    }
+    return NULL;
+}
+
+static void test_no_torn_reads(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = g_build_filename(tmpdir, STATUS_PAGE_FILE, NULL);
+    Stress stress = {0};
+    stress.writer = status_page_writer_open(path, NULL);
+    g_assert_nonnull(stress.writer);
+    stress.reader = open_reader(path);
+    g_atomic_int_set(&stress.writing, 1);
+
+    StressReader readers[STRESS_READERS];
+    GThread *threads[STRESS_READERS];
+    for (int r = 0; r < STRESS_READERS; r++) {
+        readers[r] = (StressReader){&stress, r};
+        threads[r] = g_thread_new("stress-reader", stress_reader_thread,
+                                  &readers[r]);
+    }
+
+    StatusSnapshot snap;
+    for (guint32 i = 1; i <= STRESS_PUBLISHES; i++) {
+        fill_stress_snapshot(&snap, i);
+        status_page_publish(stress.writer, &snap);
+    }
+    g_atomic_int_set(&stress.writing, 0);
+
+    guint64 reads = 0;
+    for (int r = 0; r < STRESS_READERS; r++) {
+        g_thread_join(threads[r]);
+        g_assert_cmpuint(stress.torn[r], ==, 0);
+        reads += stress.reads[r];
+    }
+    g_test_message("%u publishes, %" G_GUINT64_FORMAT " reads",
+                   STRESS_PUBLISHES, reads);
+
+    g_assert_true(status_page_read(stress.reader, &snap));
+    g_assert_cmpint(snap.start_wall, ==, STRESS_PUBLISHES);
+
+    status_page_reader_close(stress.reader);
+    status_page_writer_close(stress.writer);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+static void test_perf_read(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *path = g_build_filename(tmpdir, STATUS_PAGE_FILE, NULL);
+    StatusPageWriter *writer = status_page_writer_open(path, NULL);
+    StatusPageReader *reader = open_reader(path);
+    StatusSnapshot snap;
+    fill_stress_snapshot(&snap, 42);
+    status_page_publish(writer, &snap);
+
+    const int reads = 1000000;
+    g_test_timer_start();
+    for (int i = 0; i < reads; i++)
+        status_page_read(reader, &snap);
+    double elapsed = g_test_timer_elapsed();
+    g_assert_cmpint(snap.start_wall, ==, 42);
+
+    g_test_message("%d reads: %.1f ns each", reads, elapsed * 1e9 / reads);
+    g_test_minimized_result(elapsed * 1e9 / reads, "ns per read");
+
+    status_page_reader_close(reader);
+    status_page_writer_close(writer);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/status-page/publish_state", test_publish_state);
+    g_test_add_func("/status-page/truncated_at_character",
+                    test_truncated_at_character);
+    g_test_add_func("/status-page/reader_open_errors", test_reader_open_errors);
+    g_test_add_func("/status-page/read_waits_for_writer",
+                    test_read_waits_for_writer);
+    g_test_add_func("/status-page/no_torn_reads", test_no_torn_reads);
+    g_test_add_func("/perf/status_page_read", test_perf_read);
+
+    return g_test_run();
+}
@@ -0,0 +1,318 @@
+#include <glib.h>
+#include "string-table.h"
+#include <math.h>
+#include <string.h>
+
+/* ── Helpers ───────────────────────────────────────── */
+
+typedef struct {
+    long count;
+    gsize len;
+    gchar str[];
+} Counter;
+
+typedef struct {
+    const gchar *str;
+    gsize len;
+} Key;
+
+static gboolean counter_equal(gconstpointer item, gconstpointer key)
+{
+    const Counter *c = item;
+    const Key *k = key;
+    return c->len == k->len && memcmp(c->str, k->str, k->len) == 0;
+}
+
+static Counter *counter_new(const Key *key)
+{
+    Counter *c = g_malloc(sizeof(Counter) + key->len + 1);
+    c->count = 0;
+    c->len = key->len;
+    memcpy(c->str, key->str, key->len);
+    c->str[key->len] = '\0';
+    return c;
+}
+
+/* Counts key under hash, adding it when new */
+static Counter *count_key(StringTable *table, guint64 hash, const Key *key)
+{
+    Counter *c = string_table_lookup(table, hash, key, counter_equal);
+    if (!c) {
+        c = counter_new(key);
+        string_table_insert(table, hash, c);
+    }
+    c->count++;
+    return c;
+}
+
+static void free_counters(StringTable *table)
+{
+    StringTableIter iter;
+    gpointer item;
+    string_table_iter_init(&iter, table);
+    while (string_table_iter_next(&iter, &item))
+        g_free(item);
+    string_table_clear(table);
+}
+
+/* A window title like those of a busy day */
+static gchar *make_title(int doc)
+{
+    return g_strdup_printf("Document %d - \"Project %d\" - Application %d",
+                           doc, doc % 17, doc % 40);
+}
+
+/* ── Tests ─────────────────────────────────────────── */
+
+static void test_hash_pieces(void)
+{
+    static const gchar *const strings[] = {
+        "", "a", "Editing Main.java | my-project", "žluťoučký kůň 😀",
+        "exactly 8", "sixteen bytes!!!", "a string longer than two words",
+    };
+    for (gsize s = 0; s < G_N_ELEMENTS(strings); s++) {
+        const gchar *str = strings[s];
+        gsize len = strlen(str);
+        guint64 whole = string_hash(str, len);
+
+        /* Every split into three pieces hashes the same */
+        for (gsize a = 0; a <= len; a++) {
+            for (gsize b = a; b <= len; b++) {
+                StringHash state;
+                string_hash_init(&state, 0);
+                string_hash_update(&state, str, a);
+                string_hash_update(&state, str + a, b - a);
+                string_hash_update(&state, str + b, len - b);
+                g_assert_cmpuint(string_hash_finish(&state), ==, whole);
+            }
+        }
+    }
+
+    /* Trailing NULs, seeds and single bit changes all count */
+    g_assert_cmpuint(string_hash("a", 1), !=, string_hash("a\0", 2));
+    g_assert_cmpuint(string_hash("", 0), !=, string_hash("\0", 1));
+    StringHash seeded;
+    string_hash_init(&seeded, 1);
+    string_hash_update(&seeded, "a", 1);
+    g_assert_cmpuint(string_hash_finish(&seeded), !=, string_hash("a", 1));
+    g_assert_cmpuint(string_hash("Document 1", 10), !=,
+                     string_hash("Document 3", 10));
+}
+
+static void test_insert_lookup_grow(void)
+{
+    StringTable table;
+    string_table_init(&table);
+    Key missing = {"not there", 9};
+    g_assert_null(string_table_lookup(&table, string_hash(missing.str, missing.len),
+                                      &missing, counter_equal));
+
+    GPtrArray *titles = g_ptr_array_new_with_free_func(g_free);
+    for (int i = 0; i < 10000; i++)
+        g_ptr_array_add(titles, make_title(i));
+
+    /* Each title counted i % 3 + 1 times, interleaved */
+    for (int round = 0; round < 3; round++) {
+        for (guint i = 0; i < titles->len; i++) {
+            if ((int)i % 3 < round)
+                continue;
+            const gchar *title = g_ptr_array_index(titles, i);
+            Key key = {title, strlen(title)};
+            Counter *c = count_key(&table, string_hash(key.str, key.len), &key);
+            g_assert_cmpstr(c->str, ==, title);
+        }
+    }
+    g_assert_cmpuint(string_table_size(&table), ==, titles->len);
+
+    for (guint i = 0; i < titles->len; i++) {
+        const gchar *title = g_ptr_array_index(titles, i);
+        Key key = {title, strlen(title)};
+        Counter *c = string_table_lookup(&table, string_hash(key.str, key.len),
+                                         &key, counter_equal);
+        g_assert_nonnull(c);
+        g_assert_cmpint(c->count, ==, i % 3 + 1);
+    }
+    g_assert_null(string_table_lookup(&table, string_hash(missing.str, missing.len),
+                                      &missing, counter_equal));
+
+    free_counters(&table);
+    g_ptr_array_free(titles, TRUE);
+}
+
+static void test_colliding_hashes(void)
+{
+    /* Every key under one hash: equal() alone tells them apart, and
+     * lookups of absent keys still stop */
+    StringTable table;
+    string_table_init(&table);
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i < 200; i++) {
+            gchar *title = make_title(i);
+            Key key = {title, strlen(title)};
+            count_key(&table, 42, &key);
+            g_free(title);
+        }
+    }
+    g_assert_cmpuint(string_table_size(&table), ==, 200);
+
+    gchar *title = make_title(7);
+    Key key = {title, strlen(title)};
+    Counter *c = string_table_lookup(&table, 42, &key, counter_equal);
+    g_assert_cmpint(c->count, ==, 2);
+    key.len--;
+    g_assert_null(string_table_lookup(&table, 42, &key, counter_equal));
+    g_free(title);
+
+    free_counters(&table);
+}
+
+static void test_iterate(void)
+{
+    StringTable table;
+    string_table_init(&table);
+
+    StringTableIter iter;
+    gpointer item;
+    string_table_iter_init(&iter, &table);
+    g_assert_false(string_table_iter_next(&iter, &item));
+
+    for (int i = 0; i < 1000; i++) {
+        gchar *title = make_title(i);
+        Key key = {title, strlen(title)};
+        count_key(&table, string_hash(key.str, key.len), &key)->count = i;
+        g_free(title);
+    }
+
+    /* Each item exactly once */
+    guint8 seen[1000] = {0};
+    guint visited = 0;
+    string_table_iter_init(&iter, &table);
+    while (string_table_iter_next(&iter, &item)) {
+        Counter *c = item;
+        g_assert_cmpint(seen[c->count]++, ==, 0);
+        visited++;
+    }
+    g_assert_cmpuint(visited, ==, 1000);
+    g_assert_false(string_table_iter_next(&iter, &item));
+
+    free_counters(&table);
+}
+
+/* ── Benchmarks ────────────────────────────────────── */
+
+/* Title n of distinct ones, drawn with the skew of real days: a few
+ * windows take most records, then a long tail (Zipf, s = 1.1) */
+static guint *zipf_draws(GRand *rand, guint distinct, guint draws)
+{
+    double *cdf = g_new(double, distinct);
+    double sum = 0;
+    for (guint i = 0; i < distinct; i++)
+        cdf[i] = sum += 1.0 / pow(i + 1, 1.1);
+
+    guint *out = g_new(guint, draws);
+    for (guint d = 0; d < draws; d++) {
+        double x = g_rand_double(rand) * sum;
+        guint lo = 0, hi = distinct - 1;
+        while (lo < hi) {
+            guint mid = (lo + hi) / 2;
+            if (cdf[mid] < x)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        out[d] = lo;
+    }
+    g_free(cdf);
+    return out;
+}
+
+static void test_perf_string_table(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    /* A normal day, a kiosk seat's day, a year of days merged */
+    static const guint cardinalities[] = {400, 5000, 50000};
+    const guint draws = 200000;
+    const int rounds = 10;
+
+    for (gsize c = 0; c < G_N_ELEMENTS(cardinalities); c++) {
+        guint distinct = cardinalities[c];
+        GRand *rand = g_rand_new_with_seed(distinct);
+        guint *order = zipf_draws(rand, distinct, draws);
+        g_rand_free(rand);
+        gchar **titles = g_new(gchar *, distinct);
+        gsize *lens = g_new(gsize, distinct);
+        for (guint i = 0; i < distinct; i++) {
+            titles[i] = make_title(i);
+            lens[i] = strlen(titles[i]);
+        }
+
+        /* GHashTable as the stats used it: string keys, boxed counters */
+        long g_sum = 0;
+        g_test_timer_start();
+        for (int r = 0; r < rounds; r++) {
+            GHashTable *map = g_hash_table_new_full(g_str_hash, g_str_equal,
+                                                    g_free, g_free);
+            for (guint d = 0; d < draws; d++) {
+                const gchar *title = titles[order[d]];
+                long *secs = g_hash_table_lookup(map, title);
+                if (!secs) {
+                    secs = g_new0(long, 1);
+                    g_hash_table_insert(map, g_strdup(title), secs);
+                }
+                ++*secs;
+            }
+            g_sum += g_hash_table_size(map);
+            g_hash_table_destroy(map);
+        }
+        double g_time = g_test_timer_elapsed() / rounds;
+
+        long t_sum = 0;
+        g_test_timer_start();
+        for (int r = 0; r < rounds; r++) {
+            StringTable table;
+            string_table_init(&table);
+            for (guint d = 0; d < draws; d++) {
+                Key key = {titles[order[d]], lens[order[d]]};
+                count_key(&table, string_hash(key.str, key.len), &key);
+            }
+            t_sum += string_table_size(&table);
+            free_counters(&table);
+        }
+        double t_time = g_test_timer_elapsed() / rounds;
+        g_assert_cmpint(t_sum, ==, g_sum);
+
+        g_test_message("%u lookups over %u titles (%ld distinct seen): "
+                       "GHashTable %.2f ms, StringTable %.2f ms (%.2fx)",
+                       draws, distinct, t_sum / rounds, g_time * 1e3,
+                       t_time * 1e3, g_time / t_time);
+        g_test_minimized_result(t_time, "%u titles: %.2f ms", distinct,
+                                t_time * 1e3);
+
+        for (guint i = 0; i < distinct; i++)
+            g_free(titles[i]);
+        g_free(titles);
+        g_free(lens);
+        g_free(order);
+    }
+}
+
+/* ── main ──────────────────────────────────────────── */
+
+int main(int argc, char *argv[])
+{
+    g_test_init(&argc, &argv, NULL);
+
+    g_test_add_func("/string-table/hash_pieces", test_hash_pieces);
+    g_test_add_func("/string-table/insert_lookup_grow", test_insert_lookup_grow);
+    g_test_add_func("/string-table/colliding_hashes", test_colliding_hashes);
+    g_test_add_func("/string-table/iterate", test_iterate);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/string_table", test_perf_string_table);
+
+    return g_test_run();
+}
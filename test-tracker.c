@@ -1,6 +1,7 @@
 #define _XOPEN_SOURCE 700
 #include <glib.h>
 #include "tracker-core.h"
+#include <json-glib/json-glib.h>
 #include <string.h>
 #include <time.h>
 #include <stdio.h>
@@ -87,6 +88,64 @@ static void test_start_tracking_null_title(void)
     g_free(state.current_wm_class_instance);
 }
 
+/* A rich presence change closes the interval when its frame arrived,
+ * not when the main loop got to it */
+typedef struct {
+    guint records;
+    long duration;
+    gchar *rp_state;
+} CapturedRecord;
+
+static void capture_record(const CsvRecord *rec, gpointer user_data)
+{
+    CapturedRecord *cap = user_data;
+    cap->records++;
+    cap->duration = rec->duration;
+    g_free(cap->rp_state);
+    cap->rp_state = g_strdup(rec->rp_state);
+}
+
+static void test_start_presence_interval(void)
+{
+    AppState state = {0};
+    CapturedRecord cap = {0};
+    state.record_sink = capture_record;
+    state.record_sink_data = &cap;
+    start_tracking(&state, "main.c - Code", "Code", "code", "Editing a.c",
+                   "project", 4242, FALSE);
+    state.current_start -= 90 * G_USEC_PER_SEC;
+
+    gint64 arrived = g_get_monotonic_time() - 2 * G_USEC_PER_SEC;
+    emit_csv_line_at(&state, arrived);
+    start_presence_interval(&state, arrived, "Editing b.c", NULL);
+
+    g_assert_cmpuint(cap.records, ==, 1);
+    g_assert_cmpint(cap.duration, ==, 88);
+    g_assert_cmpstr(cap.rp_state, ==, "Editing a.c");
+
+    /* Same window, new presence, started two seconds ago */
+    g_assert_cmpstr(state.current_title, ==, "main.c - Code");
+    g_assert_cmpint(state.current_pid, ==, 4242);
+    g_assert_cmpstr(state.current_rp_state, ==, "Editing b.c");
+    g_assert_cmpstr(state.current_rp_details, ==, "");
+    g_assert_cmpint(state.current_start, ==, arrived);
+    g_assert_cmpint(time(NULL) - state.current_wall, >=, 2);
+    g_assert_cmpint(time(NULL) - state.current_wall, <=, 3);
+
+    /* Never back over time already recorded */
+    g_assert_false(start_presence_interval(&state, arrived - 1,
+                                           "Editing c.c", NULL));
+    g_assert_cmpstr(state.current_rp_state, ==, "Editing b.c");
+    g_assert_cmpint(state.current_start, ==, arrived);
+
+    g_free(cap.rp_state);
+    g_free(state.current_title);
+    g_free(state.current_wm_class);
+    g_free(state.current_wm_class_instance);
+    g_free(state.current_rp_state);
+    g_free(state.current_rp_details);
+}
+
 /* ── emit_csv_to_buffer ────────────────────────────────────── */
 
 static void test_emit_csv_active(void)
@@ -268,6 +327,247 @@ static void test_parse_focused_window_missing_wm_fields(void)
     free_focused_window_info(&info);
 }
 
+static void test_parse_focused_window_escapes(void)
+{
+    const gchar *json =
+        "[{\"title\":\"Say \\\"hi\\\" \\\\ caf\\u00e9 \\ud83d\\ude00\","
+         "\"wm_class\":\"A\\/B\",\"focus\":true}]";
+    FocusedWindowInfo info = parse_focused_window(json);
+    g_assert_cmpstr(info.title, ==, "Say \"hi\" \\ caf\xc3\xa9 \xf0\x9f\x98\x80");
+    g_assert_cmpstr(info.wm_class, ==, "A/B");
+    free_focused_window_info(&info);
+}
+
+static void test_parse_focused_window_invalid_escape(void)
+{
+    FocusedWindowInfo info = parse_focused_window(
+        "[{\"title\":\"bad \\q\",\"focus\":true}]");
+    g_assert_null(info.title);
+    free_focused_window_info(&info);
+
+    /* Lone low surrogate */
+    info = parse_focused_window("[{\"title\":\"\\udc00\",\"focus\":true}]");
+    g_assert_null(info.title);
+    free_focused_window_info(&info);
+}
+
+static void test_parse_focused_window_skips_nested(void)
+{
+    const gchar *json =
+        "[{\"title\":\"Other\",\"geometry\":{\"x\":0,\"tags\":[\"focus\",true]},"
+         "\"focus\":false},"
+         "{\"geometry\":{\"focus\":true},\"title\":\"Editor\",\"pid\":42,"
+         "\"monitors\":[[1,2],[]],\"focus\":true}]";
+    FocusedWindowInfo info = parse_focused_window(json);
+    g_assert_cmpstr(info.title, ==, "Editor");
+    g_assert_cmpint(info.pid, ==, 42);
+    free_focused_window_info(&info);
+}
+
+static void test_parse_focused_window_member_types(void)
+{
+    /* Non-string members read as NULL, the last duplicate wins and
+     * numbers convert like json_object_get_*_member() */
+    const gchar *json =
+        "[{\"title\":\"First\",\"title\":\"Second\",\"wm_class\":null,"
+         "\"wm_class_instance\":7,\"pid\":99.9,\"focus\":1}]";
+    FocusedWindowInfo info = parse_focused_window(json);
+    g_assert_cmpstr(info.title, ==, "Second");
+    g_assert_null(info.wm_class);
+    g_assert_null(info.wm_class_instance);
+    g_assert_cmpint(info.pid, ==, 99);
+    free_focused_window_info(&info);
+}
+
+static void test_parse_focused_window_truncated(void)
+{
+    FocusedWindowInfo info = parse_focused_window(
+        "[{\"title\":\"Terminal\",\"focus\":false},{\"title\":\"Fire");
+    g_assert_null(info.title);
+    free_focused_window_info(&info);
+}
+
+/* Reference implementation: the json-glib DOM parser used before the
+ * streaming scanner.  Kept to check that both agree and for benchmarks. */
+static FocusedWindowInfo parse_focused_window_dom(const gchar *json)
+{
+    FocusedWindowInfo info = {NULL, NULL, NULL, 0};
+
+    if (!json || !json[0])
+        return info;
+
+    JsonParser *parser = json_parser_new();
+    if (!json_parser_load_from_data(parser, json, -1, NULL)) {
+        g_object_unref(parser);
+        return info;
+    }
+
+    JsonNode *root = json_parser_get_root(parser);
+    if (!root || !JSON_NODE_HOLDS_ARRAY(root)) {
+        g_object_unref(parser);
+        return info;
+    }
+
+    JsonArray *array = json_node_get_array(root);
+    guint len = json_array_get_length(array);
+
+    for (guint i = 0; i < len; i++) {
+        JsonObject *obj = json_array_get_object_element(array, i);
+        if (!obj)
+            continue;
+        if (json_object_has_member(obj, "focus") &&
+            json_object_get_boolean_member(obj, "focus")) {
+            if (json_object_has_member(obj, "title")) {
+                const gchar *t = json_object_get_string_member(obj, "title");
+                if (t && t[0] != '\0')
+                    info.title = g_strdup(t);
+            }
+            if (json_object_has_member(obj, "wm_class")) {
+                const gchar *c = json_object_get_string_member(obj, "wm_class");
+                if (c)
+                    info.wm_class = g_strdup(c);
+            }
+            if (json_object_has_member(obj, "wm_class_instance")) {
+                const gchar *ci = json_object_get_string_member(obj, "wm_class_instance");
+                if (ci)
+                    info.wm_class_instance = g_strdup(ci);
+            }
+            if (json_object_has_member(obj, "pid"))
+                info.pid = (pid_t)json_object_get_int_member(obj, "pid");
+            break;
+        }
+    }
+
+    g_object_unref(parser);
+    return info;
+}
+
+/* Window Calls style list; focused < 0 means no window has focus */
+static gchar *build_window_list(int count, int focused)
+{
+    static const char *titles[] = {
+        "Terminal", "", "Inbox (3) \\u2014 Mail", "say \\\"cheese\\\"",
+        "C:\\\\path\\\\file.txt", "\\ud83d\\ude80 Launch", "caf\xc3\xa9 menu",
+        "tab\\tseparated",
+    };
+    GString *buf = g_string_new("[");
+    for (int i = 0; i < count; i++) {
+        if (i > 0)
+            g_string_append_c(buf, ',');
+        g_string_append_printf(buf,
+            "{\"in_current_workspace\":%s,\"wm_class\":\"App%d\","
+            "\"wm_class_instance\":\"app%d\",\"pid\":%d,\"id\":%d,"
+            "\"frame_type\":0,\"window_type\":0,\"width\":1280,\"height\":720,"
+            "\"x\":%d,\"y\":%d,\"focus\":%s,\"title\":\"%s #%d\"}",
+            i % 2 ? "true" : "false", i % 37, i % 37, 1000 + i, 3000000 + i,
+            i * 7 % 1920, i * 3 % 1080, i == focused ? "true" : "false",
+            titles[i % G_N_ELEMENTS(titles)], i);
+    }
+    g_string_append_c(buf, ']');
+    return g_string_free(buf, FALSE);
+}
+
+static void assert_same_focused_window(const gchar *json)
+{
+    FocusedWindowInfo a = parse_focused_window(json);
+    FocusedWindowInfo b = parse_focused_window_dom(json);
+    g_assert_cmpstr(a.title, ==, b.title);
+    g_assert_cmpstr(a.wm_class, ==, b.wm_class);
+    g_assert_cmpstr(a.wm_class_instance, ==, b.wm_class_instance);
+    g_assert_cmpint(a.pid, ==, b.pid);
+    free_focused_window_info(&a);
+    free_focused_window_info(&b);
+}
+
+static void test_parse_focused_window_matches_dom(void)
+{
+    static const gchar *cases[] = {
+        "[]", "{\"focus\":true}", "[null,{\"focus\":true}]",
+        "[{\"focus\":true,\"title\":\"\"}]",
+        "[{\"focus\":\"true\",\"title\":\"string focus\"}]",
+        "[{\"focus\":0.5,\"title\":\"fractional\",\"pid\":-3}]",
+        "[{\"focus\":true,\"title\":\"t\",\"pid\":true}]",
+        "  [ { \"focus\" : true , \"title\" : \"spaced\" } ]  ",
+    };
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++)
+        assert_same_focused_window(cases[i]);
+
+    for (int count = 1; count <= 64; count++) {
+        int focused = g_test_rand_int_range(-1, count);
+        gchar *json = build_window_list(count, focused);
+        assert_same_focused_window(json);
+        g_free(json);
+    }
+}
+
+static void test_reply_hash(void)
+{
+    gchar *a = build_window_list(50, 10);
+    gchar *b = build_window_list(50, 11);  /* focus moved, same length */
+    gsize len = strlen(a);
+    g_assert_cmpuint(strlen(b), ==, len);
+
+    g_assert_cmpuint(reply_hash(a, len), ==, reply_hash(a, len));
+    g_assert_cmpuint(reply_hash(a, len), !=, reply_hash(b, len));
+    /* Every tail length goes through the partial-word path */
+    for (gsize n = 0; n < 16; n++)
+        g_assert_cmpuint(reply_hash(a, len - n), !=, reply_hash(a, len - n - 1));
+
+    /* A single flipped byte anywhere changes the hash */
+    guint64 orig = reply_hash(a, len);
+    for (gsize i = 0; i < len; i += 7) {
+        a[i] ^= 1;
+        g_assert_cmpuint(reply_hash(a, len), !=, orig);
+        a[i] ^= 1;
+    }
+    g_free(a);
+    g_free(b);
+}
+
+static void test_perf_parse_focused_window(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    static const int counts[] = {10, 100, 500, 1000, 5000};
+    for (gsize i = 0; i < G_N_ELEMENTS(counts); i++) {
+        int n = counts[i];
+        /* Focused window last: the scanner has to cross the whole list */
+        gchar *json = build_window_list(n, n - 1);
+        int iterations = MAX(20, 200000 / n);
+
+        g_test_timer_start();
+        for (int j = 0; j < iterations; j++) {
+            FocusedWindowInfo info = parse_focused_window_dom(json);
+            free_focused_window_info(&info);
+        }
+        double dom = g_test_timer_elapsed() / iterations;
+
+        g_test_timer_start();
+        for (int j = 0; j < iterations; j++) {
+            FocusedWindowInfo info = parse_focused_window(json);
+            free_focused_window_info(&info);
+        }
+        double scan = g_test_timer_elapsed() / iterations;
+
+        g_test_timer_start();
+        guint64 sink = 0;
+        for (int j = 0; j < iterations; j++)
+            sink += reply_hash(json, strlen(json));
+        double hash = g_test_timer_elapsed() / iterations;
+
+        g_test_message("%5d windows (%7zu bytes): json-glib %9.1f us, "
+                       "scanner %8.1f us, unchanged check %6.1f us (%" G_GUINT64_FORMAT ")",
+                       n, strlen(json), dom * 1e6, scan * 1e6, hash * 1e6,
+                       sink & 1);
+        g_test_minimized_result(scan, "parse_focused_window %d windows: %.2f us",
+                                n, scan * 1e6);
+        g_free(json);
+    }
+}
+
 /* ── file output ───────────────────────────────────────────── */
 
 static gchar *create_test_tmpdir(void)
@@ -302,7 +602,7 @@ static void test_ensure_output_creates(void)
 
     gboolean ok = ensure_output_file(&state, t);
     g_assert_true(ok);
-    g_assert_nonnull(state.output_fp);
+    g_assert_cmpint(state.output_fd, >=, 0);
     g_assert_cmpint(state.file_year, ==, 2026);
     g_assert_cmpint(state.file_month, ==, 1);
     g_assert_cmpint(state.file_day, ==, 28);
@@ -337,12 +637,12 @@ static void test_ensure_output_same_date(void)
     time_t t = mktime(&tm);
 
     ensure_output_file(&state, t);
-    FILE *first_fp = state.output_fp;
+    int first_fd = state.output_fd;
 
     /* Call again with same date — should be no-op */
     gboolean ok = ensure_output_file(&state, t + 3600);
     g_assert_true(ok);
-    g_assert_true(state.output_fp == first_fp);
+    g_assert_cmpint(state.output_fd, ==, first_fd);
 
     close_output_file(&state);
     cleanup_test_tmpdir(tmpdir);
@@ -401,10 +701,10 @@ static void test_close_output_file(void)
     time_t t = mktime(&tm);
 
     ensure_output_file(&state, t);
-    g_assert_nonnull(state.output_fp);
+    g_assert_cmpint(state.output_fd, >=, 0);
 
     close_output_file(&state);
-    g_assert_null(state.output_fp);
+    g_assert_cmpint(state.output_fd, ==, -1);
     g_assert_cmpint(state.file_year, ==, 0);
     g_assert_cmpint(state.file_month, ==, 0);
     g_assert_cmpint(state.file_day, ==, 0);
@@ -427,12 +727,12 @@ static void test_ensure_output_appends(void)
 
     /* First open — writes header */
     ensure_output_file(&state, t);
-    fprintf(state.output_fp, "fake,data,line\n");
+    dprintf(state.output_fd, "fake,data,line\n");
     close_output_file(&state);
 
     /* Second open — should NOT write header again */
     ensure_output_file(&state, t);
-    fprintf(state.output_fp, "more,data,here\n");
+    dprintf(state.output_fd, "more,data,here\n");
     close_output_file(&state);
 
     gchar *file_path = g_strdup_printf("%s/activity-tracker/2026-01/2026-01-28.csv", tmpdir);
@@ -459,6 +759,268 @@ static void test_ensure_output_appends(void)
     cleanup_test_tmpdir(tmpdir);
 }
 
+/* ── durability & recovery ─────────────────────────────────── */
+
+static void emit_test_record(AppState *state, time_t wall, const gchar *title)
+{
+    g_free(state->current_title);
+    state->current_title = g_strdup(title);
+    state->current_wall = wall;
+    state->current_start = g_get_monotonic_time() - 5 * G_USEC_PER_SEC;
+    emit_csv_line(state);
+}
+
+static time_t test_noon(void)
+{
+    struct tm tm = {0};
+    tm.tm_year = 126;
+    tm.tm_mon = 0;
+    tm.tm_mday = 28;
+    tm.tm_hour = 12;
+    return mktime(&tm);
+}
+
+static void test_durability_strict(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    time_t t = test_noon();
+
+    ensure_output_file(&state, t);
+    guint64 base = state.sync_count;  /* header */
+    emit_test_record(&state, t, "One");
+    emit_test_record(&state, t, "Two");
+    g_assert_cmpuint(state.sync_count, ==, base + 2);
+    g_assert_cmpint(state.unsynced_records, ==, 0);
+
+    close_output_file(&state);
+    g_free(state.current_title);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_durability_interval_records(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_INTERVAL;
+    state.sync_records = 3;
+    state.sync_interval = 3600;
+    time_t t = test_noon();
+
+    ensure_output_file(&state, t);
+    g_assert_cmpuint(state.sync_count, ==, 0);
+    emit_test_record(&state, t, "One");
+    emit_test_record(&state, t, "Two");
+    g_assert_cmpuint(state.sync_count, ==, 0);
+    g_assert_cmpint(state.unsynced_records, ==, 2);
+    emit_test_record(&state, t, "Three");
+    g_assert_cmpuint(state.sync_count, ==, 1);
+    g_assert_cmpint(state.unsynced_records, ==, 0);
+
+    close_output_file(&state);
+    g_free(state.current_title);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_durability_interval_seconds(void)
+{
+    AppState state = {0};
+    state.durability = DURABILITY_INTERVAL;
+    state.sync_interval = 10;
+    state.last_sync = 1000 * G_USEC_PER_SEC;
+
+    g_assert_false(output_sync_due(&state, state.last_sync + 60 * G_USEC_PER_SEC));
+    state.unsynced_records = 1;
+    g_assert_false(output_sync_due(&state, state.last_sync + 9 * G_USEC_PER_SEC));
+    g_assert_true(output_sync_due(&state, state.last_sync + 10 * G_USEC_PER_SEC));
+
+    /* Disabled by count: only the clock matters */
+    state.unsynced_records = 1000;
+    g_assert_false(output_sync_due(&state, state.last_sync + G_USEC_PER_SEC));
+}
+
+static void test_durability_rotation(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+    time_t t = test_noon();
+
+    ensure_output_file(&state, t);
+    for (int i = 0; i < 10; i++)
+        emit_test_record(&state, t, "Record");
+    g_assert_cmpuint(state.sync_count, ==, 0);
+    g_assert_false(output_sync_due(&state, G_MAXINT64));
+
+    /* Rotation to the next day syncs the closed file */
+    ensure_output_file(&state, t + 24 * 3600);
+    g_assert_cmpuint(state.sync_count, ==, 1);
+    close_output_file(&state);
+    g_assert_cmpuint(state.sync_count, ==, 2);
+
+    /* Records reached the file even without fsync */
+    gchar *path = build_csv_path(tmpdir, 2026, 1, 28);
+    gchar *contents = NULL;
+    g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    g_assert_cmpuint(g_strv_length(lines), ==, 12);  /* header + 10 + "" */
+    g_strfreev(lines);
+    g_free(contents);
+    g_free(path);
+
+    g_free(state.current_title);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_parse_durability_mode(void)
+{
+    DurabilityMode mode = DURABILITY_STRICT;
+    g_assert_true(parse_durability_mode("interval", &mode));
+    g_assert_cmpint(mode, ==, DURABILITY_INTERVAL);
+    g_assert_true(parse_durability_mode("rotation", &mode));
+    g_assert_cmpint(mode, ==, DURABILITY_ROTATION);
+    g_assert_true(parse_durability_mode("strict", &mode));
+    g_assert_cmpint(mode, ==, DURABILITY_STRICT);
+    g_assert_false(parse_durability_mode("sometimes", &mode));
+    g_assert_false(parse_durability_mode(NULL, &mode));
+    g_assert_cmpint(mode, ==, DURABILITY_STRICT);
+}
+
+static void test_parse_output_format(void)
+{
+    OutputFormat format = OUTPUT_CSV;
+    g_assert_true(parse_output_format("binary", &format));
+    g_assert_cmpint(format, ==, OUTPUT_BINARY);
+    g_assert_true(parse_output_format("csv", &format));
+    g_assert_cmpint(format, ==, OUTPUT_CSV);
+    g_assert_false(parse_output_format("json", &format));
+    g_assert_cmpint(format, ==, OUTPUT_CSV);
+}
+
+static gchar *write_temp_file(const gchar *contents, gssize len)
+{
+    gchar *path = NULL;
+    gint fd = g_file_open_tmp("recover-test-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+    g_assert_true(g_file_set_contents(path, contents, len, NULL));
+    return path;
+}
+
+static void assert_recovered(const gchar *before, goffset dropped,
+                             const gchar *after)
+{
+    gchar *path = write_temp_file(before, -1);
+    g_assert_cmpint(recover_torn_tail(path), ==, dropped);
+    gchar *contents = NULL;
+    g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+    g_assert_cmpstr(contents, ==, after);
+    g_free(contents);
+    unlink(path);
+    g_free(path);
+}
+
+static void test_recover_torn_tail(void)
+{
+    assert_recovered("header\na,1,active\nb,2,act", 7,
+                     "header\na,1,active\n");
+    /* Intact file and empty file are left alone */
+    assert_recovered("header\na,1,active\n", 0, "header\na,1,active\n");
+    assert_recovered("", 0, "");
+    /* Torn header: nothing worth keeping */
+    assert_recovered("timestamp,dura", 14, "");
+}
+
+static void test_recover_torn_tail_large(void)
+{
+    /* Last newline lies several read blocks before the end */
+    GString *buf = g_string_new("header\n");
+    for (int i = 0; i < 3 * 4096; i++)
+        g_string_append_c(buf, 'x');
+    gchar *path = write_temp_file(buf->str, buf->len);
+    g_assert_cmpint(recover_torn_tail(path), ==, 3 * 4096);
+
+    gchar *contents = NULL;
+    g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+    g_assert_cmpstr(contents, ==, "header\n");
+    g_free(contents);
+    unlink(path);
+    g_free(path);
+    g_string_free(buf, TRUE);
+}
+
+static gpointer recover_in_thread(gpointer path)
+{
+    return GINT_TO_POINTER((gint)recover_torn_tail(path));
+}
+
+/* A report with the file mapped holds the truncation off until it is done */
+static void test_recover_waits_for_report(void)
+{
+    gchar *path = write_temp_file("header\na,1,active\nb,2,act", -1);
+    int fd = open_day_file_locked(path);
+    g_assert_cmpint(fd, >=, 0);
+
+    GThread *thread = g_thread_new("recover", recover_in_thread, path);
+    g_usleep(G_USEC_PER_SEC / 10);
+    gchar *contents = NULL;
+    g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+    g_assert_cmpstr(contents, ==, "header\na,1,active\nb,2,act");
+    g_free(contents);
+
+    close(fd);
+    g_assert_cmpint(GPOINTER_TO_INT(g_thread_join(thread)), ==, 7);
+    g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+    g_assert_cmpstr(contents, ==, "header\na,1,active\n");
+    g_free(contents);
+    unlink(path);
+    g_free(path);
+}
+
+static void test_recover_missing_file(void)
+{
+    g_assert_cmpint(recover_torn_tail("/nonexistent/activity-tracker.csv"), ==, 0);
+}
+
+static void test_ensure_output_recovers_torn_line(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    time_t t = test_noon();
+
+    ensure_output_file(&state, t);
+    emit_test_record(&state, t, "Complete");
+    close_output_file(&state);
+
+    /* Simulate a crash halfway through writing a record */
+    gchar *path = build_csv_path(tmpdir, 2026, 1, 28);
+    FILE *fp = fopen(path, "a");
+    fputs("2026-01-28T12:05:00,42,act", fp);
+    fclose(fp);
+
+    ensure_output_file(&state, t);
+    emit_test_record(&state, t, "After restart");
+    close_output_file(&state);
+
+    gchar *contents = NULL;
+    g_assert_true(g_file_get_contents(path, &contents, NULL, NULL));
+    g_assert_null(strstr(contents, ",42,"));
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    g_assert_cmpuint(g_strv_length(lines), ==, 4);  /* header + 2 + "" */
+    g_assert_nonnull(strstr(lines[1], "\"Complete\""));
+    g_assert_nonnull(strstr(lines[2], "\"After restart\""));
+    g_strfreev(lines);
+    g_free(contents);
+    g_free(path);
+
+    g_free(state.current_title);
+    cleanup_test_tmpdir(tmpdir);
+}
+
 static void test_csv_escape_print_fp(void)
 {
     gchar *tmppath = NULL;
@@ -481,6 +1043,214 @@ static void test_csv_escape_print_fp(void)
     g_free(tmppath);
 }
 
+/* ── serialize_csv_record ──────────────────────────────────── */
+
+/* The stdio path serialize_csv_record() replaced: fprintf for the fixed
+ * columns, one fputc per character for the quoted ones. */
+static void stdio_escape_field(FILE *fp, const char *field)
+{
+    fputc('"', fp);
+    for (const char *p = field; *p; p++) {
+        if (*p == '"')
+            fputc('"', fp);
+        fputc(*p, fp);
+    }
+    fputc('"', fp);
+}
+
+static void write_record_stdio(FILE *fp, const CsvRecord *rec)
+{
+    char ts[32];
+    format_iso8601(rec->wall, ts, sizeof(ts));
+    fprintf(fp, "%s,%ld,%s,", ts, rec->duration, rec->status);
+    stdio_escape_field(fp, rec->title);
+    fputc(',', fp);
+    stdio_escape_field(fp, rec->wm_class);
+    fputc(',', fp);
+    stdio_escape_field(fp, rec->wm_class_instance);
+    fputc(',', fp);
+    stdio_escape_field(fp, rec->rp_state);
+    fputc(',', fp);
+    stdio_escape_field(fp, rec->rp_details);
+    fputc('\n', fp);
+    fflush(fp);
+}
+
+static const CsvRecord test_record = {
+    0, 42, "active", "Main.java - \"project\" - IntelliJ IDEA",
+    "jetbrains-idea", "jetbrains-idea", "Editing Main.java", "my-project"
+};
+
+static void test_csv_escape_runs(void)
+{
+    static const struct { const char *in, *out; } cases[] = {
+        {"\"", "\"\"\"\""},
+        {"\"\"", "\"\"\"\"\"\""},
+        {"\"lead", "\"\"\"lead\""},
+        {"trail\"", "\"trail\"\"\""},
+        {"a\"b\"\"c", "\"a\"\"b\"\"\"\"c\""},
+        {"no quotes, only commas", "\"no quotes, only commas\""},
+    };
+    for (gsize i = 0; i < G_N_ELEMENTS(cases); i++) {
+        GString *buf = g_string_new(NULL);
+        csv_escape_to_buffer(buf, cases[i].in);
+        g_assert_cmpstr(buf->str, ==, cases[i].out);
+        g_string_free(buf, TRUE);
+    }
+}
+
+static void test_iso8601_cached(void)
+{
+    TimestampCache cache = {0};
+    /* Crosses minute, hour and day boundaries, including going backwards */
+    time_t base = 1705362000 - 90;  /* shortly before midnight UTC */
+    for (time_t t = base; t < base + 3 * 3600; t += 7) {
+        char want[32], got[32];
+        format_iso8601(t, want, sizeof(want));
+        gsize len = format_iso8601_cached(&cache, t, got);
+        g_assert_cmpstr(got, ==, want);
+        g_assert_cmpuint(len, ==, strlen(want));
+
+        format_iso8601(t - 61, want, sizeof(want));
+        format_iso8601_cached(&cache, t - 61, got);
+        g_assert_cmpstr(got, ==, want);
+    }
+}
+
+static void test_serialize_matches_stdio(void)
+{
+    gchar *path = NULL;
+    gint fd = g_file_open_tmp("csv-test-XXXXXX", &path, NULL);
+    g_assert_cmpint(fd, >=, 0);
+    close(fd);
+
+    CsvRecord rec = test_record;
+    rec.wall = test_noon();
+    FILE *fp = fopen(path, "w");
+    write_record_stdio(fp, &rec);
+    fclose(fp);
+
+    gchar *want = NULL;
+    g_file_get_contents(path, &want, NULL, NULL);
+
+    TimestampCache cache = {0};
+    GString *buf = g_string_new(NULL);
+    serialize_csv_record(buf, &rec, &cache);
+    g_assert_cmpstr(buf->str, ==, want);
+
+    /* The buffer is appended to; without a cache the result is the same */
+    serialize_csv_record(buf, &rec, NULL);
+    g_assert_cmpuint(buf->len, ==, 2 * strlen(want));
+    g_assert_true(g_str_has_suffix(buf->str, want));
+
+    g_string_free(buf, TRUE);
+    g_free(want);
+    unlink(path);
+    g_free(path);
+}
+
+static void test_write_record_one_line_per_call(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+
+    CsvRecord rec = test_record;
+    rec.wall = test_noon();
+    for (int i = 0; i < 3; i++) {
+        rec.duration = i + 1;
+        write_csv_record(&state, &rec);
+    }
+    g_assert_nonnull(state.line_buf);
+    close_output_file(&state);
+    g_assert_null(state.line_buf);
+
+    gchar *path = g_strdup_printf("%s/activity-tracker/2026-01/2026-01-28.csv", tmpdir);
+    gchar *contents = NULL;
+    g_file_get_contents(path, &contents, NULL, NULL);
+    gchar **lines = g_strsplit(contents, "\n", -1);
+    g_assert_cmpuint(g_strv_length(lines), ==, 5);  /* header, 3, "" */
+    for (int i = 0; i < 3; i++) {
+        gchar *ts, *status, *title, *cls, *inst, *rps, *rpd;
+        long dur;
+        g_assert_true(parse_csv_line(lines[i + 1], &ts, &dur, &status, &title,
+                                     &cls, &inst, &rps, &rpd));
+        g_assert_cmpint(dur, ==, i + 1);
+        g_assert_cmpstr(title, ==, test_record.title);
+        g_free(ts); g_free(status); g_free(title);
+        g_free(cls); g_free(inst); g_free(rps); g_free(rpd);
+    }
+
+    g_strfreev(lines);
+    g_free(contents);
+    g_free(path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+static void test_perf_csv_record(void)
+{
+    if (!g_test_perf()) {
+        g_test_skip("benchmark, run with -m perf");
+        return;
+    }
+
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *stdio_path = g_build_filename(tmpdir, "stdio.csv", NULL);
+    int iterations = 200000;
+    CsvRecord rec = test_record;
+    time_t noon = test_noon();
+
+    /* Formatting alone: one day of seconds, so the cache misses once a minute */
+    g_test_timer_start();
+    FILE *null_fp = fopen("/dev/null", "w");
+    for (int i = 0; i < iterations; i++) {
+        rec.wall = noon + i % 86400;
+        write_record_stdio(null_fp, &rec);
+    }
+    fclose(null_fp);
+    double stdio_format = g_test_timer_elapsed() / iterations;
+
+    TimestampCache cache = {0};
+    GString *buf = g_string_sized_new(512);
+    g_test_timer_start();
+    for (int i = 0; i < iterations; i++) {
+        rec.wall = noon + i % 86400;
+        g_string_truncate(buf, 0);
+        serialize_csv_record(buf, &rec, &cache);
+    }
+    double serialize = g_test_timer_elapsed() / iterations;
+    g_string_free(buf, TRUE);
+
+    /* Formatting plus the file append, fsync left out */
+    rec.wall = noon;
+    FILE *fp = fopen(stdio_path, "a");
+    g_test_timer_start();
+    for (int i = 0; i < iterations; i++)
+        write_record_stdio(fp, &rec);
+    double stdio_write = g_test_timer_elapsed() / iterations;
+    fclose(fp);
+
+    AppState state = {0};
+    state.data_dir = tmpdir;
+    state.durability = DURABILITY_ROTATION;
+    ensure_output_file(&state, rec.wall);
+    g_test_timer_start();
+    for (int i = 0; i < iterations; i++)
+        write_csv_record(&state, &rec);
+    double fd_write = g_test_timer_elapsed() / iterations;
+    close_output_file(&state);
+
+    g_test_message("format: stdio %.3f us, serializer %.3f us; "
+                   "format+append: fprintf/fputc %.3f us, write(2) %.3f us",
+                   stdio_format * 1e6, serialize * 1e6,
+                   stdio_write * 1e6, fd_write * 1e6);
+    g_test_minimized_result(fd_write, "write_csv_record: %.3f us", fd_write * 1e6);
+
+    g_free(stdio_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
 /* ── format_duration ───────────────────────────────────────── */
 
 static void test_format_duration_hours(void)
@@ -635,7 +1405,7 @@ static void test_compute_day_stats(void)
     g_assert_cmpint(second->total_seconds, ==, 90);
 
     /* Firefox should have 2 titles */
-    g_assert_cmpuint(g_hash_table_size(second->titles), ==, 2);
+    g_assert_cmpuint(second->n_titles, ==, 2);
 
     free_day_stats(stats);
     g_free(csv_path);
@@ -1104,7 +1874,7 @@ static void test_grep_app_name_match(void)
     g_assert_cmpstr(app->wm_class, ==, "Firefox");
     g_assert_cmpint(app->total_seconds, ==, 90);
     /* All titles preserved when app name matches */
-    g_assert_cmpuint(g_hash_table_size(app->titles), ==, 2);
+    g_assert_cmpuint(app->n_titles, ==, 2);
 
     free_day_stats(filtered);
     free_day_stats(stats);
@@ -1121,7 +1891,7 @@ static void test_grep_title_match_only(void)
     g_assert_cmpstr(app->wm_class, ==, "Chromium");
     /* Only the matching title's seconds */
     g_assert_cmpint(app->total_seconds, ==, 10);
-    g_assert_cmpuint(g_hash_table_size(app->titles), ==, 1);
+    g_assert_cmpuint(app->n_titles, ==, 1);
 
     free_day_stats(filtered);
     free_day_stats(stats);
@@ -1192,7 +1962,7 @@ static void test_grep_matches_both_app_and_title(void)
     g_assert_cmpuint(filtered->apps->len, ==, 1);
     AppStat *app = g_ptr_array_index(filtered->apps, 0);
     g_assert_cmpint(app->total_seconds, ==, 60);
-    g_assert_cmpuint(g_hash_table_size(app->titles), ==, 1);
+    g_assert_cmpuint(app->n_titles, ==, 1);
 
     free_day_stats(filtered);
     free_day_stats(stats);
@@ -1342,13 +2112,54 @@ static void test_compute_day_stats_rich_presence(void)
 
     g_assert_nonnull(idea);
     g_assert_cmpint(idea->total_seconds, ==, 90);
-    g_assert_cmpuint(g_hash_table_size(idea->titles), ==, 1);
-    g_assert_nonnull(g_hash_table_lookup(idea->titles, "Editing Main.java | my-project"));
+    g_assert_cmpuint(idea->n_titles, ==, 1);
+    g_assert_nonnull(app_stat_find_title(idea, "Editing Main.java | my-project"));
 
     g_assert_nonnull(term);
     g_assert_cmpint(term->total_seconds, ==, 120);
-    g_assert_cmpuint(g_hash_table_size(term->titles), ==, 1);
-    g_assert_nonnull(g_hash_table_lookup(term->titles, "Terminal"));
+    g_assert_cmpuint(term->n_titles, ==, 1);
+    g_assert_nonnull(app_stat_find_title(term, "Terminal"));
+
+    free_day_stats(stats);
+    g_free(csv_path);
+    cleanup_test_tmpdir(tmpdir);
+}
+
+/* ── compute_day_stats display keys ───────────────────────── */
+
+static void test_compute_day_stats_display_key_pieces(void)
+{
+    gchar *tmpdir = create_test_tmpdir();
+    gchar *csv_path = g_strdup_printf("%s/test.csv", tmpdir);
+
+    /* The same display key from split, whole, escaped and merged fields;
+     * a different wm_class keeps its own */
+    const gchar *csv =
+        "timestamp,duration_seconds,status,window_title,wm_class,wm_class_instance,rp_state,rp_details\n"
+        "2026-01-28T10:00:00,10,active,\"x\",\"app\",\"app\",\"Say \"\"hi\"\"\",\"now\"\n"
+        "2026-01-28T10:00:10,20,active,\"y\",\"app\",\"app\",\"Say \"\"hi\"\" | now\",\"\"\n"
+        "2026-01-28T10:00:30,40,active,\"Say \"\"hi\"\" | now\",app,app,,\n"
+        "2026-01-28T10:01:10,80,active,\"z\",\"other\",\"other\",\"\",\"Say \"\"hi\"\" | now\"\n";
+    g_file_set_contents(csv_path, csv, -1, NULL);
+
+    DayStats *stats = compute_day_stats(csv_path);
+    g_assert_nonnull(stats);
+    g_assert_cmpuint(stats->apps->len, ==, 2);
+    AppStat *other = g_ptr_array_index(stats->apps, 0);
+    AppStat *app = g_ptr_array_index(stats->apps, 1);
+    g_assert_cmpstr(app->wm_class, ==, "app");
+    g_assert_cmpuint(app->n_titles, ==, 1);
+    g_assert_cmpint(app_stat_find_title(app, "Say \"hi\" | now")->total_seconds,
+                    ==, 70);
+    g_assert_cmpuint(other->n_titles, ==, 1);
+
+    DayStats *again = compute_day_stats(csv_path);
+    merge_day_stats(stats, again);
+    free_day_stats(again);
+    g_assert_cmpuint(stats->apps->len, ==, 2);
+    app = g_ptr_array_index(stats->apps, 1);
+    g_assert_cmpuint(app->n_titles, ==, 1);
+    g_assert_cmpint(app->titles->total_seconds, ==, 140);
 
     free_day_stats(stats);
     g_free(csv_path);
@@ -1415,6 +2226,74 @@ static void test_emit_csv_with_rich_presence(void)
     g_free(state.current_rp_details);
 }
 
+/* ── Latency histogram ─────────────────────────────────────── */
+
+static void test_latency_bucket_boundaries(void)
+{
+    g_assert_cmpint(latency_histogram_bucket(0), ==, 0);
+    g_assert_cmpint(latency_histogram_bucket(999), ==, 0);
+    g_assert_cmpint(latency_histogram_bucket(1000), ==, 1);
+    g_assert_cmpint(latency_histogram_bucket(1999), ==, 1);
+    g_assert_cmpint(latency_histogram_bucket(2000), ==, 2);
+    g_assert_cmpint(latency_histogram_bucket(3999), ==, 2);
+    g_assert_cmpint(latency_histogram_bucket(4000), ==, 3);
+    g_assert_cmpint(latency_histogram_bucket(4095999), ==, 12);
+    g_assert_cmpint(latency_histogram_bucket(4096000), ==, LATENCY_BUCKETS - 1);
+    g_assert_cmpint(latency_histogram_bucket(G_GINT64_CONSTANT(3600000000)),
+                    ==, LATENCY_BUCKETS - 1);
+}
+
+static void test_latency_add(void)
+{
+    LatencyHistogram hist = {0};
+    latency_histogram_add(&hist, 500);
+    latency_histogram_add(&hist, 1500);
+    latency_histogram_add(&hist, 1500);
+    latency_histogram_add(&hist, -20); /* clock skew clamps to 0 */
+
+    g_assert_cmpuint(hist.count, ==, 4);
+    g_assert_cmpuint(hist.buckets[0], ==, 2);
+    g_assert_cmpuint(hist.buckets[1], ==, 2);
+    g_assert_cmpint(hist.total_usec, ==, 3500);
+    g_assert_cmpint(hist.max_usec, ==, 1500);
+}
+
+static void test_latency_print(void)
+{
+    LatencyHistogram hist = {0};
+    latency_histogram_add(&hist, 200);
+    latency_histogram_add(&hist, 5000);
+    latency_histogram_add(&hist, 5500);
+
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    print_latency_histogram(out, "Lag", &hist);
+    fclose(out);
+
+    g_assert_nonnull(strstr(buf, "Lag: 3 samples"));
+    g_assert_nonnull(strstr(buf, "max 5.50 ms"));
+    g_assert_nonnull(strstr(buf, "<1 ms"));
+    g_assert_nonnull(strstr(buf, "4-7 ms"));
+    /* Range is trimmed to non-empty outer buckets */
+    g_assert_null(strstr(buf, "8-15 ms"));
+    /* Tallest bucket gets the full 40-column bar */
+    g_assert_nonnull(strstr(buf, "########################################\n"));
+    free(buf);
+}
+
+static void test_latency_print_empty(void)
+{
+    LatencyHistogram hist = {0};
+    char *buf = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&buf, &len);
+    print_latency_histogram(out, "Lag", &hist);
+    fclose(out);
+    g_assert_cmpstr(buf, ==, "Lag: no samples\n");
+    free(buf);
+}
+
 /* ── main ──────────────────────────────────────────────────── */
 
 int main(int argc, char *argv[])
@@ -1426,8 +2305,12 @@ int main(int argc, char *argv[])
     g_test_add_func("/csv/escape_simple", test_csv_escape_simple);
     g_test_add_func("/csv/escape_with_quotes", test_csv_escape_with_quotes);
     g_test_add_func("/csv/escape_empty", test_csv_escape_empty);
+    g_test_add_func("/csv/escape_runs", test_csv_escape_runs);
+    g_test_add_func("/csv/iso8601_cached", test_iso8601_cached);
+    g_test_add_func("/csv/serialize_matches_stdio", test_serialize_matches_stdio);
     g_test_add_func("/tracking/start", test_start_tracking);
     g_test_add_func("/tracking/start_null_title", test_start_tracking_null_title);
+    g_test_add_func("/tracking/start_presence_interval", test_start_presence_interval);
     g_test_add_func("/emit/csv_active", test_emit_csv_active);
     g_test_add_func("/emit/csv_locked", test_emit_csv_locked);
     g_test_add_func("/emit/csv_idle", test_emit_csv_idle);
@@ -1442,12 +2325,31 @@ int main(int argc, char *argv[])
     g_test_add_func("/parse/focused_window_empty_string", test_parse_focused_window_empty_string);
     g_test_add_func("/parse/focused_window_missing_wm_fields", test_parse_focused_window_missing_wm_fields);
     g_test_add_func("/parse/focused_window_pid", test_parse_focused_window_pid);
+    g_test_add_func("/parse/focused_window_escapes", test_parse_focused_window_escapes);
+    g_test_add_func("/parse/focused_window_invalid_escape", test_parse_focused_window_invalid_escape);
+    g_test_add_func("/parse/focused_window_skips_nested", test_parse_focused_window_skips_nested);
+    g_test_add_func("/parse/focused_window_member_types", test_parse_focused_window_member_types);
+    g_test_add_func("/parse/focused_window_truncated", test_parse_focused_window_truncated);
+    g_test_add_func("/parse/focused_window_matches_dom", test_parse_focused_window_matches_dom);
+    g_test_add_func("/parse/reply_hash", test_reply_hash);
     g_test_add_func("/file/ensure_output_creates", test_ensure_output_creates);
     g_test_add_func("/file/ensure_output_same_date", test_ensure_output_same_date);
     g_test_add_func("/file/ensure_output_date_rotation", test_ensure_output_date_rotation);
     g_test_add_func("/file/close_output_file", test_close_output_file);
     g_test_add_func("/file/ensure_output_appends", test_ensure_output_appends);
     g_test_add_func("/file/csv_escape_print_fp", test_csv_escape_print_fp);
+    g_test_add_func("/file/write_record_one_line_per_call", test_write_record_one_line_per_call);
+    g_test_add_func("/file/durability_strict", test_durability_strict);
+    g_test_add_func("/file/durability_interval_records", test_durability_interval_records);
+    g_test_add_func("/file/durability_interval_seconds", test_durability_interval_seconds);
+    g_test_add_func("/file/durability_rotation", test_durability_rotation);
+    g_test_add_func("/file/parse_durability_mode", test_parse_durability_mode);
+    g_test_add_func("/file/parse_output_format", test_parse_output_format);
+    g_test_add_func("/file/recover_torn_tail", test_recover_torn_tail);
+    g_test_add_func("/file/recover_torn_tail_large", test_recover_torn_tail_large);
+    g_test_add_func("/file/recover_waits_for_report", test_recover_waits_for_report);
+    g_test_add_func("/file/recover_missing_file", test_recover_missing_file);
+    g_test_add_func("/file/ensure_output_recovers_torn_line", test_ensure_output_recovers_torn_line);
 
     /* Statistics tests */
     g_test_add_func("/stats/format_duration_hours", test_format_duration_hours);
@@ -1469,6 +2371,8 @@ int main(int argc, char *argv[])
     g_test_add_func("/stats/compute_day_stats_nonexistent", test_compute_day_stats_nonexistent);
     g_test_add_func("/stats/compute_day_stats_rich_presence", test_compute_day_stats_rich_presence);
     g_test_add_func("/stats/compute_day_stats_afk_active", test_compute_day_stats_afk_active);
+    g_test_add_func("/stats/compute_day_stats_display_key_pieces",
+                    test_compute_day_stats_display_key_pieces);
     g_test_add_func("/stats/top_apps_limit", test_stats_top_apps_limit);
     g_test_add_func("/stats/top_titles_limit", test_stats_top_titles_limit);
     g_test_add_func("/stats/format_long_app_name", test_format_long_app_name);
@@ -1493,5 +2397,15 @@ int main(int argc, char *argv[])
     g_test_add_func("/stats/grep_empty_pattern", test_grep_empty_pattern);
     g_test_add_func("/stats/grep_regex_features", test_grep_regex_features);
 
+    /* Latency histogram tests */
+    g_test_add_func("/latency/bucket_boundaries", test_latency_bucket_boundaries);
+    g_test_add_func("/latency/add", test_latency_add);
+    g_test_add_func("/latency/print", test_latency_print);
+    g_test_add_func("/latency/print_empty", test_latency_print_empty);
+
+    /* Benchmarks, run with -m perf */
+    g_test_add_func("/perf/parse_focused_window", test_perf_parse_focused_window);
+    g_test_add_func("/perf/csv_record", test_perf_csv_record);
+
     return g_test_run();
 }
@@ -1,8 +1,14 @@
-#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
 #include "tracker-core.h"
-#include <json-glib/json-glib.h>
+#include "binary-log.h"
+#include "day-archive.h"
+#include "csv-scan.h"
+#include "stats-cache.h"
+#include <errno.h>
+#include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/file.h>
 #include <sys/stat.h>
 #include <unistd.h>
 #include <wchar.h>
@@ -15,24 +21,65 @@ void format_iso8601(time_t t, char *buf, size_t len)
     strftime(buf, len, "%Y-%m-%dT%H:%M:%S", &tm);
 }
 
+/* Like format_iso8601() into a buffer of at least 32 bytes; returns the
+ * length.  Calls localtime_r() only when the minute changes. */
+gsize format_iso8601_cached(TimestampCache *cache, time_t t, char *buf)
+{
+    gint64 minute = t >= 0 ? t / 60 : (t - 59) / 60;
+    int sec = (int)(t - minute * 60);
+
+    if (!cache->valid || cache->minute != minute) {
+        struct tm tm;
+        time_t start = (time_t)(minute * 60);
+        localtime_r(&start, &tm);
+        cache->prefix_len = strftime(cache->prefix, sizeof(cache->prefix),
+                                     "%Y-%m-%dT%H:%M:", &tm);
+        cache->minute = minute;
+        cache->valid = TRUE;
+    }
+
+    memcpy(buf, cache->prefix, cache->prefix_len);
+    buf[cache->prefix_len] = (char)('0' + sec / 10);
+    buf[cache->prefix_len + 1] = (char)('0' + sec % 10);
+    buf[cache->prefix_len + 2] = '\0';
+    return cache->prefix_len + 2;
+}
+
+/* Quotes are doubled; everything between them is copied in one run */
 void csv_escape_to_buffer(GString *buf, const char *field)
 {
+    gsize len = strlen(field);
     g_string_append_c(buf, '"');
-    for (const char *p = field; *p; p++) {
-        if (*p == '"')
-            g_string_append_c(buf, '"');
-        g_string_append_c(buf, *p);
+    for (;;) {
+        const char *q = memchr(field, '"', len);
+        if (!q) {
+            g_string_append_len(buf, field, len);
+            break;
+        }
+        gsize run = q - field + 1;
+        g_string_append_len(buf, field, run);
+        g_string_append_c(buf, '"');
+        field += run;
+        len -= run;
     }
     g_string_append_c(buf, '"');
 }
 
 void csv_escape_and_print_fp(FILE *fp, const char *field)
 {
+    gsize len = strlen(field);
     fputc('"', fp);
-    for (const char *p = field; *p; p++) {
-        if (*p == '"')
-            fputc('"', fp);
-        fputc(*p, fp);
+    for (;;) {
+        const char *q = memchr(field, '"', len);
+        if (!q) {
+            fwrite(field, 1, len, fp);
+            break;
+        }
+        gsize run = q - field + 1;
+        fwrite(field, 1, run, fp);
+        fputc('"', fp);
+        field += run;
+        len -= run;
     }
     fputc('"', fp);
 }
@@ -42,84 +89,129 @@ void csv_escape_and_print(const char *field)
     csv_escape_and_print_fp(stdout, field);
 }
 
-void emit_csv_to_buffer(GString *buf, AppState *state, gint64 now)
+gboolean fill_csv_record(const AppState *state, gint64 now, CsvRecord *rec)
 {
     if (!state->current_title)
-        return;
+        return FALSE;
 
     gint64 duration_sec = (now - state->current_start) / G_USEC_PER_SEC;
-
     if (duration_sec < 1)
-        return;
-
-    char ts[32];
-    format_iso8601(state->current_wall, ts, sizeof(ts));
+        return FALSE;
 
     gboolean away = state->is_locked || state->is_idle;
     const gchar *empty = "";
-    const gchar *title = away ? empty : state->current_title;
-    const gchar *wm_class = away ? empty : (state->current_wm_class ? state->current_wm_class : empty);
-    const gchar *wm_class_instance = away ? empty : (state->current_wm_class_instance ? state->current_wm_class_instance : empty);
-    const gchar *status = state->is_locked ? "locked" : (state->is_idle ? "idle" : "active");
+    rec->wall = state->current_wall;
+    rec->duration = (long)duration_sec;
+    rec->status = state->is_locked ? "locked" : (state->is_idle ? "idle" : "active");
+    rec->title = away ? empty : state->current_title;
+    rec->wm_class = away ? empty : (state->current_wm_class ? state->current_wm_class : empty);
+    rec->wm_class_instance = away ? empty : (state->current_wm_class_instance ? state->current_wm_class_instance : empty);
+    rec->rp_state = away ? empty : (state->current_rp_state ? state->current_rp_state : empty);
+    rec->rp_details = away ? empty : (state->current_rp_details ? state->current_rp_details : empty);
+    return TRUE;
+}
+
+/* Append rec as one CSV line.  cache may be NULL. */
+void serialize_csv_record(GString *buf, const CsvRecord *rec,
+                          TimestampCache *cache)
+{
+    char ts[32];
+    gsize ts_len;
+    if (cache) {
+        ts_len = format_iso8601_cached(cache, rec->wall, ts);
+    } else {
+        format_iso8601(rec->wall, ts, sizeof(ts));
+        ts_len = strlen(ts);
+    }
 
-    const gchar *rp_state = away ? empty : (state->current_rp_state ? state->current_rp_state : empty);
-    const gchar *rp_details = away ? empty : (state->current_rp_details ? state->current_rp_details : empty);
+    char num[24];
+    int num_len = g_snprintf(num, sizeof(num), ",%ld,", rec->duration);
 
-    g_string_append_printf(buf, "%s,%ld,%s,", ts, (long)duration_sec, status);
-    csv_escape_to_buffer(buf, title);
+    g_string_append_len(buf, ts, ts_len);
+    g_string_append_len(buf, num, num_len);
+    g_string_append(buf, rec->status);
+    g_string_append_c(buf, ',');
+    csv_escape_to_buffer(buf, rec->title);
     g_string_append_c(buf, ',');
-    csv_escape_to_buffer(buf, wm_class);
+    csv_escape_to_buffer(buf, rec->wm_class);
     g_string_append_c(buf, ',');
-    csv_escape_to_buffer(buf, wm_class_instance);
+    csv_escape_to_buffer(buf, rec->wm_class_instance);
     g_string_append_c(buf, ',');
-    csv_escape_to_buffer(buf, rp_state);
+    csv_escape_to_buffer(buf, rec->rp_state);
     g_string_append_c(buf, ',');
-    csv_escape_to_buffer(buf, rp_details);
+    csv_escape_to_buffer(buf, rec->rp_details);
     g_string_append_c(buf, '\n');
 }
 
+void emit_csv_to_buffer(GString *buf, AppState *state, gint64 now)
+{
+    CsvRecord rec;
+    if (fill_csv_record(state, now, &rec))
+        serialize_csv_record(buf, &rec, NULL);
+}
+
 void emit_csv_line(AppState *state)
 {
-    if (!state->current_title)
+    emit_csv_line_at(state, g_get_monotonic_time());
+}
+
+void emit_csv_line_at(AppState *state, gint64 now)
+{
+    CsvRecord rec;
+    if (!fill_csv_record(state, now, &rec))
         return;
 
-    gint64 now = g_get_monotonic_time();
-    gint64 duration_sec = (now - state->current_start) / G_USEC_PER_SEC;
+    if (state->record_sink)
+        state->record_sink(&rec, state->record_sink_data);
+    else
+        write_csv_record(state, &rec);
+}
 
-    if (duration_sec < 1)
-        return;
+/* write(2) all of data; O_APPEND keeps each call's bytes contiguous */
+static gboolean write_all(int fd, const char *data, gsize len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return FALSE;
+        }
+        data += n;
+        len -= n;
+    }
+    return TRUE;
+}
 
-    if (!ensure_output_file(state, state->current_wall))
+/* Append one record to the day file for rec->wall with a single write(2),
+ * in the configured output format, honouring the durability policy. */
+void write_csv_record(AppState *state, const CsvRecord *rec)
+{
+    if (!ensure_output_file(state, rec->wall))
         return;
 
-    FILE *fp = state->output_fp;
+    if (state->binlog) {
+        if (!binlog_writer_append(state->binlog, rec)) {
+            g_printerr("Failed to write record: %s\n", g_strerror(errno));
+            return;
+        }
+        goto written;
+    }
 
-    char ts[32];
-    format_iso8601(state->current_wall, ts, sizeof(ts));
+    if (!state->line_buf)
+        state->line_buf = g_string_sized_new(512);
+    g_string_truncate(state->line_buf, 0);
+    serialize_csv_record(state->line_buf, rec, &state->ts_cache);
 
-    gboolean away = state->is_locked || state->is_idle;
-    const gchar *empty = "";
-    const gchar *title = away ? empty : state->current_title;
-    const gchar *wm_class = away ? empty : (state->current_wm_class ? state->current_wm_class : empty);
-    const gchar *wm_class_instance = away ? empty : (state->current_wm_class_instance ? state->current_wm_class_instance : empty);
-    const gchar *status = state->is_locked ? "locked" : (state->is_idle ? "idle" : "active");
-
-    const gchar *rp_state = away ? empty : (state->current_rp_state ? state->current_rp_state : empty);
-    const gchar *rp_details = away ? empty : (state->current_rp_details ? state->current_rp_details : empty);
-
-    fprintf(fp, "%s,%ld,%s,", ts, (long)duration_sec, status);
-    csv_escape_and_print_fp(fp, title);
-    fprintf(fp, ",");
-    csv_escape_and_print_fp(fp, wm_class);
-    fprintf(fp, ",");
-    csv_escape_and_print_fp(fp, wm_class_instance);
-    fprintf(fp, ",");
-    csv_escape_and_print_fp(fp, rp_state);
-    fprintf(fp, ",");
-    csv_escape_and_print_fp(fp, rp_details);
-    fprintf(fp, "\n");
-    fflush(fp);
-    fsync(fileno(fp));
+    if (!write_all(state->output_fd, state->line_buf->str, state->line_buf->len)) {
+        g_printerr("Failed to write record: %s\n", g_strerror(errno));
+        return;
+    }
+
+written:
+    state->unsynced_records++;
+    if (output_sync_due(state, g_get_monotonic_time()))
+        sync_output_file(state);
 }
 
 void start_tracking(AppState *state, const gchar *title,
@@ -141,6 +233,47 @@ void start_tracking(AppState *state, const gchar *title,
     state->current_start = g_get_monotonic_time();
     state->current_wall = time(NULL);
     state->is_locked = locked;
+    if (state->tracking_changed)
+        state->tracking_changed(state->tracking_changed_data);
+}
+
+gboolean start_presence_interval(AppState *state, gint64 start,
+                                 const gchar *rp_state, const gchar *rp_details)
+{
+    /* Time before start was already recorded or is being tracked */
+    if (start < state->current_start)
+        return FALSE;
+
+    g_free(state->current_rp_state);
+    state->current_rp_state = g_strdup(rp_state ? rp_state : "");
+    g_free(state->current_rp_details);
+    state->current_rp_details = g_strdup(rp_details ? rp_details : "");
+    state->current_start = start;
+    state->current_wall = time(NULL) -
+                          (g_get_monotonic_time() - start) / G_USEC_PER_SEC;
+    if (state->tracking_changed)
+        state->tracking_changed(state->tracking_changed_data);
+    return TRUE;
+}
+
+gboolean track_presence_change(AppState *state, pid_t pid,
+                               const gchar *rp_state, const gchar *rp_details,
+                               gint64 changed)
+{
+    if (state->is_locked || state->is_idle || pid != state->current_pid)
+        return FALSE;
+    /* Reported late: the interval being tracked began after the change,
+     * with whatever presence was current by then */
+    if (changed < state->current_start)
+        return FALSE;
+    if (g_strcmp0(state->current_rp_state ? state->current_rp_state : "",
+                  rp_state ? rp_state : "") == 0 &&
+        g_strcmp0(state->current_rp_details ? state->current_rp_details : "",
+                  rp_details ? rp_details : "") == 0)
+        return FALSE;
+
+    emit_csv_line_at(state, changed);
+    return start_presence_interval(state, changed, rp_state, rp_details);
 }
 
 gchar *build_csv_path(const gchar *data_dir_override,
@@ -152,6 +285,26 @@ gchar *build_csv_path(const gchar *data_dir_override,
                            data_dir, year, month, year, month, day);
 }
 
+gchar *build_binlog_path(const gchar *data_dir_override,
+                         int year, int month, int day)
+{
+    const gchar *data_dir = data_dir_override ? data_dir_override
+                                              : g_get_user_data_dir();
+    return g_strdup_printf("%s/activity-tracker/%04d-%02d/%04d-%02d-%02d.atlog",
+                           data_dir, year, month, year, month, day);
+}
+
+gchar *build_runtime_path(const gchar *name)
+{
+    const gchar *runtime_dir = g_getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir)
+        return g_build_filename(runtime_dir, name, NULL);
+    gchar *fallback = g_strdup_printf("/run/user/%d", getuid());
+    gchar *path = g_build_filename(fallback, name, NULL);
+    g_free(fallback);
+    return path;
+}
+
 gboolean ensure_output_file(AppState *state, time_t wall_time)
 {
     struct tm tm;
@@ -161,17 +314,26 @@ gboolean ensure_output_file(AppState *state, time_t wall_time)
     int day = tm.tm_mday;
 
     /* Already open for this date */
-    if (state->output_fp &&
+    if (state->file_day != 0 &&
         state->file_year == year &&
         state->file_month == month &&
         state->file_day == day) {
         return TRUE;
     }
 
-    /* Close previous file if open */
+    /* Close previous file if open, compressing it if it is a finished
+     * CSV day */
+    gchar *closed_path = NULL;
+    if (state->file_day != 0 && state->compress_closed && !state->binlog)
+        closed_path = build_csv_path(state->data_dir, state->file_year,
+                                     state->file_month, state->file_day);
     close_output_file(state);
+    if (closed_path)
+        state->compress_thread = day_archive_compress_in_background(closed_path);
 
-    gchar *file_path = build_csv_path(state->data_dir, year, month, day);
+    gboolean binary = state->output_format == OUTPUT_BINARY;
+    gchar *file_path = binary ? build_binlog_path(state->data_dir, year, month, day)
+                              : build_csv_path(state->data_dir, year, month, day);
     gchar *dir_path = g_path_get_dirname(file_path);
 
     if (g_mkdir_with_parents(dir_path, 0700) != 0) {
@@ -181,21 +343,57 @@ gboolean ensure_output_file(AppState *state, time_t wall_time)
         return FALSE;
     }
 
-    state->output_fp = fopen(file_path, "a");
-    if (!state->output_fp) {
+    /* A day written to again after it was compressed continues in full */
+    GError *error = NULL;
+    if (!binary && !day_archive_restore(file_path, &error)) {
+        g_printerr("Failed to restore compressed day file: %s\n", error->message);
+        g_error_free(error);
+        g_free(dir_path);
+        g_free(file_path);
+        return FALSE;
+    }
+
+    /* The binary log is checked by binlog_writer_new() instead */
+    goffset dropped = binary ? 0 : recover_torn_tail(file_path);
+    if (dropped > 0)
+        g_printerr("Dropped %" G_GOFFSET_FORMAT " bytes of an incomplete record from %s\n",
+                   dropped, file_path);
+
+    state->output_fd = open(file_path, (binary ? O_RDWR : O_WRONLY) |
+                            O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+    struct stat st;
+    if (state->output_fd < 0 || fstat(state->output_fd, &st) != 0) {
         g_printerr("Failed to open output file: %s\n", file_path);
+        if (state->output_fd >= 0)
+            close(state->output_fd);
+        state->output_fd = -1;
         g_free(dir_path);
         g_free(file_path);
         return FALSE;
     }
 
-    if (ftell(state->output_fp) == 0) {
-        fprintf(state->output_fp,
-                "timestamp,duration_seconds,status,window_title,wm_class,wm_class_instance,rp_state,rp_details\n");
-        fflush(state->output_fp);
-        fsync(fileno(state->output_fp));
+    if (binary) {
+        state->binlog = binlog_writer_new(state->output_fd, file_path);
+        if (!state->binlog) {
+            close(state->output_fd);
+            state->output_fd = -1;
+            g_free(dir_path);
+            g_free(file_path);
+            return FALSE;
+        }
     }
 
+    if (st.st_size == 0) {
+        if (!binary)
+            write_all(state->output_fd, CSV_HEADER, strlen(CSV_HEADER));
+        if (state->durability == DURABILITY_STRICT) {
+            fsync(state->output_fd);
+            state->sync_count++;
+        }
+    }
+    state->unsynced_records = 0;
+    state->last_sync = g_get_monotonic_time();
+
     state->file_year = year;
     state->file_month = month;
     state->file_day = day;
@@ -207,70 +405,576 @@ gboolean ensure_output_file(AppState *state, time_t wall_time)
 
 void close_output_file(AppState *state)
 {
-    if (state->output_fp) {
-        fflush(state->output_fp);
-        fsync(fileno(state->output_fp));
-        fclose(state->output_fp);
-        state->output_fp = NULL;
+    if (state->file_day != 0) {
+        fsync(state->output_fd);
+        state->sync_count++;
+        close(state->output_fd);
+    }
+    state->output_fd = -1;
+    binlog_writer_free(state->binlog);
+    state->binlog = NULL;
+    if (state->compress_thread) {
+        g_thread_join(state->compress_thread);
+        state->compress_thread = NULL;
+    }
+    if (state->line_buf) {
+        g_string_free(state->line_buf, TRUE);
+        state->line_buf = NULL;
     }
+    state->unsynced_records = 0;
     state->file_year = 0;
     state->file_month = 0;
     state->file_day = 0;
 }
 
-FocusedWindowInfo parse_focused_window(const gchar *json)
+void sync_output_file(AppState *state)
 {
-    FocusedWindowInfo info = {NULL, NULL, NULL, 0};
+    if (state->file_day == 0)
+        return;
+    fsync(state->output_fd);
+    state->sync_count++;
+    state->unsynced_records = 0;
+    state->last_sync = g_get_monotonic_time();
+}
 
-    if (!json || !json[0])
-        return info;
+gboolean output_sync_due(const AppState *state, gint64 now)
+{
+    if (state->unsynced_records == 0)
+        return FALSE;
 
-    JsonParser *parser = json_parser_new();
-    if (!json_parser_load_from_data(parser, json, -1, NULL)) {
-        g_object_unref(parser);
-        return info;
+    switch (state->durability) {
+    case DURABILITY_STRICT:
+        return TRUE;
+    case DURABILITY_INTERVAL:
+        if (state->sync_records > 0 &&
+            state->unsynced_records >= state->sync_records)
+            return TRUE;
+        return state->sync_interval > 0 &&
+               now - state->last_sync >= (gint64)state->sync_interval * G_USEC_PER_SEC;
+    case DURABILITY_ROTATION:
+    default:
+        return FALSE;
     }
+}
 
-    JsonNode *root = json_parser_get_root(parser);
-    if (!root || !JSON_NODE_HOLDS_ARRAY(root)) {
-        g_object_unref(parser);
-        return info;
+gboolean parse_durability_mode(const gchar *str, DurabilityMode *mode)
+{
+    if (g_strcmp0(str, "strict") == 0)
+        *mode = DURABILITY_STRICT;
+    else if (g_strcmp0(str, "interval") == 0)
+        *mode = DURABILITY_INTERVAL;
+    else if (g_strcmp0(str, "rotation") == 0)
+        *mode = DURABILITY_ROTATION;
+    else
+        return FALSE;
+    return TRUE;
+}
+
+gboolean parse_output_format(const gchar *str, OutputFormat *format)
+{
+    if (g_strcmp0(str, "csv") == 0)
+        *format = OUTPUT_CSV;
+    else if (g_strcmp0(str, "binary") == 0)
+        *format = OUTPUT_BINARY;
+    else
+        return FALSE;
+    return TRUE;
+}
+
+static int flock_retry(int fd, int operation)
+{
+    int rc;
+    do
+        rc = flock(fd, operation);
+    while (rc != 0 && errno == EINTR);
+    return rc;
+}
+
+gboolean truncate_day_file(int fd, goffset size)
+{
+    if (flock_retry(fd, LOCK_EX) != 0)
+        return FALSE;
+    gboolean ok = ftruncate(fd, size) == 0;
+    int saved = errno;
+    flock(fd, LOCK_UN);
+    errno = saved;
+    return ok;
+}
+
+int open_day_file_locked(const gchar *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    if (flock_retry(fd, LOCK_SH) != 0) {
+        int saved = errno;
+        close(fd);
+        errno = saved;
+        return -1;
+    }
+    return fd;
+}
+
+/* Records that were written but not yet fsynced when the machine went down
+ * can leave the file ending mid-line.  Cut it back to the last newline so
+ * new records do not get glued onto the torn one.  Returns the number of
+ * bytes removed, 0 when the file is intact or missing, -1 on I/O error. */
+goffset recover_torn_tail(const gchar *path)
+{
+    int fd = open(path, O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return errno == ENOENT ? 0 : -1;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    off_t keep = 0;
+    off_t pos = st.st_size;
+    char buf[4096];
+    while (pos > 0) {
+        size_t n = pos < (off_t)sizeof(buf) ? (size_t)pos : sizeof(buf);
+        if (pread(fd, buf, n, pos - n) != (ssize_t)n) {
+            close(fd);
+            return -1;
+        }
+        const char *nl = memrchr(buf, '\n', n);
+        if (nl) {
+            keep = pos - n + (nl - buf) + 1;
+            break;
+        }
+        pos -= n;
+    }
+
+    goffset dropped = st.st_size - keep;
+    if (dropped > 0 && (!truncate_day_file(fd, keep) || fsync(fd) != 0))
+        dropped = -1;
+    close(fd);
+    return dropped;
+}
+
+/* ── Focused window extraction ─────────────────────────── */
+
+/* Window Calls returns every open window on each poll.  Instead of building
+ * a json-glib tree, the list is scanned in place: members of unfocused
+ * windows are only skipped over, and scanning stops at the end of the first
+ * object whose "focus" member is true.  Values are converted with the same
+ * rules as json_object_get_*_member(). */
+
+#define JSON_MAX_DEPTH 64
+
+typedef struct {
+    const gchar *p;
+    int depth;
+} JsonCursor;
+
+/* Raw extent of a value, from its first byte up to one past its last */
+typedef struct {
+    const gchar *start;
+    const gchar *end;
+} JsonSpan;
+
+typedef struct {
+    JsonSpan title;
+    JsonSpan wm_class;
+    JsonSpan wm_class_instance;
+    JsonSpan pid;
+    gboolean focus;
+} WindowMembers;
+
+static inline void json_skip_ws(JsonCursor *c)
+{
+    while (*c->p == ' ' || *c->p == '\t' || *c->p == '\n' || *c->p == '\r')
+        c->p++;
+}
+
+static gboolean json_skip_string(JsonCursor *c)
+{
+    const gchar *p = c->p + 1;
+    for (;;) {
+        gchar ch = *p;
+        if (ch == '"')
+            break;
+        if (ch == '\0')
+            return FALSE;
+        if (ch == '\\' && *++p == '\0')
+            return FALSE;
+        p++;
     }
+    c->p = p + 1;
+    return TRUE;
+}
+
+static gboolean json_skip_number(JsonCursor *c)
+{
+    const gchar *p = c->p;
+    if (*p == '-')
+        p++;
+    if (*p == '0')
+        p++;
+    else if (g_ascii_isdigit(*p))
+        while (g_ascii_isdigit(*p))
+            p++;
+    else
+        return FALSE;
+    if (*p == '.') {
+        p++;
+        if (!g_ascii_isdigit(*p))
+            return FALSE;
+        while (g_ascii_isdigit(*p))
+            p++;
+    }
+    if (*p == 'e' || *p == 'E') {
+        p++;
+        if (*p == '+' || *p == '-')
+            p++;
+        if (!g_ascii_isdigit(*p))
+            return FALSE;
+        while (g_ascii_isdigit(*p))
+            p++;
+    }
+    c->p = p;
+    return TRUE;
+}
+
+static gboolean json_skip_literal(JsonCursor *c, const char *word, gsize len)
+{
+    if (strncmp(c->p, word, len) != 0)
+        return FALSE;
+    c->p += len;
+    return TRUE;
+}
+
+static gboolean json_skip_value(JsonCursor *c);
+
+/* Walks a '{' or '[' container, validating it and skipping its values */
+static gboolean json_skip_container(JsonCursor *c)
+{
+    gboolean is_object = *c->p == '{';
+    gchar close = is_object ? '}' : ']';
 
-    JsonArray *array = json_node_get_array(root);
-    guint len = json_array_get_length(array);
+    if (++c->depth > JSON_MAX_DEPTH)
+        return FALSE;
+    c->p++;
+    json_skip_ws(c);
+    if (*c->p == close) {
+        c->p++;
+        c->depth--;
+        return TRUE;
+    }
 
-    for (guint i = 0; i < len; i++) {
-        JsonObject *obj = json_array_get_object_element(array, i);
-        if (!obj)
+    for (;;) {
+        if (is_object) {
+            if (*c->p != '"' || !json_skip_string(c))
+                return FALSE;
+            json_skip_ws(c);
+            if (*c->p != ':')
+                return FALSE;
+            c->p++;
+            json_skip_ws(c);
+        }
+        if (!json_skip_value(c))
+            return FALSE;
+        json_skip_ws(c);
+        if (*c->p == ',') {
+            c->p++;
+            json_skip_ws(c);
             continue;
-        if (json_object_has_member(obj, "focus") &&
-            json_object_get_boolean_member(obj, "focus")) {
-            if (json_object_has_member(obj, "title")) {
-                const gchar *t = json_object_get_string_member(obj, "title");
-                if (t && t[0] != '\0')
-                    info.title = g_strdup(t);
-            }
-            if (json_object_has_member(obj, "wm_class")) {
-                const gchar *c = json_object_get_string_member(obj, "wm_class");
-                if (c)
-                    info.wm_class = g_strdup(c);
+        }
+        if (*c->p != close)
+            return FALSE;
+        c->p++;
+        c->depth--;
+        return TRUE;
+    }
+}
+
+static gboolean json_skip_value(JsonCursor *c)
+{
+    switch (*c->p) {
+    case '"':
+        return json_skip_string(c);
+    case '{':
+    case '[':
+        return json_skip_container(c);
+    case 't':
+        return json_skip_literal(c, "true", 4);
+    case 'f':
+        return json_skip_literal(c, "false", 5);
+    case 'n':
+        return json_skip_literal(c, "null", 4);
+    default:
+        return json_skip_number(c);
+    }
+}
+
+/* Decode a string value.  *out stays NULL when the value is not a string;
+ * FALSE means a malformed escape or invalid UTF-8, which json-glib rejects. */
+static gboolean json_span_to_string(const JsonSpan *v, gchar **out)
+{
+    *out = NULL;
+    if (!v->start || *v->start != '"')
+        return TRUE;
+
+    const gchar *p = v->start + 1;
+    const gchar *end = v->end - 1;
+    const gchar *bs = memchr(p, '\\', end - p);
+    if (!bs) {
+        if (!g_utf8_validate(p, end - p, NULL))
+            return FALSE;
+        *out = g_strndup(p, end - p);
+        return TRUE;
+    }
+
+    GString *buf = g_string_sized_new(end - p);
+    while (p < end) {
+        bs = memchr(p, '\\', end - p);
+        if (!bs) {
+            g_string_append_len(buf, p, end - p);
+            break;
+        }
+        g_string_append_len(buf, p, bs - p);
+        p = bs + 1;
+        gchar esc = *p++;
+        switch (esc) {
+        case '"':  g_string_append_c(buf, '"');  break;
+        case '\\': g_string_append_c(buf, '\\'); break;
+        case '/':  g_string_append_c(buf, '/');  break;
+        case 'b':  g_string_append_c(buf, '\b'); break;
+        case 'f':  g_string_append_c(buf, '\f'); break;
+        case 'n':  g_string_append_c(buf, '\n'); break;
+        case 'r':  g_string_append_c(buf, '\r'); break;
+        case 't':  g_string_append_c(buf, '\t'); break;
+        case 'u': {
+            gunichar cp = 0;
+            for (int i = 0; i < 4; i++, p++) {
+                int d = p < end ? g_ascii_xdigit_value(*p) : -1;
+                if (d < 0)
+                    goto invalid;
+                cp = (cp << 4) | d;
             }
-            if (json_object_has_member(obj, "wm_class_instance")) {
-                const gchar *ci = json_object_get_string_member(obj, "wm_class_instance");
-                if (ci)
-                    info.wm_class_instance = g_strdup(ci);
+            if (cp >= 0xD800 && cp <= 0xDBFF) {
+                /* High surrogate must be followed by an escaped low one */
+                gunichar lo = 0;
+                if (end - p < 6 || p[0] != '\\' || p[1] != 'u')
+                    goto invalid;
+                for (int i = 2; i < 6; i++) {
+                    int d = g_ascii_xdigit_value(p[i]);
+                    if (d < 0)
+                        goto invalid;
+                    lo = (lo << 4) | d;
+                }
+                if (lo < 0xDC00 || lo > 0xDFFF)
+                    goto invalid;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                p += 6;
+            } else if (cp >= 0xDC00 && cp <= 0xDFFF) {
+                goto invalid;
             }
-            if (json_object_has_member(obj, "pid"))
-                info.pid = (pid_t)json_object_get_int_member(obj, "pid");
+            g_string_append_unichar(buf, cp);
             break;
         }
+        default:
+            goto invalid;
+        }
+    }
+
+    if (!g_utf8_validate(buf->str, buf->len, NULL))
+        goto invalid;
+    *out = g_string_free(buf, FALSE);
+    return TRUE;
+
+invalid:
+    g_string_free(buf, TRUE);
+    return FALSE;
+}
+
+/* Numbers and booleans convert to each other, anything else reads as 0 */
+static gint64 json_span_to_int(const JsonSpan *v)
+{
+    if (!v->start)
+        return 0;
+    if (*v->start == 't')
+        return 1;
+    if (*v->start != '-' && !g_ascii_isdigit(*v->start))
+        return 0;
+    for (const gchar *p = v->start; p < v->end; p++)
+        if (*p == '.' || *p == 'e' || *p == 'E')
+            return (gint64)g_ascii_strtod(v->start, NULL);
+    return g_ascii_strtoll(v->start, NULL, 10);
+}
+
+static gboolean json_span_to_boolean(const JsonSpan *v)
+{
+    if (*v->start == 't')
+        return TRUE;
+    if (*v->start == '-' || g_ascii_isdigit(*v->start))
+        return g_ascii_strtod(v->start, NULL) != 0.0;
+    return FALSE;
+}
+
+typedef enum {
+    MEMBER_OTHER,
+    MEMBER_TITLE,
+    MEMBER_WM_CLASS,
+    MEMBER_WM_CLASS_INSTANCE,
+    MEMBER_PID,
+    MEMBER_FOCUS,
+} WindowMember;
+
+static WindowMember window_member_from_name(const gchar *name, gsize len)
+{
+    switch (len) {
+    case 3:
+        return memcmp(name, "pid", 3) == 0 ? MEMBER_PID : MEMBER_OTHER;
+    case 5:
+        if (memcmp(name, "title", 5) == 0)
+            return MEMBER_TITLE;
+        return memcmp(name, "focus", 5) == 0 ? MEMBER_FOCUS : MEMBER_OTHER;
+    case 8:
+        return memcmp(name, "wm_class", 8) == 0 ? MEMBER_WM_CLASS : MEMBER_OTHER;
+    case 17:
+        return memcmp(name, "wm_class_instance", 17) == 0
+               ? MEMBER_WM_CLASS_INSTANCE : MEMBER_OTHER;
+    default:
+        return MEMBER_OTHER;
+    }
+}
+
+/* key spans the quoted member name */
+static WindowMember window_member_from_key(const JsonSpan *key)
+{
+    const gchar *name = key->start + 1;
+    gsize len = key->end - key->start - 2;
+    if (!memchr(name, '\\', len))
+        return window_member_from_name(name, len);
+
+    gchar *decoded = NULL;
+    WindowMember m = MEMBER_OTHER;
+    if (json_span_to_string(key, &decoded))
+        m = window_member_from_name(decoded, strlen(decoded));
+    g_free(decoded);
+    return m;
+}
+
+/* Scan one window object, remembering where the members of interest are.
+ * Later duplicates win, as in json-glib. */
+static gboolean json_scan_window(JsonCursor *c, WindowMembers *w)
+{
+    memset(w, 0, sizeof(*w));
+    c->depth++;
+    c->p++;
+    json_skip_ws(c);
+    if (*c->p == '}') {
+        c->p++;
+        c->depth--;
+        return TRUE;
+    }
+
+    for (;;) {
+        JsonSpan key = {c->p, NULL};
+        if (*key.start != '"' || !json_skip_string(c))
+            return FALSE;
+        key.end = c->p;
+        json_skip_ws(c);
+        if (*c->p != ':')
+            return FALSE;
+        c->p++;
+        json_skip_ws(c);
+
+        JsonSpan value = {c->p, NULL};
+        if (!json_skip_value(c))
+            return FALSE;
+        value.end = c->p;
+
+        switch (window_member_from_key(&key)) {
+        case MEMBER_TITLE:             w->title = value; break;
+        case MEMBER_WM_CLASS:          w->wm_class = value; break;
+        case MEMBER_WM_CLASS_INSTANCE: w->wm_class_instance = value; break;
+        case MEMBER_PID:               w->pid = value; break;
+        case MEMBER_FOCUS:             w->focus = json_span_to_boolean(&value); break;
+        case MEMBER_OTHER:             break;
+        }
+
+        json_skip_ws(c);
+        if (*c->p == ',') {
+            c->p++;
+            json_skip_ws(c);
+            continue;
+        }
+        if (*c->p != '}')
+            return FALSE;
+        c->p++;
+        c->depth--;
+        return TRUE;
+    }
+}
+
+static FocusedWindowInfo focused_window_from_members(const WindowMembers *w)
+{
+    FocusedWindowInfo info = {NULL, NULL, NULL, 0};
+    gchar *title = NULL, *wm_class = NULL, *wm_class_instance = NULL;
+
+    if (!json_span_to_string(&w->title, &title) ||
+        !json_span_to_string(&w->wm_class, &wm_class) ||
+        !json_span_to_string(&w->wm_class_instance, &wm_class_instance)) {
+        g_free(title);
+        g_free(wm_class);
+        return info;
     }
 
-    g_object_unref(parser);
+    if (title && title[0] != '\0')
+        info.title = title;
+    else
+        g_free(title);
+    info.wm_class = wm_class;
+    info.wm_class_instance = wm_class_instance;
+    info.pid = (pid_t)json_span_to_int(&w->pid);
     return info;
 }
 
+/* Everything after the focused window is left unread, so trailing garbage
+ * there is not detected; malformed input before it yields an empty result. */
+FocusedWindowInfo parse_focused_window(const gchar *json)
+{
+    FocusedWindowInfo info = {NULL, NULL, NULL, 0};
+
+    if (!json || !json[0])
+        return info;
+
+    JsonCursor c = {json, 0};
+    json_skip_ws(&c);
+    if (*c.p != '[')
+        return info;
+    c.p++;
+    c.depth++;
+    json_skip_ws(&c);
+    if (*c.p == ']')
+        return info;
+
+    for (;;) {
+        if (*c.p == '{') {
+            WindowMembers w;
+            if (!json_scan_window(&c, &w))
+                return info;
+            if (w.focus)
+                return focused_window_from_members(&w);
+        } else if (!json_skip_value(&c)) {
+            return info;
+        }
+
+        json_skip_ws(&c);
+        if (*c.p == ',') {
+            c.p++;
+            json_skip_ws(&c);
+            continue;
+        }
+        return info;
+    }
+}
+
 void free_focused_window_info(FocusedWindowInfo *info)
 {
     g_free(info->title);
@@ -282,6 +986,42 @@ void free_focused_window_info(FocusedWindowInfo *info)
     info->pid = 0;
 }
 
+/* Non-cryptographic hash for recognising a repeated D-Bus reply.  Four
+ * independent lanes of eight bytes keep the multiplier busy, so hashing a
+ * reply costs a small fraction of parsing it. */
+static inline guint64 reply_hash_mix(guint64 h, guint64 w)
+{
+    h = (h ^ w) * G_GUINT64_CONSTANT(0x9E3779B97F4A7C15);
+    return h ^ (h >> 29);
+}
+
+guint64 reply_hash(const gchar *data, gsize len)
+{
+    guint64 lane[4] = {len, ~(guint64)len, len << 32, len >> 32};
+    gsize i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        guint64 w[4];
+        memcpy(w, data + i, 32);
+        for (int j = 0; j < 4; j++)
+            lane[j] = reply_hash_mix(lane[j], w[j]);
+    }
+
+    guint64 h = reply_hash_mix(reply_hash_mix(lane[0], lane[1]),
+                               reply_hash_mix(lane[2], lane[3]));
+    for (; i + 8 <= len; i += 8) {
+        guint64 w;
+        memcpy(&w, data + i, 8);
+        h = reply_hash_mix(h, w);
+    }
+    if (i < len) {
+        guint64 w = 0;
+        memcpy(&w, data + i, len - i);
+        h = reply_hash_mix(h, w);
+    }
+    return reply_hash_mix(h, len);
+}
+
 /* ── Statistics functions ──────────────────────────────── */
 
 #define DURATION_WIDTH 11
@@ -390,93 +1130,624 @@ static gint compare_app_stat_desc(gconstpointer a, gconstpointer b)
     const AppStat *sb = *(const AppStat **)b;
     if (sb->total_seconds > sa->total_seconds) return 1;
     if (sb->total_seconds < sa->total_seconds) return -1;
-    return 0;
+    /* By name on a tie, so the order does not depend on hash order */
+    return strcmp(sa->wm_class, sb->wm_class);
 }
 
-DayStats *compute_day_stats(const gchar *csv_path)
+/* ── Statistics storage ────────────────────────────────── */
+
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/* A block of the bump allocator behind a DayStats, the newest first */
+struct StatsArena {
+    StatsArena *next;
+    gsize used;
+    gsize size;
+    guint64 data[];
+};
+
+static gpointer stats_arena_alloc(StatsArena **arena, gsize size)
 {
-    gchar *contents = NULL;
-    if (!g_file_get_contents(csv_path, &contents, NULL, NULL))
-        return NULL;
+    size = (size + sizeof(guint64) - 1) & ~(sizeof(guint64) - 1);
+    StatsArena *block = *arena;
+    if (!block || block->size - block->used < size) {
+        gsize block_size = MAX(size, ARENA_BLOCK_SIZE);
+        StatsArena *fresh = g_malloc(sizeof(StatsArena) + block_size);
+        fresh->used = 0;
+        fresh->size = block_size;
+        /* A large string gets a block to itself, leaving room in the
+         * current one for the next small allocations */
+        if (block && size > ARENA_BLOCK_SIZE / 4) {
+            fresh->next = block->next;
+            block->next = fresh;
+        } else {
+            fresh->next = block;
+            *arena = fresh;
+        }
+        block = fresh;
+    }
+    gpointer p = (guint8 *)block->data + block->used;
+    block->used += size;
+    return p;
+}
+
+/* An app name, or a title of one app.  The string is given in up to three
+ * pieces read as one, so that "state | details" is looked up straight
+ * from its fields without being put together first. */
+typedef struct {
+    const AppStat *app;     /* NULL for an app's own key */
+    const gchar *part[3];
+    gsize len[3];
+    guint64 hash;
+} StatKey;
 
+typedef struct {
+    StatKey key;
+    AppStat stat;
+} AppEntry;
+
+typedef struct {
+    StatKey key;
+    TitleStat stat;
+} TitleEntry;
+
+static void stat_key_hash(StatKey *key)
+{
+    /* Fed piece by piece, which hashes the same as the whole string */
+    StringHash state;
+    string_hash_init(&state, GPOINTER_TO_SIZE(key->app));
+    for (int i = 0; i < 3; i++)
+        string_hash_update(&state, key->part[i], key->len[i]);
+    key->hash = string_hash_finish(&state);
+}
+
+static gboolean stat_key_equal(gconstpointer a, gconstpointer b)
+{
+    const StatKey *x = a, *y = b;
+    if (x->hash != y->hash || x->app != y->app)
+        return FALSE;
+
+    /* Walks both keys piece by piece, however each is split */
+    guint i = 0, j = 0;
+    gsize at_x = 0, at_y = 0;
+    for (;;) {
+        while (i < 3 && at_x == x->len[i]) {
+            i++;
+            at_x = 0;
+        }
+        while (j < 3 && at_y == y->len[j]) {
+            j++;
+            at_y = 0;
+        }
+        if (i == 3 || j == 3)
+            return i == 3 && j == 3;
+        gsize n = MIN(x->len[i] - at_x, y->len[j] - at_y);
+        if (memcmp(x->part[i] + at_x, y->part[j] + at_y, n) != 0)
+            return FALSE;
+        at_x += n;
+        at_y += n;
+    }
+}
+
+/* The entry of entry_size bytes under key, added with a copy of the key
+ * string after it if new */
+static StatKey *stats_index_get(DayStats *stats, StatKey *key,
+                                gsize entry_size, gboolean *added)
+{
+    stat_key_hash(key);
+    StatKey *entry = string_table_lookup(&stats->index, key->hash, key,
+                                         stat_key_equal);
+    *added = entry == NULL;
+    if (entry)
+        return entry;
+
+    gsize len = key->len[0] + key->len[1] + key->len[2];
+    entry = stats_arena_alloc(&stats->arena, entry_size + len + 1);
+    gchar *str = (gchar *)entry + entry_size, *end = str;
+    for (int i = 0; i < 3; i++)
+        end = mempcpy(end, key->part[i], key->len[i]);
+    *end = '\0';
+    *entry = (StatKey){key->app, {str}, {len}, key->hash};
+    string_table_insert(&stats->index, entry->hash, entry);
+    return entry;
+}
+
+static AppStat *day_stats_app(DayStats *stats, const gchar *wm_class, gsize len)
+{
+    StatKey key = {NULL, {wm_class}, {len}};
+    gboolean added;
+    AppEntry *entry = (AppEntry *)stats_index_get(stats, &key,
+                                                  sizeof(AppEntry), &added);
+    if (added) {
+        entry->stat = (AppStat){entry->key.part[0], 0, 0, NULL};
+        g_ptr_array_add(stats->apps, &entry->stat);
+    }
+    return &entry->stat;
+}
+
+/* Accumulator for the seconds of app under the display key in key */
+static long *day_stats_title_seconds(DayStats *stats, AppStat *app,
+                                     StatKey *key)
+{
+    key->app = app;
+    gboolean added;
+    TitleEntry *entry = (TitleEntry *)stats_index_get(stats, key,
+                                                      sizeof(TitleEntry), &added);
+    if (added) {
+        entry->stat = (TitleStat){entry->key.part[0], 0, app->titles};
+        app->titles = &entry->stat;
+        app->n_titles++;
+    }
+    return &entry->stat.total_seconds;
+}
+
+/* Rich presence if available, else the window title */
+static void display_key(StatKey *key, const gchar *title, gsize title_len,
+                        const gchar *rps, gsize rps_len,
+                        const gchar *rpd, gsize rpd_len)
+{
+    *key = (StatKey){0};
+    if (rps_len && rpd_len) {
+        *key = (StatKey){NULL, {rps, " | ", rpd}, {rps_len, 3, rpd_len}};
+    } else if (rps_len) {
+        key->part[0] = rps;
+        key->len[0] = rps_len;
+    } else if (rpd_len) {
+        key->part[0] = rpd;
+        key->len[0] = rpd_len;
+    } else {
+        key->part[0] = title;
+        key->len[0] = title_len;
+    }
+}
+
+DayStats *day_stats_new(void)
+{
     DayStats *stats = g_new0(DayStats, 1);
-    GHashTable *app_map = g_hash_table_new(g_str_hash, g_str_equal);
+    stats->apps = g_ptr_array_new();
+    string_table_init(&stats->index);
+    return stats;
+}
+
+void day_stats_sort(DayStats *stats)
+{
+    g_ptr_array_sort(stats->apps, compare_app_stat_desc);
+}
+
+void day_stats_add_title(DayStats *stats, const gchar *wm_class,
+                         const gchar *title, long seconds)
+{
+    AppStat *app = day_stats_app(stats, wm_class, strlen(wm_class));
+    app->total_seconds += seconds;
+    StatKey key = {NULL, {title}, {strlen(title)}};
+    *day_stats_title_seconds(stats, app, &key) += seconds;
+}
+
+void day_stats_add_record(DayStats *stats, const CsvRecord *rec)
+{
+    /* As day_stats_add_fields() counts the same record read back */
+    if (strcmp(rec->status, "locked") == 0 || strcmp(rec->status, "idle") == 0) {
+        stats->total_locked_seconds += rec->duration;
+        return;
+    }
+    if (!rec->title[0] && !rec->rp_state[0] && !rec->rp_details[0]) {
+        stats->total_afk_active_seconds += rec->duration;
+        return;
+    }
 
-    gchar **lines = g_strsplit(contents, "\n", -1);
-    for (int i = 0; lines[i]; i++) {
-        if (!lines[i][0])
+    stats->total_active_seconds += rec->duration;
+    AppStat *app = day_stats_app(stats, rec->wm_class, strlen(rec->wm_class));
+    app->total_seconds += rec->duration;
+    StatKey key;
+    display_key(&key, rec->title, strlen(rec->title),
+                rec->rp_state, strlen(rec->rp_state),
+                rec->rp_details, strlen(rec->rp_details));
+    *day_stats_title_seconds(stats, app, &key) += rec->duration;
+}
+
+TitleStat *app_stat_find_title(const AppStat *app, const gchar *title)
+{
+    for (TitleStat *t = app->titles; t; t = t->next)
+        if (strcmp(t->title, title) == 0)
+            return t;
+    return NULL;
+}
+
+enum {
+    CSV_FIELD_TIMESTAMP,
+    CSV_FIELD_DURATION,
+    CSV_FIELD_STATUS,
+    CSV_FIELD_TITLE,
+    CSV_FIELD_WM_CLASS,
+    CSV_FIELD_WM_CLASS_INSTANCE,
+    CSV_FIELD_RP_STATE,
+    CSV_FIELD_RP_DETAILS,
+    CSV_FIELD_COUNT
+};
+
+/* Counts one scanned record.  Apps and titles are looked up straight
+ * from the fields; only a field with doubled quotes is first unescaped
+ * into scratch, a buffer reused for every record. */
+static void day_stats_add_fields(DayStats *stats, CsvField *fields, guint n,
+                                 GString *scratch)
+{
+    long duration;
+    if (n <= CSV_FIELD_DURATION ||
+        !csv_field_to_long(&fields[CSV_FIELD_DURATION], &duration))
+        return;
+    /* Older files end after wm_class_instance */
+    for (guint i = n; i < CSV_FIELD_COUNT; i++)
+        fields[i] = (CsvField){"", 0, FALSE};
+
+    const CsvField *status = &fields[CSV_FIELD_STATUS];
+    if (csv_field_equal(status, "locked") || csv_field_equal(status, "idle")) {
+        stats->total_locked_seconds += duration;
+        return;
+    }
+
+    CsvField plain[] = {
+        fields[CSV_FIELD_WM_CLASS], fields[CSV_FIELD_TITLE],
+        fields[CSV_FIELD_RP_STATE], fields[CSV_FIELD_RP_DETAILS],
+    };
+    enum { WM_CLASS, TITLE, RPS, RPD };
+    if (!plain[TITLE].len && !plain[RPS].len && !plain[RPD].len) {
+        stats->total_afk_active_seconds += duration;
+        return;
+    }
+
+    gsize at[G_N_ELEMENTS(plain)];
+    g_string_truncate(scratch, 0);
+    for (guint i = 0; i < G_N_ELEMENTS(plain); i++) {
+        if (!plain[i].escaped)
             continue;
+        at[i] = scratch->len;
+        csv_field_append(scratch, &plain[i]);
+        plain[i].len = scratch->len - at[i];
+    }
+    /* Only once scratch has stopped growing */
+    for (guint i = 0; i < G_N_ELEMENTS(plain); i++)
+        if (plain[i].escaped)
+            plain[i].ptr = scratch->str + at[i];
+
+    stats->total_active_seconds += duration;
+    AppStat *app = day_stats_app(stats, plain[WM_CLASS].ptr, plain[WM_CLASS].len);
+    app->total_seconds += duration;
+    StatKey key;
+    display_key(&key, plain[TITLE].ptr, plain[TITLE].len,
+                plain[RPS].ptr, plain[RPS].len, plain[RPD].ptr, plain[RPD].len);
+    *day_stats_title_seconds(stats, app, &key) += duration;
+}
+
+/* Returns where the records counted end.  Without complete, a last line
+ * without its newline is taken to be still being appended. */
+static gsize add_csv_stats(DayStats *stats, const gchar *data, gsize len,
+                           gboolean complete)
+{
+    CsvScanner scanner;
+    CsvField fields[CSV_FIELD_COUNT];
+    GString *scratch = g_string_sized_new(256);
+    guint n;
+
+    csv_scanner_init(&scanner, data, len, complete);
+    while ((n = csv_scanner_next(&scanner, fields, CSV_FIELD_COUNT)))
+        day_stats_add_fields(stats, fields, n, scratch);
+    g_string_free(scratch, TRUE);
+    return scanner.pos;
+}
+
+/* Strings that decide where an active record is counted, by dictionary id */
+typedef struct {
+    guint32 wm_class;
+    guint32 title;
+    guint32 rp_state;
+    guint32 rp_details;
+} BinlogStatsKey;
+
+typedef struct {
+    AppStat *app;
+    long *secs;
+} BinlogStatsSlot;
 
-        gchar *ts, *status, *title, *wm_class, *wm_instance;
-        gchar *rps, *rpd;
-        long duration;
-        if (!parse_csv_line(lines[i], &ts, &duration, &status, &title,
-                            &wm_class, &wm_instance, &rps, &rpd))
+static guint binlog_stats_key_hash(gconstpointer p)
+{
+    const BinlogStatsKey *k = p;
+    guint h = k->wm_class;
+    h = h * 31 + k->title;
+    h = h * 31 + k->rp_state;
+    return h * 31 + k->rp_details;
+}
+
+static gboolean binlog_stats_key_equal(gconstpointer a, gconstpointer b)
+{
+    return memcmp(a, b, sizeof(BinlogStatsKey)) == 0;
+}
+
+/* Records repeat the same few string combinations, so the app and title
+ * accumulators are resolved once per combination and then only summed. */
+static void add_binlog_stats(DayStats *stats, BinlogReader *reader)
+{
+    GHashTable *slots = g_hash_table_new_full(binlog_stats_key_hash,
+                                              binlog_stats_key_equal,
+                                              g_free, g_free);
+    GPtrArray *apps_by_id = g_ptr_array_new();  /* wm_class id -> AppStat* */
+    BinlogRecord rec;
+    while (binlog_reader_next(reader, &rec)) {
+        if (rec.status != BINLOG_STATUS_ACTIVE) {
+            stats->total_locked_seconds += rec.duration;
             continue;
+        }
 
-        if (g_strcmp0(status, "locked") == 0 || g_strcmp0(status, "idle") == 0) {
-            stats->total_locked_seconds += duration;
-        } else {
-            gboolean has_title = title && title[0];
-            gboolean has_rps = rps && rps[0];
-            gboolean has_rpd = rpd && rpd[0];
-            if (!has_title && !has_rps && !has_rpd) {
-                stats->total_afk_active_seconds += duration;
-            } else {
-            stats->total_active_seconds += duration;
-
-            AppStat *app = g_hash_table_lookup(app_map, wm_class);
-            if (!app) {
-                app = g_new0(AppStat, 1);
-                app->wm_class = g_strdup(wm_class);
-                app->titles = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                     g_free, g_free);
-                g_hash_table_insert(app_map, app->wm_class, app);
+        BinlogStatsKey key = {rec.wm_class, rec.title, rec.rp_state, rec.rp_details};
+        BinlogStatsSlot *slot = g_hash_table_lookup(slots, &key);
+        if (!slot) {
+            const gchar *title = binlog_reader_string(reader, rec.title);
+            const gchar *rps = binlog_reader_string(reader, rec.rp_state);
+            const gchar *rpd = binlog_reader_string(reader, rec.rp_details);
+            slot = g_new0(BinlogStatsSlot, 1);
+            if (title[0] || rps[0] || rpd[0]) {
+                if (rec.wm_class >= apps_by_id->len)
+                    g_ptr_array_set_size(apps_by_id, reader->strings->len);
+                slot->app = g_ptr_array_index(apps_by_id, rec.wm_class);
+                if (!slot->app) {
+                    const gchar *wm_class = binlog_reader_string(reader,
+                                                                 rec.wm_class);
+                    slot->app = day_stats_app(stats, wm_class, strlen(wm_class));
+                    g_ptr_array_index(apps_by_id, rec.wm_class) = slot->app;
+                }
+                StatKey display;
+                display_key(&display, title, strlen(title), rps, strlen(rps),
+                            rpd, strlen(rpd));
+                slot->secs = day_stats_title_seconds(stats, slot->app, &display);
             }
-            app->total_seconds += duration;
-
-            /* Build display key: use rich presence if available, else window title */
-            gchar *display_key;
-            gboolean has_rps = rps && rps[0];
-            gboolean has_rpd = rpd && rpd[0];
-            if (has_rps && has_rpd)
-                display_key = g_strdup_printf("%s | %s", rps, rpd);
-            else if (has_rps)
-                display_key = g_strdup(rps);
-            else if (has_rpd)
-                display_key = g_strdup(rpd);
-            else
-                display_key = g_strdup(title);
-
-            long *title_secs = g_hash_table_lookup(app->titles, display_key);
-            if (title_secs) {
-                *title_secs += duration;
-                g_free(display_key);
+            g_hash_table_insert(slots, g_memdup2(&key, sizeof(key)), slot);
+        }
+
+        if (!slot->app) {
+            stats->total_afk_active_seconds += rec.duration;
+            continue;
+        }
+        stats->total_active_seconds += rec.duration;
+        slot->app->total_seconds += rec.duration;
+        *slot->secs += rec.duration;
+    }
+    g_ptr_array_free(apps_by_id, TRUE);
+    g_hash_table_destroy(slots);
+}
+
+/* A quoted title may hold newlines, so a chunk is cut after its last
+ * whole record rather than its last newline; the record cut off is
+ * counted with the next chunk. */
+static gsize add_csv_chunk_stats(gchar *data, gsize len, gboolean last,
+                                 gpointer user_data)
+{
+    return add_csv_stats(user_data, data, len, last);
+}
+
+/* ── Parallel CSV statistics ───────────────────────────── */
+
+/* One piece of the data per worker.  Pieces are first cut at even byte
+ * offsets; the quote parity of each is all a piece needs from the ones
+ * before it to move its cut to the end of a record. */
+typedef struct {
+    const gchar *data;
+    gsize len;
+    guint n_chunks;
+    gsize *cuts;            /* n_chunks + 1 offsets */
+    gboolean *quotes_odd;   /* per piece, as first cut */
+    DayStats **parts;
+    gsize parsed;           /* where the last piece's records end */
+} CsvChunkJob;
+
+static void count_chunk_quotes(gpointer data, gpointer user_data)
+{
+    CsvChunkJob *job = user_data;
+    guint i = GPOINTER_TO_UINT(data) - 1;
+    job->quotes_odd[i] = csv_scan_quotes_odd(job->data + job->cuts[i],
+                                             job->cuts[i + 1] - job->cuts[i]);
+}
+
+/* Each piece is counted into tables of its own */
+static void parse_chunk(gpointer data, gpointer user_data)
+{
+    CsvChunkJob *job = user_data;
+    guint i = GPOINTER_TO_UINT(data) - 1;
+    DayStats *stats = day_stats_new();
+    gsize end = add_csv_stats(stats, job->data + job->cuts[i],
+                              job->cuts[i + 1] - job->cuts[i], FALSE);
+    if (i == job->n_chunks - 1)
+        job->parsed = job->cuts[i] + end;
+    day_stats_sort(stats);
+    job->parts[i] = stats;
+}
+
+static void run_chunks(CsvChunkJob *job, GFunc func, guint threads)
+{
+    /* Shared threads, so the second pass reuses those of the first */
+    GThreadPool *pool = g_thread_pool_new(func, job, (gint)threads, FALSE, NULL);
+    for (guint i = 0; i < job->n_chunks; i++)
+        g_thread_pool_push(pool, GUINT_TO_POINTER(i + 1), NULL);
+    g_thread_pool_free(pool, FALSE, TRUE);
+}
+
+DayStats *compute_csv_stats(const gchar *data, gsize len, guint max_threads,
+                            gsize min_chunk, gsize *parsed)
+{
+    if (max_threads == 0)
+        max_threads = g_get_num_processors();
+    gsize n_chunks = MIN(max_threads, len / MAX(min_chunk, 1));
+
+    if (n_chunks <= 1) {
+        DayStats *stats = day_stats_new();
+        gsize end = add_csv_stats(stats, data, len, FALSE);
+        day_stats_sort(stats);
+        if (parsed)
+            *parsed = end;
+        return stats;
+    }
+
+    CsvChunkJob job = {
+        .data = data,
+        .len = len,
+        .n_chunks = (guint)n_chunks,
+        .cuts = g_new(gsize, n_chunks + 1),
+        .quotes_odd = g_new(gboolean, n_chunks),
+        .parts = g_new0(DayStats *, n_chunks),
+    };
+    for (gsize i = 0; i <= n_chunks; i++)
+        job.cuts[i] = len / n_chunks * i;
+    job.cuts[n_chunks] = len;
+    run_chunks(&job, count_chunk_quotes, job.n_chunks);
+
+    /* A cut moves past the next newline outside quotes, so every piece
+     * starts a record outside quotes, as the serial scan would see it.
+     * The last piece keeps the end and with it any record still being
+     * written. */
+    gboolean inside = FALSE;
+    for (gsize i = 1; i < n_chunks; i++) {
+        inside ^= job.quotes_odd[i - 1];
+        job.cuts[i] = csv_scan_record_start(data, len, job.cuts[i], inside);
+    }
+    run_chunks(&job, parse_chunk, job.n_chunks);
+
+    /* Sums are the same in any order; pieces are merged in file order
+     * anyway */
+    DayStats *stats = job.parts[0];
+    for (gsize i = 1; i < n_chunks; i++) {
+        merge_day_stats(stats, job.parts[i]);
+        free_day_stats(job.parts[i]);
+    }
+
+    if (parsed)
+        *parsed = job.parsed;
+    g_free(job.cuts);
+    g_free(job.quotes_odd);
+    g_free(job.parts);
+    return stats;
+}
+
+/* Decompresses in fixed-size chunks instead of loading the file */
+static DayStats *compute_compressed_day_stats(const gchar *path)
+{
+    DayStats *stats = day_stats_new();
+    GError *error = NULL;
+    gboolean ok = day_archive_foreach_chunk(path, add_csv_chunk_stats, stats,
+                                            &error);
+
+    day_stats_sort(stats);
+    if (!ok) {
+        g_printerr("%s\n", error->message);
+        g_error_free(error);
+        free_day_stats(stats);
+        return NULL;
+    }
+    return stats;
+}
+
+DayStats *compute_day_stats(const gchar *csv_path)
+{
+    return compute_day_stats_threaded(csv_path, 1);
+}
+
+DayStats *compute_day_stats_threaded(const gchar *csv_path, guint max_threads)
+{
+    if (day_archive_is_compressed(csv_path))
+        return compute_compressed_day_stats(csv_path);
+
+    /* Mapped rather than read: the tracker only ever appends, and what
+     * it appends after the mapping was made is not looked at.  It does
+     * cut a torn tail off at startup and rotation, and a partial binary
+     * entry after a failed write; the shared lock holds that off while
+     * the file is mapped, where it would raise SIGBUS. */
+    int fd = open_day_file_locked(csv_path);
+    if (fd < 0)
+        return NULL;
+    GMappedFile *file = g_mapped_file_new_from_fd(fd, FALSE, NULL);
+    if (!file) {
+        close(fd);
+        return NULL;
+    }
+    const gchar *contents = g_mapped_file_get_contents(file);
+    gsize len = g_mapped_file_get_length(file);
+
+    DayStats *stats;
+    BinlogReader reader;
+    if (binlog_reader_init(&reader, contents, len)) {
+        stats = day_stats_new();
+        add_binlog_stats(stats, &reader);
+        binlog_reader_clear(&reader);
+        day_stats_sort(stats);
+    } else {
+        stats = compute_csv_stats(contents, len, max_threads,
+                                  CSV_STATS_MIN_CHUNK, NULL);
+    }
+
+    g_mapped_file_unref(file);
+    close(fd);
+    return stats;
+}
+
+DayStats *load_day_stats(const gchar *data_dir, int year, int month, int day,
+                         guint max_threads, const gchar *cache_dir,
+                         gboolean *found)
+{
+    /* A day may have been logged in both formats if --format changed */
+    gchar *csv_path = build_csv_path(data_dir, year, month, day);
+    gchar *paths[] = {
+        day_archive_find(csv_path),
+        build_binlog_path(data_dir, year, month, day),
+    };
+    g_free(csv_path);
+    DayStats *stats = NULL;
+    gboolean failed = FALSE;
+    *found = FALSE;
+
+    for (gsize i = 0; i < G_N_ELEMENTS(paths); i++) {
+        if (paths[i] && g_file_test(paths[i], G_FILE_TEST_EXISTS)) {
+            *found = TRUE;
+            /* Only a plain CSV is appended to and worth caching */
+            gboolean cached = cache_dir && i == 0 &&
+                              !day_archive_is_compressed(paths[i]);
+            DayStats *part = cached
+                ? stats_cache_compute(paths[i], cache_dir, max_threads)
+                : compute_day_stats_threaded(paths[i], max_threads);
+            if (!part) {
+                failed = TRUE;
+            } else if (!stats) {
+                stats = part;
             } else {
-                long *new_secs = g_new(long, 1);
-                *new_secs = duration;
-                g_hash_table_insert(app->titles, display_key, new_secs);
-            }
+                merge_day_stats(stats, part);
+                free_day_stats(part);
             }
         }
+        g_free(paths[i]);
+    }
 
-        g_free(ts); g_free(status); g_free(title);
-        g_free(wm_class); g_free(wm_instance);
-        g_free(rps); g_free(rpd);
+    if (failed) {
+        free_day_stats(stats);
+        return NULL;
     }
+    return stats;
+}
 
-    stats->apps = g_ptr_array_new();
-    GHashTableIter iter;
-    gpointer key, value;
-    g_hash_table_iter_init(&iter, app_map);
-    while (g_hash_table_iter_next(&iter, &key, &value))
-        g_ptr_array_add(stats->apps, value);
-    g_ptr_array_sort(stats->apps, compare_app_stat_desc);
+/* Adds the totals of src into dst, e.g. for a day logged in both formats */
+void merge_day_stats(DayStats *dst, const DayStats *src)
+{
+    dst->total_active_seconds += src->total_active_seconds;
+    dst->total_locked_seconds += src->total_locked_seconds;
+    dst->total_afk_active_seconds += src->total_afk_active_seconds;
+
+    for (guint i = 0; i < src->apps->len; i++) {
+        const AppStat *from = g_ptr_array_index(src->apps, i);
+        AppStat *app = day_stats_app(dst, from->wm_class, strlen(from->wm_class));
+        app->total_seconds += from->total_seconds;
+
+        for (const TitleStat *t = from->titles; t; t = t->next) {
+            StatKey key = {NULL, {t->title}, {strlen(t->title)}};
+            *day_stats_title_seconds(dst, app, &key) += t->total_seconds;
+        }
+    }
 
-    g_hash_table_destroy(app_map);
-    g_strfreev(lines);
-    g_free(contents);
-    return stats;
+    day_stats_sort(dst);
 }
 
 DayStats *filter_stats_by_grep(const DayStats *stats, const gchar *pattern,
@@ -486,76 +1757,51 @@ DayStats *filter_stats_by_grep(const DayStats *stats, const gchar *pattern,
     if (!regex)
         return NULL;
 
-    DayStats *filtered = g_new0(DayStats, 1);
+    DayStats *filtered = day_stats_new();
     filtered->total_active_seconds = stats->total_active_seconds;
     filtered->total_locked_seconds = stats->total_locked_seconds;
     filtered->total_afk_active_seconds = stats->total_afk_active_seconds;
-    filtered->apps = g_ptr_array_new();
 
     for (guint i = 0; i < stats->apps->len; i++) {
         AppStat *app = g_ptr_array_index(stats->apps, i);
         gboolean class_matches = g_regex_match(regex, app->wm_class, 0, NULL);
+        gsize class_len = strlen(app->wm_class);
 
         /* Collect matching titles */
         AppStat *clone = NULL;
-        long clone_total = 0;
-        GHashTableIter titer;
-        gpointer tkey, tval;
-        g_hash_table_iter_init(&titer, app->titles);
-        while (g_hash_table_iter_next(&titer, &tkey, &tval)) {
-            if (g_regex_match(regex, (const gchar *)tkey, 0, NULL)) {
-                if (!clone) {
-                    clone = g_new0(AppStat, 1);
-                    clone->wm_class = g_strdup(app->wm_class);
-                    clone->titles = g_hash_table_new_full(
-                        g_str_hash, g_str_equal, g_free, g_free);
-                }
-                long *secs = g_new(long, 1);
-                *secs = *(long *)tval;
-                clone_total += *secs;
-                g_hash_table_insert(clone->titles,
-                                    g_strdup(tkey), secs);
+        for (const TitleStat *t = app->titles; t; t = t->next) {
+            if (g_regex_match(regex, t->title, 0, NULL)) {
+                if (!clone)
+                    clone = day_stats_app(filtered, app->wm_class, class_len);
+                StatKey key = {NULL, {t->title}, {strlen(t->title)}};
+                *day_stats_title_seconds(filtered, clone, &key) = t->total_seconds;
+                clone->total_seconds += t->total_seconds;
             }
         }
 
-        if (clone) {
-            /* Title(s) matched: show only matching titles */
-            clone->total_seconds = clone_total;
-            g_ptr_array_add(filtered->apps, clone);
-        } else if (class_matches) {
-            /* App name matched but no titles did: clone all titles */
-            AppStat *full = g_new0(AppStat, 1);
-            full->wm_class = g_strdup(app->wm_class);
+        /* App name matched but no titles did: clone all titles */
+        if (!clone && class_matches) {
+            AppStat *full = day_stats_app(filtered, app->wm_class, class_len);
             full->total_seconds = app->total_seconds;
-            full->titles = g_hash_table_new_full(g_str_hash, g_str_equal,
-                                                  g_free, g_free);
-            g_hash_table_iter_init(&titer, app->titles);
-            while (g_hash_table_iter_next(&titer, &tkey, &tval)) {
-                long *secs = g_new(long, 1);
-                *secs = *(long *)tval;
-                g_hash_table_insert(full->titles, g_strdup(tkey), secs);
+            for (const TitleStat *t = app->titles; t; t = t->next) {
+                StatKey key = {NULL, {t->title}, {strlen(t->title)}};
+                *day_stats_title_seconds(filtered, full, &key) = t->total_seconds;
             }
-            g_ptr_array_add(filtered->apps, full);
         }
     }
 
-    g_ptr_array_sort(filtered->apps, compare_app_stat_desc);
+    day_stats_sort(filtered);
     g_regex_unref(regex);
     return filtered;
 }
 
-typedef struct {
-    const gchar *title;
-    long total_seconds;
-} TitleEntry;
-
-static gint compare_title_entry_desc(gconstpointer a, gconstpointer b)
+static gint compare_title_stat_desc(gconstpointer a, gconstpointer b)
 {
-    const TitleEntry *ta = a;
-    const TitleEntry *tb = b;
+    const TitleStat *ta = *(const TitleStat **)a;
+    const TitleStat *tb = *(const TitleStat **)b;
     if (tb->total_seconds > ta->total_seconds) return 1;
     if (tb->total_seconds < ta->total_seconds) return -1;
-    return 0;
+    return strcmp(ta->title, tb->title);
 }
 
 #define DEFAULT_COLS 80
@@ -609,6 +1855,14 @@ static int utf8_field_width(const gchar *str, int desired_columns)
 void print_stats_report(FILE *out, const DayStats *stats,
                         int year, int month, int day,
                         const StatsOptions *opts)
+{
+    gchar period[16];
+    g_snprintf(period, sizeof(period), "%04d-%02d-%02d", year, month, day);
+    print_period_report(out, stats, period, opts);
+}
+
+void print_period_report(FILE *out, const DayStats *stats,
+                         const gchar *period, const StatsOptions *opts)
 {
     int top_apps = opts ? opts->top_apps : 20;
     int top_titles = opts ? opts->top_titles : 5;
@@ -619,7 +1873,7 @@ void print_stats_report(FILE *out, const DayStats *stats,
                   + stats->total_afk_active_seconds;
     gchar *total_dur = format_duration(total);
     gchar *active_dur = format_duration(stats->total_active_seconds);
-    fprintf(out, "Activity Report for %04d-%02d-%02d\n", year, month, day);
+    fprintf(out, "Activity Report for %s\n", period);
     fprintf(out, "Total tracked: %s (active: %s)\n\n", total_dur, active_dur);
     g_free(total_dur);
     g_free(active_dur);
@@ -636,22 +1890,17 @@ void print_stats_report(FILE *out, const DayStats *stats,
         g_free(dur);
 
         /* Collect and sort titles */
-        GArray *titles = g_array_new(FALSE, FALSE, sizeof(TitleEntry));
-        GHashTableIter titer;
-        gpointer tkey, tval;
-        g_hash_table_iter_init(&titer, app->titles);
-        while (g_hash_table_iter_next(&titer, &tkey, &tval)) {
-            TitleEntry te = { .title = tkey, .total_seconds = *(long *)tval };
-            g_array_append_val(titles, te);
-        }
-        g_array_sort(titles, compare_title_entry_desc);
+        GPtrArray *titles = g_ptr_array_sized_new(app->n_titles);
+        for (TitleStat *t = app->titles; t; t = t->next)
+            g_ptr_array_add(titles, t);
+        g_ptr_array_sort(titles, compare_title_stat_desc);
 
         guint title_count = titles->len;
         guint title_display = (guint)MIN((int)title_count, top_titles);
         long other_title_seconds = 0;
 
         for (guint j = 0; j < title_count; j++) {
-            TitleEntry *te = &g_array_index(titles, TitleEntry, j);
+            const TitleStat *te = g_ptr_array_index(titles, j);
             if (j < title_display) {
                 gchar *td = format_duration(te->total_seconds);
                 gchar *trunc = truncate_label(te->title, label_width - 7);
@@ -675,7 +1924,7 @@ void print_stats_report(FILE *out, const DayStats *stats,
         }
 
         fprintf(out, "\n");
-        g_array_free(titles, TRUE);
+        g_ptr_array_free(titles, TRUE);
     }
 
     if ((int)app_count > top_apps) {
@@ -705,12 +1954,78 @@ void free_day_stats(DayStats *stats)
 {
     if (!stats)
         return;
-    for (guint i = 0; i < stats->apps->len; i++) {
-        AppStat *app = g_ptr_array_index(stats->apps, i);
-        g_free(app->wm_class);
-        g_hash_table_destroy(app->titles);
-        g_free(app);
+    while (stats->arena) {
+        StatsArena *next = stats->arena->next;
+        g_free(stats->arena);
+        stats->arena = next;
     }
+    string_table_clear(&stats->index);
     g_ptr_array_free(stats->apps, TRUE);
     g_free(stats);
 }
+
+/* ── Latency histogram ───────────────────────────────────── */
+
+int latency_histogram_bucket(gint64 usec)
+{
+    gint64 ms = usec / 1000;
+    int bucket = 0;
+    while (ms > 0 && bucket < LATENCY_BUCKETS - 1) {
+        ms >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void latency_histogram_add(LatencyHistogram *hist, gint64 usec)
+{
+    if (usec < 0)
+        usec = 0;
+    hist->buckets[latency_histogram_bucket(usec)]++;
+    hist->count++;
+    hist->total_usec += usec;
+    if (usec > hist->max_usec)
+        hist->max_usec = usec;
+}
+
+void print_latency_histogram(FILE *out, const gchar *label,
+                             const LatencyHistogram *hist)
+{
+    if (hist->count == 0) {
+        fprintf(out, "%s: no samples\n", label);
+        return;
+    }
+
+    fprintf(out, "%s: %" G_GUINT64_FORMAT " samples, avg %.2f ms, max %.2f ms\n",
+            label, hist->count,
+            (double)hist->total_usec / hist->count / 1000.0,
+            (double)hist->max_usec / 1000.0);
+
+    int first = 0, last = LATENCY_BUCKETS - 1;
+    guint64 peak = 0;
+    while (hist->buckets[first] == 0)
+        first++;
+    while (hist->buckets[last] == 0)
+        last--;
+    for (int i = first; i <= last; i++)
+        if (hist->buckets[i] > peak)
+            peak = hist->buckets[i];
+
+    for (int i = first; i <= last; i++) {
+        char range[32];
+        if (i == 0)
+            snprintf(range, sizeof(range), "<1 ms");
+        else if (i == LATENCY_BUCKETS - 1)
+            snprintf(range, sizeof(range), ">=%d ms", 1 << (i - 1));
+        else
+            snprintf(range, sizeof(range), "%d-%d ms", 1 << (i - 1), (1 << i) - 1);
+
+        int bar = (int)(hist->buckets[i] * 40 / peak);
+        if (bar == 0 && hist->buckets[i] > 0)
+            bar = 1;
+        fprintf(out, "  %12s %10" G_GUINT64_FORMAT " ", range, hist->buckets[i]);
+        for (int j = 0; j < bar; j++)
+            fputc('#', out);
+        fputc('\n', out);
+    }
+}
@@ -4,6 +4,53 @@
 #include <gio/gio.h>
 #include <stdio.h>
 #include <time.h>
+#include "string-table.h"
+
+/* When CSV records are fsynced.  Records are always flushed to the kernel
+ * right away; the mode only decides how much a power loss can take. */
+typedef enum {
+    DURABILITY_STRICT,    /* fsync after every record */
+    DURABILITY_INTERVAL,  /* fsync every sync_interval s or sync_records records */
+    DURABILITY_ROTATION,  /* fsync only on day rotation and shutdown */
+} DurabilityMode;
+
+/* Format of the daily output file */
+typedef enum {
+    OUTPUT_CSV,           /* YYYY-MM-DD.csv */
+    OUTPUT_BINARY,        /* YYYY-MM-DD.atlog, see binary-log.h */
+} OutputFormat;
+
+#define CSV_HEADER \
+    "timestamp,duration_seconds,status,window_title,wm_class,wm_class_instance,rp_state,rp_details\n"
+
+/* A finished interval, ready to be written as one CSV line */
+typedef struct {
+    time_t wall;                   /* start, wall clock */
+    long duration;                 /* seconds */
+    const gchar *status;           /* "active", "idle" or "locked" (static) */
+    const gchar *title;
+    const gchar *wm_class;
+    const gchar *wm_class_instance;
+    const gchar *rp_state;
+    const gchar *rp_details;
+} CsvRecord;
+
+/* Receives finished intervals instead of them being written inline.
+ * rec and its strings are only valid for the duration of the call. */
+typedef void (*CsvRecordSink)(const CsvRecord *rec, gpointer user_data);
+
+/* Told that start_tracking() has set a new interval in the state */
+typedef void (*TrackingChangedFunc)(gpointer user_data);
+
+/* Local "YYYY-MM-DDTHH:MM:" of the last formatted minute.  Time zone
+ * offsets and DST changes are whole minutes, so within a minute only the
+ * seconds differ and localtime_r() can be skipped. */
+typedef struct {
+    gboolean valid;
+    gint64 minute;        /* wall time / 60 */
+    char prefix[32];
+    gsize prefix_len;
+} TimestampCache;
 
 typedef struct {
     GMainLoop *loop;
@@ -18,7 +65,7 @@ typedef struct {
     gboolean is_locked;
     GDBusProxy *idle_proxy; /* Proxy to org.gnome.Mutter.IdleMonitor */
     gboolean is_idle;       /* TRUE when user is idle */
-    FILE *output_fp;        /* current output file handle */
+    int output_fd;          /* O_APPEND descriptor, valid while file_day != 0 */
     int file_year;          /* year of open file */
     int file_month;         /* month (1-12) of open file */
     int file_day;           /* day (1-31) of open file */
@@ -26,6 +73,22 @@ typedef struct {
     gchar *current_rp_state;   /* Discord rich presence state */
     gchar *current_rp_details; /* Discord rich presence details */
     pid_t current_pid;         /* PID of current focused window */
+    DurabilityMode durability; /* fsync policy for output_fd */
+    int sync_interval;         /* DURABILITY_INTERVAL: seconds, 0 = unused */
+    int sync_records;          /* DURABILITY_INTERVAL: records, 0 = unused */
+    int unsynced_records;      /* records written since the last fsync */
+    gint64 last_sync;          /* monotonic time of the last fsync */
+    guint64 sync_count;        /* fsyncs issued on output files */
+    CsvRecordSink record_sink; /* NULL = write to output_fd directly */
+    gpointer record_sink_data;
+    TrackingChangedFunc tracking_changed; /* NULL = nobody to tell */
+    gpointer tracking_changed_data;
+    OutputFormat output_format;
+    struct _BinlogWriter *binlog; /* OUTPUT_BINARY: dictionary of the open file */
+    gboolean compress_closed;  /* gzip a CSV day file once rotated away from */
+    GThread *compress_thread;  /* compressing the previous day, joined on close */
+    GString *line_buf;         /* reused for every record, freed on close */
+    TimestampCache ts_cache;
 } AppState;
 
 typedef struct {
@@ -36,34 +99,86 @@ typedef struct {
 } FocusedWindowInfo;
 
 void format_iso8601(time_t t, char *buf, size_t len);
+gsize format_iso8601_cached(TimestampCache *cache, time_t t, char *buf);
 void csv_escape_to_buffer(GString *buf, const char *field);
 void csv_escape_and_print(const char *field);
+/* The interval tracked in state, as a record ending at now.  FALSE when
+ * there is nothing to record or it lasted less than a second. */
+gboolean fill_csv_record(const AppState *state, gint64 now, CsvRecord *rec);
 void emit_csv_to_buffer(GString *buf, AppState *state, gint64 now);
 void emit_csv_line(AppState *state);
+/* emit_csv_line() for an interval that ended at monotonic time now */
+void emit_csv_line_at(AppState *state, gint64 now);
+void serialize_csv_record(GString *buf, const CsvRecord *rec,
+                          TimestampCache *cache);
+void write_csv_record(AppState *state, const CsvRecord *rec);
 void start_tracking(AppState *state, const gchar *title,
                     const gchar *wm_class, const gchar *wm_class_instance,
                     const gchar *rp_state, const gchar *rp_details,
                     pid_t pid, gboolean locked);
+/* A new interval in the window being tracked, with other rich presence,
+ * that began at monotonic time start.  FALSE, changing nothing, when start
+ * is before the current interval began. */
+gboolean start_presence_interval(AppState *state, gint64 start,
+                                 const gchar *rp_state, const gchar *rp_details);
+/* pid's rich presence changed at monotonic time changed.  Ends the current
+ * interval then and starts one with the new presence when pid is the
+ * window tracked, the presence differs and the change is not older than
+ * the current interval.  TRUE when it did. */
+gboolean track_presence_change(AppState *state, pid_t pid,
+                               const gchar *rp_state, const gchar *rp_details,
+                               gint64 changed);
 FocusedWindowInfo parse_focused_window(const gchar *json);
 void free_focused_window_info(FocusedWindowInfo *info);
+guint64 reply_hash(const gchar *data, gsize len);
 
 gboolean ensure_output_file(AppState *state, time_t wall_time);
 void close_output_file(AppState *state);
+void sync_output_file(AppState *state);
+gboolean output_sync_due(const AppState *state, gint64 now);
+gboolean parse_durability_mode(const gchar *str, DurabilityMode *mode);
+gboolean parse_output_format(const gchar *str, OutputFormat *format);
+goffset recover_torn_tail(const gchar *path);
+/* Reports map day files, and a mapping whose file is cut short by a page
+ * faults with SIGBUS instead of reading less.  So a day file is only
+ * shortened under an exclusive flock, which waits for reports holding the
+ * shared one. */
+gboolean truncate_day_file(int fd, goffset size);
+/* path opened for reading with that shared lock, held until it is closed;
+ * -1 with errno set on failure */
+int open_day_file_locked(const gchar *path);
 void csv_escape_and_print_fp(FILE *fp, const char *field);
 
 /* ── Statistics ──────────────────────────────────────────── */
 
+typedef struct TitleStat TitleStat;
+
+struct TitleStat {
+    const gchar *title;   /* rich presence if any, else the window title */
+    long total_seconds;
+    TitleStat *next;      /* the app's other titles, in no particular order */
+};
+
 typedef struct {
-    gchar *wm_class;
+    const gchar *wm_class;
     long total_seconds;
-    GHashTable *titles; /* gchar* -> long* (title -> cumulative seconds) */
+    guint n_titles;
+    TitleStat *titles;
 } AppStat;
 
+typedef struct StatsArena StatsArena;
+
 typedef struct {
     long total_active_seconds;
     long total_locked_seconds;
     long total_afk_active_seconds; /* active status but empty title + empty RP */
     GPtrArray *apps; /* AppStat*, sorted descending by total_seconds */
+
+    /* Apps and titles with their strings live in the arena, freed in one
+     * go, and are found through index; counting a record allocates only
+     * for an app or title not seen before */
+    StatsArena *arena;
+    StringTable index;
 } DayStats;
 
 typedef struct {
@@ -75,18 +190,73 @@ typedef struct {
 
 gchar *build_csv_path(const gchar *data_dir_override,
                       int year, int month, int day);
+gchar *build_binlog_path(const gchar *data_dir_override,
+                         int year, int month, int day);
+/* $XDG_RUNTIME_DIR/name, or /run/user/UID/name when it is not set */
+gchar *build_runtime_path(const gchar *name);
 gchar *format_duration(long seconds);
 gboolean parse_csv_line(const gchar *line,
                         gchar **timestamp, long *duration,
                         gchar **status, gchar **window_title,
                         gchar **wm_class, gchar **wm_class_instance,
                         gchar **rp_state, gchar **rp_details);
+DayStats *day_stats_new(void);
+/* Counts seconds for title of wm_class */
+void day_stats_add_title(DayStats *stats, const gchar *wm_class,
+                         const gchar *title, long seconds);
+/* Counts rec as it will be counted once read back from the day file */
+void day_stats_add_record(DayStats *stats, const CsvRecord *rec);
+/* Puts apps back in report order after day_stats_add_title() or
+ * day_stats_add_record() */
+void day_stats_sort(DayStats *stats);
+/* NULL when app has no such title */
+TitleStat *app_stat_find_title(const AppStat *app, const gchar *title);
+/* Reads a CSV, a gzipped CSV (by its .gz suffix) or a binary log (by its
+ * magic) */
 DayStats *compute_day_stats(const gchar *csv_path);
+/* compute_day_stats() splitting a large CSV between up to max_threads
+ * threads, 0 for one per processor */
+DayStats *compute_day_stats_threaded(const gchar *csv_path, guint max_threads);
+/* Smallest piece of CSV worth a thread of its own */
+#define CSV_STATS_MIN_CHUNK (1 << 20)
+/* Statistics of CSV data in memory, split at record boundaries into pieces
+ * of at least min_chunk bytes counted in parallel.  The result does not
+ * depend on the split.  parsed, if not NULL, is set to where the last
+ * complete record ends. */
+DayStats *compute_csv_stats(const gchar *data, gsize len, guint max_threads,
+                            gsize min_chunk, gsize *parsed);
+/* All day files of one date, NULL when there are none (found is FALSE) or
+ * one cannot be read (found is TRUE).  With a cache_dir, a plain CSV is
+ * read through the stats cache there. */
+DayStats *load_day_stats(const gchar *data_dir, int year, int month, int day,
+                         guint max_threads, const gchar *cache_dir,
+                         gboolean *found);
+void merge_day_stats(DayStats *dst, const DayStats *src);
 DayStats *filter_stats_by_grep(const DayStats *stats, const gchar *pattern,
                                GError **error);
 void print_stats_report(FILE *out, const DayStats *stats,
                         int year, int month, int day,
                         const StatsOptions *opts);
+/* print_stats_report() with the date replaced by free text */
+void print_period_report(FILE *out, const DayStats *stats,
+                         const gchar *period, const StatsOptions *opts);
 void free_day_stats(DayStats *stats);
 
+/* ── Latency histogram ───────────────────────────────────── */
+
+/* Bucket 0 is <1ms, bucket i covers [2^(i-1), 2^i) ms, the last is open. */
+#define LATENCY_BUCKETS 14
+
+typedef struct {
+    guint64 buckets[LATENCY_BUCKETS];
+    guint64 count;
+    gint64 total_usec;
+    gint64 max_usec;
+} LatencyHistogram;
+
+int latency_histogram_bucket(gint64 usec);
+void latency_histogram_add(LatencyHistogram *hist, gint64 usec);
+void print_latency_histogram(FILE *out, const gchar *label,
+                             const LatencyHistogram *hist);
+
 #endif /* TRACKER_CORE_H */